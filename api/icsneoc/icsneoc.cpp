@@ -9,23 +9,57 @@
 #include "icsneo/platform/dynamiclib.h"
 #include "icsneo/api/eventmanager.h"
 #include "icsneo/device/devicefinder.h"
+#include "icsneo/api/handletable.h"
+#include "icsneo/api/neodevicelookup.h"
 #include <string>
 #include <functional>
 #include <vector>
 #include <memory>
 #include <algorithm>
 #include <cstring>
-#include <map>
+#include <atomic>
 
 using namespace icsneo;
 
-// Holds references for the shared_ptrs so they do not get freed until we're ready
-static std::vector<std::shared_ptr<Device>> connectableFoundDevices, connectedDevices;
+// What we hold on behalf of each neodevice_t handed out, so it does not get freed until we're ready
+struct CDevice {
+	CDevice(std::shared_ptr<Device> device) : device(std::move(device)) {}
 
-// We store an array of shared_ptr messages per device, this is the owner of the shared_ptr on behalf of the C interface
-static std::map<devicehandle_t, std::vector<std::shared_ptr<Message>>> polledMessageStorage;
+	const std::shared_ptr<Device> device;
+	std::atomic<bool> connected{false}; // Otherwise it's freed by the next search
+	std::vector<std::shared_ptr<Message>> polledMessages; // The owner of the shared_ptrs for the last icsneo_getMessages()
+};
 
-void icsneo_findAllDevices(neodevice_t* devices, size_t* count) {
+// Each neodevice_t handed out holds a handle into this table, rather than a pointer to the Device
+static HandleTable<CDevice> devices;
+
+static HandleTable<CDevice>::Handle HandleOf(const neodevice_t* device) {
+	return reinterpret_cast<HandleTable<CDevice>::Handle>(device->device);
+}
+
+// An empty Ref, with an event flagged, if the neodevice_t is not valid
+static HandleTable<CDevice>::Ref ResolveNeoDevice(const neodevice_t* device) {
+	if(!device) {
+		EventManager::GetInstance().add(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
+		return {};
+	}
+	// If this neodevice_t was returned by a previous search, it will no longer be valid (as the underlying icsneo::Device is freed)
+	auto ref = devices.acquire(HandleOf(device));
+	if(!ref)
+		EventManager::GetInstance().add(APIEvent::Type::InvalidNeoDevice, APIEvent::Severity::Error);
+	return ref;
+}
+
+namespace icsneo {
+
+std::shared_ptr<Device> DeviceFromNeoDevice(const neodevice_t* device) {
+	auto ref = ResolveNeoDevice(device);
+	return ref ? ref->device : nullptr;
+}
+
+}
+
+void icsneo_findAllDevices(neodevice_t* neodevices, size_t* count) {
 	std::vector<std::shared_ptr<Device>> foundDevices = icsneo::FindAllDevices();
 	
 	if(count == nullptr) {
@@ -33,7 +67,7 @@ void icsneo_findAllDevices(neodevice_t* devices, size_t* count) {
 		return;
 	}
 
-	if(devices == nullptr) {
+	if(neodevices == nullptr) {
 		*count = foundDevices.size();
 		return;
 	}
@@ -49,13 +83,19 @@ void icsneo_findAllDevices(neodevice_t* devices, size_t* count) {
 	}
 
 	for(size_t i = 0; i < outputSize; i++) {
-		connectableFoundDevices.push_back(foundDevices[i]);
-		devices[i] = foundDevices[i]->getNeoDevice();
+		const auto handle = devices.add(foundDevices[i]);
+		if(!handle) {
+			EventManager::GetInstance().add(APIEvent::Type::OutputTruncated, APIEvent::Severity::EventWarning);
+			*count = i;
+			return;
+		}
+		neodevices[i] = foundDevices[i]->getNeoDevice();
+		neodevices[i].device = reinterpret_cast<devicehandle_t>(handle);
 	}
 }
 
 void icsneo_freeUnconnectedDevices() {
-	connectableFoundDevices.clear();
+	devices.removeIf([](const CDevice& dev) { return !dev.connected; });
 }
 
 bool icsneo_serialNumToString(uint32_t num, char* str, size_t* count) {
@@ -91,116 +131,96 @@ uint32_t icsneo_serialStringToNum(const char* str) {
 }
 
 bool icsneo_isValidNeoDevice(const neodevice_t* device) {
-	// return false on nullptr
-	if(!device) {
-		EventManager::GetInstance().add(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
-		return false;
-	}
-	// If this neodevice_t was returned by a previous search, it will no longer be valid (as the underlying icsneo::Device is freed)
-	for(auto& dev : connectedDevices) {
-		if(dev.get() == device->device)
-			return true;
-	}
-	for(auto& dev : connectableFoundDevices) {
-		if(dev.get() == device->device)
-			return true;
-	}
-
-	EventManager::GetInstance().add(APIEvent::Type::InvalidNeoDevice, APIEvent::Severity::Error);
-	return false;
+	return bool(ResolveNeoDevice(device));
 }
 
 bool icsneo_openDevice(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	if(!device->device->open())
+	if(!dev->device->open())
 		return false;
 
-	// We connected successfully, move the device to connected devices
-	std::vector<std::vector<std::shared_ptr<Device>>::iterator> itemsToMove;
-	for(auto it = connectableFoundDevices.begin(); it < connectableFoundDevices.end(); it++) {
-		if((*it).get() == device->device)
-			itemsToMove.push_back(it);
-	}
-	for(auto it : itemsToMove) {
-		connectedDevices.push_back(*it);
-		connectableFoundDevices.erase(it);
-	}
-
+	// We connected successfully, keep the device past the next search
+	dev->connected = true;
 	return true;
 }
 
 bool icsneo_closeDevice(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
-		return false;
-	
-	if(!device->device->close())
-		return false;
+	{
+		auto dev = ResolveNeoDevice(device);
+		if(!dev)
+			return false;
 
-	// We disconnected successfully, free the device
-	std::vector<std::vector<std::shared_ptr<Device>>::iterator> itemsToDelete;
-	for(auto it = connectedDevices.begin(); it < connectedDevices.end(); it++) {
-		if((*it).get() == device->device)
-			itemsToDelete.push_back(it);
+		if(!dev->device->close())
+			return false;
 	}
-	for(auto it : itemsToDelete)
-		connectedDevices.erase(it);
 
+	// We disconnected successfully, free the device once nobody else is using it
+	devices.remove(HandleOf(device));
 	return true;
 }
 
 bool icsneo_isOpen(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->isOpen();
+	return dev->device->isOpen();
 }
 
 bool icsneo_goOnline(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->goOnline();
+	return dev->device->goOnline();
 }
 
 bool icsneo_goOffline(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->goOffline();
+	return dev->device->goOffline();
 }
 
 bool icsneo_isOnline(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->isOnline();
+	return dev->device->isOnline();
 }
 
 bool icsneo_enableMessagePolling(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->enableMessagePolling();
+	return dev->device->enableMessagePolling();
 }
 
 bool icsneo_disableMessagePolling(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->disableMessagePolling();
+	return dev->device->disableMessagePolling();
 }
 
 bool icsneo_isMessagePollingEnabled(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 	
-	return device->device->isMessagePollingEnabled();
+	return dev->device->isMessagePollingEnabled();
 }
 
 bool icsneo_getMessages(const neodevice_t* device, neomessage_t* messages, size_t* items, uint64_t timeout) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(items == nullptr) {
@@ -210,13 +230,13 @@ bool icsneo_getMessages(const neodevice_t* device, neomessage_t* messages, size_
 
 	if(messages == nullptr) {
 		// A NULL value for messages means the user wants the current size of the buffer into items
-		*items = device->device->getCurrentMessageCount();
+		*items = dev->device->getCurrentMessageCount();
 		return true;
 	}
 
-	std::vector<std::shared_ptr<Message>>& storage = polledMessageStorage[device->device];
+	std::vector<std::shared_ptr<Message>>& storage = dev->polledMessages;
 
-	if(!device->device->getMessages(storage, *items, std::chrono::milliseconds(timeout)))
+	if(!dev->device->getMessages(storage, *items, std::chrono::milliseconds(timeout)))
 		return false;
 
 	*items = storage.size();
@@ -232,25 +252,81 @@ bool icsneo_getMessages(const neodevice_t* device, neomessage_t* messages, size_
 }
 
 int icsneo_getPollingMessageLimit(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return -1;
 
-	return (int)device->device->getPollingMessageLimit();
+	return (int)dev->device->getPollingMessageLimit();
 }
 
 bool icsneo_setPollingMessageLimit(const neodevice_t* device, size_t newLimit) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	device->device->setPollingMessageLimit(newLimit);
+	dev->device->setPollingMessageLimit(newLimit);
+	return true;
+}
+
+bool icsneo_enableMessageRing(const neodevice_t* device, size_t messageCapacity, size_t payloadCapacity) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return false;
+
+	return dev->device->enableNeoMessageRing(messageCapacity, payloadCapacity);
+}
+
+bool icsneo_disableMessageRing(const neodevice_t* device) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return false;
+
+	return dev->device->disableNeoMessageRing();
+}
+
+bool icsneo_readMessageRing(const neodevice_t* device, const neomessage_t** messages, size_t* count) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return false;
+
+	if(messages == nullptr || count == nullptr) {
+		EventManager::GetInstance().add(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
+		return false;
+	}
+
+	const auto ring = dev->device->getNeoMessageRing(); // Kept for the whole call, in case the ring is disabled meanwhile
+	if(!ring) {
+		EventManager::GetInstance().add(APIEvent::Type::DeviceNotCurrentlyPolling, APIEvent::Severity::Error);
+		return false;
+	}
+
+	*messages = ring->read(*count);
+	if(ring->takeNewlyDropped() != 0)
+		EventManager::GetInstance().add(APIEvent::Type::PollingMessageOverflow, APIEvent::Severity::EventWarning);
+	return true;
+}
+
+bool icsneo_commitMessageRing(const neodevice_t* device, size_t count) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return false;
+
+	const auto ring = dev->device->getNeoMessageRing();
+	if(!ring) {
+		EventManager::GetInstance().add(APIEvent::Type::DeviceNotCurrentlyPolling, APIEvent::Severity::Error);
+		return false;
+	}
+
+	ring->commit(count);
 	return true;
 }
 
 int icsneo_addMessageCallback(const neodevice_t* device, void (*callback)(neomessage_t), void*) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return -1;
 
-	return device->device->addMessageCallback(
+	return dev->device->addMessageCallback(
 		std::make_shared<MessageCallback>(
 			[=](std::shared_ptr<icsneo::Message> msg) {
 				return callback(CreateNeoMessage(msg));
@@ -260,15 +336,42 @@ int icsneo_addMessageCallback(const neodevice_t* device, void (*callback)(neomes
 }
 
 bool icsneo_removeMessageCallback(const neodevice_t* device, int id) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
-	return device->device->removeMessageCallback(id);
+	return dev->device->removeMessageCallback(id);
+}
+
+int icsneo_addBatchMessageCallback(const neodevice_t* device, void (*callback)(const neomessage_t* messages, size_t count), void*) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return -1;
+
+	return dev->device->addMessageBatchCallback(
+		std::make_shared<MessageBatchCallback>(
+			// Calls for one callback never overlap, so the same buffer is used for every batch
+			[=, messages = std::vector<neomessage_t>()](const std::vector<std::shared_ptr<icsneo::Message>>& batch) mutable {
+				messages.clear();
+				for(const auto& msg : batch)
+					messages.push_back(CreateNeoMessage(msg));
+				callback(messages.data(), messages.size());
+			}
+		)
+	);
+}
+
+bool icsneo_removeBatchMessageCallback(const neodevice_t* device, int id) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return false;
+	return dev->device->removeMessageBatchCallback(id);
 }
 
 neonetid_t icsneo_getNetworkByNumber(const neodevice_t* device, neonettype_t type, unsigned int number) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
-	return neonetid_t(device->device->getNetworkByNumber(icsneo::Network::Type(type), size_t(number)).getNetID());
+	return neonetid_t(dev->device->getNetworkByNumber(icsneo::Network::Type(type), size_t(number)).getNetID());
 }
 
 bool icsneo_getProductName(const neodevice_t* device, char* str, size_t* maxLength) {
@@ -278,10 +381,11 @@ bool icsneo_getProductName(const neodevice_t* device, char* str, size_t* maxLeng
 		return false;
 	}
 
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	std::string output = device->device->getProductName();
+	std::string output = dev->device->getProductName();
 
 	if(str == nullptr) {
 		*maxLength = output.length();
@@ -321,45 +425,51 @@ bool icsneo_getProductNameForType(devicetype_t type, char* str, size_t* maxLengt
 }
 
 bool icsneo_settingsRefresh(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->refresh();
+	return dev->device->settings->refresh();
 }
 
 bool icsneo_settingsApply(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->apply();
+	return dev->device->settings->apply();
 }
 
 bool icsneo_settingsApplyTemporary(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->apply(true);
+	return dev->device->settings->apply(true);
 }
 
 bool icsneo_settingsApplyDefaults(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->applyDefaults();
+	return dev->device->settings->applyDefaults();
 }
 
 bool icsneo_settingsApplyDefaultsTemporary(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->applyDefaults(true);
+	return dev->device->settings->applyDefaults(true);
 }
 
 int icsneo_settingsReadStructure(const neodevice_t* device, void* structure, size_t structureSize) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return -1;
 
-	size_t readSize = device->device->settings->getSize();
+	size_t readSize = dev->device->settings->getSize();
 	if(structure == nullptr) // Structure size request
 		return (int)readSize;
 	if(readSize > structureSize) {
@@ -369,7 +479,7 @@ int icsneo_settingsReadStructure(const neodevice_t* device, void* structure, siz
 		readSize = structureSize;
 	}
 
-	const void* deviceStructure = device->device->settings->getRawStructurePointer();
+	const void* deviceStructure = dev->device->settings->getRawStructurePointer();
 	if(deviceStructure == nullptr) {
 		EventManager::GetInstance().add(APIEvent::Type::SettingsNotAvailable, APIEvent::Severity::Error);
 		return -1;
@@ -385,7 +495,8 @@ int icsneo_settingsReadStructure(const neodevice_t* device, void* structure, siz
 
 // Not exported
 static bool icsneo_settingsWriteStructure(const neodevice_t* device, const void* structure, size_t structureSize) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(structure == nullptr) {
@@ -393,13 +504,13 @@ static bool icsneo_settingsWriteStructure(const neodevice_t* device, const void*
 		return false;
 	}
 
-	size_t writeSize = device->device->settings->getSize();
+	size_t writeSize = dev->device->settings->getSize();
 	if(writeSize < structureSize) {
 		EventManager::GetInstance().add(APIEvent::Type::OutputTruncated, APIEvent::Severity::EventWarning);
 		structureSize = writeSize;
 	}
 
-	void* deviceStructure = device->device->settings->getMutableRawStructurePointer();
+	void* deviceStructure = dev->device->settings->getMutableRawStructurePointer();
 	if(deviceStructure == nullptr) {
 		EventManager::GetInstance().add(APIEvent::Type::SettingsNotAvailable, APIEvent::Severity::Error);
 		return false;
@@ -422,58 +533,75 @@ bool icsneo_settingsApplyStructureTemporary(const neodevice_t* device, const voi
 }
 
 int64_t icsneo_getBaudrate(const neodevice_t* device, neonetid_t netid) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return -1;
 
-	return device->device->settings->getBaudrateFor(netid);
+	return dev->device->settings->getBaudrateFor(netid);
 }
 
 bool icsneo_setBaudrate(const neodevice_t* device, neonetid_t netid, int64_t newBaudrate) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->setBaudrateFor(netid, newBaudrate);
+	return dev->device->settings->setBaudrateFor(netid, newBaudrate);
 }
 
 int64_t icsneo_getFDBaudrate(const neodevice_t* device, neonetid_t netid) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return -1;
 
-	return device->device->settings->getFDBaudrateFor(netid);
+	return dev->device->settings->getFDBaudrateFor(netid);
 }
 
 bool icsneo_setFDBaudrate(const neodevice_t* device, neonetid_t netid, int64_t newBaudrate) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->setFDBaudrateFor(netid, newBaudrate);
+	return dev->device->settings->setFDBaudrateFor(netid, newBaudrate);
 }
 
 bool icsneo_transmit(const neodevice_t* device, const neomessage_t* message) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(auto frame = std::dynamic_pointer_cast<icsneo::Frame>(CreateMessageFromNeoMessage(message)))
-		return device->device->transmit(frame);
+		return dev->device->transmit(frame);
 
 	return false;
 }
 
 bool icsneo_transmitMessages(const neodevice_t* device, const neomessage_t* messages, size_t count) {
-	// Transmit implements neodevice_t check so it is not needed here
-	// TODO This can be implemented faster
+	return icsneo_transmitBatch(device, messages, count) == count;
+}
+
+size_t icsneo_transmitBatch(const neodevice_t* device, const neomessage_t* messages, size_t count) {
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
+		return 0;
+
+	std::vector<std::shared_ptr<icsneo::Frame>> frames;
+	frames.reserve(count);
 	for(size_t i = 0; i < count; i++) {
-		if(!icsneo_transmit(device, messages + i))
-			return false;
+		auto frame = std::dynamic_pointer_cast<icsneo::Frame>(CreateMessageFromNeoMessage(messages + i));
+		if(!frame)
+			break; // Only what comes before it is sent, same as if it had failed to transmit
+		frames.push_back(std::move(frame));
 	}
-	return true;
+
+	return dev->device->transmitBatch(frames);
 }
 
 void icsneo_setWriteBlocks(const neodevice_t* device, bool blocks) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return;
 	
-	device->device->setWriteBlocks(blocks);
+	dev->device->setWriteBlocks(blocks);
 }
 
 bool icsneo_describeDevice(const neodevice_t* device, char* str, size_t* maxLength) {
@@ -483,15 +611,16 @@ bool icsneo_describeDevice(const neodevice_t* device, char* str, size_t* maxLeng
 		return false;
 	}
 
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(!str) {
-		*maxLength = device->device->describe().length();
+		*maxLength = dev->device->describe().length();
 		return false;
 	}
 
-	std::string output = device->device->describe();
+	std::string output = dev->device->describe();
 
 	*maxLength = output.copy(str, *maxLength);
 	str[*maxLength] = '\0';
@@ -540,7 +669,8 @@ bool icsneo_getEvents(neoevent_t* events, size_t* size) {
 }
 
 bool icsneo_getDeviceEvents(const neodevice_t* device, neoevent_t* events, size_t* size) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(size == nullptr) {
@@ -549,7 +679,7 @@ bool icsneo_getDeviceEvents(const neodevice_t* device, neoevent_t* events, size_
 	}
 
 	// Creating the filter will nullptr is okay! It will find any events not associated with a device.
-	EventFilter filter = (device != nullptr ? device->device : nullptr);
+	EventFilter filter = (device != nullptr ? dev->device.get() : nullptr);
 
 	if(events == nullptr) {
 		*size = icsneo::EventCount(filter);
@@ -582,13 +712,14 @@ void icsneo_discardAllEvents(void) {
 }
 
 void icsneo_discardDeviceEvents(const neodevice_t* device) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return;
 
 	if(device == nullptr)
 		icsneo::DiscardEvents(nullptr); // Discard events not associated with a device
 	else
-		icsneo::DiscardEvents(device->device);
+		icsneo::DiscardEvents(dev->device.get());
 }
 
 void icsneo_setEventLimit(size_t newLimit) {
@@ -626,7 +757,8 @@ bool icsneo_getSupportedDevices(devicetype_t* devices, size_t* count) {
 }
 
 bool icsneo_getTimestampResolution(const neodevice_t* device, uint16_t* resolution) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(resolution == nullptr) {
@@ -634,12 +766,13 @@ bool icsneo_getTimestampResolution(const neodevice_t* device, uint16_t* resoluti
 		return false;
 	}
 
-	*resolution = device->device->getTimestampResolution();
+	*resolution = dev->device->getTimestampResolution();
 	return true;
 }
 
 bool icsneo_getDigitalIO(const neodevice_t* device, neoio_t type, uint32_t number, bool* value) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(value == nullptr) {
@@ -647,7 +780,7 @@ bool icsneo_getDigitalIO(const neodevice_t* device, neoio_t type, uint32_t numbe
 		return false;
 	}
 
-	const std::optional<bool> val = device->device->getDigitalIO(static_cast<icsneo::IO>(type), number);
+	const std::optional<bool> val = dev->device->getDigitalIO(static_cast<icsneo::IO>(type), number);
 	if(!val.has_value())
 		return false;
 
@@ -656,46 +789,52 @@ bool icsneo_getDigitalIO(const neodevice_t* device, neoio_t type, uint32_t numbe
 }
 
 bool icsneo_setDigitalIO(const neodevice_t* device, neoio_t type, uint32_t number, bool value) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->setDigitalIO(static_cast<icsneo::IO>(type), number, value);
+	return dev->device->setDigitalIO(static_cast<icsneo::IO>(type), number, value);
 }
 
 bool icsneo_isTerminationSupportedFor(const neodevice_t* device, neonetid_t netid) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->isTerminationSupportedFor(Network(netid));
+	return dev->device->settings->isTerminationSupportedFor(Network(netid));
 }
 
 bool icsneo_canTerminationBeEnabledFor(const neodevice_t* device, neonetid_t netid) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->canTerminationBeEnabledFor(Network(netid));
+	return dev->device->settings->canTerminationBeEnabledFor(Network(netid));
 }
 
 bool icsneo_isTerminationEnabledFor(const neodevice_t* device, neonetid_t netid) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->isTerminationEnabledFor(Network(netid)).value_or(false);
+	return dev->device->settings->isTerminationEnabledFor(Network(netid)).value_or(false);
 }
 
 bool icsneo_setTerminationFor(const neodevice_t* device, neonetid_t netid, bool enabled) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	return device->device->settings->setTerminationFor(Network(netid), enabled);
+	return dev->device->settings->setTerminationFor(Network(netid), enabled);
 }
 
 bool icsneo_getRTC(const neodevice_t* device, uint64_t* output)
 {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
-	const std::optional<std::chrono::time_point<std::chrono::system_clock>> rtc = device->device->getRTC();
+	const std::optional<std::chrono::time_point<std::chrono::system_clock>> rtc = dev->device->getRTC();
 	if(!rtc)
 		return false;
 
@@ -707,23 +846,25 @@ bool icsneo_getRTC(const neodevice_t* device, uint64_t* output)
 
 bool icsneo_setRTC(const neodevice_t* device, uint64_t input)
 {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	std::chrono::seconds duration(input);
 	const std::chrono::system_clock::time_point time(duration);
-	return device->device->setRTC(time);
+	return dev->device->setRTC(time);
 }
 
 int icsneo_getDeviceStatus(const neodevice_t* device, void* status, size_t* size) {
-	if(!icsneo_isValidNeoDevice(device))
+	auto dev = ResolveNeoDevice(device);
+	if(!dev)
 		return false;
 
 	if(status == nullptr || size == nullptr)
 		return false;
 	
-	std::shared_ptr<Message> msg = device->device->com->waitForMessageSync([&]() {
-		return device->device->com->sendCommand(Command::RequestStatusUpdate);
+	std::shared_ptr<Message> msg = dev->device->com->waitForMessageSync([&]() {
+		return dev->device->com->sendCommand(Command::RequestStatusUpdate);
 	}, std::make_shared<MessageFilter>(Network::NetID::DeviceStatus), std::chrono::milliseconds(100));
 
 	if(!msg) // Did not receive a message
@@ -161,6 +161,7 @@ bool EventManager::removeEventCallback(int id) {
 }
 
 bool EventManager::isDowngradingErrorsOnCurrentThread() const {
+	std::lock_guard<std::mutex> lk(downgradedThreadsMutex);
 	auto i = downgradedThreads.find(std::this_thread::get_id());
 	if(i != downgradedThreads.end()) {
 		return i->second;
@@ -12,10 +12,14 @@
 #include "icsneo/icsneoc.h"
 
 #include "icsneo/communication/network.h"
+#include "icsneolegacyextra.h"
 #include <map>
+#include <vector>
 #include <algorithm>
+#include <type_traits>
 
 #include <cstring>
+#include <cstddef>
 #include <climits>
 
 #ifdef _MSC_VER
@@ -25,8 +29,32 @@
 
 using namespace icsneo;
 
+// The original API's limit for a single icsneoGetMessages(), the caller's array is expected to hold this many
+static constexpr size_t MAX_MESSAGES = 20000;
+/**
+ * Room for the payloads of MAX_MESSAGES CAN FD frames. Larger frames, such as
+ * Ethernet, fill it before the ring is full of records, in which case the
+ * oldest are dropped to make room just the same, and reported as a
+ * PollingMessageOverflow.
+ */
+static constexpr size_t MESSAGE_RING_PAYLOAD_BYTES = 4 * 1024 * 1024;
+static_assert(MESSAGE_RING_PAYLOAD_BYTES >= MAX_MESSAGES * 64, "The message ring must hold the payloads of MAX_MESSAGES CAN FD frames");
+
+// hObject points at the neodevice_t, which comes first so we can get back to the rest
+struct LegacyDevice {
+	neodevice_t device;
+	// Payloads of the last icsneoGetMessages(), which the caller's ExtraDataPtrs point at until the next
+	std::vector<uint8_t> extraData;
+};
+static_assert(std::is_standard_layout<LegacyDevice>::value && offsetof(LegacyDevice, device) == 0, "hObject must be convertible to a LegacyDevice");
+
 typedef uint64_t legacymaphandle_t;
-static std::map<legacymaphandle_t, neodevice_t> neodevices;
+static std::map<legacymaphandle_t, LegacyDevice> neodevices;
+
+static LegacyDevice& LegacyDeviceFromHObject(void* hObject)
+{
+	return *reinterpret_cast<LegacyDevice*>(hObject);
+}
 
 static const std::map<size_t, size_t> mp_netIDToVnetOffSet = {
 	{NETID_HSCAN, 1},
@@ -65,7 +93,8 @@ static NeoDevice OldNeoDeviceFromNew(const neodevice_t* newnd)
 	return oldnd;
 }
 
-static bool NeoMessageToSpyMessage(const neodevice_t* device, const neomessage_t& newmsg, icsSpyMessage& oldmsg)
+// A timestampResolution of 0 leaves the hardware timestamp unset
+static bool NeoMessageToSpyMessage(uint16_t timestampResolution, const neomessage_t& newmsg, icsSpyMessage& oldmsg)
 {
 	memset(&oldmsg, 0, sizeof(icsSpyMessage));
 
@@ -139,8 +168,8 @@ static bool NeoMessageToSpyMessage(const neodevice_t* device, const neomessage_t
 
 	// Timestamp - epoch = 1/1/2007 - 25ns per tick most of the time
 	uint64_t t = frame.timestamp;
-	uint16_t res = 0;
-	if (icsneo_getTimestampResolution(device, &res))
+	const uint16_t res = timestampResolution;
+	if (res != 0)
 	{
 		t /= res;
 		oldmsg.TimeHardware2 = (unsigned long)(t >> 32);
@@ -393,7 +422,7 @@ int LegacyDLLExport icsneoFindNeoDevices(unsigned long DeviceTypes, NeoDevice* p
 	for (size_t i = 0; i < count; i++)
 	{
 		pNeoDevice[i] = OldNeoDeviceFromNew(&devices[i]);														  // Write out into user memory
-		neodevices[uint64_t(devices[i].handle) << 32 | icsneo_serialStringToNum(devices[i].serial)] = devices[i]; // Fill the look up table
+		neodevices[uint64_t(devices[i].handle) << 32 | icsneo_serialStringToNum(devices[i].serial)].device = devices[i]; // Fill the look up table, an open device keeps its extraData
 	}
 
 	return 1;
@@ -407,7 +436,7 @@ int LegacyDLLExport icsneoOpenNeoDevice(NeoDevice* pNeoDevice, void** hObject, u
 	neodevice_t *device;
 	try
 	{
-		device = &neodevices.at(uint64_t(pNeoDevice->Handle) << 32 | pNeoDevice->SerialNumber);
+		device = &neodevices.at(uint64_t(pNeoDevice->Handle) << 32 | pNeoDevice->SerialNumber).device;
 	}
 	catch (const std::out_of_range&)
 	{
@@ -418,7 +447,7 @@ int LegacyDLLExport icsneoOpenNeoDevice(NeoDevice* pNeoDevice, void** hObject, u
 	if (!icsneo_openDevice(device))
 		return false;
 	
-	return icsneo_setPollingMessageLimit(device, 20000) && icsneo_enableMessagePolling(device) && icsneo_goOnline(device);
+	return LegacyEnableMessageRing(device, MAX_MESSAGES, MESSAGE_RING_PAYLOAD_BYTES) && icsneo_goOnline(device);
 }
 
 int LegacyDLLExport icsneoOpenDevice(
@@ -436,7 +465,7 @@ int LegacyDLLExport icsneoOpenDevice(
 	neodevice_t* device;
 	try
 	{
-		device = &neodevices.at(uint64_t(pNeoDeviceEx->neoDevice.Handle) << 32 | pNeoDeviceEx->neoDevice.SerialNumber);
+		device = &neodevices.at(uint64_t(pNeoDeviceEx->neoDevice.Handle) << 32 | pNeoDeviceEx->neoDevice.SerialNumber).device;
 	}
 	catch (const std::out_of_range&)
 	{
@@ -447,7 +476,7 @@ int LegacyDLLExport icsneoOpenDevice(
 	if(!icsneo_openDevice(device))
 		return false;
 	
-	return icsneo_setPollingMessageLimit(device, 20000) && icsneo_enableMessagePolling(device) && icsneo_goOnline(device);
+	return LegacyEnableMessageRing(device, MAX_MESSAGES, MESSAGE_RING_PAYLOAD_BYTES) && icsneo_goOnline(device);
 }
 
 int LegacyDLLExport icsneoClosePort(void* hObject, int* pNumberOfErrors)
@@ -475,25 +504,49 @@ int LegacyDLLExport icsneoSerialNumberToString(unsigned long serial, char* data,
 //Message Functions
 int LegacyDLLExport icsneoGetMessages(void* hObject, icsSpyMessage* pMsg, int* pNumberOfMessages, int* pNumberOfErrors)
 {
-	static neomessage_t messages[20000];
 	if (!icsneoValidateHObject(hObject))
 		return false;
-	neodevice_t* device = reinterpret_cast<neodevice_t*>(hObject);
+	LegacyDevice& legacy = LegacyDeviceFromHObject(hObject);
+	neodevice_t* device = &legacy.device;
 
-	size_t messageCount = 20000;
-	if (!icsneo_getMessages(device, messages, &messageCount, 0))
+	// Converted straight out of the ring into the caller's array, anything past a wrap around comes next time
+	const neomessage_t* messages;
+	size_t messageCount = MAX_MESSAGES;
+	if (!icsneo_readMessageRing(device, &messages, &messageCount))
 		return false;
 
+	uint16_t resolution = 0;
+	icsneo_getTimestampResolution(device, &resolution);
+
+	// The payloads are copied out so the records can go straight back, letting the ring drop the oldest while the caller holds on
+	size_t extraBytes = 0; // At least as many as are copied
+	for (size_t i = 0; i < messageCount; i++)
+	{
+		if (messages[i].messageType == ICSNEO_MESSAGE_TYPE_FRAME)
+			extraBytes += reinterpret_cast<const neomessage_frame_t*>(&messages[i])->length;
+	}
+	legacy.extraData.resize(extraBytes);
+
 	*pNumberOfMessages = 0;
 	*pNumberOfErrors = 0;
 
+	uint8_t* extraData = legacy.extraData.data();
 	for (size_t i = 0; i < messageCount; i++)
 	{
-		if (NeoMessageToSpyMessage(device, messages[i], pMsg[*pNumberOfMessages]))
-			(*pNumberOfMessages)++;
+		icsSpyMessage& oldmsg = pMsg[*pNumberOfMessages];
+		if (!NeoMessageToSpyMessage(resolution, messages[i], oldmsg))
+			continue;
+		const neomessage_frame_t& frame = *reinterpret_cast<const neomessage_frame_t*>(&messages[i]);
+		if (oldmsg.ExtraDataPtr == frame.data && frame.length != 0)
+		{
+			memcpy(extraData, frame.data, frame.length);
+			oldmsg.ExtraDataPtr = extraData;
+			extraData += frame.length;
+		}
+		(*pNumberOfMessages)++;
 	}
 
-	return true;
+	return icsneo_commitMessageRing(device, messageCount);
 }
 
 int LegacyDLLExport icsneoTxMessages(void* hObject, icsSpyMessage* pMsg, int lNetworkID, int lNumMessages)
@@ -506,19 +559,26 @@ int LegacyDLLExport icsneoTxMessagesEx(void* hObject, icsSpyMessage* pMsg, unsig
 {
 	if (!icsneoValidateHObject(hObject))
 		return false;
-	neodevice_t* device = reinterpret_cast<neodevice_t*>(hObject);
-	neomessage_frame_t newmsg;
 	unsigned int temp = 0;
 	if (NumTxed == nullptr)
 		NumTxed = &temp;
 	*NumTxed = 0;
+	std::vector<neomessage_frame_t> newmsgs(lNumMessages);
 	for (unsigned int i = 0; i < lNumMessages; i++)
+		SpyMessageToNeoMessage(pMsg[i], newmsgs[i], lNetworkID);
+
+	// The batch stops at a message which can't be sent, skip over it and carry on with the rest.
+	// A failed write stops it too, and as the rest would go out ahead of what it lost, they aren't sent.
+	const neomessage_t* msgs = reinterpret_cast<const neomessage_t*>(newmsgs.data());
+	size_t next = 0;
+	while (next < lNumMessages)
 	{
-		newmsg = {};
-		const icsSpyMessage& oldMsg = pMsg[i];
-		SpyMessageToNeoMessage(oldMsg, newmsg, lNetworkID);
-		if (icsneo_transmit(device, reinterpret_cast<neomessage_t*>(&newmsg)))
-			(*NumTxed)++;
+		bool writeFailed;
+		const size_t sent = LegacyTransmitBatch(hObject, msgs + next, lNumMessages - next, writeFailed);
+		*NumTxed += static_cast<unsigned int>(sent);
+		if (writeFailed)
+			break;
+		next += sent + 1;
 	}
 	return lNumMessages == *NumTxed;
 }
@@ -873,7 +933,7 @@ int LegacyDLLExport icsneoValidateHObject(void* hObject)
 {
 	for (auto it = neodevices.begin(); it != neodevices.end(); it++)
 	{
-		if (&it->second == hObject)
+		if (&it->second.device == hObject)
 		{
 			neodevice_t* device = reinterpret_cast<neodevice_t*>(hObject);
 			if (icsneo_isValidNeoDevice(device))
@@ -6,10 +6,14 @@
 #endif
 
 #include "icsneo/device/device.h"
+#include "icsneo/api/neodevicelookup.h"
+#include "icsneolegacyextra.h"
 #define ICSNEOC_MAKEDLL
 #include "icsneo/platform/dynamiclib.h" // Dynamic library loading and exporting
 #undef ICSNEOC_MAKEDLL
 #include <chrono>
+#include <memory>
+#include <vector>
 
 using namespace icsneo;
 
@@ -21,8 +25,36 @@ extern int LegacyDLLExport icsneoWaitForRxMessagesWithTimeOut(void* hObject, uns
 int LegacyDLLExport icsneoWaitForRxMessagesWithTimeOut(void* hObject, unsigned int iTimeOut) {
 	if(!icsneoValidateHObject(hObject))
 		return false;
-	neodevice_t* device = (neodevice_t*)hObject;
-	if(device->device->getCurrentMessageCount() != 0)
+	const auto device = DeviceFromNeoDevice((neodevice_t*)hObject);
+	if(!device)
+		return false;
+	const auto ring = device->getNeoMessageRing();
+	if(ring && ring->size() != 0)
 		return true;
-	return bool(device->device->com->waitForMessageSync({}, std::chrono::milliseconds(iTimeOut)));
-}
\ No newline at end of file
+	return bool(device->com->waitForMessageSync({}, std::chrono::milliseconds(iTimeOut)));
+}
+
+bool LegacyEnableMessageRing(void* hObject, size_t messageCapacity, size_t payloadCapacity) {
+	const auto device = DeviceFromNeoDevice((neodevice_t*)hObject);
+	if(!device)
+		return false;
+	return device->enableNeoMessageRing(messageCapacity, payloadCapacity, nullptr, NeoMessageRing::Overflow::DropOldest);
+}
+
+size_t LegacyTransmitBatch(void* hObject, const neomessage_t* messages, size_t count, bool& writeFailed) {
+	writeFailed = false;
+	const auto device = DeviceFromNeoDevice((neodevice_t*)hObject);
+	if(!device)
+		return 0;
+
+	std::vector<std::shared_ptr<Frame>> frames;
+	frames.reserve(count);
+	for(size_t i = 0; i < count; i++) {
+		auto frame = std::dynamic_pointer_cast<Frame>(CreateMessageFromNeoMessage(messages + i));
+		if(!frame)
+			break; // Only what comes before it is sent, same as if it had failed to transmit
+		frames.push_back(std::move(frame));
+	}
+
+	return device->transmitBatch(frames, &writeFailed);
+}
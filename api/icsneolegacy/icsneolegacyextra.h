@@ -0,0 +1,16 @@
+#ifndef __ICSNEOLEGACYEXTRA_H_
+#define __ICSNEOLEGACYEXTRA_H_
+
+// Shared between icsneolegacy.cpp and icsneolegacyextra.cpp, which can't include
+// each other's headers, so this mustn't include icsnVC40.h or the device headers
+
+#include "icsneo/communication/message/neomessage.h"
+#include <cstddef>
+
+// Polls through a neomessage_t ring which drops the oldest messages when full, as message polling did
+bool LegacyEnableMessageRing(void* hObject, size_t messageCapacity, size_t payloadCapacity);
+
+// As icsneo_transmitBatch(), but also telling a failed write apart from a message which can't be sent
+size_t LegacyTransmitBatch(void* hObject, const neomessage_t* messages, size_t count, bool& writeFailed);
+
+#endif
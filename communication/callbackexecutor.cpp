@@ -0,0 +1,177 @@
+#include "icsneo/communication/callbackexecutor.h"
+#include "icsneo/api/eventmanager.h"
+
+using namespace icsneo;
+
+static std::mutex sharedWorkersMutex;
+static size_t sharedWorkerCount = 2;
+static std::shared_ptr<WorkerPool> sharedWorkers; // Created the first time a Pooled callback is started
+
+// The executor whose pooled callback this thread is running, so stopping from inside it doesn't wait on itself
+static thread_local const CallbackExecutor* running = nullptr;
+
+std::shared_ptr<CallbackExecutor> CallbackExecutor::Start(std::shared_ptr<MessageCallback> callback) {
+	if(!callback || callback->getExecutionPolicy().execution == MessageCallback::Execution::Inline)
+		return nullptr;
+
+	auto executor = std::make_shared<CallbackExecutor>(std::move(callback));
+	if(executor->policy.execution == MessageCallback::Execution::Thread) {
+		executor->thread = std::thread(&CallbackExecutor::run, executor);
+	} else {
+		std::lock_guard<std::mutex> lk(sharedWorkersMutex);
+		if(!sharedWorkers)
+			sharedWorkers = std::make_shared<WorkerPool>(sharedWorkerCount);
+		executor->workers = sharedWorkers;
+	}
+	return executor;
+}
+
+void CallbackExecutor::SetPoolThreads(size_t threads) {
+	std::lock_guard<std::mutex> lk(sharedWorkersMutex);
+	if(sharedWorkerCount != threads)
+		sharedWorkers.reset();
+	sharedWorkerCount = threads;
+}
+
+CallbackExecutor::CallbackExecutor(std::shared_ptr<MessageCallback> cb) :
+	callback(std::move(cb)), policy(callback->getExecutionPolicy()), stats(callback->queueStats),
+	room(moodycamel::LightweightSemaphore::ssize_t(policy.queueCapacity ? policy.queueCapacity : 1)) {}
+
+bool CallbackExecutor::post(std::shared_ptr<Message> message) {
+	if(closed.load(std::memory_order_acquire))
+		return false;
+
+	bool replacing = false; // Taking the place of a message we dropped, which already holds a slot and counts as pending
+	if(!room.tryWait()) {
+		switch(policy.overflow) {
+			case MessageCallback::Overflow::Block:
+				while(!room.wait(BlockedPollMicroseconds)) {
+					if(closed.load(std::memory_order_acquire))
+						return false;
+				}
+				break;
+			case MessageCallback::Overflow::DropNewest:
+				dropped();
+				return false;
+			case MessageCallback::Overflow::DropOldest: {
+				std::shared_ptr<Message> oldest;
+				while(true) {
+					if(queue.try_dequeue(oldest)) {
+						if(oldest) // Not the stop marker, which only matters once we're closed anyway
+							dropped();
+						replacing = true;
+						break;
+					}
+					if(room.tryWait())
+						break; // Whoever is draining took it first
+					std::this_thread::yield();
+				}
+				break;
+			}
+		}
+	}
+
+	if(!replacing) {
+		if(closed.load(std::memory_order_acquire)) {
+			room.signal();
+			return false;
+		}
+		stats->depth.fetch_add(1, std::memory_order_relaxed);
+	}
+	queue.enqueue(std::move(message));
+	if(workers && !replacing && pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+		workers->post([self = shared_from_this()]() { self->drain(); });
+	return true;
+}
+
+void CallbackExecutor::close() {
+	if(closed.exchange(true))
+		return;
+	if(thread.joinable())
+		queue.enqueue(nullptr); // Wake the thread, it checks closed before and after every message
+}
+
+void CallbackExecutor::stop() {
+	close();
+	if(stopped.exchange(true))
+		return;
+
+	if(thread.joinable()) {
+		if(thread.get_id() == std::this_thread::get_id())
+			thread.detach(); // It will see that we're closed as soon as the callback returns
+		else
+			thread.join();
+		// Nothing else takes from the queue now
+		std::shared_ptr<Message> message;
+		while(queue.try_dequeue(message)) {
+			if(message)
+				stats->depth.fetch_sub(1, std::memory_order_relaxed);
+		}
+	} else if(workers && running != this) {
+		std::unique_lock<std::mutex> lk(idleMutex);
+		idle.wait(lk, [this]() { return pending.load(std::memory_order_acquire) == 0; });
+	}
+}
+
+void CallbackExecutor::run() {
+	// An empty message, or a wait timing out, is a cue to check whether we've closed
+	static constexpr auto CloseCheckInterval = std::chrono::milliseconds(100);
+	std::shared_ptr<Message> message;
+	while(!closed.load(std::memory_order_acquire)) {
+		if(!queue.wait_dequeue_timed(message, CloseCheckInterval) || !message)
+			continue;
+		room.signal();
+		stats->depth.fetch_sub(1, std::memory_order_relaxed);
+		deliver(message);
+		message = nullptr; // Let go of it before waiting for the next
+	}
+}
+
+void CallbackExecutor::drain() {
+	// Only one drain runs at a time, since another is only posted once pending has gone back to 0
+	running = this;
+
+	// The callbacks are the user's code, so they get to see their errors even on one of our threads
+	const bool downgrading = EventManager::GetInstance().isDowngradingErrorsOnCurrentThread();
+	if(downgrading)
+		EventManager::GetInstance().cancelErrorDowngradingOnCurrentThread();
+
+	std::shared_ptr<Message> message;
+	for(size_t handled = 1; ; handled++) {
+		// pending counts a message which a post() dropping the oldest has taken out but not yet replaced,
+		// in which case we wait for its replacement
+		queue.wait_dequeue(message);
+		room.signal();
+		if(message) {
+			stats->depth.fetch_sub(1, std::memory_order_relaxed);
+			deliver(message);
+		}
+		message = nullptr;
+
+		// Only we take away from pending, so if there's more than one there's still more once we do
+		if(pending.load(std::memory_order_acquire) > 1) {
+			pending.fetch_sub(1, std::memory_order_acq_rel);
+			if(handled == MaxMessagesPerTurn) {
+				workers->post([self = shared_from_this()]() { self->drain(); });
+				break;
+			}
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lk(idleMutex);
+		if(pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			idle.notify_all();
+			break;
+		}
+	}
+
+	if(downgrading)
+		EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+	running = nullptr;
+}
+
+void CallbackExecutor::deliver(const std::shared_ptr<Message>& message) {
+	// Already matched by the reading thread before it was queued
+	if(!closed.load(std::memory_order_acquire))
+		callback->getCallback()(message);
+}
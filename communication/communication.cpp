@@ -1,4 +1,5 @@
 #include "icsneo/communication/communication.h"
+#include "icsneo/communication/callbackexecutor.h"
 #include <chrono>
 #include <iostream>
 #include <queue>
@@ -6,11 +7,19 @@
 #include <cstring>
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <atomic>
 #include "icsneo/communication/command.h"
 #include "icsneo/communication/decoder.h"
 #include "icsneo/communication/packetizer.h"
 #include "icsneo/communication/message/serialnumbermessage.h"
 #include "icsneo/communication/message/filter/main51messagefilter.h"
+#include "icsneo/communication/message/filter/canmessagefilter.h"
 #include "icsneo/communication/message/readsettingsmessage.h"
 #include "icsneo/communication/message/versionmessage.h"
 #include "icsneo/communication/message/componentversionsmessage.h"
@@ -24,6 +33,7 @@ Communication::~Communication() {
 		clearRedirectRead();
 	if(isOpen())
 		close();
+	flushMessageBatches(true);
 }
 
 bool Communication::open() {
@@ -52,6 +62,8 @@ void Communication::joinThreads() {
 bool Communication::close() {
 	joinThreads();
 
+	flushMessageBatches(false); // Nothing more is coming, so batch callbacks get what their windows were holding back
+
 	if(!isOpen() && !isDisconnected()) {
 		report(APIEvent::Type::DeviceCurrentlyClosed, APIEvent::Severity::Error);
 		return false;
@@ -60,6 +72,21 @@ bool Communication::close() {
 	return driver->close();
 }
 
+Communication::PoolCounters Communication::getReceivePoolCounters() const {
+	PoolCounters counters;
+	const auto add = [&counters](uint64_t hits, uint64_t misses) {
+		counters.hits += hits;
+		counters.misses += misses;
+	};
+	if(packetizer)
+		add(packetizer->packetPool.hits(), packetizer->packetPool.misses());
+	if(decoder) {
+		add(decoder->canPool.hits(), decoder->canPool.misses());
+		add(decoder->ethernetPool.hits(), decoder->ethernetPool.misses());
+	}
+	return counters;
+}
+
 bool Communication::isOpen() {
 	return driver->isOpen();
 }
@@ -73,6 +100,10 @@ bool Communication::sendPacket(std::vector<uint8_t>& bytes) {
 	return rawWrite(bytes);
 }
 
+bool Communication::sendPacketAsync(std::vector<uint8_t>& bytes, Driver::WriteCompletion onComplete) {
+	return rawWriteAsync(bytes, std::move(onComplete));
+}
+
 bool Communication::sendCommand(Command cmd, std::vector<uint8_t> arguments) {
 	std::vector<uint8_t> packet;
 	if(!encoder->encode(*packetizer, packet, cmd, arguments))
@@ -195,70 +226,756 @@ std::shared_ptr<LogicalDiskInfoMessage> Communication::getLogicalDiskInfoSync(st
 	return std::dynamic_pointer_cast<LogicalDiskInfoMessage>(msg);
 }
 
+template<typename Callback>
+struct Communication::Registration {
+	Registration(int id, Callback callback) : id(id), callback(std::move(callback)) {}
+	~Registration() {
+		if(executor)
+			executor->stop();
+	}
+	const int id;
+	const Callback callback;
+	std::shared_ptr<CallbackExecutor> executor; // For message callbacks which don't run inline
+	std::atomic<bool> removed{false};
+};
+
+/**
+ * Holds a batch callback's messages back until its window closes. With a
+ * maxDelay a timer thread of its own hands over whatever has waited that
+ * long, even if no more reads come in. Calls are made one at a time and
+ * in order, whether from a read, the timer or a flush.
+ */
+struct Communication::MessageBatcher : public std::enable_shared_from_this<MessageBatcher> {
+	MessageBatcher(std::shared_ptr<MessageBatchCallback> callback) : callback(std::move(callback)) {}
+	~MessageBatcher() { stop(); }
+	const std::shared_ptr<MessageBatchCallback> callback;
+
+	// The timer thread keeps the batcher alive until stop(), so it may be stopped from within the callback
+	void start() {
+		if(callback->getWindow().maxDelay != std::chrono::microseconds::zero())
+			timer = std::thread(&MessageBatcher::runTimer, shared_from_this());
+	}
+
+	void add(const std::vector< std::shared_ptr<Message> >& messages) {
+		const MessageFilter& filter = callback->getFilter();
+		if(!callback->isWindowed()) {
+			// Hand the read over as it is when everything in it matches, as it will for the most part
+			const auto firstMismatch = std::find_if(messages.begin(), messages.end(), [&filter](const auto& msg) { return !filter.match(msg); });
+			if(firstMismatch == messages.end()) {
+				callback->call(messages);
+				return;
+			}
+			std::vector< std::shared_ptr<Message> > matched(messages.begin(), firstMismatch);
+			std::copy_if(firstMismatch + 1, messages.end(), std::back_inserter(matched), [&filter](const auto& msg) { return filter.match(msg); });
+			if(!matched.empty())
+				callback->call(matched);
+			return;
+		}
+
+		const auto& window = callback->getWindow();
+		std::lock_guard<std::recursive_mutex> calls(callMutex);
+		std::vector< std::shared_ptr<Message> > ready;
+		{
+			std::lock_guard<std::mutex> lk(mutex); // Reads from several VNETs may come in at once
+			const auto now = std::chrono::steady_clock::now();
+			const bool wasEmpty = pending.empty();
+			std::copy_if(messages.begin(), messages.end(), std::back_inserter(pending), [&filter](const auto& msg) { return filter.match(msg); });
+			if(pending.empty())
+				return;
+			if(wasEmpty) {
+				windowStart = now;
+				timerWake.notify_one();
+			}
+			if((window.messages != 0 && pending.size() >= window.messages) ||
+				(window.maxDelay != std::chrono::microseconds::zero() && now - windowStart >= window.maxDelay))
+				ready.swap(pending);
+		}
+		call(ready);
+	}
+
+	// Hand over whatever is being held back, for when nothing more is coming
+	void flush() {
+		std::lock_guard<std::recursive_mutex> calls(callMutex);
+		std::vector< std::shared_ptr<Message> > ready;
+		{
+			std::lock_guard<std::mutex> lk(mutex);
+			ready.swap(pending);
+		}
+		call(ready);
+	}
+
+	// Flushes, and once this returns the timer won't call the callback again
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lk(mutex);
+			if(stopping)
+				return;
+			stopping = true;
+		}
+		timerWake.notify_all();
+		if(timer.joinable()) {
+			// From inside the callback the timer may be waiting on us to return, it sees that we've stopped once it gets in
+			if(timer.get_id() == std::this_thread::get_id() || calling == std::this_thread::get_id())
+				timer.detach();
+			else
+				timer.join();
+		}
+		flush();
+	}
+
+private:
+	std::mutex mutex; // Guards everything below
+	std::vector< std::shared_ptr<Message> > pending;
+	std::chrono::steady_clock::time_point windowStart;
+	bool stopping = false;
+	std::condition_variable timerWake;
+	std::thread timer;
+
+	std::recursive_mutex callMutex; // Held from taking a batch until it has been handed over, taken before `mutex`
+	std::atomic<std::thread::id> calling{};
+
+	void call(const std::vector< std::shared_ptr<Message> >& ready) {
+		if(ready.empty())
+			return;
+		const std::thread::id outer = calling.exchange(std::this_thread::get_id());
+		callback->call(ready);
+		calling = outer;
+	}
+
+	static void runTimer(std::shared_ptr<MessageBatcher> self) {
+		const auto maxDelay = self->callback->getWindow().maxDelay;
+		std::unique_lock<std::mutex> lk(self->mutex);
+		while(!self->stopping) {
+			if(self->pending.empty()) {
+				self->timerWake.wait(lk);
+				continue;
+			}
+			const auto deadline = self->windowStart + maxDelay;
+			if(std::chrono::steady_clock::now() < deadline) {
+				self->timerWake.wait_until(lk, deadline);
+				continue;
+			}
+
+			lk.unlock();
+			{
+				std::lock_guard<std::recursive_mutex> calls(self->callMutex);
+				std::vector< std::shared_ptr<Message> > ready;
+				{
+					std::lock_guard<std::mutex> pendingLock(self->mutex);
+					// A read may have handed them over while we waited for our turn
+					if(!self->stopping && !self->pending.empty() && std::chrono::steady_clock::now() - self->windowStart >= maxDelay)
+						ready.swap(self->pending);
+				}
+				self->call(ready);
+			}
+			lk.lock();
+		}
+	}
+};
+
+struct Communication::CallbackSnapshot {
+	CallbackSnapshot() = default;
+	CallbackSnapshot(const CallbackSnapshot& other) : messages(other.messages), canFrameBatches(other.canFrameBatches), messageBatches(other.messageBatches),
+		always(other.always), byNetID(other.byNetID), byNetworkType(other.byNetworkType), byMessageType(other.byMessageType), byArbID(other.byArbID) {}
+
+	std::vector< std::shared_ptr< Registration< std::shared_ptr<MessageCallback> > > > messages;
+	std::vector< std::shared_ptr< Registration<fn_canFrameBatchCallback> > > canFrameBatches;
+	std::vector< std::shared_ptr< Registration< std::shared_ptr<MessageBatcher> > > > messageBatches;
+	mutable std::atomic<uint32_t> dispatching{0}; // DispatchFrames working from this snapshot
+
+	template<typename Callback>
+	bool contains(const Registration<Callback>& reg) const {
+		const auto& list = registrations<Callback>();
+		return std::any_of(list.begin(), list.end(), [&reg](const auto& other) { return other.get() == &reg; });
+	}
+	template<typename Callback>
+	const auto& registrations() const { return const_cast<CallbackSnapshot*>(this)->registrations<Callback>(); }
+	template<typename Callback>
+	auto& registrations() {
+		if constexpr(std::is_same_v<Callback, fn_canFrameBatchCallback>)
+			return canFrameBatches;
+		else if constexpr(std::is_same_v<Callback, std::shared_ptr<MessageBatcher>>)
+			return messageBatches;
+		else
+			return messages;
+	}
+
+	/**
+	 * Where in `messages` to look for callbacks which could match a message.
+	 * Plain MessageFilters and CANMessageFilters go under whatever narrows
+	 * them down the most, anything else is tried against every message.
+	 * Each list is in the order the callbacks were added, as is dispatch.
+	 */
+	using Positions = std::vector<size_t>;
+	Positions always;
+	std::unordered_map<neonetid_t, Positions> byNetID;
+	std::unordered_map<neonettype_t, Positions> byNetworkType;
+	std::unordered_map<neomessagetype_t, Positions> byMessageType;
+	std::unordered_map<uint32_t, Positions> byArbID;
+
+	void reindex() {
+		always.clear();
+		byNetID.clear();
+		byNetworkType.clear();
+		byMessageType.clear();
+		byArbID.clear();
+		for(size_t i = 0; i < messages.size(); i++) {
+			const MessageCallback& cb = *messages[i]->callback;
+			const MessageFilter& filter = cb.getFilter();
+			const std::type_info& filterType = typeid(filter);
+			if(typeid(cb) != typeid(MessageCallback) || (filterType != typeid(MessageFilter) && filterType != typeid(CANMessageFilter))) {
+				always.push_back(i); // callIfMatch() or match() may do anything
+				continue;
+			}
+
+			std::optional<uint32_t> arbid;
+			if(filterType == typeid(CANMessageFilter))
+				arbid = static_cast<const CANMessageFilter&>(filter).getArbID();
+			if(arbid)
+				byArbID[*arbid].push_back(i);
+			else if(filter.getNetID() != Network::NetID::Any)
+				byNetID[neonetid_t(filter.getNetID())].push_back(i);
+			else if(filter.getNetworkType() != Network::Type::Any)
+				byNetworkType[neonettype_t(filter.getNetworkType())].push_back(i);
+			else if(filter.getMessageType() != Message::Type::Invalid)
+				byMessageType[neomessagetype_t(filter.getMessageType())].push_back(i);
+			else
+				always.push_back(i);
+		}
+	}
+
+	// Calls fn with the position of every callback which could match, in order
+	template<typename Fn>
+	void forEachCandidate(const Message& message, Fn&& fn) const {
+		std::array<std::pair<const size_t*, const size_t*>, 5> lists;
+		size_t count = 0;
+		const auto add = [&lists, &count](const Positions& list) {
+			if(!list.empty())
+				lists[count++] = { list.data(), list.data() + list.size() };
+		};
+		const auto find = [&add](const auto& map, auto key) {
+			if(map.empty())
+				return;
+			const auto it = map.find(key);
+			if(it != map.end())
+				add(it->second);
+		};
+
+		add(always);
+		// The only types which carry a network, see MessageFilter::match()
+		if(message.type == Message::Type::Frame || message.type == Message::Type::Main51 ||
+			message.type == Message::Type::RawMessage || message.type == Message::Type::ReadSettings) {
+			const Network& network = static_cast<const RawMessage&>(message).network;
+			find(byNetID, neonetid_t(network.getNetID()));
+			find(byNetworkType, neonettype_t(network.getType()));
+			if(!byArbID.empty()) {
+				if(const auto can = dynamic_cast<const CANMessage*>(&message))
+					find(byArbID, can->arbid);
+			}
+		}
+		find(byMessageType, neomessagetype_t(message.type));
+
+		// Merge the lists back into the order the callbacks were added
+		while(count) {
+			size_t next = 0;
+			for(size_t i = 1; i < count; i++) {
+				if(*lists[i].first < *lists[next].first)
+					next = i;
+			}
+			fn(*lists[next].first);
+			if(++lists[next].first == lists[next].second)
+				lists[next] = lists[--count];
+		}
+	}
+};
+
+class Communication::DispatchFrame {
+public:
+	DispatchFrame(const Communication& com, std::shared_ptr<const CallbackSnapshot> snapshot) :
+		com(com), snapshot(std::move(snapshot)), outer(current), downgrading(EventManager::GetInstance().isDowngradingErrorsOnCurrentThread()) {
+		this->snapshot->dispatching++;
+		current = this;
+
+		// The callbacks are the user's code, so they get to see their errors even on one of our threads
+		if(downgrading)
+			EventManager::GetInstance().cancelErrorDowngradingOnCurrentThread();
+	}
+	~DispatchFrame() {
+		if(downgrading)
+			EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+		current = outer;
+		snapshot->dispatching--;
+		if(com.removalsWaiting != 0) {
+			std::lock_guard<std::mutex> lk(com.dispatchEndedMutex);
+			com.dispatchEnded.notify_all();
+		}
+	}
+	DispatchFrame(const DispatchFrame&) = delete;
+	DispatchFrame& operator=(const DispatchFrame&) = delete;
+
+	void dispatch(const std::shared_ptr<Message>& msg) const {
+		snapshot->forEachCandidate(*msg, [this, &msg](size_t i) {
+			const auto& reg = snapshot->messages[i];
+			if(reg->removed || com.closing) // We might have closed while reading or processing
+				return;
+			if(!reg->executor)
+				reg->callback->callIfMatch(msg);
+			else if(reg->callback->getFilter().match(msg))
+				reg->executor->post(msg);
+		});
+	}
+	void dispatch(const std::vector< std::shared_ptr<Message> >& messages) const {
+		for(const auto& reg : snapshot->messageBatches) {
+			if(!reg->removed && !com.closing)
+				reg->callback->add(messages);
+		}
+	}
+	void dispatch(const CANFrameBatch& batch) const {
+		for(const auto& reg : snapshot->canFrameBatches) {
+			if(!reg->removed && !com.closing)
+				reg->callback(batch);
+		}
+	}
+
+	const CallbackSnapshot& getSnapshot() const { return *snapshot; }
+
+	// How many of this thread's frames are working from the snapshot, they can't be waited on
+	static uint32_t OnThisThread(const CallbackSnapshot& snapshot) {
+		uint32_t count = 0;
+		for(const DispatchFrame* frame = current; frame; frame = frame->outer) {
+			if(frame->snapshot.get() == &snapshot)
+				count++;
+		}
+		return count;
+	}
+
+private:
+	static thread_local const DispatchFrame* current;
+	const Communication& com;
+	const std::shared_ptr<const CallbackSnapshot> snapshot;
+	const DispatchFrame* const outer;
+	const bool downgrading;
+};
+
+thread_local const Communication::DispatchFrame* Communication::DispatchFrame::current = nullptr;
+
+void Communication::publishCallbacks(std::shared_ptr<const CallbackSnapshot> snapshot) {
+	if(auto old = std::atomic_exchange(&callbacks, std::move(snapshot)))
+		retiredCallbacks.push_back(old);
+	// Once nobody is dispatching from a snapshot it can never be dispatched from again
+	retiredCallbacks.erase(std::remove_if(retiredCallbacks.begin(), retiredCallbacks.end(), [](const auto& weak) {
+		return weak.expired();
+	}), retiredCallbacks.end());
+}
+
+template<typename Callback>
+std::vector< std::shared_ptr<const Communication::CallbackSnapshot> > Communication::snapshotsContaining(const Registration<Callback>& reg) const {
+	std::vector< std::shared_ptr<const CallbackSnapshot> > ret;
+	for(const auto& weak : retiredCallbacks) {
+		auto snapshot = weak.lock();
+		if(snapshot && snapshot->contains(reg))
+			ret.push_back(std::move(snapshot));
+	}
+	return ret;
+}
+
+template<typename Callback>
+void Communication::waitUntilUnused(Registration<Callback>& removed, const std::vector< std::shared_ptr<const CallbackSnapshot> >& containing) {
+	// Either a dispatch sees the flag, or we see its count and wait it out
+	removed.removed = true;
+	// Counted before checking, so that a frame either sees us waiting or ended before we looked
+	removalsWaiting++;
+	for(const auto& snapshot : containing) {
+		const uint32_t own = DispatchFrame::OnThisThread(*snapshot); // Removed from inside a callback, it's done once that returns
+		std::unique_lock<std::mutex> lk(dispatchEndedMutex);
+		dispatchEnded.wait(lk, [&]() { return snapshot->dispatching <= own; });
+	}
+	removalsWaiting--;
+}
+
 int Communication::addMessageCallback(const std::shared_ptr<MessageCallback>& cb) {
 	std::lock_guard<std::mutex> lk(messageCallbacksLock);
-	messageCallbacks.insert(std::make_pair(messageCallbackIDCounter, cb));
+	const auto old = loadCallbacks();
+	auto snapshot = old ? std::make_shared<CallbackSnapshot>(*old) : std::make_shared<CallbackSnapshot>();
+	auto reg = std::make_shared< Registration< std::shared_ptr<MessageCallback> > >(messageCallbackIDCounter, cb);
+	reg->executor = CallbackExecutor::Start(cb);
+	snapshot->messages.push_back(std::move(reg));
+	snapshot->reindex();
+	updateNetworkInterestLocked(*snapshot);
+	publishCallbacks(std::move(snapshot));
 	return messageCallbackIDCounter++;
 }
 
 bool Communication::removeMessageCallback(int id) {
+	removeRegistration< std::shared_ptr<MessageCallback> >(id);
+	return true; // Nothing to do if it wasn't there
+}
+
+template<typename Callback>
+bool Communication::removeRegistration(int id) {
+	std::shared_ptr< Registration<Callback> > removed;
+	std::vector< std::shared_ptr<const CallbackSnapshot> > containing;
+	{
+		std::lock_guard<std::mutex> lk(messageCallbacksLock);
+		const auto old = loadCallbacks();
+		if(!old)
+			return false;
+		auto snapshot = std::make_shared<CallbackSnapshot>(*old);
+		auto& list = snapshot->registrations<Callback>();
+		const auto it = std::find_if(list.begin(), list.end(), [id](const auto& reg) { return reg->id == id; });
+		if(it == list.end())
+			return false;
+		removed = *it;
+		list.erase(it);
+		snapshot->reindex();
+		updateNetworkInterestLocked(*snapshot);
+		batchingCANFrames = !snapshot->canFrameBatches.empty();
+		publishCallbacks(std::move(snapshot));
+		containing = snapshotsContaining(*removed);
+	}
+	if(removed->executor)
+		removed->executor->close(); // So nobody waits on its queue while we wait on them
+	waitUntilUnused(*removed, containing); // Outside the lock, so a slow callback only holds up its own removal
+	if(removed->executor)
+		removed->executor->stop();
+	if constexpr(std::is_same_v<Callback, std::shared_ptr<MessageBatcher>>)
+		removed->callback->stop(); // Whatever its window was holding back goes to it now
+	return true;
+}
+
+int Communication::addMessageBatchCallback(const std::shared_ptr<MessageBatchCallback>& cb) {
+	if(!cb) {
+		report(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
+		return -1;
+	}
 	std::lock_guard<std::mutex> lk(messageCallbacksLock);
-	try {
-		messageCallbacks.erase(id);
-		return true;
-	} catch(...) {
-		report(APIEvent::Type::Unknown, APIEvent::Severity::Error);
-		return false;
+	const auto old = loadCallbacks();
+	auto snapshot = old ? std::make_shared<CallbackSnapshot>(*old) : std::make_shared<CallbackSnapshot>();
+	auto batcher = std::make_shared<MessageBatcher>(cb);
+	batcher->start();
+	snapshot->messageBatches.push_back(std::make_shared< Registration< std::shared_ptr<MessageBatcher> > >(messageCallbackIDCounter, std::move(batcher)));
+	updateNetworkInterestLocked(*snapshot);
+	publishCallbacks(std::move(snapshot));
+	return messageCallbackIDCounter++;
+}
+
+bool Communication::removeMessageBatchCallback(int id) {
+	return removeRegistration< std::shared_ptr<MessageBatcher> >(id);
+}
+
+void Communication::flushMessageBatches(bool stop) {
+	const auto snapshot = loadCallbacks();
+	if(!snapshot)
+		return;
+	for(const auto& reg : snapshot->messageBatches) {
+		if(stop)
+			reg->callback->stop();
+		else
+			reg->callback->flush();
 	}
 }
 
-std::shared_ptr<Message> Communication::waitForMessageSync(std::function<bool(void)> onceWaitingDo,
-	const std::shared_ptr<MessageFilter>& f, std::chrono::milliseconds timeout) {
-	std::mutex cvMutex;
-	std::condition_variable cv;
-	std::shared_ptr<Message> returnedMessage;
+int Communication::addCANFrameBatchCallback(fn_canFrameBatchCallback cb) {
+	if(!cb) {
+		report(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
+		return -1;
+	}
+	std::lock_guard<std::mutex> lk(messageCallbacksLock);
+	const auto old = loadCallbacks();
+	auto snapshot = old ? std::make_shared<CallbackSnapshot>(*old) : std::make_shared<CallbackSnapshot>();
+	snapshot->canFrameBatches.push_back(std::make_shared< Registration<fn_canFrameBatchCallback> >(messageCallbackIDCounter, std::move(cb)));
+	publishCallbacks(std::move(snapshot));
+	batchingCANFrames = true;
+	return messageCallbackIDCounter++;
+}
 
-	std::unique_lock<std::mutex> fnLk(syncMessageMutex); // Only allow for one sync message at a time
-	std::unique_lock<std::mutex> cvLk(cvMutex); // Don't let the callback fire until we're waiting for it
-	int cb = addMessageCallback(std::make_shared<MessageCallback>([&cvMutex, &returnedMessage, &cv](std::shared_ptr<Message> message) {
-		{
-			std::lock_guard<std::mutex> lk(cvMutex);
-			returnedMessage = message;
+bool Communication::removeCANFrameBatchCallback(int id) {
+	return removeRegistration<fn_canFrameBatchCallback>(id);
+}
+
+struct Communication::ResponseTable {
+	struct Request {
+		int id;
+		std::shared_ptr<MessageFilter> filter;
+		std::function<void(std::shared_ptr<Message>)> onResponse;
+		bool widens; // Its filter wanted networks no callback did, so the interest narrows again once it's gone
+	};
+	using Queue = std::deque< std::shared_ptr<Request> >; // Oldest first
+
+	// Plain MessageFilters and Main51MessageFilters go under whatever narrows them down the most
+	struct Index {
+		std::unordered_map<uint8_t, Queue> byCommand;
+		std::unordered_map<neonetid_t, Queue> byNetID;
+		std::unordered_map<neonettype_t, Queue> byNetworkType;
+		std::unordered_map<neomessagetype_t, Queue> byMessageType;
+		Queue others;
+
+		Queue& queueFor(const MessageFilter& filter) {
+			const std::type_info& type = typeid(filter);
+			if(type == typeid(Main51MessageFilter)) {
+				if(const auto command = static_cast<const Main51MessageFilter&>(filter).getCommand())
+					return byCommand[uint8_t(*command)];
+			} else if(type != typeid(MessageFilter)) {
+				return others; // match() may do anything
+			}
+			if(filter.getNetID() != Network::NetID::Any)
+				return byNetID[neonetid_t(filter.getNetID())];
+			if(filter.getNetworkType() != Network::Type::Any)
+				return byNetworkType[neonettype_t(filter.getNetworkType())];
+			if(filter.getMessageType() != Message::Type::Invalid)
+				return byMessageType[neomessagetype_t(filter.getMessageType())];
+			return others;
 		}
-		cv.notify_all();
-	}, f));
 
-	// We have now added the callback, do whatever the caller wanted to do
-	bool fail = !onceWaitingDo();
-	if(!fail)
-		cv.wait_for(cvLk, timeout, [&returnedMessage] { return !!returnedMessage; }); // `!!shared_ptr` checks if the ptr has a value
-	cvLk.unlock(); // Ensure callbacks can complete even if we didn't wait for them
+		// Visits each queue holding requests the message could match, most specific first, until visit returns true
+		template<typename Visit>
+		void visit(const Message& message, Visit&& visit) {
+			const auto visitIn = [&visit](auto& map, auto key) {
+				if(map.empty())
+					return false;
+				const auto it = map.find(key);
+				return it != map.end() && visit(it->second);
+			};
+			if(!byCommand.empty()) {
+				if(const auto main51 = dynamic_cast<const Main51Message*>(&message)) {
+					if(visitIn(byCommand, uint8_t(main51->command)))
+						return;
+				}
+			}
+			// The only types which carry a network, see MessageFilter::match()
+			if(message.type == Message::Type::Frame || message.type == Message::Type::Main51 ||
+				message.type == Message::Type::RawMessage || message.type == Message::Type::ReadSettings) {
+				const Network& network = static_cast<const RawMessage&>(message).network;
+				if(visitIn(byNetID, neonetid_t(network.getNetID())) || visitIn(byNetworkType, neonettype_t(network.getType())))
+					return;
+			}
+			if(visitIn(byMessageType, neomessagetype_t(message.type)))
+				return;
+			visit(others);
+		}
+
+		void addNetworkInterest(NetworkInterest& interest) const {
+			const auto add = [&interest](const Queue& queue) {
+				for(const auto& request : queue)
+					request->filter->addNetworkInterest(interest);
+			};
+			const auto addAll = [&add](const auto& map) {
+				for(const auto& entry : map)
+					add(entry.second);
+			};
+			addAll(byCommand);
+			addAll(byNetID);
+			addAll(byNetworkType);
+			addAll(byMessageType);
+			add(others);
+		}
+	};
+
+	std::mutex mutex;
+	std::atomic<size_t> outstanding{0};
+	int nextID = 1;
+
+	Index correlated; // expectResponse(), each message answers one of these
+	Index waiting; // waitForMessageSync(), each message goes to all of these it matches
+	std::unordered_map<int, Queue*> queueOf; // Queues are never erased, so these stay valid
+
+	void add(std::shared_ptr<Request> request, bool correlate) {
+		Queue& queue = (correlate ? correlated : waiting).queueFor(*request->filter);
+		queueOf[request->id] = &queue;
+		queue.push_back(std::move(request));
+		outstanding++;
+	}
+
+	// Takes the requests the message answers out of the table, the oldest correlated one it matches and every waiter
+	void claim(const std::shared_ptr<Message>& message, std::vector< std::shared_ptr<Request> >& answered) {
+		correlated.visit(*message, [&](Queue& queue) {
+			for(auto it = queue.begin(); it != queue.end(); it++) {
+				if((*it)->filter->match(message)) {
+					answered.push_back(std::move(*it));
+					queue.erase(it);
+					return true;
+				}
+			}
+			return false;
+		});
+		waiting.visit(*message, [&](Queue& queue) {
+			for(auto it = queue.begin(); it != queue.end();) {
+				if((*it)->filter->match(message)) {
+					answered.push_back(std::move(*it));
+					it = queue.erase(it);
+				} else {
+					it++;
+				}
+			}
+			return false;
+		});
+		for(const auto& request : answered)
+			queueOf.erase(request->id);
+		outstanding -= answered.size();
+	}
+
+	std::shared_ptr<Request> cancel(int id) {
+		const auto it = queueOf.find(id);
+		if(it == queueOf.end())
+			return nullptr;
+		Queue& queue = *it->second;
+		queueOf.erase(it);
+		const auto request = std::find_if(queue.begin(), queue.end(), [id](const auto& other) { return other->id == id; });
+		auto ret = std::move(*request);
+		queue.erase(request);
+		outstanding--;
+		return ret;
+	}
+
+	void addNetworkInterest(NetworkInterest& interest) {
+		std::lock_guard<std::mutex> lk(mutex);
+		if(outstanding == 0)
+			return;
+		correlated.addNetworkInterest(interest);
+		waiting.addNetworkInterest(interest);
+	}
+};
+
+std::shared_ptr<Communication::ResponseTable> Communication::MakeResponseTable() {
+	return std::make_shared<ResponseTable>();
+}
+
+int Communication::expectResponse(std::shared_ptr<MessageFilter> filter, std::function<void(std::shared_ptr<Message>)> onResponse) {
+	return expectMessage(std::move(filter), std::move(onResponse), true);
+}
 
-	// We don't actually check that we got a message, because either way we want to remove the callback (since it should only happen once)
-	removeMessageCallback(cb);
-	// We are now guaranteed that no more callbacks will happen
+Communication::ExpectedResponse Communication::expectResponse(std::shared_ptr<MessageFilter> filter) {
+	return expectMessage(std::move(filter), true);
+}
+
+int Communication::expectMessage(std::shared_ptr<MessageFilter> filter, std::function<void(std::shared_ptr<Message>)> onResponse, bool correlate) {
+	if(!onResponse) {
+		report(APIEvent::Type::RequiredParameterNull, APIEvent::Severity::Error);
+		return -1;
+	}
+	auto request = std::make_shared<ResponseTable::Request>();
+	request->filter = filter ? std::move(filter) : std::make_shared<MessageFilter>();
+	request->onResponse = std::move(onResponse);
+	NetworkInterest interest;
+	request->filter->addNetworkInterest(interest);
+
+	// Most responses come from internal networks, which are decoded regardless
+	std::lock_guard<std::mutex> lk(messageCallbacksLock);
+	const bool widens = request->widens = !interest.isCoveredBy(wantedInterest);
+	int id;
+	{
+		std::lock_guard<std::mutex> tableLk(responses->mutex);
+		id = request->id = responses->nextID++;
+		responses->add(std::move(request), correlate);
+	}
+	if(widens) {
+		const auto snapshot = loadCallbacks();
+		updateNetworkInterestLocked(snapshot ? *snapshot : CallbackSnapshot());
+	}
+	return id;
+}
+
+Communication::ExpectedResponse Communication::expectMessage(std::shared_ptr<MessageFilter> filter, bool correlate) {
+	auto promise = std::make_shared< std::promise< std::shared_ptr<Message> > >();
+	ExpectedResponse ret;
+	ret.response = promise->get_future();
+	ret.id = expectMessage(std::move(filter), [promise](std::shared_ptr<Message> message) {
+		promise->set_value(std::move(message));
+	}, correlate);
+	return ret;
+}
+
+bool Communication::cancelResponse(int id) {
+	std::shared_ptr<ResponseTable::Request> request;
+	{
+		std::lock_guard<std::mutex> lk(responses->mutex);
+		request = responses->cancel(id);
+	}
+	if(!request)
+		return false;
+	if(request->widens)
+		updateNetworkInterest();
+	return true;
+}
 
-	if(fail) // The caller's function failed, so don't return a message
-		returnedMessage.reset();
+void Communication::answerResponses(const std::shared_ptr<Message>& message) {
+	if(responses->outstanding.load(std::memory_order_relaxed) == 0)
+		return;
+	std::vector< std::shared_ptr<ResponseTable::Request> > answered;
+	{
+		std::lock_guard<std::mutex> lk(responses->mutex);
+		responses->claim(message, answered);
+	}
+	bool widened = false;
+	for(const auto& request : answered) {
+		request->onResponse(message);
+		widened |= request->widens;
+	}
+	if(widened)
+		updateNetworkInterest();
+}
 
-	// Then we either will return the message we got or we will return the empty shared_ptr, caller responsible for checking
-	return returnedMessage;
+std::shared_ptr<Message> Communication::waitForMessageSync(std::function<bool(void)> onceWaitingDo,
+	const std::shared_ptr<MessageFilter>& f, std::chrono::milliseconds timeout) {
+	auto expected = expectMessage(f, false);
+	if(!onceWaitingDo()) {
+		// The caller's function failed, so don't return a message
+		cancelResponse(expected.id);
+		return {};
+	}
+	if(expected.response.wait_for(timeout) != std::future_status::ready && cancelResponse(expected.id))
+		return {}; // Nothing came
+	return expected.response.get();
 }
 
 void Communication::dispatchMessage(const std::shared_ptr<Message>& msg) {
+	answerResponses(msg);
+	if(auto snapshot = loadCallbacks()) {
+		const DispatchFrame frame(*this, std::move(snapshot));
+		frame.dispatch(msg);
+		if(!frame.getSnapshot().messageBatches.empty())
+			frame.dispatch(std::vector< std::shared_ptr<Message> >{ msg });
+	}
+}
+
+void Communication::updateNetworkInterest() {
 	std::lock_guard<std::mutex> lk(messageCallbacksLock);
+	const auto snapshot = loadCallbacks();
+	updateNetworkInterestLocked(snapshot ? *snapshot : CallbackSnapshot());
+}
 
-	// We want callbacks to be able to access errors
-	const bool downgrade = EventManager::GetInstance().isDowngradingErrorsOnCurrentThread();
-	if(downgrade)
-		EventManager::GetInstance().cancelErrorDowngradingOnCurrentThread();
-	for(auto& cb : messageCallbacks) {
-		if(!closing) { // We might have closed while reading or processing
-			cb.second->callIfMatch(msg);
-		}
+void Communication::updateNetworkInterestLocked(const CallbackSnapshot& snapshot) {
+	NetworkInterest interest;
+	for(const auto& reg : snapshot.messages) {
+		reg->callback->getFilter().addNetworkInterest(interest);
+		if(interest.wantsAll())
+			break;
+	}
+	for(const auto& reg : snapshot.messageBatches)
+		reg->callback->callback->getFilter().addNetworkInterest(interest);
+	if(!interest.wantsAll())
+		responses->addNetworkInterest(interest);
+
+	wantedInterest = interest;
+	if(!interest.wantsAll()) {
+		// Narrow down before letting go of everything, a wanted network is never missed in between
+		for(size_t i = 0; i < wantedTypes.size(); i++)
+			wantedTypes[i].store(interest.wants(Network::Type(i)), std::memory_order_relaxed);
+		for(size_t i = 0; i < wantedNetIDs.size(); i++)
+			wantedNetIDs[i].store(interest.wants(Network::NetID(i)), std::memory_order_relaxed);
 	}
-	if(downgrade)
-		EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+	wantsEverything.store(interest.wantsAll(), std::memory_order_release);
+}
+
+std::function<std::unique_ptr<Packetizer>()> Communication::skippingUnwantedNetworks(std::function<std::unique_ptr<Packetizer>()> makePacketizer) {
+	return [this, makePacketizer]() {
+		auto packetizer = makePacketizer();
+		if(packetizer)
+			packetizer->wantsNetwork = [this](const Network& network) {
+				return wantsNetwork(network) || (batchingCANFrames.load(std::memory_order_relaxed) && Decoder::IsCANFrameNetwork(network.getType()));
+			};
+		return packetizer;
+	};
 }
 
 void Communication::readTask() {
@@ -267,9 +984,10 @@ void Communication::readTask() {
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
 	while(!closing) {
-		readBytes.clear();
-		if(driver->readWait(readBytes)) {
+		if(driver->readChunkWait(readBytes)) {
 			handleInput(*packetizer, readBytes);
+			driver->releaseReadBuffer(std::move(readBytes));
+			readBytes.clear();
 		}
 	}
 }
@@ -292,12 +1010,38 @@ void Communication::handleInput(Packetizer& p, std::vector<uint8_t>& readBytes)
 		}
 	} else {
 		if(p.input(readBytes)) {
+			packetReads.fetch_add(1, std::memory_order_relaxed);
+			// Each thread reading keeps its own, so they keep their capacity from read to read
+			static thread_local std::vector<std::shared_ptr<Message>> messages;
+			static thread_local CANFrameBatch batch;
+			const bool batching = batchingCANFrames.load(std::memory_order_relaxed);
 			for(const auto& packet : p.output()) {
+				if(batching)
+					decoder->decodeToBatch(batch, *packet);
+
+				if(!wantsNetwork(packet->network))
+					continue; // Nobody would match it, so don't bother decoding
+
 				std::shared_ptr<Message> msg;
-				if(!decoder->decode(msg, packet))
-					continue;
+				if(decoder->decode(msg, packet))
+					messages.push_back(std::move(msg));
+			}
 
-				dispatchMessage(msg);
+			// Decoding errors stay downgraded, so the whole read is decoded before any callbacks run
+			if(!messages.empty() || !batch.empty()) {
+				for(const auto& msg : messages)
+					answerResponses(msg);
+				if(auto snapshot = loadCallbacks()) {
+					const DispatchFrame frame(*this, std::move(snapshot));
+					for(const auto& msg : messages)
+						frame.dispatch(msg);
+					if(!messages.empty())
+						frame.dispatch(messages);
+					if(!batch.empty())
+						frame.dispatch(batch);
+				}
+				messages.clear();
+				batch.clear();
 			}
 		}
 	}
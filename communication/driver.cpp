@@ -1,4 +1,6 @@
 #include "icsneo/communication/driver.h"
+#include <algorithm>
+#include <cstring>
 
 //#define ICSNEO_DRIVER_DEBUG_PRINTS
 #ifdef ICSNEO_DRIVER_DEBUG_PRINTS
@@ -13,17 +15,10 @@ bool Driver::read(std::vector<uint8_t>& bytes, size_t limit) {
 	if(limit == 0)
 		limit = (size_t)-1;
 
-	if(limit > (readQueue.size_approx() + 4))
-		limit = (readQueue.size_approx() + 4);
-
-	if(bytes.capacity() < limit)
-		bytes.resize(limit);
-
-	size_t actuallyRead = readQueue.try_dequeue_bulk(bytes.data(), limit);
-
-	if(bytes.size() > actuallyRead)
-		bytes.resize(actuallyRead);
+	bytes.clear();
 
+	std::lock_guard<std::mutex> lk(readRemainderMutex);
+	takeReadBytes(bytes, limit);
 	return true;
 }
 
@@ -32,15 +27,20 @@ bool Driver::readWait(std::vector<uint8_t>& bytes, std::chrono::milliseconds tim
 	if(limit == 0)
 		limit = (size_t)-1;
 
-	if(limit > (readQueue.size_approx() + 4))
-		limit = (readQueue.size_approx() + 4);
-
-	bytes.resize(limit);
-
-	size_t actuallyRead = readQueue.wait_dequeue_bulk_timed(bytes.data(), limit, timeout);
+	bytes.clear();
 
-	bytes.resize(actuallyRead);
+	std::lock_guard<std::mutex> lk(readRemainderMutex);
+	if(readRemainderOffset >= readRemainder.size()) {
+		std::vector<uint8_t> chunk;
+		if(!readQueue.wait_dequeue_timed(chunk, timeout))
+			return false;
+		releaseReadBuffer(std::move(readRemainder));
+		readRemainder = std::move(chunk);
+		readRemainderOffset = 0;
+	}
+	takeReadBytes(bytes, limit);
 
+	const size_t actuallyRead = bytes.size();
 #ifdef ICSNEO_DRIVER_DEBUG_PRINTS
 	if(actuallyRead > 0) {
 		std::cout << "Read data: (" << actuallyRead << ')' << std::hex << std::endl;
@@ -56,6 +56,83 @@ bool Driver::readWait(std::vector<uint8_t>& bytes, std::chrono::milliseconds tim
 	return actuallyRead > 0;
 }
 
+bool Driver::readChunkWait(std::vector<uint8_t>& chunk, std::chrono::milliseconds timeout) {
+	{
+		// Hand out anything left over from the compatibility path first so ordering is kept
+		std::lock_guard<std::mutex> lk(readRemainderMutex);
+		if(readRemainderOffset < readRemainder.size()) {
+			readRemainder.erase(readRemainder.begin(), readRemainder.begin() + readRemainderOffset);
+			chunk = std::move(readRemainder);
+			readRemainder = std::vector<uint8_t>();
+			readRemainderOffset = 0;
+			return true;
+		}
+	}
+
+	if(!readQueue.wait_dequeue_timed(chunk, timeout))
+		return false;
+	return !chunk.empty();
+}
+
+void Driver::releaseReadBuffer(std::vector<uint8_t>&& buffer) {
+	if(buffer.capacity() == 0 || readBufferPool.size_approx() >= MaxPooledReadBuffers)
+		return; // Let it be freed
+	buffer.clear();
+	readBufferPool.enqueue(std::move(buffer));
+}
+
+std::vector<uint8_t> Driver::acquireReadBuffer(size_t size) {
+	std::vector<uint8_t> buffer;
+	readBufferPool.try_dequeue(buffer);
+	buffer.resize(size);
+	return buffer;
+}
+
+void Driver::pushReadBuffer(std::vector<uint8_t>&& buffer) {
+	if(buffer.empty()) {
+		releaseReadBuffer(std::move(buffer));
+		return;
+	}
+	readQueue.enqueue(std::move(buffer));
+}
+
+void Driver::pushReadBytes(const uint8_t* data, size_t length) {
+	if(length == 0)
+		return;
+	auto buffer = acquireReadBuffer(length);
+	memcpy(buffer.data(), data, length);
+	readQueue.enqueue(std::move(buffer));
+}
+
+void Driver::clearReadQueue() {
+	std::vector<uint8_t> flush;
+	while(readQueue.try_dequeue(flush))
+		releaseReadBuffer(std::move(flush));
+
+	std::lock_guard<std::mutex> lk(readRemainderMutex);
+	readRemainder.clear();
+	readRemainderOffset = 0;
+}
+
+void Driver::takeReadBytes(std::vector<uint8_t>& bytes, size_t limit) {
+	// readRemainderMutex must be held
+	while(bytes.size() < limit) {
+		if(readRemainderOffset >= readRemainder.size()) {
+			std::vector<uint8_t> chunk;
+			if(!readQueue.try_dequeue(chunk))
+				break;
+			releaseReadBuffer(std::move(readRemainder));
+			readRemainder = std::move(chunk);
+			readRemainderOffset = 0;
+			continue;
+		}
+
+		const size_t toCopy = std::min(readRemainder.size() - readRemainderOffset, limit - bytes.size());
+		bytes.insert(bytes.end(), readRemainder.begin() + readRemainderOffset, readRemainder.begin() + readRemainderOffset + toCopy);
+		readRemainderOffset += toCopy;
+	}
+}
+
 bool Driver::write(const std::vector<uint8_t>& bytes) {
 	if(!isOpen()) {
 		report(APIEvent::Type::DeviceCurrentlyClosed, APIEvent::Severity::Error);
@@ -64,8 +141,11 @@ bool Driver::write(const std::vector<uint8_t>& bytes) {
 
 	if(writeBlocks) {
 		if(writeQueueFull()) {
-			while(writeQueueAlmostFull()) // Wait until we have some decent amount of space
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			// Wait until we have some decent amount of space, the write tasks wake us as they drain the queue.
+			// We still check periodically for drivers which manage their own queue and never notify.
+			std::unique_lock<std::mutex> lk(writeSpaceMutex);
+			while(writeQueueAlmostFull() && !closing && !disconnected)
+				writeSpaceCV.wait_for(lk, std::chrono::milliseconds(10));
 		}
 	} else {
 		if(writeQueueFull()) {
@@ -74,9 +154,109 @@ bool Driver::write(const std::vector<uint8_t>& bytes) {
 		}
 	}
 
-	const bool ret = writeInternal(bytes);
+	return queueWrite(WriteOperation(bytes));
+}
+
+bool Driver::writeAsync(const std::vector<uint8_t>& bytes, WriteCompletion onComplete) {
+	if(!isOpen()) {
+		report(APIEvent::Type::DeviceCurrentlyClosed, APIEvent::Severity::Error);
+		return false;
+	}
+
+	// Never wait for space here, the caller is pipelining and can wait for completions instead
+	if(writeQueueFull()) {
+		report(APIEvent::Type::TransmitBufferFull, APIEvent::Severity::Error);
+		return false;
+	}
+
+	return queueWrite(WriteOperation(bytes, std::move(onComplete)));
+}
+
+bool Driver::queueWrite(WriteOperation&& op) {
+	const bool ret = writeInternal(std::move(op));
 	if(!ret)
 		report(APIEvent::Type::Unknown, APIEvent::Severity::Error);
 
 	return ret;
-}
\ No newline at end of file
+}
+
+void Driver::notifyWriteSpace() {
+	// Taking the lock orders this with a writer which has just checked for space and is about to wait
+	{ std::lock_guard<std::mutex> lk(writeSpaceMutex); }
+	writeSpaceCV.notify_all();
+}
+
+bool Driver::dequeueWriteBatch(WriteBatch& batch, std::chrono::milliseconds timeout, bool linger) {
+	WriteOperation writeOp;
+	if(heldWrite) {
+		writeOp = std::move(*heldWrite);
+		heldWrite.reset();
+	} else if(!writeQueue.wait_dequeue_timed(writeOp, timeout)) {
+		return false;
+	}
+
+	batch.bytes += writeOp.bytes.size();
+	batch.operations.push_back(std::move(writeOp));
+
+	const auto deadline = std::chrono::steady_clock::now() + writeBatchMaxLatency;
+	while(batch.bytes < writeBatchMaxBytes) {
+		if(!writeQueue.try_dequeue(writeOp)) {
+			if(!linger || writeBatchMaxLatency.count() <= 0)
+				break;
+			const auto now = std::chrono::steady_clock::now();
+			if(now >= deadline || !writeQueue.wait_dequeue_timed(writeOp, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now)))
+				break;
+		}
+
+		if(batch.bytes + writeOp.bytes.size() > writeBatchMaxBytes) {
+			heldWrite = std::move(writeOp);
+			break;
+		}
+		batch.bytes += writeOp.bytes.size();
+		batch.operations.push_back(std::move(writeOp));
+	}
+
+	notifyWriteSpace();
+	return true;
+}
+
+bool Driver::dequeueCoalescedWrite(WriteOperation& writeOp, std::chrono::milliseconds timeout) {
+	WriteBatch batch;
+	if(!dequeueWriteBatch(batch, timeout))
+		return false;
+
+	if(batch.operations.size() == 1) {
+		writeOp = std::move(batch.operations.front());
+		batch.operations.clear();
+		return true;
+	}
+
+	writeOp.bytes.clear();
+	writeOp.bytes.reserve(batch.bytes);
+	std::vector<WriteCompletion> completions;
+	for(auto& op : batch.operations) {
+		writeOp.bytes.insert(writeOp.bytes.end(), op.bytes.begin(), op.bytes.end());
+		if(op.onComplete)
+			completions.push_back(std::move(op.onComplete));
+		op.onComplete = nullptr;
+	}
+	writeOp.onComplete = nullptr;
+	if(!completions.empty()) {
+		writeOp.onComplete = [completions = std::move(completions)](bool success) {
+			for(const auto& fn : completions)
+				fn(success);
+		};
+	}
+	batch.operations.clear();
+	return true;
+}
+
+void Driver::clearWriteQueue() {
+	WriteOperation flushop;
+	while(writeQueue.try_dequeue(flushop))
+		flushop.complete(false);
+	if(heldWrite)
+		heldWrite->complete(false);
+	heldWrite.reset();
+	notifyWriteSpace();
+}
@@ -9,111 +9,165 @@ using namespace icsneo;
 const size_t EthernetPacketizer::MaxPacketLength = 1490; // MTU - overhead
 static const uint8_t BROADCAST_MAC[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
 
-EthernetPacketizer::EthernetPacket& EthernetPacketizer::newSendPacket(bool first) {
-	processedDownPackets.emplace_back();
-	EthernetPacket& ret = processedDownPackets.back();
+static constexpr size_t HeaderLength = 24;
+
+void EthernetPacketizer::newSendFrame(bool first) {
+	uint16_t packetNumber;
 	if(first) {
-		ret.packetNumber = sequenceDown++;
+		packetNumber = sequenceDown++;
 	} else {
-		ret.firstPiece = false;
-		if(processedDownPackets.size() > 1)
-			ret.packetNumber = (processedDownPackets.rbegin() + 1)->packetNumber;
-		else
-			assert(false); // This should never be called with !first if there are no packets in the queue
+		assert(!downFrames.empty()); // This should never be called with !first if there are no packets in the queue
+		const uint8_t* previous = downBuffer.data() + downFrames.back();
+		packetNumber = previous[20] | (previous[21] << 8);
+		downBuffer[downFrames.back() + 22] &= ~0x02; // The previous piece is no longer the last
 	}
-	std::copy(std::begin(hostMAC), std::end(hostMAC), std::begin(ret.srcMAC));
-	std::copy(std::begin(deviceMAC), std::end(deviceMAC), std::begin(ret.destMAC));
-	return ret;
+
+	downFrames.push_back(downBuffer.size());
+	downBuffer.insert(downBuffer.end(), std::begin(deviceMAC), std::end(deviceMAC));
+	downBuffer.insert(downBuffer.end(), std::begin(hostMAC), std::end(hostMAC));
+	const uint8_t packetInfo = first ? 0x03 : 0x02; // This piece is the last until another follows it
+	downBuffer.insert(downBuffer.end(), {
+		0xCA, 0xB1, // EtherType, big endian
+		0xAA, 0xAA, 0x55, 0x55, // Our Ethernet header, big endian
+		0x00, 0x00, // Payload size, little endian, filled in by outputDown
+		uint8_t(packetNumber), uint8_t(packetNumber >> 8), // Little endian
+		packetInfo, 0x01 // Protocol version 1
+	});
+}
+
+size_t EthernetPacketizer::downFrameEnd(size_t frame) const {
+	return frame + 1 < downFrames.size() ? downFrames[frame + 1] : downBuffer.size();
 }
 
 void EthernetPacketizer::inputDown(std::vector<uint8_t> bytes, bool first) {
-	EthernetPacket* sendPacket = nullptr;
-	if(first && !processedDownPackets.empty()) {
-		// We have some packets already, let's see if we can add this to the last one
-		if(processedDownPackets.back().payload.size() + bytes.size() <= MaxPacketLength)
-			sendPacket = &processedDownPackets.back();
-	}
+	inputDown(bytes.data(), bytes.size(), first);
+}
 
-	if(sendPacket == nullptr)
-		sendPacket = &newSendPacket(first);
+void EthernetPacketizer::inputDown(const uint8_t* data, size_t length, bool first) {
+	if(downFramesTaken == downFrames.size()) {
+		// Everything has been sent, start again at the front of the buffer
+		downBuffer.clear();
+		downFrames.clear();
+		downFramesTaken = 0;
+	}
 
-	if(sendPacket->payload.empty())
-		sendPacket->payload = std::move(bytes);
-	else
-		sendPacket->payload.insert(sendPacket->payload.end(), bytes.begin(), bytes.end());
+	// We may be able to add this to the last packet, as long as it has not been taken yet
+	const bool canPack = first && downFramesTaken < downFrames.size() &&
+		downFrameEnd(downFrames.size() - 1) - downFrames.back() - HeaderLength + length <= MaxPacketLength;
+	if(!canPack)
+		newSendFrame(first);
 
 	// Split packets larger than MTU
-	std::vector<uint8_t> extraData;
-	if(sendPacket->payload.size() > MaxPacketLength) {
-		extraData.insert(extraData.end(), sendPacket->payload.begin() + MaxPacketLength, sendPacket->payload.end());
-		sendPacket->payload.resize(MaxPacketLength);
-		sendPacket->lastPiece = false;
-		inputDown(std::move(extraData), false);
+	while(true) {
+		const size_t room = MaxPacketLength - (downBuffer.size() - downFrames.back() - HeaderLength);
+		const size_t piece = std::min(room, length);
+		downBuffer.insert(downBuffer.end(), data, data + piece);
+		data += piece;
+		length -= piece;
+		if(length == 0)
+			break;
+		newSendFrame(false);
 	}
 }
 
+bool EthernetPacketizer::outputDown(const uint8_t*& frame, size_t& length) {
+	if(downFramesTaken == downFrames.size())
+		return false;
+
+	const size_t index = downFramesTaken++;
+	const size_t start = downFrames[index];
+	length = downFrameEnd(index) - start;
+	const size_t payloadSize = length - HeaderLength;
+	downBuffer[start + 18] = uint8_t(payloadSize);
+	downBuffer[start + 19] = uint8_t(payloadSize >> 8);
+	frame = downBuffer.data() + start;
+	return true;
+}
+
 std::vector< std::vector<uint8_t> > EthernetPacketizer::outputDown() {
 	std::vector< std::vector<uint8_t> > ret;
-	ret.reserve(processedDownPackets.size());
-	for(auto&& packet : std::move(processedDownPackets))
-		ret.push_back(packet.getBytestream());
-	processedDownPackets.clear();
+	ret.reserve(downFrames.size() - downFramesTaken);
+	const uint8_t* frame;
+	size_t length;
+	while(outputDown(frame, length))
+		ret.emplace_back(frame, frame + length);
 	return ret;
 }
 
 bool EthernetPacketizer::inputUp(std::vector<uint8_t> bytes) {
-	EthernetPacket packet(bytes);
+	return inputUp(bytes.data(), bytes.size());
+}
 
-	if(packet.errorWhileDecodingFromBytestream)
+bool EthernetPacketizer::inputUp(const uint8_t* data, size_t length) {
+	const uint8_t* payload;
+	size_t payloadLength;
+	if(inputUp(data, length, payload, payloadLength))
+		processedUpBytes.insert(processedUpBytes.end(), payload, payload + payloadLength);
+	return !processedUpBytes.empty(); // If there are packets in the pipe
+}
+
+bool EthernetPacketizer::inputUp(const uint8_t* data, size_t length, const uint8_t*& payload, size_t& payloadLength) {
+	if(data == nullptr || length < HeaderLength)
 		return false; // Bad packet
 
-	if(packet.etherType != 0xCAB2)
+	const uint16_t etherType = (data[12] << 8) | data[13];
+	if(etherType != 0xCAB2)
 		return false; // Not a packet to host
 
-	if(memcmp(packet.destMAC, hostMAC, sizeof(packet.destMAC)) != 0 &&
-		memcmp(packet.destMAC, BROADCAST_MAC, sizeof(packet.destMAC)) != 0)
+	const uint8_t* destMAC = data;
+	const uint8_t* srcMAC = data + 6;
+	if(memcmp(destMAC, hostMAC, sizeof(hostMAC)) != 0 &&
+		memcmp(destMAC, BROADCAST_MAC, sizeof(BROADCAST_MAC)) != 0)
 		return false; // Packet is not addressed to us or broadcast
 
-	if(!allowInPacketsFromAnyMAC && memcmp(packet.srcMAC, deviceMAC, sizeof(deviceMAC)) != 0)
+	if(!allowInPacketsFromAnyMAC && memcmp(srcMAC, deviceMAC, sizeof(deviceMAC)) != 0)
 		return false; // Not a packet from the device we're concerned with
 
-	// Handle single packets
-	if(packet.firstPiece && packet.lastPiece) {
+	const uint16_t payloadSize = data[18] | (data[19] << 8);
+	const uint16_t packetNumber = data[20] | (data[21] << 8);
+	const uint16_t packetInfo = data[22] | (data[23] << 8);
+	const bool firstPiece = packetInfo & 1;
+	const bool lastPiece = (packetInfo >> 1) & 1;
+	const uint8_t* piece = data + HeaderLength;
+	const size_t pieceLength = std::min<size_t>(length - HeaderLength, payloadSize);
+
+	// Handle single packets, these go up from where they lie
+	if(firstPiece && lastPiece) {
 		// Could ensure no out-of-order reassembly by checking reassembing here,
 		// not doing that here because it should be harmless if it ever happened.
-		processedUpBytes.insert(processedUpBytes.end(), std::make_move_iterator(packet.payload.begin()), std::make_move_iterator(packet.payload.end()));
+		payload = piece;
+		payloadLength = pieceLength;
 		return true;
 	}
 
-	if(packet.firstPiece) {
+	if(firstPiece) {
 		if(reassembling) {
 			//report(APIEvent::Type::FailedToRead, APIEvent::Severity::EventWarning);
 			reassemblingData.clear();
 		}
 
+		// The reassembly buffer keeps its capacity from packet to packet
 		reassembling = true;
-		reassemblingId = packet.packetNumber;
-		reassemblingData = std::move(packet.payload);
-		return !processedUpBytes.empty(); // If there are other packets in the pipe
+		reassemblingId = packetNumber;
+		reassemblingData.assign(piece, piece + pieceLength);
+		return false;
 	}
 
-	if(!reassembling || reassemblingId != packet.packetNumber) {
+	if(!reassembling || reassemblingId != packetNumber) {
 		//report(APIEvent::Type::FailedToRead, APIEvent::Severity::EventWarning);
 		reassembling = false;
 		reassemblingData.clear();
-		return !processedUpBytes.empty(); // If there are other packets in the pipe
+		return false;
 	}
 
-	if(packet.lastPiece) {
-		processedUpBytes.insert(processedUpBytes.end(), std::make_move_iterator(reassemblingData.begin()), std::make_move_iterator(reassemblingData.end()));
-		reassemblingData.clear();
-		reassembling = false;
-		processedUpBytes.insert(processedUpBytes.end(), std::make_move_iterator(packet.payload.begin()), std::make_move_iterator(packet.payload.end()));
-		return true;
-	}
+	reassemblingData.insert(reassemblingData.end(), piece, piece + pieceLength);
+	if(!lastPiece)
+		return false;
 
-	reassemblingData.insert(reassemblingData.end(), std::make_move_iterator(packet.payload.begin()), std::make_move_iterator(packet.payload.end()));
-	return !processedUpBytes.empty(); // If there are other packets in the pipe
+	reassembling = false;
+	payload = reassemblingData.data();
+	payloadLength = reassemblingData.size();
+	return true;
 }
 
 std::vector<uint8_t> EthernetPacketizer::outputUp() {
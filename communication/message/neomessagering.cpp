@@ -0,0 +1,136 @@
+#include "icsneo/communication/message/neomessagering.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace icsneo;
+
+static size_t RoundUpToPowerOf2(size_t value) {
+	size_t ret = 1;
+	while(ret < value)
+		ret <<= 1;
+	return ret;
+}
+
+// The data of any message which has some, whichever type it is
+static const std::vector<uint8_t>* PayloadOf(const Message& message) {
+	if(message.type == Message::Type::Frame)
+		return &static_cast<const Frame&>(message).data;
+	if(const auto raw = dynamic_cast<const RawMessage*>(&message))
+		return &raw->data;
+	return nullptr;
+}
+
+NeoMessageRing::NeoMessageRing(size_t messageCapacity, size_t payloadCapacity, Overflow overflow) :
+	messageMask(RoundUpToPowerOf2(std::max<size_t>(messageCapacity, 1)) - 1), payloadCapacity(std::max<size_t>(payloadCapacity, 1)), overflow(overflow),
+	records(new neomessage_t[messageMask + 1]), payloadEnds(new uint64_t[messageMask + 1]), payload(new uint8_t[this->payloadCapacity]) {}
+
+void NeoMessageRing::lockWriting() {
+	while(writing.test_and_set(std::memory_order_acquire))
+		std::this_thread::yield();
+}
+
+size_t NeoMessageRing::write(const std::vector<std::shared_ptr<Message>>& messages) {
+	lockWriting();
+
+	uint64_t h = head.load(std::memory_order_relaxed);
+	uint64_t t = tail.load(std::memory_order_acquire);
+	uint64_t freedPayload = payloadTail.load(std::memory_order_acquire);
+	size_t written = 0;
+	size_t evicted = 0;
+	const auto evictOldest = [&]() {
+		if(overflow != Overflow::DropOldest || reading || t == h)
+			return false;
+		freedPayload = payloadEnds[t & messageMask];
+		t++;
+		evicted++;
+		return true;
+	};
+	for(const auto& message : messages) {
+		if(h - t > messageMask && !evictOldest())
+			break; // No more records free, so none of the rest will fit either
+
+		neomessage_t neomsg = CreateNeoMessage(message);
+		// The record may point into the message's own data, which won't be around by the time it's read
+		const std::vector<uint8_t>* data = PayloadOf(*message);
+		neomessage_frame_t& frame = *(neomessage_frame_t*)&neomsg;
+		if(data && !data->empty() && frame.data >= data->data() && frame.data <= data->data() + data->size()) {
+			// A payload is never split across the end, the space left there is skipped
+			const auto startOf = [&]() {
+				uint64_t start = payloadHead;
+				if(start % payloadCapacity + data->size() > payloadCapacity)
+					start += payloadCapacity - start % payloadCapacity;
+				return start;
+			};
+			uint64_t start = startOf();
+			bool fits = true;
+			while(start + data->size() - freedPayload > payloadCapacity && (fits = evictOldest()))
+				start = startOf();
+			if(!fits)
+				continue; // Smaller ones after it may still fit
+			uint8_t* copy = payload.get() + start % payloadCapacity;
+			std::memcpy(copy, data->data(), data->size());
+			frame.data = copy + (frame.data - data->data());
+			payloadHead = start + data->size();
+		}
+		records[h & messageMask] = neomsg;
+		payloadEnds[h & messageMask] = payloadHead;
+		h++;
+		written++;
+	}
+	if(evicted != 0) {
+		payloadTail.store(freedPayload, std::memory_order_release);
+		tail.store(t, std::memory_order_release);
+	}
+	head.store(h, std::memory_order_release);
+	writing.clear(std::memory_order_release);
+
+	const size_t lost = messages.size() - written + evicted;
+	if(lost != 0)
+		dropped.fetch_add(lost, std::memory_order_relaxed);
+	return written;
+}
+
+const neomessage_t* NeoMessageRing::read(size_t& count) {
+	if(overflow == Overflow::DropOldest)
+		lockWriting(); // So the writer doesn't drop what we're about to hand out
+	const uint64_t t = tail.load(std::memory_order_relaxed);
+	uint64_t available = head.load(std::memory_order_acquire) - t;
+	available = std::min<uint64_t>(available, messageMask + 1 - (t & messageMask)); // Up to the end of the ring
+	if(count != 0)
+		available = std::min<uint64_t>(available, count);
+	count = size_t(available);
+	if(overflow == Overflow::DropOldest) {
+		reading = count != 0;
+		writing.clear(std::memory_order_release);
+	}
+	return &records[t & messageMask];
+}
+
+void NeoMessageRing::commit(size_t count) {
+	if(overflow == Overflow::DropOldest)
+		lockWriting();
+	const uint64_t t = tail.load(std::memory_order_relaxed);
+	count = size_t(std::min<uint64_t>(count, head.load(std::memory_order_acquire) - t));
+	if(count != 0) {
+		// Read before the records are handed back, after which the writer may replace them
+		payloadTail.store(payloadEnds[(t + count - 1) & messageMask], std::memory_order_release);
+		tail.store(t + count, std::memory_order_release);
+	}
+	if(overflow == Overflow::DropOldest) {
+		reading = false;
+		writing.clear(std::memory_order_release);
+	}
+}
+
+size_t NeoMessageRing::size() const {
+	const uint64_t t = tail.load(std::memory_order_acquire);
+	return size_t(head.load(std::memory_order_acquire) - t);
+}
+
+uint64_t NeoMessageRing::takeNewlyDropped() {
+	const uint64_t total = dropped.load(std::memory_order_relaxed);
+	const uint64_t ret = total - droppedReported;
+	droppedReported = total;
+	return ret;
+}
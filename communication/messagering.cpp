@@ -0,0 +1,147 @@
+#include "icsneo/communication/messagering.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+using namespace icsneo;
+
+MessageRing::MessageRing(size_t limit, Overflow overflow) :
+	slots(new Slot[InitialCapacity]), mask(InitialCapacity - 1), limit(limit), overflow(overflow) {}
+
+bool MessageRing::push(std::shared_ptr<Message> message) {
+	while(pushing.test_and_set(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	const uint64_t h = head.load(std::memory_order_relaxed);
+	const size_t max = limit.load(std::memory_order_relaxed);
+	bool stored = (max != 0);
+	uint64_t t = tail.load(std::memory_order_acquire);
+	while(stored && h - t >= std::min<uint64_t>(max, mask + 1)) {
+		if(mask + 1 < max) {
+			grow();
+			t = tail.load(std::memory_order_acquire);
+		} else if(overflow.load(std::memory_order_relaxed) == Overflow::DropNewest) {
+			stored = false;
+		} else {
+			// Consumers may be claiming at the same time, in which case there's likely room once we see what they took
+			const uint64_t newTail = h - max + 1;
+			if(tail.compare_exchange_weak(t, newTail, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				dropped.fetch_add(newTail - t, std::memory_order_relaxed);
+				t = newTail;
+			}
+		}
+	}
+
+	if(stored) {
+		// Whatever was there before has either been taken, dropped, or is being given up on by a slow consumer
+		Slot& slot = slots[h & mask];
+		slot.lock();
+		slot.index = h;
+		slot.message.swap(message);
+		slot.unlock();
+		head.store(h + 1, std::memory_order_release);
+	} else {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	pushing.clear(std::memory_order_release);
+	message.reset(); // Freed outside of the lock
+
+	if(stored) {
+		std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with pop() announcing that it's waiting
+		if(waiting.load(std::memory_order_relaxed) != 0)
+			pushed.signal();
+	}
+	return stored;
+}
+
+size_t MessageRing::pop(std::vector<std::shared_ptr<Message>>& out, size_t max, std::chrono::milliseconds timeout) {
+	out.clear();
+	if(max == 0)
+		max = std::numeric_limits<size_t>::max();
+
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while(true) {
+		{
+			std::lock_guard<std::mutex> lk(popMutex);
+			uint64_t t = tail.load(std::memory_order_acquire);
+			uint64_t count;
+			do {
+				count = std::min<uint64_t>(head.load(std::memory_order_acquire) - t, max);
+			} while(count != 0 && !tail.compare_exchange_weak(t, t + count, std::memory_order_acq_rel, std::memory_order_acquire));
+
+			if(count != 0) {
+				out.reserve(count);
+				uint64_t lost = 0;
+				for(uint64_t i = t; i != t + count; i++) {
+					Slot& slot = slots[i & mask];
+					slot.lock();
+					if(slot.index == i && slot.message)
+						out.push_back(std::move(slot.message));
+					else
+						lost++; // The producer came around again before we got to it
+					slot.unlock();
+				}
+				if(lost != 0)
+					dropped.fetch_add(lost, std::memory_order_relaxed);
+				return out.size();
+			}
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if(timeout <= std::chrono::milliseconds(0) || now >= deadline)
+			return 0;
+		waiting.fetch_add(1);
+		if(tail.load() == head.load())
+			pushed.wait(std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count());
+		waiting.fetch_sub(1);
+	}
+}
+
+size_t MessageRing::size() const {
+	const uint64_t t = tail.load(std::memory_order_acquire); // First, as the head only ever moves further ahead
+	return size_t(head.load(std::memory_order_acquire) - t);
+}
+
+void MessageRing::clear() {
+	while(pushing.test_and_set(std::memory_order_acquire))
+		std::this_thread::yield();
+	{
+		std::lock_guard<std::mutex> lk(popMutex);
+		tail.store(head.load(std::memory_order_relaxed), std::memory_order_release);
+		for(size_t i = 0; i <= mask; i++)
+			slots[i].message.reset();
+	}
+	pushing.clear(std::memory_order_release);
+}
+
+void MessageRing::setLimit(size_t newLimit) {
+	limit.store(newLimit, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lk(popMutex);
+	uint64_t t = tail.load(std::memory_order_acquire);
+	while(true) {
+		const uint64_t h = head.load(std::memory_order_acquire);
+		if(h - t <= newLimit)
+			break;
+		// The messages stay in their slots until the producer comes around to them again
+		if(tail.compare_exchange_weak(t, h - newLimit, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			dropped.fetch_add(h - newLimit - t, std::memory_order_relaxed);
+			break;
+		}
+	}
+}
+
+void MessageRing::grow() {
+	// Consumers, and setLimit(), only move the tail while holding popMutex
+	std::lock_guard<std::mutex> lk(popMutex);
+	const size_t capacity = (mask + 1) * 2;
+	std::unique_ptr<Slot[]> larger(new Slot[capacity]);
+	const uint64_t h = head.load(std::memory_order_relaxed);
+	for(uint64_t i = tail.load(std::memory_order_relaxed); i != h; i++) {
+		Slot& to = larger[i & (capacity - 1)];
+		to.index = i;
+		to.message = std::move(slots[i & mask].message);
+	}
+	slots = std::move(larger);
+	mask = capacity - 1;
+}
@@ -3,21 +3,58 @@
 #include "icsneo/communication/decoder.h"
 #include "icsneo/communication/packetizer.h"
 #include "icsneo/communication/message/neoreadmemorysdmessage.h"
+#include <algorithm>
 
 using namespace icsneo;
 
+static std::mutex defaultExecutionMutex;
+static MultiChannelCommunication::VnetExecution defaultExecution = MultiChannelCommunication::VnetExecution::ThreadPerVnet;
+static size_t sharedWorkerCount = 2;
+static std::shared_ptr<WorkerPool> sharedWorkers; // Created the first time a device opens in Pooled mode
+
+void MultiChannelCommunication::SetDefaultVnetExecution(VnetExecution execution, size_t poolThreads) {
+	std::lock_guard<std::mutex> lk(defaultExecutionMutex);
+	defaultExecution = execution;
+	if(execution != VnetExecution::Pooled || sharedWorkerCount != poolThreads)
+		sharedWorkers.reset(); // Open devices hold on to the old pool until they close
+	sharedWorkerCount = poolThreads;
+}
+
+MultiChannelCommunication::VnetExecution MultiChannelCommunication::GetDefaultVnetExecution() {
+	std::lock_guard<std::mutex> lk(defaultExecutionMutex);
+	return defaultExecution;
+}
+
 MultiChannelCommunication::MultiChannelCommunication(device_eventhandler_t err, std::unique_ptr<Driver> com,
 	std::function<std::unique_ptr<Packetizer>()> makeConfiguredPacketizer, std::unique_ptr<Encoder> e,
 	std::unique_ptr<Decoder> md, size_t vnetCount) :
-	Communication(err, std::move(com), makeConfiguredPacketizer, std::move(e), std::move(md)), numVnets(vnetCount) {
+	Communication(err, std::move(com), makeConfiguredPacketizer, std::move(e), std::move(md)), numVnets(vnetCount), vnetQueued(vnetCount) {
 	vnetThreads.resize(numVnets);
+	vnetPacketizers.resize(numVnets);
 	vnetQueues.resize(numVnets);
+	vnetBatches.resize(numVnets);
 }
 
 void MultiChannelCommunication::spawnThreads() {
+	demuxCarry.clear();
+	gotPacket = false;
+	{
+		std::lock_guard<std::mutex> lk(defaultExecutionMutex);
+		execution = executionOverride.value_or(defaultExecution);
+		if(execution == VnetExecution::Pooled) {
+			if(!sharedWorkers)
+				sharedWorkers = std::make_shared<WorkerPool>(sharedWorkerCount);
+			workers = sharedWorkers;
+		}
+	}
+
 	for(size_t i = 0; i < numVnets; i++) {
+		vnetBatches[i].clear();
 		while(vnetQueues[i].pop()) {} // Ensure the queue is empty
-		vnetThreads[i] = std::thread(&MultiChannelCommunication::vnetReadTask, this, i);
+		if(i != 0)
+			vnetPacketizers[i] = makeConfiguredPacketizer();
+		if(execution == VnetExecution::ThreadPerVnet)
+			vnetThreads[i] = std::thread(&MultiChannelCommunication::vnetReadTask, this, i);
 	}
 	hidReadThread = std::thread(&MultiChannelCommunication::hidReadTask, this);
 }
@@ -30,6 +67,14 @@ void MultiChannelCommunication::joinThreads() {
 		if(thread.joinable())
 			thread.join();
 	}
+	if(workers) {
+		// Nothing more will be posted, wait for the pool to finish what it has of ours
+		std::unique_lock<std::mutex> lk(vnetIdleMutex);
+		vnetIdle.wait(lk, [this]() {
+			return std::all_of(vnetQueued.begin(), vnetQueued.end(), [](const std::atomic<size_t>& queued) { return queued == 0; });
+		});
+		workers.reset();
+	}
 	closing = false;
 }
 
@@ -38,138 +83,199 @@ bool MultiChannelCommunication::sendPacket(std::vector<uint8_t>& bytes) {
 	return rawWrite(bytes);
 }
 
+bool MultiChannelCommunication::sendPacketAsync(std::vector<uint8_t>& bytes, Driver::WriteCompletion onComplete) {
+	bytes.insert(bytes.begin(), {(uint8_t)CommandType::HostPC_to_Vnet1, (uint8_t)bytes.size(), (uint8_t)(bytes.size() >> 8)});
+	return rawWriteAsync(bytes, std::move(onComplete));
+}
+
+void MultiChannelCommunication::appendPacket(std::vector<uint8_t>& batch, const std::vector<uint8_t>& packet) {
+	batch.insert(batch.end(), {(uint8_t)CommandType::HostPC_to_Vnet1, (uint8_t)packet.size(), (uint8_t)(packet.size() >> 8)});
+	batch.insert(batch.end(), packet.begin(), packet.end());
+}
+
 void MultiChannelCommunication::hidReadTask() {
-	bool readMore = true;
-	bool gotPacket = false; // Have we got the first valid packet (don't flag errors otherwise)
-	std::deque<uint8_t> usbReadFifo;
 	std::vector<uint8_t> readBytes;
-	std::vector<uint8_t> payloadBytes;
+	size_t needed;
 
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
 	while(!closing) {
-		if(readMore) {
-			readBytes.clear();
-			if(driver->readWait(readBytes)) {
-				readMore = false;
-				usbReadFifo.insert(usbReadFifo.end(), std::make_move_iterator(readBytes.begin()), std::make_move_iterator(readBytes.end()));
-			}
-		} else {
-			switch(state) {
-				case PreprocessState::SearchForCommand:
-					if(usbReadFifo.size() < 1) {
-						readMore = true;
-						continue;
-					}
-
-					currentCommandType = (CommandType)usbReadFifo[0];
-
-					if(!CommandTypeIsValid(currentCommandType)) {
-						// Device to host bytes discarded
-						if(gotPacket)
-							EventManager::GetInstance().add(APIEvent(APIEvent::Type::FailedToRead, APIEvent::Severity::Error));
-						usbReadFifo.pop_front();
-						continue;
-					}
-
-					currentReadIndex = 1;
-
-					if(CommandTypeHasAddress(currentCommandType)) {
-						state = PreprocessState::ParseAddress;
-						continue; // No commands which define an address also define a length, so we can just continue from there
-					}
-
-					currentCommandLength = CommandTypeDefinesLength(currentCommandType);
-					if(currentCommandLength == 0) {
-						state = PreprocessState::ParseLength;
-						continue;
-					}
-
-					state = PreprocessState::GetData;
-					continue;
-				case PreprocessState::ParseAddress:
-					// The address is represented by a 4 byte little endian
-					// Don't care about it yet
-					currentReadIndex += 4;
-					// Intentionally fall through
-				case PreprocessState::ParseLength:
-					state = PreprocessState::ParseLength; // Set state in case we've fallen through, but later need to go around again
-
-					if(usbReadFifo.size() < currentReadIndex + 2) { // Come back we have more data
-						readMore = true;
-						continue;
-					}
-
-					// The length is represented by a 2 byte little endian
-					currentCommandLength = usbReadFifo[currentReadIndex++];
-					currentCommandLength |= usbReadFifo[currentReadIndex++] << 8;
-					// Intentionally fall through
-				case PreprocessState::GetData:
-					state = PreprocessState::GetData; // Set state in case we've fallen through, but later need to go around again
-
-					if(usbReadFifo.size() < currentReadIndex + currentCommandLength) { // Come back when we have more data
-						readMore = true;
-						continue;
-					}
-
-					for(size_t i = 0; i < currentReadIndex; i++)
-						usbReadFifo.pop_front();
-
-					payloadBytes.clear();
-					payloadBytes.resize(currentCommandLength);
-					for(auto i = 0; i < currentCommandLength; i++) {
-						payloadBytes[i] = usbReadFifo[0];
-						usbReadFifo.pop_front();
-					}
-
-					moodycamel::BlockingReaderWriterQueue< std::vector<uint8_t> >* currentQueue = nullptr;
-					switch(currentCommandType) {
-						case CommandType::Vnet1_to_HostPC:
-							currentQueue = &vnetQueues[0];
-							break;
-						case CommandType::Vnet2_to_HostPC:
-							if(numVnets >= 2)
-								currentQueue = &vnetQueues[1];
-							break;
-						case CommandType::Vnet3_to_HostPC:
-							if(numVnets >= 3)
-								currentQueue = &vnetQueues[2];
-							break;
-						case CommandType::SDCC1_to_HostPC: {
-							auto msg = std::make_shared<NeoReadMemorySDMessage>();
-							std::swap(msg->data, payloadBytes);
-							dispatchMessage(msg);
-							break;
-						}
-					}
-
-					if(currentQueue == nullptr) {
-						state = PreprocessState::SearchForCommand;
-						break;
-					}
-
-					if(!currentQueue->enqueue(std::move(payloadBytes)) && gotPacket)
-						EventManager::GetInstance().add(APIEvent(APIEvent::Type::FailedToRead, APIEvent::Severity::Error));
-					payloadBytes.clear();
-					gotPacket = true;
-					state = PreprocessState::SearchForCommand;
+		if(!driver->readChunkWait(readBytes))
+			continue;
+
+		const uint8_t* data = readBytes.data();
+		size_t length = readBytes.size();
+		if(!demuxCarry.empty()) {
+			// Finish off the command which straddled the end of the last read,
+			// taking only as many bytes as it needs so the rest can be parsed in place
+			while(true) {
+				demuxCarry.erase(demuxCarry.begin(), demuxCarry.begin() + demux(demuxCarry.data(), demuxCarry.size(), needed));
+				if(demuxCarry.empty() || length == 0)
 					break;
+				const size_t take = std::min(needed - demuxCarry.size(), length);
+				demuxCarry.insert(demuxCarry.end(), data, data + take);
+				data += take;
+				length -= take;
 			}
 		}
+
+		if(demuxCarry.empty()) {
+			const size_t used = demux(data, length, needed);
+			demuxCarry.assign(data + used, data + length);
+		}
+
+		driver->releaseReadBuffer(std::move(readBytes));
+		readBytes.clear();
+
+		// Everything each VNET got from this read goes to it together
+		for(size_t i = 0; i < numVnets; i++) {
+			if(!vnetBatches[i].empty())
+				runVnet(i);
+		}
+	}
+}
+
+void MultiChannelCommunication::runVnet(size_t vnetIndex) {
+	auto& batch = vnetBatches[vnetIndex];
+	switch(execution) {
+		case VnetExecution::ThreadPerVnet:
+			break;
+		case VnetExecution::Inline:
+			handleVnetInput(vnetIndex, batch);
+			batch.clear();
+			return;
+		case VnetExecution::Pooled:
+			// Nothing of this VNET's is on the pool, so nobody else is using its packetizer
+			if(batch.size() <= InlineBatchLimit && vnetQueued[vnetIndex].load(std::memory_order_acquire) == 0) {
+				handleVnetInput(vnetIndex, batch);
+				batch.clear();
+				return;
+			}
+			break;
+	}
+
+	if(!vnetQueues[vnetIndex].enqueue(std::move(batch))) {
+		if(gotPacket)
+			EventManager::GetInstance().add(APIEvent(APIEvent::Type::FailedToRead, APIEvent::Severity::Error));
+	} else if(execution == VnetExecution::Pooled && vnetQueued[vnetIndex].fetch_add(1, std::memory_order_acq_rel) == 0) {
+		workers->post([this, vnetIndex]() { drainVnet(vnetIndex); });
 	}
+	batch = std::vector<uint8_t>();
+	vnetBufferPool.try_dequeue(batch);
+}
+
+void MultiChannelCommunication::drainVnet(size_t vnetIndex) {
+	// Only one drain runs for a VNET at a time, since another is only posted once vnetQueued has gone back to 0
+	std::atomic<size_t>& queued = vnetQueued[vnetIndex];
+	std::vector<uint8_t> payloadBytes;
+	for(size_t handled = 1; ; handled++) {
+		if(vnetQueues[vnetIndex].try_dequeue(payloadBytes)) {
+			if(!closing)
+				handleVnetInput(vnetIndex, payloadBytes);
+			if(payloadBytes.capacity() != 0 && vnetBufferPool.size_approx() < MaxPooledVnetBuffers) {
+				payloadBytes.clear();
+				vnetBufferPool.enqueue(std::move(payloadBytes));
+			}
+		}
+
+		// Only we take away from vnetQueued, so if there's more than one there's still more once we do
+		if(queued.load(std::memory_order_acquire) > 1) {
+			queued.fetch_sub(1, std::memory_order_acq_rel);
+			if(handled == MaxBatchesPerTurn) {
+				workers->post([this, vnetIndex]() { drainVnet(vnetIndex); });
+				return;
+			}
+			continue;
+		}
+
+		// joinThreads() checks under the lock, so we're done with `this` once we let go of it
+		std::lock_guard<std::mutex> lk(vnetIdleMutex);
+		if(queued.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			vnetIdle.notify_all();
+			return;
+		}
+	}
+}
+
+void MultiChannelCommunication::handleVnetInput(size_t vnetIndex, std::vector<uint8_t>& bytes) {
+	handleInput(vnetIndex == 0 ? *packetizer : *vnetPacketizers[vnetIndex], bytes);
+}
+
+size_t MultiChannelCommunication::demux(const uint8_t* data, size_t length, size_t& needed) {
+	size_t offset = 0;
+	while(offset < length) {
+		const uint8_t* command = data + offset;
+		const size_t available = length - offset;
+		const CommandType commandType = (CommandType)command[0];
+
+		if(!CommandTypeIsValid(commandType)) {
+			// Device to host bytes discarded
+			if(gotPacket)
+				EventManager::GetInstance().add(APIEvent(APIEvent::Type::FailedToRead, APIEvent::Severity::Error));
+			offset++;
+			continue;
+		}
+
+		size_t headerLength = 1;
+		// The address is represented by a 4 byte little endian
+		// Don't care about it yet
+		if(CommandTypeHasAddress(commandType))
+			headerLength += 4;
+
+		size_t commandLength = CommandTypeDefinesLength(commandType);
+		if(commandLength == 0) {
+			if(available < headerLength + 2) { // Come back we have more data
+				needed = headerLength + 2;
+				return offset;
+			}
+
+			// The length is represented by a 2 byte little endian
+			commandLength = command[headerLength] | (command[headerLength + 1] << 8);
+			headerLength += 2;
+		}
+
+		if(available < headerLength + commandLength) { // Come back when we have more data
+			needed = headerLength + commandLength;
+			return offset;
+		}
+
+		const uint8_t* payload = command + headerLength;
+		offset += headerLength + commandLength;
+
+		size_t vnet;
+		switch(commandType) {
+			case CommandType::Vnet1_to_HostPC:
+				vnet = 0;
+				break;
+			case CommandType::Vnet2_to_HostPC:
+				vnet = 1;
+				break;
+			case CommandType::Vnet3_to_HostPC:
+				vnet = 2;
+				break;
+			case CommandType::SDCC1_to_HostPC: {
+				auto msg = std::make_shared<NeoReadMemorySDMessage>();
+				msg->data.assign(payload, payload + commandLength);
+				dispatchMessage(msg);
+				continue;
+			}
+			default:
+				continue;
+		}
+
+		if(vnet >= numVnets)
+			continue;
+
+		vnetBatches[vnet].insert(vnetBatches[vnet].end(), payload, payload + commandLength);
+		gotPacket = true;
+	}
+
+	return offset;
 }
 
 void MultiChannelCommunication::vnetReadTask(size_t vnetIndex) {
 	moodycamel::BlockingReaderWriterQueue< std::vector<uint8_t> >& queue = vnetQueues[vnetIndex];
 	std::vector<uint8_t> payloadBytes;
-	std::unique_ptr<Packetizer> packetizerLifetime;
-	Packetizer* vnetPacketizer;
-	if(vnetIndex == 0)
-		vnetPacketizer = packetizer.get();
-	else {
-		packetizerLifetime = makeConfiguredPacketizer();
-		vnetPacketizer = packetizerLifetime.get();
-	}
 
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
@@ -178,7 +284,11 @@ void MultiChannelCommunication::vnetReadTask(size_t vnetIndex) {
 			if(closing)
 				break;
 			
-			handleInput(*vnetPacketizer, payloadBytes);
+			handleVnetInput(vnetIndex, payloadBytes);
+			if(payloadBytes.capacity() != 0 && vnetBufferPool.size_approx() < MaxPooledVnetBuffers) {
+				payloadBytes.clear();
+				vnetBufferPool.enqueue(std::move(payloadBytes));
+			}
 		}
 	}
 }
\ No newline at end of file
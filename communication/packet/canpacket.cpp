@@ -54,7 +54,7 @@ static std::optional<uint8_t> CAN_LengthToDLC(size_t dataLength, bool fd)
 	return std::nullopt;
 }
 
-std::shared_ptr<Message> HardwareCANPacket::DecodeToMessage(const std::vector<uint8_t>& bytestream) {
+std::shared_ptr<Message> HardwareCANPacket::DecodeToMessage(const std::vector<uint8_t>& bytestream, ObjectPool<CANMessage>* pool) {
 	const HardwareCANPacket* data = (const HardwareCANPacket*)bytestream.data();
 
 	if(data->dlc.RB1) { // Change counts reporting
@@ -70,7 +70,7 @@ std::shared_ptr<Message> HardwareCANPacket::DecodeToMessage(const std::vector<ui
 		return msg;
 
 	} else { // CAN Frame
-		auto msg = std::make_shared<CANMessage>();
+		auto msg = pool ? pool->make() : std::make_shared<CANMessage>();
 
 		// Arb ID
 		if(data->header.IDE) { // Extended 29-bit ID
@@ -125,6 +125,65 @@ std::shared_ptr<Message> HardwareCANPacket::DecodeToMessage(const std::vector<ui
 	}
 }
 
+bool HardwareCANPacket::DecodeToBatch(const uint8_t* bytes, size_t length, Network::NetID netid, CANFrameBatch& batch) {
+	if(length < sizeof(HardwareCANPacket))
+		return false;
+	const HardwareCANPacket* data = (const HardwareCANPacket*)bytes;
+	if(data->dlc.RB1)
+		return false; // Change counts reporting, not a frame
+
+	// The same as DecodeToMessage(), a column at a time
+	uint16_t flags = 0;
+	uint32_t arbid;
+	if(data->header.IDE) {
+		arbid = (data->header.SID & 0x7ff) << 18;
+		arbid |= (data->eid.EID & 0xfff) << 6;
+		arbid |= (data->dlc.EID2 & 0x3f);
+		flags |= CANFrameBatch::Extended;
+	} else {
+		arbid = data->header.SID;
+	}
+
+	uint8_t dataLength = data->dlc.DLC;
+	if(data->header.EDL && data->timestamp.IsExtended) {
+		flags |= CANFrameBatch::CANFD;
+		if(data->header.BRS)
+			flags |= CANFrameBatch::BaudrateSwitch;
+		if(data->header.ESI)
+			flags |= CANFrameBatch::ErrorStateIndicator;
+		const std::optional<uint8_t> lenFromDLC = CAN_DLCToLength(dataLength, true);
+		if(lenFromDLC)
+			dataLength = *lenFromDLC;
+	} else if(dataLength > 8) {
+		dataLength = 8;
+	}
+
+	// Extra data comes after the uint16_t netid and uint16_t length which follow the packet
+	static constexpr size_t ExtraDataStart = sizeof(HardwareCANPacket) + 2 + 2;
+	if((data->dlc.RTR && data->header.IDE) || (!data->header.IDE && data->header.SRR)) {
+		flags |= CANFrameBatch::Remote;
+	} else {
+		if(dataLength > 8 && length < ExtraDataStart + (dataLength - 8))
+			return false;
+		batch.payload.insert(batch.payload.end(), data->data, data->data + (dataLength > 8 ? 8 : dataLength));
+		if(dataLength > 8)
+			batch.payload.insert(batch.payload.end(), bytes + ExtraDataStart, bytes + ExtraDataStart + (dataLength - 8));
+	}
+
+	if(data->eid.TXMSG)
+		flags |= CANFrameBatch::Transmitted;
+	if(data->eid.TXAborted || data->eid.TXError || data->eid.TXLostArb)
+		flags |= CANFrameBatch::Error;
+
+	batch.timestamps.push_back(data->timestamp.TS);
+	batch.arbids.push_back(arbid);
+	batch.flags.push_back(flags);
+	batch.dlcs.push_back(uint8_t(data->dlc.DLC));
+	batch.netids.push_back(netid);
+	batch.payloadOffsets.push_back(uint32_t(batch.payload.size()));
+	return true;
+}
+
 bool HardwareCANPacket::EncodeFromMessage(const CANMessage& message, std::vector<uint8_t>& result, const device_eventhandler_t& report) {
 	if(message.isCANFD && message.isRemote) {
 		report(APIEvent::Type::RTRNotSupported, APIEvent::Severity::Error);
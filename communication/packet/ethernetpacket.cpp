@@ -4,7 +4,7 @@
 
 using namespace icsneo;
 
-std::shared_ptr<EthernetMessage> HardwareEthernetPacket::DecodeToMessage(const std::vector<uint8_t>& bytestream, const device_eventhandler_t& report) {
+std::shared_ptr<EthernetMessage> HardwareEthernetPacket::DecodeToMessage(const std::vector<uint8_t>& bytestream, const device_eventhandler_t& report, ObjectPool<EthernetMessage>* pool) {
 	const HardwareEthernetPacket* packet = (const HardwareEthernetPacket*)((const void*)bytestream.data());
 	const uint16_t* rawWords = (const uint16_t*)bytestream.data();
 	
@@ -26,7 +26,7 @@ std::shared_ptr<EthernetMessage> HardwareEthernetPacket::DecodeToMessage(const s
 	if(bytestreamActualSize > bytestreamExpectedSize + 1)
 		report(APIEvent::Type::PacketDecodingError, APIEvent::Severity::EventWarning);
 
-	auto messagePtr = std::make_shared<EthernetMessage>();
+	auto messagePtr = pool ? pool->make() : std::make_shared<EthernetMessage>();
 	EthernetMessage& message = *messagePtr;
 
 	message.transmitted = packet->eid.TXMSG;
@@ -1,17 +1,22 @@
 #include "icsneo/communication/packetizer.h"
+#include <algorithm>
 #include <iomanip>
 
 using namespace icsneo;
 
-uint8_t Packetizer::ICSChecksum(const std::vector<uint8_t>& data) {
+static uint8_t Checksum(const uint8_t* data, size_t length) {
 	uint32_t checksum = 0;
-	for(size_t i = 0; i < data.size(); i++)
+	for(size_t i = 0; i < length; i++)
 		checksum += data[i];
 	checksum = ~checksum;
 	checksum++;
 	return (uint8_t)checksum;
 }
 
+uint8_t Packetizer::ICSChecksum(const std::vector<uint8_t>& data) {
+	return Checksum(data.data(), data.size());
+}
+
 std::vector<uint8_t>& Packetizer::packetWrap(std::vector<uint8_t>& data, bool shortFormat) const {
 	if(shortFormat) {
 		// Some devices don't use the checksum, so might as well not calculate it if that's the case
@@ -25,159 +30,139 @@ std::vector<uint8_t>& Packetizer::packetWrap(std::vector<uint8_t>& data, bool sh
 }
 
 bool Packetizer::input(const std::vector<uint8_t>& inputBytes) {
-	bool haveEnoughData = true;
-
-	bytes.Copy(inputBytes);
-
-	while(haveEnoughData) {
-		switch(state) {
-			case ReadState::SearchForHeader:
-				if(bytes.size() < 1) {
-					haveEnoughData = false;
-					break;
-				}
-
-				if(bytes[0] == 0xAA) { // 0xAA denotes the beginning of a packet
-					state = ReadState::ParseHeader;
-					currentIndex = 1;
-				} else {
-					bytes.pop_front(); // Discard
-				}
-				break;
-			case ReadState::ParseHeader:
-				if(bytes.size() < 2) {
-					haveEnoughData = false;
-					break;
-				}
-	
-				packetLength = bytes[1] >> 4 & 0xF;
-				packet.network = Network(bytes[1] & 0xF); // Lower nibble of the second byte is the network ID
-
-				if(packetLength == 0) {
-					state = ReadState::ParseLongStylePacketHeader;
-					break;
-				} else if(packetLength == 0xA && packet.network == Network::NetID::DiskData) {
-					state = ReadState::ParseDiskDataHeader;
-					break;
-				}
-
-				checksum = true; // Even if checksum is not explicitly disallowed, we enable it here, as this goes into length calculation
-				headerSize = 2;
-				packetLength += 2; // The packet length given in short packets does not include header
-				currentIndex++;
-				state = ReadState::GetData;
-				break;
-			case ReadState::ParseLongStylePacketHeader:
-				if(bytes.size() < 6) {
-					haveEnoughData = false;
-					break;
-				}
-				
-				packetLength = bytes[2]; // Long packets have a little endian length on bytes 3 and 4
-				packetLength |= bytes[3] << 8;
-				packet.network = Network(((bytes[5] << 8) | bytes[4]), false); // Long packets have their netid stored as little endian on bytes 5 and 6. Devices never send actual VNET IDs so we must not perform ID expansion here.
-
-				/* Long packets can't have a length less than 6, because that would indicate a negative payload size.
-				* Unlike the short packet length, the long packet length encompasses everything from the 0xAA to the
-				* end of the payload. The short packet length, for reference, only encompasses the length of the actual
-				* payload, and not the header or checksum.
-				*/
-				if(packetLength < 6 || packetLength > 4000) {
-					bytes.pop_front();
-					EventManager::GetInstance().add(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
-					state = ReadState::SearchForHeader;
-					break;
-				}
-
-				checksum = false;
-				headerSize = 6;
-				currentIndex += 5;
-				state = ReadState::GetData;
-				break;
-			case ReadState::ParseDiskDataHeader:
-				if(bytes.size() < 3) {
-					haveEnoughData = false;
-					break;
-				}
-
-				if(bytes[2] != 0xAA) {
-					bytes.pop_front();
-					state = ReadState::SearchForHeader;
-					break;
-				}
-
-				if(bytes.size() < 4) {
-					haveEnoughData = false;
-					break;
-				}
-
-				if(bytes[3] != 0x55) {
-					bytes.pop_front();
-					state = ReadState::SearchForHeader;
-					break;
-				}
-
-				if(bytes.size() < 5) {
-					haveEnoughData = false;
-					break;
-				}
-
-				if(bytes[4] != 0x55) {
-					bytes.pop_front();
-					state = ReadState::SearchForHeader;
-					break;
-				}
-
-				if(bytes.size() < 7) {
-					haveEnoughData = false;
-					break;
-				}
-				
-				packetLength = bytes[5] | (bytes[6] << 8);
-				
-				checksum = false;
-				headerSize = 7;
-				packetLength += headerSize;
-				currentIndex += 6;
-				state = ReadState::GetData;
-				break;
-			case ReadState::GetData:
-				// We do not include the checksum in packetLength so it doesn't get copied into the payload buffer
-				if(bytes.size() < (size_t)(packetLength + (checksum ? 1 : 0))) { // Read until we have the rest of the packet
-					haveEnoughData = false;
-					break;
-				}
-
-				packet.data.clear();
-				if(packetLength > 0)
-					packet.data.resize(packetLength - headerSize);
-
-				bytes.CopyTo(packet.data.data(), currentIndex, (packetLength - currentIndex));
-				currentIndex = packetLength;
-
-				if(disableChecksum || !checksum || bytes[currentIndex] == ICSChecksum(packet.data)) {
-					// Got a good packet
-					gotGoodPackets = true;
-					processedPackets.push_back(std::make_shared<Packet>(packet));
-					bytes.Erase_front(packetLength);
-
-					if(packet.network == Network::NetID::DiskData && (packetLength - headerSize) % 2 == 0) {
-						bytes.pop_front();
-					}
-				} else {
-					if(gotGoodPackets) // Don't complain unless we've already gotten a good packet, in case we started in the middle of a stream
-						report(APIEvent::Type::PacketChecksumError, APIEvent::Severity::Error);
-					bytes.pop_front(); // Drop the first byte so it doesn't get picked up again
-				}
-
-				// Reset for the next packet
-				currentIndex = 0;
-				state = ReadState::SearchForHeader;
+	return input(inputBytes.data(), inputBytes.size());
+}
+
+bool Packetizer::input(const uint8_t* data, size_t length) {
+	size_t needed;
+	gotPacketsThisInput = false;
+	if(!carry.empty()) {
+		// Finish off the packet which straddled the end of the last input,
+		// taking only as many bytes as it needs so the rest can be parsed in place
+		while(true) {
+			carry.erase(carry.begin(), carry.begin() + parse(carry.data(), carry.size(), needed));
+			if(carry.empty() || length == 0)
 				break;
+			const size_t take = std::min(needed - carry.size(), length);
+			carry.insert(carry.end(), data, data + take);
+			data += take;
+			length -= take;
+		}
+	}
+
+	if(carry.empty()) {
+		const size_t used = parse(data, length, needed);
+		carry.assign(data + used, data + length);
+	}
+
+	return gotPacketsThisInput || processedPackets.size() > 0;
+}
+
+size_t Packetizer::parse(const uint8_t* data, size_t length, size_t& needed) {
+	size_t offset = 0;
+	if(discardPadding && length > 0) {
+		discardPadding = false;
+		offset++;
+	}
+
+	while(offset < length) {
+		// 0xAA denotes the beginning of a packet, anything before it is discarded
+		const auto header = static_cast<const uint8_t*>(memchr(data + offset, 0xAA, length - offset));
+		if(header == nullptr)
+			return length;
+		offset = size_t(header - data);
+		const size_t available = length - offset;
+
+		if(available < 2) {
+			needed = 2;
+			return offset;
+		}
+
+		size_t packetLength = header[1] >> 4 & 0xF;
+		const neonetid_t shortNetID = header[1] & 0xF; // Lower nibble of the second byte is the network ID
+		size_t headerSize;
+		bool checksum = false;
+		if(packetLength == 0) {
+			if(available < 6) {
+				needed = 6;
+				return offset;
+			}
+
+			packetLength = header[2] | (header[3] << 8); // Long packets have a little endian length on bytes 3 and 4
+
+			/* Long packets can't have a length less than 6, because that would indicate a negative payload size.
+			* Unlike the short packet length, the long packet length encompasses everything from the 0xAA to the
+			* end of the payload. The short packet length, for reference, only encompasses the length of the actual
+			* payload, and not the header or checksum.
+			*/
+			if(packetLength < 6 || packetLength > 4000) {
+				offset++;
+				EventManager::GetInstance().add(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
+				continue;
+			}
+
+			headerSize = 6;
+		} else if(packetLength == 0xA && shortNetID == neonetid_t(Network::NetID::DiskData)) {
+			// DiskData has a 0xAA5555 marker, check as much of it as we have
+			static constexpr uint8_t Marker[] = { 0xAA, 0x55, 0x55 };
+			const size_t markerAvailable = std::min<size_t>(available - 2, sizeof(Marker));
+			if(memcmp(header + 2, Marker, markerAvailable) != 0) {
+				offset++;
+				continue;
+			}
+
+			if(available < 7) {
+				needed = 7;
+				return offset;
+			}
+
+			headerSize = 7;
+			packetLength = (header[5] | (header[6] << 8)) + headerSize;
+		} else {
+			checksum = true; // Even if checksum is not explicitly disallowed, we enable it here, as this goes into length calculation
+			headerSize = 2;
+			packetLength += 2; // The packet length given in short packets does not include header
+		}
+
+		// We do not include the checksum in packetLength so it doesn't get copied into the payload buffer
+		if(available < packetLength + (checksum ? 1 : 0)) {
+			needed = packetLength + (checksum ? 1 : 0);
+			return offset;
+		}
+
+		const uint8_t* payload = header + headerSize;
+		const size_t payloadLength = packetLength - headerSize;
+		if(disableChecksum || !checksum || header[packetLength] == Checksum(payload, payloadLength)) {
+			// Got a good packet
+			gotGoodPackets = true;
+			gotPacketsThisInput = true;
+			// Long packets have their netid stored as little endian on bytes 5 and 6. Devices never send actual VNET IDs so we must not perform ID expansion here.
+			const Network network = headerSize == 6 ? Network(((header[5] << 8) | header[4]), false) : Network(shortNetID);
+			if(!wantsNetwork || wantsNetwork(network)) {
+				auto packet = packetPool.make();
+				packet->network = network;
+				packet->data.assign(payload, payload + payloadLength);
+				processedPackets.push_back(std::move(packet));
+			} else {
+				skipped++;
+			}
+			offset += packetLength;
+
+			if(network.getNetID() == Network::NetID::DiskData && payloadLength % 2 == 0) {
+				// DiskData is padded out to 16 bits, whichever form its header took
+				if(offset < length)
+					offset++;
+				else
+					discardPadding = true;
+			}
+		} else {
+			if(gotGoodPackets) // Don't complain unless we've already gotten a good packet, in case we started in the middle of a stream
+				report(APIEvent::Type::PacketChecksumError, APIEvent::Severity::Error);
+			offset++; // Drop the first byte so it doesn't get picked up again
 		}
 	}
 
-	return processedPackets.size() > 0;
+	return offset;
 }
 
 std::vector<std::shared_ptr<Packet>> Packetizer::output() {
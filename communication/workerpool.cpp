@@ -0,0 +1,44 @@
+#include "icsneo/communication/workerpool.h"
+#include "icsneo/api/eventmanager.h"
+
+using namespace icsneo;
+
+WorkerPool::WorkerPool(size_t threadCount) {
+	if(threadCount == 0)
+		threadCount = 1;
+	for(size_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool() {
+	// An empty task tells a thread to stop, each one takes exactly one
+	for(size_t i = 0; i < threads.size(); i++)
+		tasks.enqueue(nullptr);
+	for(auto& thread : threads)
+		thread.join();
+
+	// The queue is only FIFO per producer, so some work may have been behind the stops
+	std::function<void()> task;
+	while(tasks.try_dequeue(task)) {
+		if(task)
+			task();
+	}
+}
+
+void WorkerPool::post(std::function<void()> task) {
+	if(task)
+		tasks.enqueue(std::move(task));
+}
+
+void WorkerPool::run() {
+	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+
+	std::function<void()> task;
+	while(true) {
+		tasks.wait_dequeue(task);
+		if(!task)
+			return;
+		task();
+		task = nullptr; // Let go of whatever the task captured
+	}
+}
@@ -33,6 +33,19 @@ static const char toBase36Table[36] = { '0', '1', '2', '3', '4', '5', '6', '7',
 
 static const uint32_t toBase36Powers[7] = { 1, 36, 1296, 46656, 1679616, 60466176, 2176782336 };
 
+// Matches everything which is decoded, including internal messages, without asking for any more networks to be decoded
+class PassiveMessageFilter : public MessageFilter {
+public:
+	PassiveMessageFilter(std::function<void(NetworkInterest&)> interest = {}) : interest(std::move(interest)) { includeInternalInAny = true; }
+	void addNetworkInterest(NetworkInterest& wanted) const override {
+		if(interest)
+			interest(wanted);
+	}
+
+private:
+	const std::function<void(NetworkInterest&)> interest;
+};
+
 #define MIN_BASE36_SERIAL (16796160)
 #define MAX_SERIAL (2176782335)
 
@@ -86,6 +99,8 @@ bool Device::SerialStringIsNumeric(const std::string& serial) {
 Device::~Device() {
 	if(isMessagePollingEnabled())
 		disableMessagePolling();
+	if(getNeoMessageRing())
+		disableNeoMessageRing();
 	if(isOpen())
 		close();
 }
@@ -100,15 +115,14 @@ std::string Device::describe() const {
 	return ss.str();
 }
 
-bool Device::enableMessagePolling() {
+bool Device::enableMessagePolling(std::shared_ptr<MessageFilter> filter) {
 	if(isMessagePollingEnabled()) {// We are already polling
 		report(APIEvent::Type::DeviceCurrentlyPolling, APIEvent::Severity::Error);
 		return false;
 	}
 	messagePollingCallbackID = com->addMessageCallback(std::make_shared<MessageCallback>([this](std::shared_ptr<Message> message) {
-		pollingContainer.enqueue(message);
-		enforcePollingMessageLimit();
-	}));
+		pollingContainer.push(message);
+	}, filter));
 	return true;
 }
 
@@ -118,11 +132,39 @@ bool Device::disableMessagePolling() {
 		return false; // Not currently polling
 	}
 	auto ret = com->removeMessageCallback(messagePollingCallbackID);
-	getMessages(); // Flush any messages still in the container
+	pollingContainer.clear(); // Drop any messages still in the container
 	messagePollingCallbackID = 0;
 	return ret;
 }
 
+bool Device::enableNeoMessageRing(size_t messageCapacity, size_t payloadCapacity, std::shared_ptr<MessageFilter> filter, NeoMessageRing::Overflow overflow) {
+	if(getNeoMessageRing()) {
+		report(APIEvent::Type::DeviceCurrentlyPolling, APIEvent::Severity::Error);
+		return false;
+	}
+	if(messageCapacity == 0 || payloadCapacity == 0) {
+		report(APIEvent::Type::ParameterOutOfRange, APIEvent::Severity::Error);
+		return false;
+	}
+	auto ring = std::make_shared<NeoMessageRing>(messageCapacity, payloadCapacity, overflow);
+	neoMessageRingCallbackID = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>([ring](const std::vector<std::shared_ptr<Message>>& messages) {
+		ring->write(messages);
+	}, filter));
+	std::atomic_store(&neoMessageRing, std::move(ring));
+	return true;
+}
+
+bool Device::disableNeoMessageRing() {
+	if(!getNeoMessageRing()) {
+		report(APIEvent::Type::DeviceNotCurrentlyPolling, APIEvent::Severity::Error);
+		return false;
+	}
+	const bool ret = com->removeMessageBatchCallback(neoMessageRingCallbackID);
+	neoMessageRingCallbackID = 0;
+	std::atomic_store(&neoMessageRing, std::shared_ptr<NeoMessageRing>());
+	return ret;
+}
+
 // Returns a pair of {vector, bool}, where the vector contains shared_ptrs to the returned msgs and the bool is whether or not the call was successful.
 std::pair<std::vector<std::shared_ptr<Message>>, bool> Device::getMessages() {
 	std::vector<std::shared_ptr<Message>> ret;
@@ -147,35 +189,16 @@ bool Device::getMessages(std::vector<std::shared_ptr<Message>>& container, size_
 	}
 
 	// A limit of zero indicates no limit
-	if(limit == 0)
-		limit = (size_t)-1;
-
-	if(limit > (pollingContainer.size_approx() + 4))
-		limit = (pollingContainer.size_approx() + 4);
-
-	if(container.size() < limit)
-		container.resize(limit);
-
-	size_t actuallyRead;
-	if(timeout != std::chrono::milliseconds(0))
-		actuallyRead = pollingContainer.wait_dequeue_bulk_timed(container.data(), limit, timeout);
-	else
-		actuallyRead = pollingContainer.try_dequeue_bulk(container.data(), limit);
+	pollingContainer.pop(container, limit, timeout);
 
-	if(container.size() > actuallyRead)
-		container.resize(actuallyRead);
+	// Messages are dropped on the reading thread without raising anything, so the loss is reported here instead
+	const uint64_t dropped = pollingContainer.getDroppedCount();
+	if(pollingDropsReported.exchange(dropped, std::memory_order_relaxed) != dropped)
+		report(APIEvent::Type::PollingMessageOverflow, APIEvent::Severity::EventWarning);
 
 	return true;
 }
 
-void Device::enforcePollingMessageLimit() {
-	while(pollingContainer.size_approx() > pollingMessageLimit) {
-		std::shared_ptr<Message> throwAway;
-		pollingContainer.try_dequeue(throwAway);
-		report(APIEvent::Type::PollingMessageOverflow, APIEvent::Severity::EventWarning);
-	}
-}
-
 bool Device::open(OpenFlags flags, OpenStatusHandler handler) {
 	if(!com) {
 		report(APIEvent::Type::Unknown, APIEvent::Severity::Error);
@@ -237,17 +260,22 @@ bool Device::open(OpenFlags flags, OpenStatusHandler handler) {
 			EventManager::GetInstance().cancelErrorDowngradingOnCurrentThread();
 	}
 
-	MessageFilter filter;
-	filter.includeInternalInAny = true;
-	internalHandlerCallbackID = com->addMessageCallback(std::make_shared<MessageCallback>(filter, [this](std::shared_ptr<Message> message) {
+	const auto internalFilter = std::make_shared<PassiveMessageFilter>([this](NetworkInterest& interest) {
+		forEachExtension([&](const std::shared_ptr<DeviceExtension>& ext) {
+			ext->addNetworkInterest(interest);
+			return !interest.wantsAll();
+		});
+	});
+	internalHandlerCallbackID = com->addMessageCallback(std::make_shared<MessageCallback>(internalFilter, [this](std::shared_ptr<Message> message) {
 		handleInternalMessage(message);
 	}));
 
 	heartbeatThread = std::thread([this]() {
 		EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
-		MessageFilter filter;
-		filter.includeInternalInAny = true;
+		// Any packet will do, so there's no need for the bus traffic to be decoded
+		const auto filter = std::make_shared<PassiveMessageFilter>();
+		uint64_t readsSeen = com->getPacketReadCount();
 
 		std::condition_variable heartbeatCV;
 		std::mutex receivedMessageMutex;
@@ -271,8 +299,10 @@ bool Device::open(OpenFlags flags, OpenStatusHandler handler) {
 			// Wait for 110ms for a possible heartbeat
 			std::this_thread::sleep_for(std::chrono::milliseconds(110));
 			std::unique_lock<std::mutex> recvLk(receivedMessageMutex);
-			if(receivedMessage) {
+			const uint64_t reads = com->getPacketReadCount();
+			if(receivedMessage || reads != readsSeen) {
 				receivedMessage = false;
+				readsSeen = reads;
 			} else {
 				// Some communication, such as the bootloader and extractor interfaces, must
 				// redirect the input stream from the device as it will no longer be in the
@@ -645,7 +675,8 @@ bool Device::clearScript(Disk::MemoryType memType)
 	return true;
 }
 
-bool Device::transmit(std::shared_ptr<Frame> frame) {
+bool Device::prepareTransmit(const std::shared_ptr<Frame>& frame, std::vector<uint8_t>& packet, bool& status, const std::function<bool()>& beforeHook) {
+	status = false;
 	if(!isOpen()) {
 		report(APIEvent::Type::DeviceCurrentlyClosed, APIEvent::Severity::Error);
 		return false;
@@ -663,27 +694,97 @@ bool Device::transmit(std::shared_ptr<Frame> frame) {
 
 	bool extensionHookedTransmit = false;
 	bool transmitStatusFromExtension = false;
+	bool calledBeforeHook = false;
+	bool stoppedBeforeHook = false;
 	forEachExtension([&](const std::shared_ptr<DeviceExtension>& ext) {
+		if(beforeHook && !calledBeforeHook && ext->hooksTransmit(*frame)) {
+			calledBeforeHook = true;
+			if(!beforeHook()) {
+				stoppedBeforeHook = true;
+				return false;
+			}
+		}
 		if(!ext->transmitHook(frame, transmitStatusFromExtension))
 			extensionHookedTransmit = true;
 		return !extensionHookedTransmit; // false breaks out of the loop early
 	});
-	if(extensionHookedTransmit)
-		return transmitStatusFromExtension;
+	if(stoppedBeforeHook)
+		return false;
+	if(extensionHookedTransmit) {
+		status = transmitStatusFromExtension;
+		return false;
+	}
+
+	return com->encoder->encode(*com->packetizer, packet, frame);
+}
 
+bool Device::transmit(std::shared_ptr<Frame> frame) {
 	std::vector<uint8_t> packet;
-	if(!com->encoder->encode(*com->packetizer, packet, frame))
-		return false;
+	bool status;
+	if(!prepareTransmit(frame, packet, status))
+		return status;
 
 	return com->sendPacket(packet);
 }
 
+bool Device::transmitAsync(std::shared_ptr<Frame> frame, std::function<void(bool success)> onComplete) {
+	std::vector<uint8_t> packet;
+	bool status;
+	if(!prepareTransmit(frame, packet, status)) {
+		// An extension took care of it, so it's as done as it will ever be
+		if(status && onComplete)
+			onComplete(true);
+		return status;
+	}
+
+	return com->sendPacketAsync(packet, std::move(onComplete));
+}
+
 bool Device::transmit(std::vector<std::shared_ptr<Frame>> frames) {
-	for(auto& frame : frames) {
-		if(!transmit(frame))
+	return transmitBatch(frames) == frames.size();
+}
+
+size_t Device::transmitBatch(const std::vector<std::shared_ptr<Frame>>& frames, bool* writeFailed) {
+	if(writeFailed)
+		*writeFailed = false;
+	std::vector<uint8_t> batch;
+	std::vector<uint8_t> packet;
+	size_t accepted = 0;
+	size_t acceptedBeforeBatch = 0; // What we can still claim if writing out `batch` fails
+	bool flushFailed = false;
+	const std::function<bool()> flush = [&]() { // Made once, as prepareTransmit() takes it for every frame
+		if(!batch.empty() && !com->rawWrite(batch)) {
+			flushFailed = true;
+			if(writeFailed)
+				*writeFailed = true;
 			return false;
+		}
+		batch.clear();
+		acceptedBeforeBatch = accepted;
+		return true;
+	};
+	for(const auto& frame : frames) {
+		bool status;
+		// What's batched goes out before an extension sends anything of its own, so the frames stay in order
+		if(!prepareTransmit(frame, packet, status, flush)) {
+			if(flushFailed || !status)
+				break;
+			// An extension took care of it
+			accepted++;
+			if(batch.empty())
+				acceptedBeforeBatch = accepted;
+			continue;
+		}
+
+		com->appendPacket(batch, packet);
+		accepted++;
+		if(batch.size() >= TransmitBatchMaxBytes && !flush())
+			break;
 	}
-	return true;
+
+	if(flushFailed || !flush())
+		return acceptedBeforeBatch;
+	return accepted;
 }
 
 void Device::setWriteBlocks(bool blocks) {
@@ -1574,8 +1675,11 @@ Lifetime Device::suppressDisconnects() {
 }
 
 void Device::addExtension(std::shared_ptr<DeviceExtension>&& extension) {
-	std::lock_guard<std::mutex> lk(extensionsLock);
-	extensions.push_back(extension);
+	{
+		std::lock_guard<std::mutex> lk(extensionsLock);
+		extensions.push_back(extension);
+	}
+	com->updateNetworkInterest(); // The internal handler passes everything decoded on to the extensions
 }
 
 void Device::forEachExtension(std::function<bool(const std::shared_ptr<DeviceExtension>&)> fn) {
@@ -3078,6 +3182,8 @@ bool Device::dispatchVSAMessages(VSAParser& parser) {
 		return false;
 	}
 	for(const auto& packet : packets) {
+		if(!com->wantsNetwork(packet->network))
+			continue;
 		std::shared_ptr<Message> msg;
 		if(!com->decoder->decode(msg, packet)) {
 			return false;
@@ -11,6 +11,10 @@
 #include "icsneo/platform/pcap.h"
 #endif
 
+#ifdef ICSNEO_ENABLE_AF_PACKET
+#include "icsneo/platform/posix/linux/afpacket.h"
+#endif
+
 #ifdef ICSNEO_ENABLE_CDCACM
 #include "icsneo/platform/cdcacm.h"
 #endif
@@ -59,6 +63,10 @@ std::vector<std::shared_ptr<Device>> DeviceFinder::FindAll() {
 	TCP::Find(newDriverFoundDevices);
 	#endif
 
+	#ifdef ICSNEO_ENABLE_AF_PACKET
+	AFPacket::Find(newDriverFoundDevices); // Before PCAP, which skips the devices found here
+	#endif
+
 	#ifdef ICSNEO_ENABLE_RAW_ETHERNET
 	PCAP::Find(newDriverFoundDevices);
 	#endif
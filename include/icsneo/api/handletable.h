@@ -0,0 +1,180 @@
+#ifndef __HANDLETABLE_H_
+#define __HANDLETABLE_H_
+
+#ifdef __cplusplus
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace icsneo {
+
+/**
+ * Hands out integer handles to entries, for APIs which give their users
+ * something opaque rather than a pointer. A handle is the entry's slot
+ * along with the slot's generation, which changes whenever the entry is
+ * removed, so a stale or made up handle is turned away in constant time
+ * without touching anything it might once have referred to.
+ *
+ * Looking up an entry takes no lock. The Ref it returns keeps the entry
+ * from being destroyed while it is held, remove() waits for every Ref to
+ * be dropped first, so a thread must not remove an entry it holds a Ref to.
+ */
+template<typename T>
+class HandleTable {
+	struct Slot {
+		std::atomic<uintptr_t> generation{0}; // Odd while the slot is in use
+		std::atomic<size_t> users{0};
+		std::optional<T> value;
+	};
+
+public:
+	typedef uintptr_t Handle; // Never 0
+
+	static constexpr size_t IndexBits = 12;
+	static constexpr size_t MaxEntries = size_t(1) << IndexBits;
+
+	class Ref {
+	public:
+		Ref() = default;
+		Ref(Ref&& other) noexcept : slot(other.slot) { other.slot = nullptr; }
+		Ref& operator=(Ref&& other) noexcept {
+			if(this != &other) {
+				reset();
+				slot = other.slot;
+				other.slot = nullptr;
+			}
+			return *this;
+		}
+		Ref(const Ref&) = delete;
+		Ref& operator=(const Ref&) = delete;
+		~Ref() { reset(); }
+
+		explicit operator bool() const { return slot != nullptr; }
+		T* operator->() const { return &*slot->value; }
+		T& operator*() const { return *slot->value; }
+
+		void reset() {
+			if(slot)
+				slot->users.fetch_sub(1, std::memory_order_release);
+			slot = nullptr;
+		}
+
+	private:
+		friend class HandleTable;
+		explicit Ref(Slot* slot) : slot(slot) {}
+		Slot* slot = nullptr;
+	};
+
+	HandleTable() = default;
+	~HandleTable() {
+		for(auto& chunk : chunks)
+			delete[] chunk.load(std::memory_order_relaxed);
+	}
+	HandleTable(const HandleTable&) = delete;
+	HandleTable& operator=(const HandleTable&) = delete;
+
+	// Returns 0 if the table is full
+	template<typename... Args>
+	Handle add(Args&&... args) {
+		std::lock_guard<std::mutex> lk(mutex);
+		size_t index;
+		if(!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		} else if(slotsUsed < MaxEntries) {
+			index = slotsUsed++;
+			if(index % ChunkSize == 0) // Slots never move or go away, so lookups don't need the lock
+				chunks[index / ChunkSize].store(new Slot[ChunkSize], std::memory_order_release);
+		} else {
+			return 0;
+		}
+
+		Slot& slot = at(index);
+		slot.value.emplace(std::forward<Args>(args)...);
+		const uintptr_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+		slot.generation.store(generation, std::memory_order_release);
+		return ((generation & GenerationMask) << IndexBits) | index;
+	}
+
+	// An empty Ref if the handle isn't, or is no longer, in the table
+	Ref acquire(Handle handle) {
+		const size_t index = size_t(handle & IndexMask);
+		const uintptr_t generation = handle >> IndexBits;
+		if(!(generation & 1))
+			return Ref();
+		Slot* chunk = chunks[index / ChunkSize].load(std::memory_order_acquire);
+		if(!chunk)
+			return Ref();
+
+		// Counted before checking, so that remove() either waits for us or we see that it has started
+		Slot& slot = chunk[index % ChunkSize];
+		slot.users.fetch_add(1);
+		if((slot.generation.load() & GenerationMask) != generation) {
+			slot.users.fetch_sub(1, std::memory_order_release);
+			return Ref();
+		}
+		return Ref(&slot);
+	}
+
+	// Waits for anyone using the entry, then destroys it, returns false if the handle wasn't in the table
+	bool remove(Handle handle) {
+		const size_t index = size_t(handle & IndexMask);
+		Slot* slot;
+		{
+			std::lock_guard<std::mutex> lk(mutex);
+			if(index >= slotsUsed)
+				return false;
+			slot = &at(index);
+			const uintptr_t generation = slot->generation.load(std::memory_order_relaxed);
+			if(!(generation & 1) || (generation & GenerationMask) != handle >> IndexBits)
+				return false;
+			slot->generation.fetch_add(1); // Nobody new gets in from here on
+		}
+
+		while(slot->users.load() != 0)
+			std::this_thread::yield();
+		slot->value.reset();
+
+		std::lock_guard<std::mutex> lk(mutex);
+		freeSlots.push_back(index);
+		return true;
+	}
+
+	template<typename Predicate>
+	void removeIf(Predicate&& predicate) {
+		std::vector<Handle> matching;
+		{
+			std::lock_guard<std::mutex> lk(mutex);
+			for(size_t index = 0; index < slotsUsed; index++) {
+				Slot& slot = at(index);
+				const uintptr_t generation = slot.generation.load(std::memory_order_relaxed);
+				if((generation & 1) && predicate(const_cast<const T&>(*slot.value)))
+					matching.push_back(((generation & GenerationMask) << IndexBits) | index);
+			}
+		}
+		for(Handle handle : matching)
+			remove(handle);
+	}
+
+private:
+	static constexpr size_t ChunkSize = 64;
+	static constexpr uintptr_t IndexMask = MaxEntries - 1;
+	static constexpr uintptr_t GenerationMask = ~uintptr_t(0) >> IndexBits; // What's left of the generation once it's shifted into a handle
+
+	Slot& at(size_t index) { return chunks[index / ChunkSize].load(std::memory_order_acquire)[index % ChunkSize]; }
+
+	std::atomic<Slot*> chunks[MaxEntries / ChunkSize] = {};
+	std::mutex mutex; // Held while adding and removing
+	size_t slotsUsed = 0;
+	std::vector<size_t> freeSlots;
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __NEODEVICELOOKUP_H_
+#define __NEODEVICELOOKUP_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/device/device.h"
+#include <memory>
+
+namespace icsneo {
+
+/**
+ * The C++ device behind a neodevice_t handed out by the C API, or nullptr
+ * (with an event) if the handle is no longer valid. For the legacy API,
+ * which needs to get at things the C API doesn't expose.
+ */
+std::shared_ptr<Device> DeviceFromNeoDevice(const neodevice_t* device);
+
+}
+
+#endif // __cplusplus
+
+#endif
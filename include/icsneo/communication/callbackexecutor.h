@@ -0,0 +1,86 @@
+#ifndef __CALLBACKEXECUTOR_H_
+#define __CALLBACKEXECUTOR_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/message/callback/messagecallback.h"
+#include "icsneo/communication/workerpool.h"
+#include "icsneo/third-party/concurrentqueue/blockingconcurrentqueue.h"
+#include "icsneo/third-party/concurrentqueue/lightweightsemaphore.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace icsneo {
+
+/**
+ * Runs one MessageCallback off the reading thread, as its ExecutionPolicy
+ * asks, from a bounded queue which the reading thread posts to.
+ *
+ * The executor keeps itself alive while its thread or a pool task of its
+ * is running, so it may be stopped from within its own callback.
+ */
+class CallbackExecutor : public std::enable_shared_from_this<CallbackExecutor> {
+public:
+	// Null for callbacks which run inline
+	static std::shared_ptr<CallbackExecutor> Start(std::shared_ptr<MessageCallback> callback);
+
+	/**
+	 * Set how many threads the pool shared by every Pooled callback has.
+	 * Callbacks started afterwards get the new pool, ones already running
+	 * hold on to the old one until they are stopped.
+	 */
+	static void SetPoolThreads(size_t threads);
+
+	CallbackExecutor(std::shared_ptr<MessageCallback> callback);
+	~CallbackExecutor() { stop(); }
+	CallbackExecutor(const CallbackExecutor&) = delete;
+	CallbackExecutor& operator=(const CallbackExecutor&) = delete;
+
+	// Queue a message which matched, returns false if it was dropped
+	bool post(std::shared_ptr<Message> message);
+
+	// Nothing is queued from here on, and anyone blocked waiting for room gives up
+	void close();
+
+	/**
+	 * Close, drop whatever is still queued and wait for the callback to
+	 * return. Once this returns the callback won't be called again, other
+	 * than the call this was made from, if it was.
+	 */
+	void stop();
+
+private:
+	static constexpr size_t MaxMessagesPerTurn = 64; // On the pool, a busy callback goes to the back of the line after this many
+	static constexpr int64_t BlockedPollMicroseconds = 10000; // How often a reader blocked on a full queue checks for close()
+
+	const std::shared_ptr<MessageCallback> callback;
+	const MessageCallback::ExecutionPolicy policy;
+	const std::shared_ptr<MessageCallback::QueueStats> stats;
+	moodycamel::BlockingConcurrentQueue< std::shared_ptr<Message> > queue;
+	moodycamel::LightweightSemaphore room;
+	std::atomic<bool> closed{false};
+	std::atomic<bool> stopped{false};
+
+	// Thread
+	std::thread thread;
+	void run();
+
+	// Pooled
+	std::shared_ptr<WorkerPool> workers;
+	std::atomic<size_t> pending{0}; // Queued and not yet taken by drain(), a drain is posted when this leaves 0
+	std::mutex idleMutex;
+	std::condition_variable idle;
+	void drain();
+
+	void deliver(const std::shared_ptr<Message>& message);
+	void dropped() { stats->dropped.fetch_add(1, std::memory_order_relaxed); }
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -6,8 +6,10 @@
 #include "icsneo/communication/driver.h"
 #include "icsneo/communication/command.h"
 #include "icsneo/communication/network.h"
+#include "icsneo/communication/networkinterest.h"
 #include "icsneo/communication/packet.h"
 #include "icsneo/communication/message/callback/messagecallback.h"
+#include "icsneo/communication/message/callback/messagebatchcallback.h"
 #include "icsneo/communication/message/serialnumbermessage.h"
 #include "icsneo/communication/message/logicaldiskinfomessage.h"
 #include "icsneo/communication/message/componentversionsmessage.h"
@@ -21,8 +23,12 @@
 #include <vector>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <queue>
 #include <map>
+#include <array>
+#include <future>
 
 namespace icsneo {
 
@@ -35,7 +41,7 @@ public:
 		std::unique_ptr<Driver>&& driver,
 		std::function<std::unique_ptr<Packetizer>()> makeConfiguredPacketizer,
 		std::unique_ptr<Encoder>&& e,
-		std::unique_ptr<Decoder>&& md) : makeConfiguredPacketizer(makeConfiguredPacketizer), encoder(std::move(e)), decoder(std::move(md)), driver(std::move(driver)), report(report) {}
+		std::unique_ptr<Decoder>&& md) : makeConfiguredPacketizer(skippingUnwantedNetworks(makeConfiguredPacketizer)), encoder(std::move(e)), decoder(std::move(md)), driver(std::move(driver)), report(report) {}
 	virtual ~Communication();
 
 	bool open();
@@ -47,7 +53,11 @@ public:
 	void modeChangeIncoming() { driver->modeChangeIncoming(); }
 	void awaitModeChangeComplete() { driver->awaitModeChangeComplete(); }
 	bool rawWrite(const std::vector<uint8_t>& bytes) { return driver->write(bytes); }
+	bool rawWriteAsync(const std::vector<uint8_t>& bytes, Driver::WriteCompletion onComplete) { return driver->writeAsync(bytes, std::move(onComplete)); }
 	virtual bool sendPacket(std::vector<uint8_t>& bytes);
+	virtual bool sendPacketAsync(std::vector<uint8_t>& bytes, Driver::WriteCompletion onComplete);
+	// Frames `packet` as sendPacket() would and adds it to the end of `batch`, so several can go in one rawWrite()
+	virtual void appendPacket(std::vector<uint8_t>& batch, const std::vector<uint8_t>& packet) { batch.insert(batch.end(), packet.begin(), packet.end()); }
 	bool redirectRead(std::function<void(std::vector<uint8_t>&&)> redirectTo);
 	void clearRedirectRead();
 
@@ -62,8 +72,68 @@ public:
 	std::shared_ptr<LogicalDiskInfoMessage> getLogicalDiskInfoSync(std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
 	std::optional< std::vector<ComponentVersion> > getComponentVersionsSync(std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
 
+	/**
+	 * Callbacks run on the read thread, or on more than one thread at once
+	 * for devices with several VNETs, unless their ExecutionPolicy queues
+	 * them for a thread of their own or the callback pool. Adding one never
+	 * waits for callbacks to finish, and once removeMessageCallback() returns
+	 * the callback won't be called again, though it may remove itself from
+	 * within the call. Anything still queued for it is dropped.
+	 */
 	int addMessageCallback(const std::shared_ptr<MessageCallback>& cb);
 	bool removeMessageCallback(int id);
+
+	/**
+	 * Batch callbacks are handed each read's CAN and CAN FD frames as one
+	 * CANFrameBatch, which is decoded straight from the packets without a
+	 * CANMessage being made for any frame. They run on the read thread
+	 * once the message callbacks for that read are done, and the batch
+	 * is only valid until they return.
+	 */
+	int addCANFrameBatchCallback(fn_canFrameBatchCallback cb);
+	bool removeCANFrameBatchCallback(int id);
+
+	/**
+	 * Message batch callbacks are handed every message from a read which
+	 * matches their filter at once, see MessageBatchCallback. They run on
+	 * the read thread once the message callbacks for that read are done,
+	 * before the CAN frame batch callbacks.
+	 */
+	int addMessageBatchCallback(const std::shared_ptr<MessageBatchCallback>& cb);
+	bool removeMessageBatchCallback(int id);
+
+
+	/**
+	 * Expect a response to a command which is about to be sent, without
+	 * waiting for any other command's response. Any number of requests can
+	 * be outstanding at once.
+	 *
+	 * Each message answers the oldest outstanding request it matches,
+	 * trying requests for a particular Main51 command first, then those
+	 * for a NetID, a network type, a message type and finally any other
+	 * filter. Requests expecting the same response are answered in the
+	 * order they were made. The message still goes on to any
+	 * waitForMessageSync() waiters and the callbacks.
+	 *
+	 * onResponse runs once, on the read thread, unless cancelResponse()
+	 * gets to it first.
+	 */
+	int expectResponse(std::shared_ptr<MessageFilter> filter, std::function<void(std::shared_ptr<Message>)> onResponse);
+	struct ExpectedResponse {
+		int id;
+		std::future< std::shared_ptr<Message> > response;
+	};
+	ExpectedResponse expectResponse(std::shared_ptr<MessageFilter> filter);
+	// False if the response has already come, it is then handed over regardless. The future of a cancelled request throws.
+	bool cancelResponse(int id);
+
+	/**
+	 * Send with onceWaitingDo, then wait for a message matching the filter.
+	 *
+	 * Unlike expectResponse(), a message goes to every waiter it matches,
+	 * even one a request has been correlated with, so a waiter for anything
+	 * wakes on every message.
+	 */
 	std::shared_ptr<Message> waitForMessageSync(
 		const std::shared_ptr<MessageFilter>& f = {},
 		std::chrono::milliseconds timeout = std::chrono::milliseconds(50)) {
@@ -78,6 +148,35 @@ public:
 
 	void dispatchMessage(const std::shared_ptr<Message>& msg);
 
+	/**
+	 * Whether any message callback could want a message from this network.
+	 * Packets which nobody wants are dropped by the packetizer, before
+	 * they are copied out or decoded, unless a batch callback wants them.
+	 * The answer changes as callbacks are added and removed, and anything
+	 * else which feeds the filters, such as device extensions, should call
+	 * updateNetworkInterest() when it changes.
+	 */
+	bool wantsNetwork(const Network& network) const {
+		if(wantsEverything.load(std::memory_order_relaxed))
+			return true;
+		const Network::Type type = network.getType();
+		if(type == Network::Type::Internal || wantedTypes[neonettype_t(type)].load(std::memory_order_relaxed))
+			return true;
+		const neonetid_t netid = neonetid_t(network.getNetID());
+		return netid >= Network::NetIDTableSize || wantedNetIDs[netid].load(std::memory_order_relaxed);
+	}
+	void updateNetworkInterest();
+
+	// Incremented for every read which held a whole packet, whether or not anything in it was decoded
+	uint64_t getPacketReadCount() const { return packetReads.load(std::memory_order_relaxed); }
+
+	// Summed over the Packet and Message pools used on the receive path
+	struct PoolCounters {
+		uint64_t hits = 0; // Objects reused from a pool
+		uint64_t misses = 0; // Objects which had to be allocated
+	};
+	PoolCounters getReceivePoolCounters() const;
+
 	std::function<std::unique_ptr<Packetizer>()> makeConfiguredPacketizer;
 	std::unique_ptr<Packetizer> packetizer;
 	std::unique_ptr<Encoder> encoder;
@@ -87,19 +186,64 @@ public:
 
 protected:
 	static int messageCallbackIDCounter;
-	std::mutex messageCallbacksLock;
-	std::map<int, std::shared_ptr<MessageCallback>> messageCallbacks;
+	std::mutex messageCallbacksLock; // Only taken to add or remove callbacks, dispatching never waits on it
+	std::atomic<bool> batchingCANFrames{false};
 	std::atomic<bool> closing{false};
 	std::atomic<bool> redirectingRead{false};
 	std::function<void(std::vector<uint8_t>&&)> redirectionFn;
 	std::mutex redirectingReadMutex; // Don't allow read to be disabled while in the redirectionFn
-	std::mutex syncMessageMutex;
 
 	void handleInput(Packetizer& p, std::vector<uint8_t>& readBytes);
 
 private:
 	std::thread readTaskThread;
 	void readTask();
+
+	/**
+	 * The callbacks are copied on write, dispatching works from whichever
+	 * snapshot was current when it started. A DispatchFrame counts itself
+	 * in its snapshot, so removal can wait until no snapshot which still
+	 * has the removed callback is being dispatched from.
+	 */
+	struct CallbackSnapshot;
+	class DispatchFrame;
+	template<typename Callback> struct Registration;
+	struct MessageBatcher;
+	void flushMessageBatches(bool stop); // Hands batch callbacks what their windows hold, stopping their timers too if asked
+	// Only ever touched through the std::atomic_ functions, null until the first callback is added
+	std::shared_ptr<const CallbackSnapshot> callbacks;
+	std::vector< std::weak_ptr<const CallbackSnapshot> > retiredCallbacks; // Replaced, but maybe still being dispatched from
+	std::shared_ptr<const CallbackSnapshot> loadCallbacks() const { return std::atomic_load(&callbacks); }
+	void publishCallbacks(std::shared_ptr<const CallbackSnapshot> snapshot);
+	template<typename Callback>
+	std::vector< std::shared_ptr<const CallbackSnapshot> > snapshotsContaining(const Registration<Callback>& reg) const;
+	template<typename Callback>
+	bool removeRegistration(int id);
+	template<typename Callback>
+	void waitUntilUnused(Registration<Callback>& removed, const std::vector< std::shared_ptr<const CallbackSnapshot> >& containing);
+	// Signalled as DispatchFrames end, but only while a removal is waiting on one
+	mutable std::mutex dispatchEndedMutex;
+	mutable std::condition_variable dispatchEnded;
+	mutable std::atomic<uint32_t> removalsWaiting{0};
+
+	// Outstanding expectResponse() requests and waitForMessageSync() waiters, answered before the callbacks are dispatched to
+	struct ResponseTable;
+	std::shared_ptr<ResponseTable> responses = MakeResponseTable();
+	static std::shared_ptr<ResponseTable> MakeResponseTable();
+	// Correlated requests are what expectResponse() makes, the rest are waitForMessageSync() waiters
+	int expectMessage(std::shared_ptr<MessageFilter> filter, std::function<void(std::shared_ptr<Message>)> onResponse, bool correlate);
+	ExpectedResponse expectMessage(std::shared_ptr<MessageFilter> filter, bool correlate);
+	void answerResponses(const std::shared_ptr<Message>& message);
+
+	// What updateNetworkInterest() last found, each entry is only ever stored with its new value so
+	// a network which stays wanted never reads as unwanted in between
+	std::atomic<bool> wantsEverything{false};
+	std::array<std::atomic<bool>, 256> wantedTypes = {};
+	std::array<std::atomic<bool>, Network::NetIDTableSize> wantedNetIDs = {};
+	std::atomic<uint64_t> packetReads{0};
+	NetworkInterest wantedInterest; // The same, guarded by messageCallbacksLock
+	void updateNetworkInterestLocked(const CallbackSnapshot& snapshot);
+	std::function<std::unique_ptr<Packetizer>()> skippingUnwantedNetworks(std::function<std::unique_ptr<Packetizer>()> makePacketizer);
 };
 
 }
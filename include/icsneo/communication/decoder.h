@@ -5,6 +5,9 @@
 
 #include "icsneo/communication/message/message.h"
 #include "icsneo/communication/message/canmessage.h"
+#include "icsneo/communication/message/ethernetmessage.h"
+#include "icsneo/communication/message/canframebatch.h"
+#include "icsneo/communication/objectpool.h"
 #include "icsneo/communication/packet.h"
 #include "icsneo/communication/network.h"
 #include "icsneo/communication/packet/iso9141packet.h"
@@ -22,12 +25,51 @@ public:
 	Decoder(device_eventhandler_t report) : report(report) {}
 	bool decode(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
 
+	// The networks whose packets decodeToBatch() takes, the same ones decoded as CANMessages
+	static bool IsCANFrameNetwork(Network::Type type) {
+		return type == Network::Type::CAN || type == Network::Type::SWCAN || type == Network::Type::LSFTCAN;
+	}
+	// Appends the frame in the packet to the batch without making a message of it, returns false if it held no frame
+	bool decodeToBatch(CANFrameBatch& batch, const Packet& packet);
+
 	uint16_t timestampResolution = 25;
 
+	// The most common messages are recycled rather than allocated for every frame
+	ObjectPool<CANMessage> canPool;
+	ObjectPool<EthernetMessage> ethernetPool;
+
 private:
 	device_eventhandler_t report;
 	HardwareISO9141Packet::Decoder iso9141decoder;
 
+	// Picks one of the functions below for each packet, built at compile time in decoder.cpp
+	using DecodeFunction = bool (Decoder::*)(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	struct DecodeTables;
+
+	bool decodeRaw(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeEthernet(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeCAN(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeFlexRay(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeISO9141(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeI2C(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeA2B(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeLIN(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeMDIO(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeResetStatus(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeDevice(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeNeoMemorySDRead(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeExtendedCommand(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeExtendedData(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeFlexRayControl(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeMain51(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeRedOldFormat(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeReadSettings(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeLogicalDiskInfo(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeWiVICommand(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeEthPHYControl(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeScriptStatus(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+	bool decodeDiskData(std::shared_ptr<Message>& result, const std::shared_ptr<Packet>& packet);
+
 #pragma pack(push, 1)
 
 #ifdef _MSC_VER
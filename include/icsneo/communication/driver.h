@@ -4,11 +4,13 @@
 #ifdef __cplusplus
 
 #include <vector>
+#include <optional>
 #include <chrono>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include "icsneo/api/eventmanager.h"
 #include "icsneo/third-party/concurrentqueue/blockingconcurrentqueue.h"
 
@@ -26,7 +28,34 @@ public:
 	virtual bool close() = 0;
 	bool read(std::vector<uint8_t>& bytes, size_t limit = 0);
 	bool readWait(std::vector<uint8_t>& bytes, std::chrono::milliseconds timeout = std::chrono::milliseconds(100), size_t limit = 0);
+
+	/**
+	 * Take the next receive buffer exactly as the driver handed it up,
+	 * without copying it. `chunk` is replaced by the received buffer.
+	 *
+	 * Give the buffer back with releaseReadBuffer() once it has been
+	 * consumed so that its allocation can be reused by the driver.
+	 */
+	bool readChunkWait(std::vector<uint8_t>& chunk, std::chrono::milliseconds timeout = std::chrono::milliseconds(100));
+	void releaseReadBuffer(std::vector<uint8_t>&& buffer);
 	bool write(const std::vector<uint8_t>& bytes);
+
+	/**
+	 * Called once the bytes of a write have been handed to the OS or USB stack,
+	 * with false if they were dropped instead (on error or close).
+	 *
+	 * This is called from the driver's write thread, and must not block.
+	 */
+	using WriteCompletion = std::function<void(bool success)>;
+
+	/**
+	 * Queue `bytes` to be written without waiting for space in the write queue.
+	 *
+	 * Returns false if the bytes could not be queued, in which case `onComplete`
+	 * will not be called. Otherwise `onComplete` is called exactly once.
+	 */
+	bool writeAsync(const std::vector<uint8_t>& bytes, WriteCompletion onComplete);
+
 	virtual bool isEthernet() const { return false; }
 
 	device_eventhandler_t report;
@@ -34,31 +63,147 @@ public:
 	size_t writeQueueSize = 50;
 	bool writeBlocks = true; // Otherwise it just fails when the queue is full
 
+	// Pending writes are flushed together, up to this many bytes at once
+	size_t writeBatchMaxBytes = 16384;
+	// How long to hold a batch open waiting for more writes, zero only takes what is already queued
+	std::chrono::microseconds writeBatchMaxLatency = std::chrono::microseconds(0);
+
 protected:
 	class WriteOperation {
 	public:
 		WriteOperation() {}
 		WriteOperation(const std::vector<uint8_t>& b) : bytes(b) {}
+		WriteOperation(const std::vector<uint8_t>& b, WriteCompletion c) : bytes(b), onComplete(std::move(c)) {}
 		std::vector<uint8_t> bytes;
+		WriteCompletion onComplete;
+
+		// Only the first call has any effect
+		void complete(bool success) {
+			if(!onComplete)
+				return;
+			WriteCompletion fn = std::move(onComplete);
+			onComplete = nullptr;
+			fn(success);
+		}
 	};
 	enum IOTaskState {
 		LAUNCH,
 		WAIT
 	};
 
+	// Several queued writes to be flushed with one system call, tracking how much has been written so far
+	class WriteBatch {
+	public:
+		WriteBatch() {}
+		WriteBatch(const WriteBatch&) = delete;
+		WriteBatch& operator=(const WriteBatch&) = delete;
+		~WriteBatch() { clear(); }
+
+		std::vector<WriteOperation> operations;
+		size_t bytes = 0;
+
+		bool empty() const { return written >= bytes; }
+
+		// Anything not yet written is dropped and completed as failed
+		void clear() {
+			for(auto& op : operations)
+				op.complete(false);
+			operations.clear();
+			bytes = 0;
+			written = 0;
+		}
+
+		// Completes every operation which is now fully written
+		void consume(size_t amount) {
+			written += amount;
+			size_t end = 0;
+			for(auto& op : operations) {
+				end += op.bytes.size();
+				if(end > written)
+					break;
+				op.complete(true);
+			}
+			if(empty())
+				clear();
+		}
+
+		// Calls fn(data, length) for each unwritten piece, in order, until fn returns false
+		template<typename Fn>
+		void forEachRemaining(Fn fn) const {
+			size_t skip = written;
+			for(const auto& op : operations) {
+				if(skip >= op.bytes.size()) {
+					skip -= op.bytes.size();
+					continue;
+				}
+				if(!fn(op.bytes.data() + skip, op.bytes.size() - skip))
+					return;
+				skip = 0;
+			}
+		}
+
+	private:
+		size_t written = 0;
+	};
+
 	virtual void readTask() = 0;
 	virtual void writeTask() = 0;
 
 	// Overridable in case the driver doesn't want to use writeTask and writeQueue
 	virtual bool writeQueueFull() { return writeQueue.size_approx() > writeQueueSize; }
 	virtual bool writeQueueAlmostFull() { return writeQueue.size_approx() > (writeQueueSize * 3 / 4); }
-	virtual bool writeInternal(const std::vector<uint8_t>& b) { return writeQueue.enqueue(WriteOperation(b)); }
+	virtual bool writeInternal(WriteOperation&& op) { return writeQueue.enqueue(std::move(op)); }
+
+	/**
+	 * Write tasks call this after taking writes from writeQueue so that a
+	 * blocked write() can continue. dequeueWriteBatch() does this already.
+	 */
+	void notifyWriteSpace();
+
+	/**
+	 * Wait up to `timeout` for a write, then gather every other pending write
+	 * into `batch` as well, up to writeBatchMaxBytes. If `linger` is set we will
+	 * also wait up to writeBatchMaxLatency for the batch to fill.
+	 *
+	 * Returns false if nothing was queued. `batch` should be empty.
+	 */
+	bool dequeueWriteBatch(WriteBatch& batch, std::chrono::milliseconds timeout, bool linger = true);
+
+	// The same as dequeueWriteBatch(), joined into one buffer for drivers which can only take one
+	bool dequeueCoalescedWrite(WriteOperation& writeOp, std::chrono::milliseconds timeout);
 
-	moodycamel::BlockingConcurrentQueue<uint8_t> readQueue;
+	// Receive buffers are recycled through readBufferPool, drivers should
+	// read directly into an acquired buffer where they can
+	static constexpr size_t DefaultReadBufferSize = 2048;
+	static constexpr size_t MaxPooledReadBuffers = 64;
+	std::vector<uint8_t> acquireReadBuffer(size_t size = DefaultReadBufferSize);
+	void pushReadBuffer(std::vector<uint8_t>&& buffer); // The buffer's size() is the amount of valid data
+	void pushReadBytes(const uint8_t* data, size_t length);
+	void clearReadQueue();
+	void clearWriteQueue();
+
+	moodycamel::BlockingConcurrentQueue<std::vector<uint8_t>> readQueue;
+	moodycamel::ConcurrentQueue<std::vector<uint8_t>> readBufferPool;
 	moodycamel::BlockingConcurrentQueue<WriteOperation> writeQueue;
 	std::thread readThread, writeThread;
 	std::atomic<bool> closing{false};
 	std::atomic<bool> disconnected{false};
+
+private:
+	// write() waits here for the write tasks to make room in writeQueue
+	std::mutex writeSpaceMutex;
+	std::condition_variable writeSpaceCV;
+
+	bool queueWrite(WriteOperation&& op);
+
+	// A write which would have overflowed the last batch, it starts the next one
+	std::optional<WriteOperation> heldWrite;
+
+	// A partially consumed chunk, only used by the read() and readWait() compatibility path
+	std::mutex readRemainderMutex;
+	std::vector<uint8_t> readRemainder;
+	size_t readRemainderOffset = 0;
+	void takeReadBytes(std::vector<uint8_t>& bytes, size_t limit);
 };
 
 }
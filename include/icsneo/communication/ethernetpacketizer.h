@@ -28,15 +28,40 @@ public:
 	 * packets may result in better packing.
 	 */
 	void inputDown(std::vector<uint8_t> bytes, bool first = true);
+	void inputDown(const uint8_t* data, size_t length, bool first = true);
 	std::vector< std::vector<uint8_t> > outputDown();
 
+	/**
+	 * Take the next frame built by inputDown without copying it out.
+	 * The frame stays in a buffer owned by the packetizer and is
+	 * valid until the next call to inputDown. Returns false once
+	 * every frame has been taken.
+	 */
+	bool outputDown(const uint8_t*& frame, size_t& length);
+
 	/**
 	 * Call with packet data, the packet may be queued waiting
-	 * for reassembly. In this case, false will be returned.
+	 * for reassembly. Returns true if there are bytes waiting
+	 * in outputUp.
 	 */
 	bool inputUp(std::vector<uint8_t> bytes);
+
+	// The same, reading the frame where it is (e.g. in a receive ring) without copying it first
+	bool inputUp(const uint8_t* data, size_t length);
 	std::vector<uint8_t> outputUp();
 
+	/**
+	 * Call with a frame, returns true if it completed a packet.
+	 *
+	 * The header is checked where it lies and the packet's bytes
+	 * are given back as a view rather than being queued for
+	 * outputUp. For a single-piece packet the view points into
+	 * `data` itself. For the last piece of a multi-piece packet it
+	 * points into the reassembly buffer, and is valid until the
+	 * next call to inputUp.
+	 */
+	bool inputUp(const uint8_t* data, size_t length, const uint8_t*& payload, size_t& payloadLength);
+
 	class EthernetPacket {
 	public: // Don't worry about endian when setting fields, this is all taken care of in getBytestream
 		EthernetPacket() {};
@@ -70,11 +95,16 @@ private:
 	uint16_t sequenceDown = 0;
 
 	std::vector<uint8_t> processedUpBytes;
-	std::vector<EthernetPacket> processedDownPackets;
+
+	// Frames built by inputDown, back to back and ready to send
+	std::vector<uint8_t> downBuffer;
+	std::vector<size_t> downFrames; // Where each frame starts in downBuffer
+	size_t downFramesTaken = 0;
 
 	device_eventhandler_t report;
 
-	EthernetPacket& newSendPacket(bool first);
+	void newSendFrame(bool first);
+	size_t downFrameEnd(size_t frame) const;
 };
 
 }
@@ -0,0 +1,66 @@
+#ifndef __MESSAGEBATCHCALLBACK_H_
+#define __MESSAGEBATCHCALLBACK_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/message/message.h"
+#include "icsneo/communication/message/filter/messagefilter.h"
+#include <memory>
+#include <functional>
+#include <vector>
+#include <chrono>
+
+namespace icsneo {
+
+/**
+ * Handed the matching messages from each read all at once, rather than
+ * one call per message. The batch is in the order the messages were read
+ * and is only valid until the call returns, though the messages in it
+ * may be held on to.
+ */
+class MessageBatchCallback {
+public:
+	typedef std::function< void( const std::vector< std::shared_ptr<Message> >& ) > fn_messageBatchCallback;
+
+	/**
+	 * By default each read's matching messages are delivered together. A
+	 * window holds them back across reads until `messages` have matched or
+	 * `maxDelay` has passed since the first of them, whichever is set and
+	 * comes first. A timer closes the window at `maxDelay` even if no
+	 * more reads come in.
+	 */
+	struct Window {
+		size_t messages = 0;
+		std::chrono::microseconds maxDelay = std::chrono::microseconds::zero();
+	};
+
+	MessageBatchCallback(fn_messageBatchCallback cb, std::shared_ptr<MessageFilter> f, Window w)
+		: callback(cb), filter(f ? f : std::make_shared<MessageFilter>()), window(w) {
+		if(!cb)
+			throw std::bad_function_call();
+	}
+	MessageBatchCallback(fn_messageBatchCallback cb, std::shared_ptr<MessageFilter> f = nullptr)
+		: MessageBatchCallback(cb, f, Window()) {}
+	MessageBatchCallback(fn_messageBatchCallback cb, MessageFilter f, Window w)
+		: MessageBatchCallback(cb, std::make_shared<MessageFilter>(f), w) {}
+	MessageBatchCallback(fn_messageBatchCallback cb, MessageFilter f)
+		: MessageBatchCallback(cb, std::make_shared<MessageFilter>(f), Window()) {}
+
+	virtual ~MessageBatchCallback() = default;
+
+	virtual void call(const std::vector< std::shared_ptr<Message> >& messages) const { callback(messages); }
+	const MessageFilter& getFilter() const { return *filter; }
+	const Window& getWindow() const { return window; }
+	bool isWindowed() const { return window.messages != 0 || window.maxDelay != std::chrono::microseconds::zero(); }
+
+protected:
+	const fn_messageBatchCallback callback;
+	const std::shared_ptr<MessageFilter> filter;
+	const Window window;
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
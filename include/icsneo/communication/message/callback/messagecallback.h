@@ -7,6 +7,7 @@
 #include "icsneo/communication/message/filter/messagefilter.h"
 #include <memory>
 #include <functional>
+#include <atomic>
 
 namespace icsneo {
 
@@ -14,6 +15,25 @@ class MessageCallback {
 public:
 	typedef std::function< void( std::shared_ptr<Message> ) > fn_messageCallback;
 
+	enum class Execution : uint8_t {
+		Inline, // On the thread which read the message, the default
+		Thread, // On a thread of the callback's own
+		Pooled // On a worker pool shared by every pooled callback, see CallbackExecutor::SetPoolThreads()
+	};
+
+	// What happens to a message which matches while the callback's queue is full
+	enum class Overflow : uint8_t {
+		Block, // The reading thread waits for room, holding up every other callback
+		DropNewest, // The message is dropped
+		DropOldest // The oldest queued message is dropped to make room
+	};
+
+	struct ExecutionPolicy {
+		Execution execution = Execution::Inline;
+		size_t queueCapacity = 4096; // Messages, unused for Inline
+		Overflow overflow = Overflow::Block;
+	};
+
 	MessageCallback(fn_messageCallback cb, std::shared_ptr<MessageFilter> f)
 		: callback(cb), filter(f ? f : std::make_shared<MessageFilter>()) {
 		if(!cb)
@@ -40,9 +60,34 @@ public:
 	const MessageFilter& getFilter() const { return *filter; }
 	const fn_messageCallback& getCallback() const { return callback; }
 
+	/**
+	 * Run the callback somewhere other than the reading thread, so a slow
+	 * callback such as a logger doesn't hold up reading from the device.
+	 * Messages are matched on the reading thread and queued for the
+	 * callback, in order, up to the policy's capacity.
+	 *
+	 * Takes effect the next time the callback is added.
+	 */
+	void setExecutionPolicy(const ExecutionPolicy& policy) { executionPolicy = policy; }
+	const ExecutionPolicy& getExecutionPolicy() const { return executionPolicy; }
+
+	// Summed over every device the callback, or a copy of it, was added to
+	size_t getQueueDepth() const { return queueStats->depth.load(std::memory_order_relaxed); }
+	uint64_t getDroppedCount() const { return queueStats->dropped.load(std::memory_order_relaxed); }
+
 protected:
 	const fn_messageCallback callback;
 	const std::shared_ptr<MessageFilter> filter;
+
+private:
+	friend class CallbackExecutor;
+	ExecutionPolicy executionPolicy;
+	// Kept by the executors, and shared so that the callback can still be copied
+	struct QueueStats {
+		std::atomic<size_t> depth{0};
+		std::atomic<uint64_t> dropped{0};
+	};
+	std::shared_ptr<QueueStats> queueStats = std::make_shared<QueueStats>();
 };
 
 }
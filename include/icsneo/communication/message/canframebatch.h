@@ -0,0 +1,65 @@
+#ifndef __CANFRAMEBATCH_H_
+#define __CANFRAMEBATCH_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/network.h"
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+namespace icsneo {
+
+/**
+ * The CAN and CAN FD frames from one read, column by column, for
+ * consumers which would rather not pay for a CANMessage per frame.
+ *
+ * Every column has one entry per frame, other than payloadOffsets
+ * which has one more, so frame i's payload runs from
+ * payload[payloadOffsets[i]] up to payload[payloadOffsets[i + 1]].
+ * Remote frames have an empty payload.
+ */
+class CANFrameBatch {
+public:
+	enum Flags : uint16_t {
+		Extended = 1 << 0,
+		Remote = 1 << 1,
+		CANFD = 1 << 2,
+		BaudrateSwitch = 1 << 3, // CAN FD only
+		ErrorStateIndicator = 1 << 4, // CAN FD only
+		Transmitted = 1 << 5,
+		Error = 1 << 6
+	};
+
+	std::vector<uint64_t> timestamps; // In nanoseconds, the same as Message::timestamp
+	std::vector<uint32_t> arbids;
+	std::vector<uint16_t> flags;
+	std::vector<uint8_t> dlcs; // As on the wire, 0x0 - 0xF
+	std::vector<Network::NetID> netids;
+	std::vector<uint32_t> payloadOffsets = { 0 };
+	std::vector<uint8_t> payload;
+
+	size_t size() const { return arbids.size(); }
+	bool empty() const { return arbids.empty(); }
+	const uint8_t* data(size_t frame) const { return payload.data() + payloadOffsets[frame]; }
+	size_t dataLength(size_t frame) const { return payloadOffsets[frame + 1] - payloadOffsets[frame]; }
+
+	// Keeps the capacity for the next read
+	void clear() {
+		timestamps.clear();
+		arbids.clear();
+		flags.clear();
+		dlcs.clear();
+		netids.clear();
+		payloadOffsets.resize(1);
+		payload.clear();
+	}
+};
+
+typedef std::function< void( const CANFrameBatch& ) > fn_canFrameBatchCallback;
+
+}
+
+#endif // __cplusplus
+
+#endif
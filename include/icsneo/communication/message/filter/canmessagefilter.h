@@ -8,6 +8,8 @@
 #include "icsneo/communication/message/message.h"
 #include "icsneo/communication/message/canmessage.h"
 #include <memory>
+#include <optional>
+#include <typeinfo>
 
 namespace icsneo {
 
@@ -16,15 +18,28 @@ public:
 	CANMessageFilter() : MessageFilter(Network::Type::CAN), arbid(INVALID_ARBID) { messageType = Message::Type::Frame; }
 	CANMessageFilter(uint32_t arbid) : MessageFilter(Network::Type::CAN), arbid(arbid) { messageType = Message::Type::Frame; }
 
-	bool match(const std::shared_ptr<Message>& message) const {
+	bool match(const std::shared_ptr<Message>& message) const override {
 		if(!MessageFilter::match(message))
 			return false;
-		const auto canMessage = std::dynamic_pointer_cast<CANMessage>(message);
+		const auto canMessage = dynamic_cast<const CANMessage*>(message.get()); // No need to touch the reference count
 		if(canMessage == nullptr || !matchArbID(canMessage->arbid))
 			return false;
 		return true;
 	}
 
+	void addNetworkInterest(NetworkInterest& interest) const override {
+		if(typeid(*this) == typeid(CANMessageFilter))
+			addOwnNetworkInterest(interest);
+		else
+			interest.addAll();
+	}
+
+	std::optional<uint32_t> getArbID() const {
+		if(arbid == INVALID_ARBID)
+			return std::nullopt;
+		return arbid;
+	}
+
 private:
 	static constexpr uint32_t INVALID_ARBID = 0xffffffff;
 	uint32_t arbid;
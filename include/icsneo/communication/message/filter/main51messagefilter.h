@@ -8,6 +8,7 @@
 #include "icsneo/communication/communication.h"
 #include "icsneo/communication/message/main51message.h"
 #include <memory>
+#include <optional>
 #include <iostream>
 
 namespace icsneo {
@@ -28,6 +29,12 @@ public:
 		return main51Message && matchCommand(main51Message->command);
 	}
 
+	std::optional<Command> getCommand() const {
+		if(command == INVALID_COMMAND)
+			return std::nullopt;
+		return command;
+	}
+
 private:
 	static constexpr Command INVALID_COMMAND = (Command)0xff;
 	Command command;
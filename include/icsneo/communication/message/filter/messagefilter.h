@@ -4,8 +4,10 @@
 #ifdef __cplusplus
 
 #include "icsneo/communication/network.h"
+#include "icsneo/communication/networkinterest.h"
 #include "icsneo/communication/message/message.h"
 #include <memory>
+#include <typeinfo>
 
 namespace icsneo {
 
@@ -29,7 +31,8 @@ public:
 
 		if(message->type == Message::Type::Frame || message->type == Message::Type::Main51 || 
 			message->type == Message::Type::RawMessage || message->type == Message::Type::ReadSettings) {
-			const auto frame = std::dynamic_pointer_cast<RawMessage>(message);
+			// All four types are RawMessages, and this runs for every callback, so skip the dynamic cast
+			const RawMessage* frame = static_cast<const RawMessage*>(message.get());
 			if(!matchNetworkType(frame->network.getType()))
 				return false;
 			if(!matchNetID(frame->network.getNetID()))
@@ -40,7 +43,37 @@ public:
 		return true;
 	}
 
+	Message::Type getMessageType() const { return messageType; } // Message::Type::Invalid for any
+	Network::Type getNetworkType() const { return networkType; }
+	Network::NetID getNetID() const { return netid; }
+
+	/**
+	 * Adds the networks a matching message could come from, packets from
+	 * networks which no filter wants are dropped before being decoded.
+	 * Only a plain MessageFilter or CANMessageFilter narrows this down, a
+	 * subclass may match anything so it wants every network unless it says
+	 * otherwise by overriding this.
+	 */
+	virtual void addNetworkInterest(NetworkInterest& interest) const {
+		if(typeid(*this) == typeid(MessageFilter))
+			addOwnNetworkInterest(interest);
+		else
+			interest.addAll();
+	}
+
 protected:
+	// The networks a message matching the fields here could come from
+	void addOwnNetworkInterest(NetworkInterest& interest) const {
+		// Internal message types only come from internal networks, which are always decoded,
+		// other than RawMessages which are also what networks without a decoder of their own give
+		if(messageType != Message::Type::Invalid && messageType != Message::Type::RawMessage && (neomessagetype_t(messageType) & 0x8000))
+			return;
+		if(netid != Network::NetID::Any)
+			interest.add(netid);
+		else
+			interest.add(networkType);
+	}
+
 	Message::Type messageType = Message::Type::Invalid; // Used here for "any"
 	bool matchMessageType(Message::Type mtype) const {
 		if(messageType == Message::Type::Invalid && ((neomessagetype_t(mtype) & 0x8000) == 0 || includeInternalInAny))
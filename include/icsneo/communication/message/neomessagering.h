@@ -0,0 +1,89 @@
+#ifndef __NEOMESSAGERING_H_
+#define __NEOMESSAGERING_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/message/neomessage.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace icsneo {
+
+/**
+ * Messages converted to neomessage_t as they are read, along with a copy
+ * of their payloads, so a C consumer can read them in place without any
+ * conversion or copying of its own.
+ *
+ * The consumer is handed a contiguous run of records with read(), which
+ * along with the payloads they point to stay put until it calls commit().
+ * As the consumer may be holding on to the oldest messages, by default a
+ * full ring drops the newest, counting each one lost. A message whose
+ * payload doesn't fit is dropped on its own, those after it may still fit.
+ *
+ * With Overflow::DropOldest a full ring makes room by dropping the oldest
+ * instead, as message polling does, so long as the consumer isn't between
+ * a read() and its commit(). To allow this, reading and committing briefly
+ * wait on a write in progress.
+ *
+ * Writes from more than one thread are serialized, but only one thread
+ * may read and commit at a time.
+ */
+class NeoMessageRing {
+public:
+	enum class Overflow {
+		DropNewest,
+		DropOldest
+	};
+
+	NeoMessageRing(size_t messageCapacity, size_t payloadCapacity, Overflow overflow = Overflow::DropNewest);
+	NeoMessageRing(const NeoMessageRing&) = delete;
+	NeoMessageRing& operator=(const NeoMessageRing&) = delete;
+
+	// Returns how many of the messages were kept, in order, the rest are dropped
+	size_t write(const std::vector<std::shared_ptr<Message>>& messages);
+
+	/**
+	 * The oldest messages which have not been committed, up to `count` of
+	 * them, 0 meaning no limit. `count` is set to how many were returned,
+	 * which may be fewer than are waiting if they wrap around the end of
+	 * the ring.
+	 */
+	const neomessage_t* read(size_t& count);
+
+	// Give back the oldest `count` messages, at most as many as are waiting
+	void commit(size_t count);
+
+	size_t size() const;
+	uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+	// How many were dropped since the consumer last asked
+	uint64_t takeNewlyDropped();
+
+private:
+	const size_t messageMask; // The message capacity, rounded up to a power of 2, less one
+	const size_t payloadCapacity;
+	const Overflow overflow;
+	std::unique_ptr<neomessage_t[]> records;
+	std::unique_ptr<uint64_t[]> payloadEnds; // Where the payload head was after each record, so commit() knows how much to free
+	std::unique_ptr<uint8_t[]> payload;
+
+	// Positions only ever increase, and are taken modulo the capacities
+	std::atomic<uint64_t> head{0};
+	std::atomic<uint64_t> tail{0};
+	uint64_t payloadHead = 0; // Only touched by the writer
+	std::atomic<uint64_t> payloadTail{0};
+
+	std::atomic_flag writing = ATOMIC_FLAG_INIT;
+	bool reading = false; // Between a read() and its commit(), only used with Overflow::DropOldest, guarded by `writing`
+	void lockWriting();
+	std::atomic<uint64_t> dropped{0};
+	uint64_t droppedReported = 0; // Only touched by the consumer
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef __MESSAGERING_H_
+#define __MESSAGERING_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/message/message.h"
+#include "icsneo/third-party/concurrentqueue/blockingconcurrentqueue.h"
+#include "icsneo/third-party/concurrentqueue/lightweightsemaphore.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace icsneo {
+
+/**
+ * A bounded ring of messages waiting to be polled, which the reading
+ * thread pushes into without locking or raising events, even when full.
+ *
+ * Past the limit either the oldest message or the incoming one is
+ * dropped, and a single counter keeps track of how many were lost.
+ * pop() takes everything it returns by moving the tail once.
+ *
+ * Pushes from more than one thread are serialized, but are expected
+ * to come from one at a time. Any thread may pop.
+ */
+class MessageRing {
+public:
+	enum class Overflow : uint8_t {
+		DropOldest,
+		DropNewest
+	};
+
+	MessageRing(size_t limit, Overflow overflow = Overflow::DropOldest);
+	MessageRing(const MessageRing&) = delete;
+	MessageRing& operator=(const MessageRing&) = delete;
+
+	// Returns false if the message was dropped, never blocks on the consumer other than while the ring grows
+	bool push(std::shared_ptr<Message> message);
+
+	/**
+	 * Replace the contents of `out` with up to `limit` of the oldest
+	 * messages, 0 meaning no limit. If there are none, wait up to
+	 * `timeout` for one to be pushed. Returns how many were taken.
+	 */
+	size_t pop(std::vector<std::shared_ptr<Message>>& out, size_t limit = 0, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+	size_t size() const;
+	void clear(); // Drops everything without counting it, for once nobody is pushing anymore
+
+	// Lowering the limit drops the oldest messages over it straight away
+	size_t getLimit() const { return limit.load(std::memory_order_relaxed); }
+	void setLimit(size_t newLimit);
+
+	Overflow getOverflow() const { return overflow.load(std::memory_order_relaxed); }
+	void setOverflow(Overflow newOverflow) { overflow.store(newOverflow, std::memory_order_relaxed); }
+
+	uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr size_t InitialCapacity = 1024; // The slots grow towards the limit as they fill, rather than all being allocated up front
+
+	/**
+	 * A consumer which has claimed a slot may still be taking the message
+	 * out as the producer comes around to it again. Whoever gets `busy`
+	 * second sees from `index` whether it still holds what they expected.
+	 */
+	struct Slot {
+		std::atomic_flag busy = ATOMIC_FLAG_INIT;
+		uint64_t index = 0;
+		std::shared_ptr<Message> message;
+
+		void lock() {
+			while(busy.test_and_set(std::memory_order_acquire)) {}
+		}
+		void unlock() { busy.clear(std::memory_order_release); }
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t mask; // The capacity, a power of 2, less one
+
+	std::atomic<uint64_t> head{0}; // Only moved by the producer
+	std::atomic<uint64_t> tail{0}; // Moved by consumers to claim messages and by the producer to drop them
+	std::atomic<size_t> limit;
+	std::atomic<Overflow> overflow;
+	std::atomic<uint64_t> dropped{0};
+
+	std::atomic_flag pushing = ATOMIC_FLAG_INIT;
+	std::mutex popMutex; // Held while claiming and taking messages, and while the slots grow
+	std::atomic<size_t> waiting{0};
+	moodycamel::LightweightSemaphore pushed;
+
+	void grow(); // Only by the producer
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -7,7 +7,10 @@
 #include "icsneo/communication/driver.h"
 #include "icsneo/communication/command.h"
 #include "icsneo/communication/encoder.h"
+#include "icsneo/communication/workerpool.h"
 #include "icsneo/third-party/readerwriterqueue/readerwriterqueue.h"
+#include <condition_variable>
+#include <optional>
 
 namespace icsneo {
 
@@ -23,6 +26,26 @@ public:
 	void spawnThreads() override;
 	void joinThreads() override;
 	bool sendPacket(std::vector<uint8_t>& bytes) override;
+	bool sendPacketAsync(std::vector<uint8_t>& bytes, Driver::WriteCompletion onComplete) override;
+	void appendPacket(std::vector<uint8_t>& batch, const std::vector<uint8_t>& packet) override;
+
+	// Where each VNET's traffic is packetized, decoded and dispatched, it stays in order in every mode
+	enum class VnetExecution {
+		ThreadPerVnet, // Each VNET has a thread of its own
+		Inline, // On the read thread, straight after each read is split up
+		Pooled // On a worker pool shared by every device, or inline when the VNET is idle and was given little
+	};
+
+	/**
+	 * Set how devices opened after the call run their VNETs. In Pooled mode,
+	 * `poolThreads` workers are shared between all of them. Devices which
+	 * are already open keep what they have until they are closed.
+	 */
+	static void SetDefaultVnetExecution(VnetExecution execution, size_t poolThreads = 2);
+	static VnetExecution GetDefaultVnetExecution();
+
+	// Use `execution` for this device rather than the default, from the next time it is opened
+	void setVnetExecution(VnetExecution execution) { executionOverride = execution; }
 
 	enum class CommandType : uint8_t {
 		PlasmaReadRequest = 0x10, // Status read request to HSC
@@ -45,9 +68,6 @@ public:
 		Microblaze_to_HostPC = 0x81 // Microblaze processor data to host PC
 	};
 
-protected:
-	bool preprocessPacket(std::deque<uint8_t>& usbReadFifo);
-
 private:
 	static bool CommandTypeIsValid(CommandType cmd) {
 		switch(cmd) {
@@ -96,23 +116,38 @@ private:
 		}
 	}
 
-	enum class PreprocessState {
-		SearchForCommand,
-		ParseAddress,
-		ParseLength,
-		GetData
-	};
-	PreprocessState state = PreprocessState::SearchForCommand;
-	uint16_t currentCommandLength;
-	CommandType currentCommandType;
-	size_t currentReadIndex = 0;
+	/**
+	 * Split the bytes from the device up by command, where they lie.
+	 * VNET payloads are appended to vnetBatches. Returns how many bytes
+	 * were used, anything after that is the start of a command we don't
+	 * have all of yet, and `needed` is set to how many bytes it takes.
+	 */
+	size_t demux(const uint8_t* data, size_t length, size_t& needed);
+
+	bool gotPacket = false; // Have we got the first valid packet (don't flag errors otherwise)
+	std::vector<uint8_t> demuxCarry; // The start of a command which straddles the end of the last read
+	std::vector< std::vector<uint8_t> > vnetBatches; // What each VNET has been given from the current read
 
+	static constexpr size_t MaxPooledVnetBuffers = 64;
+	static constexpr size_t InlineBatchLimit = 256; // In Pooled mode, smaller batches for an idle VNET are handled on the read thread
+	static constexpr size_t MaxBatchesPerTurn = 16; // In Pooled mode, a busy VNET goes to the back of the line after this many
 	const size_t numVnets;
+	std::optional<VnetExecution> executionOverride;
+	VnetExecution execution = VnetExecution::ThreadPerVnet; // What we're running with since the last open
+	std::shared_ptr<WorkerPool> workers;
 	std::thread hidReadThread;
 	std::vector<std::thread> vnetThreads;
+	std::vector< std::unique_ptr<Packetizer> > vnetPacketizers; // VNET 0 uses our own packetizer
 	std::vector< moodycamel::BlockingReaderWriterQueue< std::vector<uint8_t> > > vnetQueues;
+	std::vector< std::atomic<size_t> > vnetQueued; // In Pooled mode, batches queued or being handled, a drain is posted when this leaves 0
+	std::mutex vnetIdleMutex;
+	std::condition_variable vnetIdle; // Notified when a VNET's vnetQueued returns to 0
+	moodycamel::ConcurrentQueue< std::vector<uint8_t> > vnetBufferPool; // Batches are handed back here once the VNET is done with them
 	void hidReadTask();
 	void vnetReadTask(size_t vnetIndex);
+	void runVnet(size_t vnetIndex); // Hand vnetBatches[vnetIndex] off, in whichever way we're running
+	void drainVnet(size_t vnetIndex); // Handles queued batches for a VNET on the worker pool
+	void handleVnetInput(size_t vnetIndex, std::vector<uint8_t>& bytes);
 };
 
 }
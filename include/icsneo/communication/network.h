@@ -8,6 +8,7 @@ typedef uint8_t neonettype_t;
 
 #ifdef __cplusplus
 
+#include <array>
 #include <ostream>
 #include <optional>
 #include <tuple>
@@ -318,7 +319,7 @@ public:
 	 * the offset from OFFSET_PLASMA_SLAVE2, return the vnet agnostic
 	 * netid so caller can commonize handlers without caring about WHICH slave.
 	 */
-	static NetID OffsetToSimpleNetworkId(uint16_t offset) {
+	static constexpr NetID OffsetToSimpleNetworkId(uint16_t offset) {
 		switch(offset) {
 		default:
 		case 0:
@@ -425,24 +426,24 @@ public:
 			return NetID::LSFTCAN2;
 		}
 	}
-	static bool Within(neonetid_t value, neonetid_t min, neonetid_t max) {
+	static constexpr bool Within(neonetid_t value, neonetid_t min, neonetid_t max) {
 		return ((min <= value) && (value < max));
 	}
-	static bool IdIsSlaveARange1(neonetid_t fullNetid) {
+	static constexpr bool IdIsSlaveARange1(neonetid_t fullNetid) {
 		return Within(fullNetid, OFFSET_PLASMA_SLAVE1, OFFSET_PLASMA_SLAVE1 + COUNT_PLASMA_SLAVE);
 	}
-	static bool IdIsSlaveARange2(neonetid_t fullNetid) {
+	static constexpr bool IdIsSlaveARange2(neonetid_t fullNetid) {
 		return Within(fullNetid, OFFSET_PLASMA_SLAVE1_RANGE2, OFFSET_PLASMA_SLAVE2_RANGE2);
 	}
-	static bool IdIsSlaveBRange1(neonetid_t fullNetid) {
+	static constexpr bool IdIsSlaveBRange1(neonetid_t fullNetid) {
 		return Within(fullNetid, OFFSET_PLASMA_SLAVE2, OFFSET_PLASMA_SLAVE2 + COUNT_PLASMA_SLAVE);
 	}
-	static bool IdIsSlaveBRange2(neonetid_t fullNetid) {
+	static constexpr bool IdIsSlaveBRange2(neonetid_t fullNetid) {
 		return Within(fullNetid, OFFSET_PLASMA_SLAVE2_RANGE2, OFFSET_PLASMA_SLAVE3_RANGE2);
 	}
-	static std::pair<VnetId, NetID> GetVnetAgnosticNetid(neonetid_t fullNetid) {
+	static constexpr std::pair<VnetId, NetID> GetVnetAgnosticNetid(neonetid_t fullNetid) {
 		VnetId vnetId = VnetId::None;
-		NetID netId;
+		NetID netId = NetID::Invalid;
 
 		if(fullNetid < OFFSET_PLASMA_SLAVE1) {
 			netId = static_cast<NetID>(fullNetid);
@@ -475,11 +476,10 @@ public:
 		}
 		return "Invalid VNET ID";
 	}
-	static Type GetTypeOfNetID(NetID netid, bool expand = true) {
-		if(expand) {
-			netid = GetVnetAgnosticNetid((neonetid_t)netid).second;
-		}
-
+	// Every NetID below this, which is all but VNET range 2, Any and Invalid, has its type in a table
+	static constexpr neonetid_t NetIDTableSize = 1024;
+	static Type GetTypeOfNetID(NetID netid, bool expand = true);
+	static constexpr Type TypeOfCommonNetID(NetID netid) {
 		switch(netid) {
 		case NetID::HSCAN:
 		case NetID::MSCAN:
@@ -593,6 +593,14 @@ public:
 			return Type::Other;
 		}
 	}
+	static constexpr std::array<std::array<Type, NetIDTableSize>, 2> MakeTypeTables() {
+		std::array<std::array<Type, NetIDTableSize>, 2> tables = {};
+		for(neonetid_t i = 0; i < NetIDTableSize; i++) {
+			tables[false][i] = TypeOfCommonNetID(NetID(i));
+			tables[true][i] = TypeOfCommonNetID(GetVnetAgnosticNetid(i).second);
+		}
+		return tables;
+	}
 	static const char* GetNetIDString(NetID netid, bool expand = true) {
 		if(expand) {
 			netid = GetVnetAgnosticNetid((neonetid_t)netid).second;
@@ -1251,6 +1259,14 @@ private:
 	}
 };
 
+inline Network::Type Network::GetTypeOfNetID(NetID netid, bool expand) {
+	// This runs for every packet, so the switch in TypeOfCommonNetID is run for each NetID at compile time instead
+	static constexpr auto types = MakeTypeTables();
+	if((neonetid_t)netid < NetIDTableSize)
+		return types[expand][(neonetid_t)netid];
+	return TypeOfCommonNetID(expand ? GetVnetAgnosticNetid((neonetid_t)netid).second : netid);
+}
+
 }
 
 #endif // __cplusplus
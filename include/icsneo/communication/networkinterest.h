@@ -0,0 +1,65 @@
+#ifndef __NETWORKINTEREST_H_
+#define __NETWORKINTEREST_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/communication/network.h"
+#include <bitset>
+
+namespace icsneo {
+
+/**
+ * Which networks somebody wants messages from, gathered from the
+ * message filters so packets nobody wants are not decoded at all.
+ *
+ * Internal networks are always wanted, the device itself relies on them.
+ */
+class NetworkInterest {
+public:
+	void addAll() { everything = true; }
+	void add(Network::Type type) {
+		if(type == Network::Type::Any)
+			everything = true;
+		else
+			types.set(neonettype_t(type));
+	}
+	void add(Network::NetID netid) {
+		if(netid == Network::NetID::Any || neonetid_t(netid) >= Network::NetIDTableSize)
+			everything = true; // Rare enough that it isn't worth tracking
+		else
+			netids.set(neonetid_t(netid));
+	}
+
+	bool wantsAll() const { return everything; }
+	bool wants(Network::Type type) const { return everything || type == Network::Type::Internal || types.test(neonettype_t(type)); }
+	bool wants(Network::NetID netid) const { return everything || neonetid_t(netid) >= Network::NetIDTableSize || netids.test(neonetid_t(netid)); }
+	bool wants(const Network& network) const { return wants(network.getType()) || wants(network.getNetID()); }
+
+	// Whether `other` already wants every network this does
+	bool isCoveredBy(const NetworkInterest& other) const {
+		if(other.everything)
+			return true;
+		if(everything)
+			return false;
+		for(size_t i = 0; i < types.size(); i++) {
+			if(types.test(i) && !other.wants(Network::Type(i)))
+				return false;
+		}
+		for(size_t i = 0; i < netids.size(); i++) {
+			if(netids.test(i) && !other.wants(Network(neonetid_t(i), false)))
+				return false;
+		}
+		return true;
+	}
+
+private:
+	bool everything = false;
+	std::bitset<256> types;
+	std::bitset<Network::NetIDTableSize> netids;
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
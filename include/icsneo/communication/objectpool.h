@@ -0,0 +1,235 @@
+#ifndef __OBJECTPOOL_H_
+#define __OBJECTPOOL_H_
+
+#ifdef __cplusplus
+
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace icsneo {
+
+/**
+ * Hands out shared_ptrs to objects which go back to the pool, rather
+ * than being freed, once the last reference to them is dropped. The
+ * shared_ptr control blocks are recycled as well, so once the pool is
+ * warm, make() does not touch the heap.
+ *
+ * Recycled objects are reset to a default constructed state, except
+ * that a `data` vector keeps its capacity for the next user.
+ *
+ * make() and releases may happen on any thread. The pool is quickest
+ * when most objects are made and released by the same thread, such as
+ * a read thread. Objects may also outlive the pool. Whatever is still out when
+ * the pool is destroyed is freed normally once it is dropped.
+ */
+template<typename T>
+class ObjectPool {
+public:
+	static constexpr size_t DefaultMaxIdle = 1024;
+
+	ObjectPool(size_t maxIdle = DefaultMaxIdle) : state(new State(maxIdle)) {}
+	~ObjectPool() { state->release(); }
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	std::shared_ptr<T> make() {
+		if(!state->isOwner())
+			state->owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+		Node* node = static_cast<Node*>(state->objects.pop());
+		if(!node) {
+			node = new Node();
+			state->misses++;
+		}
+		state->references++; // Released once the control block is freed
+		return std::shared_ptr<T>(static_cast<T*>(node), Recycler{ state }, BlockAllocator<T>(state));
+	}
+
+	// How many times make() reused an object, and how many times it had to allocate one
+	uint64_t hits() const { return state->objects.popped(); }
+	uint64_t misses() const { return state->misses.load(std::memory_order_relaxed); }
+
+private:
+	template<typename U, typename = void>
+	struct KeepsData : std::false_type {};
+	template<typename U>
+	struct KeepsData<U, std::void_t<decltype(std::declval<U&>().data.clear())>> : std::true_type {};
+
+	struct Link {
+		Link* next = nullptr;
+	};
+
+	// What the pool actually allocates, so an idle object can be linked into a free list
+	struct Node : T, Link {};
+
+	/**
+	 * A private list, used by whichever thread holds `busy`, and a
+	 * shared list which anyone can push onto. The holder of `busy`
+	 * takes everything on the shared list in one exchange once the
+	 * private list runs dry. Only one thread takes from the shared
+	 * list at a time, so there is no ABA, and nobody ever waits.
+	 */
+	class FreeList {
+	public:
+		FreeList(size_t maxIdle) : maxIdle(maxIdle) {}
+
+		Link* pop() { // Returns nullptr if the list is empty or another thread is using it
+			if(busy.test_and_set(std::memory_order_acquire))
+				return nullptr;
+			if(!owned) {
+				const size_t count = pushes.load(std::memory_order_relaxed);
+				owned = pushed.exchange(nullptr, std::memory_order_acquire);
+				ownedCount += count - taken.load(std::memory_order_relaxed);
+				taken.store(count, std::memory_order_relaxed);
+			}
+			Link* ret = owned;
+			if(ret) {
+				owned = ret->next;
+				if(ownedCount) // The counts are allowed to drift a little, see push()
+					ownedCount--;
+				pops.store(pops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // Only the holder of `busy` writes it
+			}
+			busy.clear(std::memory_order_release);
+			return ret;
+		}
+
+		// Returns false if the list is full, the caller should free it itself
+		bool push(Link* link, bool preferPrivate) {
+			// The limit is only approximate while other threads are pushing, which is fine
+			const size_t sharedCount = pushes.load(std::memory_order_relaxed) - taken.load(std::memory_order_relaxed);
+			if(preferPrivate && !busy.test_and_set(std::memory_order_acquire)) {
+				const bool room = ownedCount + sharedCount < maxIdle;
+				if(room) {
+					link->next = owned;
+					owned = link;
+					ownedCount++;
+				}
+				busy.clear(std::memory_order_release);
+				return room;
+			}
+
+			if(sharedCount >= maxIdle)
+				return false;
+			pushes.fetch_add(1, std::memory_order_relaxed);
+			link->next = pushed.load(std::memory_order_relaxed);
+			while(!pushed.compare_exchange_weak(link->next, link, std::memory_order_release, std::memory_order_relaxed)) {}
+			return true;
+		}
+
+		uint64_t popped() const { return pops.load(std::memory_order_relaxed); }
+
+		// Only once nobody else can push or pop
+		template<typename Fn>
+		void drain(Fn&& free) {
+			for(Link* list : { owned, pushed.load() }) {
+				while(list) {
+					Link* next = list->next;
+					free(list);
+					list = next;
+				}
+			}
+		}
+
+	private:
+		const size_t maxIdle;
+		std::atomic<Link*> pushed{nullptr};
+		std::atomic<size_t> pushes{0};
+		std::atomic<size_t> taken{0}; // How many of the pushes have been moved to the private list
+		std::atomic_flag busy = ATOMIC_FLAG_INIT;
+		std::atomic<uint64_t> pops{0};
+		Link* owned = nullptr;
+		size_t ownedCount = 0;
+	};
+
+	// Shared by the pool and every object it has handed out, the last one to let go deletes it
+	struct State {
+		State(size_t maxIdle) : objects(maxIdle), blocks(maxIdle) {}
+		~State() {
+			objects.drain([](Link* link) { delete static_cast<Node*>(link); });
+			blocks.drain([](Link* link) { ::operator delete(link); });
+		}
+
+		void release() {
+			if(--references == 0)
+				delete this;
+		}
+
+		// Whoever last called make(), usually a read thread, prefers the private lists
+		bool isOwner() const { return std::this_thread::get_id() == owner.load(std::memory_order_relaxed); }
+
+		std::atomic<std::thread::id> owner;
+		std::atomic<size_t> references{1};
+		std::atomic<size_t> blockSize{0};
+		FreeList objects;
+		FreeList blocks;
+		std::atomic<uint64_t> misses{0};
+	};
+
+	struct Recycler {
+		State* state; // The control block holds a reference until after this runs
+		void operator()(T* obj) const {
+			Node* node = static_cast<Node*>(obj);
+			// Objects may have const members, so they're rebuilt in place rather than assigned
+			if constexpr(KeepsData<T>::value) {
+				auto data = std::move(node->data);
+				data.clear();
+				node->~Node();
+				node = new (node) Node();
+				node->data = std::move(data);
+			} else {
+				node->~Node();
+				node = new (node) Node();
+			}
+			if(!state->objects.push(node, state->isOwner()))
+				delete node;
+		}
+	};
+
+	// Allocates the shared_ptr control blocks, which are all the same size for a given T
+	template<typename U>
+	struct BlockAllocator {
+		using value_type = U;
+
+		BlockAllocator(State* state) : state(state) {}
+		template<typename V>
+		BlockAllocator(const BlockAllocator<V>& other) : state(other.state) {}
+
+		U* allocate(size_t n) {
+			const size_t size = n * sizeof(U);
+			size_t expected = 0;
+			if(state->blockSize.load(std::memory_order_relaxed) == 0)
+				state->blockSize.compare_exchange_strong(expected, size, std::memory_order_relaxed);
+			if(state->blockSize.load(std::memory_order_relaxed) == size) {
+				if(Link* block = state->blocks.pop())
+					return reinterpret_cast<U*>(block);
+			}
+			return static_cast<U*>(::operator new(std::max(size, sizeof(Link))));
+		}
+
+		void deallocate(U* ptr, size_t n) {
+			State* owner = state;
+			if(owner->blockSize != n * sizeof(U) || !owner->blocks.push(new (ptr) Link(), owner->isOwner()))
+				::operator delete(ptr);
+			owner->release();
+		}
+
+		template<typename V>
+		bool operator==(const BlockAllocator<V>& other) const { return state == other.state; }
+		template<typename V>
+		bool operator!=(const BlockAllocator<V>& other) const { return state != other.state; }
+
+		State* state;
+	};
+
+	State* state;
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -4,6 +4,8 @@
 #ifdef __cplusplus
 
 #include "icsneo/communication/message/canmessage.h"
+#include "icsneo/communication/message/canframebatch.h"
+#include "icsneo/communication/objectpool.h"
 #include "icsneo/api/eventmanager.h"
 #include <cstdint>
 #include <memory>
@@ -14,7 +16,9 @@ namespace icsneo {
 typedef uint16_t icscm_bitfield;
 
 struct HardwareCANPacket {
-	static std::shared_ptr<Message> DecodeToMessage(const std::vector<uint8_t>& bytestream);
+	static std::shared_ptr<Message> DecodeToMessage(const std::vector<uint8_t>& bytestream, ObjectPool<CANMessage>* pool = nullptr);
+	// Appends a frame with its raw timestamp, returns false without appending anything for error counts or short packets
+	static bool DecodeToBatch(const uint8_t* bytes, size_t length, Network::NetID netid, CANFrameBatch& batch);
 	static bool EncodeFromMessage(const CANMessage& message, std::vector<uint8_t>& bytestream, const device_eventhandler_t& report);
 
 	struct {
@@ -4,6 +4,7 @@
 #ifdef __cplusplus
 
 #include "icsneo/communication/message/ethernetmessage.h"
+#include "icsneo/communication/objectpool.h"
 #include "icsneo/api/eventmanager.h"
 #include <cstdint>
 #include <memory>
@@ -13,7 +14,7 @@ namespace icsneo {
 typedef uint16_t icscm_bitfield;
 
 struct HardwareEthernetPacket {
-	static std::shared_ptr<EthernetMessage> DecodeToMessage(const std::vector<uint8_t>& bytestream, const device_eventhandler_t& report);
+	static std::shared_ptr<EthernetMessage> DecodeToMessage(const std::vector<uint8_t>& bytestream, const device_eventhandler_t& report, ObjectPool<EthernetMessage>* pool = nullptr);
 	static bool EncodeFromMessage(const EthernetMessage& message, std::vector<uint8_t>& bytestream, const device_eventhandler_t& report);
 
 	struct {
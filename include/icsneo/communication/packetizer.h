@@ -4,13 +4,14 @@
 #ifdef __cplusplus
 
 #include "icsneo/communication/packet.h"
+#include "icsneo/communication/network.h"
+#include "icsneo/communication/objectpool.h"
 #include "icsneo/api/eventmanager.h"
 #include <queue>
 #include <vector>
 #include <memory>
 #include <cstring>
-
-#define ICSNEO_PACKETIZER_BUFFER_SIZE (512 * 1024)
+#include <functional>
 
 namespace icsneo {
 
@@ -23,118 +24,39 @@ public:
 	std::vector<uint8_t>& packetWrap(std::vector<uint8_t>& data, bool shortFormat) const;
 
 	bool input(const std::vector<uint8_t>& bytes);
+
+	/**
+	 * Packets are parsed straight out of the given bytes, only the
+	 * unfinished packet at the end (if any) is copied and kept for
+	 * the next call. Returns true if any whole packets were found, even
+	 * if they were all skipped.
+	 */
+	bool input(const uint8_t* data, size_t length);
 	std::vector<std::shared_ptr<Packet>> output();
 
 	bool disableChecksum = false; // Even for short packets
 	bool align16bit = true; // Not needed for Mars, Galaxy, etc and newer
+
+	// If set, packets on networks it returns false for are passed over without being copied out
+	std::function<bool(const Network&)> wantsNetwork;
+	uint64_t skippedPackets() const { return skipped; }
+
+	ObjectPool<Packet> packetPool; // Packets are recycled once the decoder is done with them
 	
 private:
-	enum class ReadState {
-		SearchForHeader,
-		ParseHeader,
-		ParseLongStylePacketHeader,
-		ParseDiskDataHeader,
-		GetData
-	};
-
-	class RingBuffer
-	{
-	private:
-		constexpr static size_t mBufferSize = ICSNEO_PACKETIZER_BUFFER_SIZE;
-
-		size_t mStartOffset;
-		size_t mSize;
-		uint8_t mData[mBufferSize];
-
-	public:
-		RingBuffer(void)
-			: mStartOffset(0)
-			, mSize(0)
-		{
-			(void)memset(mData, 0, mBufferSize);
-		}
-
-		const uint8_t& operator [](size_t offset) { return Get(offset); }
-		size_t size(void) { return mSize; }
-		void pop_front(void)
-		{
-			Erase_front(1);
-		}
-
-		void Erase_front(size_t count)
-		{
-			if (mSize < count)
-			{
-				throw std::runtime_error("RingBuffer: Underflow");
-			}
-			mStartOffset = (mStartOffset + count) % mBufferSize;
-			mSize -= count;
-		}
-
-		const uint8_t& Get(size_t offset)
-		{
-			if (offset >= mSize)
-			{
-				throw std::runtime_error("RingBuffer: Index out of range");
-			}
-			return *Resolve(offset);
-		}
-
-		void Copy(const std::vector<uint8_t>& source)
-		{
-			const auto inputSize = source.size();
-			const auto octetsAvailable = (mBufferSize - mSize);
-
-			if (inputSize > octetsAvailable)
-			{
-				throw std::runtime_error("RingBuffer: Out of memory");
-			}
-
-			const auto octetsAvailableTail = (octetsAvailable - mStartOffset);
-			const auto octetsToWrap = (inputSize > octetsAvailableTail) ? (inputSize - octetsAvailableTail) : 0;
-			const auto octetsToAppend = (inputSize - octetsToWrap);
-
-			(void)memcpy(Resolve(mSize), source.data(), octetsToAppend);
-			if (octetsToWrap > 0)
-			{
-				(void)memcpy(mData, &source.data()[octetsToAppend], octetsToWrap);
-			}
-			mSize += inputSize;
-		}
-
-		void CopyTo(uint8_t* dest, size_t startIndex, size_t length)
-		{
-			if ((startIndex + length) > mSize)
-			{
-				throw std::runtime_error("RingBuffer: Index out of range");
-			}
-
-			const auto octetsToReadHead = std::min<size_t>((mBufferSize - mStartOffset - startIndex), length);
-			const auto octetsToReadTail = (length - octetsToReadHead);
-
-			(void)memcpy(dest, Resolve(startIndex), octetsToReadHead);
-			if (octetsToReadTail > 0)
-			{
-				(void)memcpy(&dest[octetsToReadHead], mData, octetsToReadTail);
-			}
-		}
-
-	protected:
-		inline uint8_t* Resolve(size_t offset)
-		{
-			return &mData[(mStartOffset + offset) % mBufferSize];
-		}
-	};
-
-	ReadState state = ReadState::SearchForHeader;
-
-	int currentIndex = 0;
-	int packetLength = 0;
-	int headerSize = 0;
-	bool checksum = false;
+	/**
+	 * Parse as many packets as we can from the front of the bytes,
+	 * returning how many bytes were used up. Everything after that
+	 * is the start of a packet we don't have all of yet, and
+	 * `needed` is set to how many bytes we must have to go further.
+	 */
+	size_t parse(const uint8_t* data, size_t length, size_t& needed);
+
+	std::vector<uint8_t> carry; // The start of a packet which straddles the end of the last input
+	bool discardPadding = false; // The last input ended with a DiskData packet whose padding byte we haven't seen yet
 	bool gotGoodPackets = false; // Tracks whether we've ever gotten a good packet
-	Packet packet;
-	RingBuffer bytes;
+	bool gotPacketsThisInput = false;
+	uint64_t skipped = 0;
 
 	std::vector<std::shared_ptr<Packet>> processedPackets;
 
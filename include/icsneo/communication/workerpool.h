@@ -0,0 +1,39 @@
+#ifndef __WORKERPOOL_H_
+#define __WORKERPOOL_H_
+
+#ifdef __cplusplus
+
+#include <functional>
+#include <thread>
+#include <vector>
+#include "icsneo/third-party/concurrentqueue/blockingconcurrentqueue.h"
+
+namespace icsneo {
+
+/**
+ * A fixed set of threads which run whatever is posted to them, in no
+ * particular order. Anything which needs ordering, such as the packets
+ * from one VNET, must make sure only one of its tasks is posted at a time.
+ */
+class WorkerPool {
+public:
+	WorkerPool(size_t threadCount);
+	~WorkerPool(); // Runs everything already posted before returning
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void post(std::function<void()> task);
+	size_t size() const { return threads.size(); }
+
+private:
+	void run();
+
+	moodycamel::BlockingConcurrentQueue< std::function<void()> > tasks;
+	std::vector<std::thread> threads;
+};
+
+}
+
+#endif // __cplusplus
+
+#endif
@@ -25,6 +25,8 @@
 #include "icsneo/disk/diskwritedriver.h"
 #include "icsneo/disk/nulldiskdriver.h"
 #include "icsneo/communication/communication.h"
+#include "icsneo/communication/messagering.h"
+#include "icsneo/communication/message/neomessagering.h"
 #include "icsneo/communication/packetizer.h"
 #include "icsneo/communication/encoder.h"
 #include "icsneo/communication/decoder.h"
@@ -177,23 +179,59 @@ public:
 
 
 	// Message polling related functions
-	bool enableMessagePolling();
+	// Only messages matching the filter are queued, and networks nobody else wants are not even decoded
+	bool enableMessagePolling(std::shared_ptr<MessageFilter> filter = nullptr);
 	bool disableMessagePolling();
 	bool isMessagePollingEnabled() { return messagePollingCallbackID != 0; };
 	std::pair<std::vector<std::shared_ptr<Message>>, bool> getMessages();
 	bool getMessages(std::vector<std::shared_ptr<Message>>& container, size_t limit = 0, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
-	size_t getCurrentMessageCount() { return pollingContainer.size_approx(); }
-	size_t getPollingMessageLimit() { return pollingMessageLimit; }
-	void setPollingMessageLimit(size_t newSize) {
-		pollingMessageLimit = newSize;
-		enforcePollingMessageLimit();
-	}
+	size_t getCurrentMessageCount() { return pollingContainer.size(); }
+	size_t getPollingMessageLimit() { return pollingContainer.getLimit(); }
+	void setPollingMessageLimit(size_t newSize) { pollingContainer.setLimit(newSize); }
+	// Whether the oldest or the newest message is lost once the limit is reached, the oldest by default
+	MessageRing::Overflow getPollingOverflow() const { return pollingContainer.getOverflow(); }
+	void setPollingOverflow(MessageRing::Overflow overflow) { pollingContainer.setOverflow(overflow); }
+	// How many messages have been lost to the limit since the device was created
+	uint64_t getPollingDroppedCount() const { return pollingContainer.getDroppedCount(); }
+
+	// Messages converted to neomessage_t as they're read, for the C API to poll in place, see NeoMessageRing
+	bool enableNeoMessageRing(size_t messageCapacity, size_t payloadCapacity, std::shared_ptr<MessageFilter> filter = nullptr,
+		NeoMessageRing::Overflow overflow = NeoMessageRing::Overflow::DropNewest);
+	bool disableNeoMessageRing();
+	// Hold on to it for as long as it's used, it may be disabled from another thread meanwhile
+	std::shared_ptr<NeoMessageRing> getNeoMessageRing() const { return std::atomic_load(&neoMessageRing); }
 
 	int addMessageCallback(const std::shared_ptr<MessageCallback>& cb) { return com->addMessageCallback(cb); }
 	bool removeMessageCallback(int id) { return com->removeMessageCallback(id); }
+	int addCANFrameBatchCallback(fn_canFrameBatchCallback cb) { return com->addCANFrameBatchCallback(std::move(cb)); }
+	bool removeCANFrameBatchCallback(int id) { return com->removeCANFrameBatchCallback(id); }
+	int addMessageBatchCallback(const std::shared_ptr<MessageBatchCallback>& cb) { return com->addMessageBatchCallback(cb); }
+	bool removeMessageBatchCallback(int id) { return com->removeMessageBatchCallback(id); }
 
 	bool transmit(std::shared_ptr<Frame> frame);
-	bool transmit(std::vector<std::shared_ptr<Frame>> frames);
+	bool transmit(std::vector<std::shared_ptr<Frame>> frames); // True if every frame was accepted
+
+	/**
+	 * Encode the frames back to back and hand them to the driver together,
+	 * in as few writes as their size allows, rather than one per frame.
+	 * Returns how many of the frames, from the front, were accepted; it
+	 * stops at the first one which can't be sent, and if a write fails
+	 * it stops there and the frames which were to go in it are not
+	 * counted. If given, `writeFailed` tells the two apart.
+	 */
+	size_t transmitBatch(const std::vector<std::shared_ptr<Frame>>& frames, bool* writeFailed = nullptr);
+	static constexpr size_t TransmitBatchMaxBytes = 16384; // A batch is written out once it reaches this
+
+	/**
+	 * Transmit without waiting for room in the write queue. If this returns
+	 * true, `onComplete` will be called exactly once, from the driver's write
+	 * thread, when the frame has been handed to the OS or USB stack (or with
+	 * false if it was dropped). It must not block.
+	 *
+	 * If the write queue is full this fails with TransmitBufferFull instead
+	 * of blocking, regardless of setWriteBlocks().
+	 */
+	bool transmitAsync(std::shared_ptr<Frame> frame, std::function<void(bool success)> onComplete);
 
 	void setWriteBlocks(bool blocks);
 
@@ -803,6 +841,11 @@ private:
 	
 	APIEvent::Type attemptToBeginCommunication();
 
+	// Encodes `frame` into `packet` and returns true if it should be sent, otherwise `status` is the result of the transmit.
+	// `beforeHook` is called before an extension which may send the frame itself gets it, returning false stops there.
+	bool prepareTransmit(const std::shared_ptr<Frame>& frame, std::vector<uint8_t>& packet, bool& status,
+		const std::function<bool()>& beforeHook = {});
+
 	// Use heartbeatSuppressed instead when reading
 	std::atomic<int> heartbeatSuppressedByUser{0};
 	bool heartbeatSuppressed() const { return heartbeatSuppressedByUser > 0 || (settings && settings->applyingSettings); }
@@ -821,9 +864,11 @@ private:
 	LEDState ledState;
 	void updateLEDState();
 	
-	size_t pollingMessageLimit = 20000;
-	moodycamel::BlockingConcurrentQueue<std::shared_ptr<Message>> pollingContainer;
-	void enforcePollingMessageLimit();
+	MessageRing pollingContainer{20000};
+	std::atomic<uint64_t> pollingDropsReported{0}; // One PollingMessageOverflow is raised per getMessages() which finds more were lost
+
+	std::shared_ptr<NeoMessageRing> neoMessageRing; // Only ever touched through the std::atomic_ functions
+	int neoMessageRingCallbackID = 0;
 
 	std::atomic<bool> stopHeartbeatThread{false};
 	std::mutex heartbeatMutex;
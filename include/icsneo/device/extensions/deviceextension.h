@@ -5,6 +5,7 @@
 
 #include <memory>
 #include "icsneo/communication/message/message.h"
+#include "icsneo/communication/networkinterest.h"
 #include "icsneo/api/eventmanager.h"
 #include "icsneo/device/device.h"
 
@@ -31,9 +32,13 @@ public:
 	virtual bool providesFirmware() const { return false; }
 
 	virtual void handleMessage(const std::shared_ptr<Message>&) {}
+	// Networks handleMessage() wants to see besides the internal ones, by default all of them
+	virtual void addNetworkInterest(NetworkInterest& interest) const { interest.addAll(); }
 
 	// Return true to continue transmitting, success should be written to if false is returned
 	virtual bool transmitHook(const std::shared_ptr<Frame>& frame, bool& success) { (void)frame; (void)success; return true; }
+	// Whether transmitHook() may take the frame, by default any of them, so a batch is written out ahead of it
+	virtual bool hooksTransmit(const Frame&) const { return true; }
 
 protected:
 	Device& device;
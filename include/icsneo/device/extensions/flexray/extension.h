@@ -25,7 +25,9 @@ public:
 	void onGoOffline() override;
 
 	void handleMessage(const std::shared_ptr<Message>& message) override;
+	void addNetworkInterest(NetworkInterest&) const override {} // Only FlexRayControl, which is internal
 	bool transmitHook(const std::shared_ptr<Frame>& frame, bool& success) override;
+	bool hooksTransmit(const Frame& frame) const override { return frame.network.getType() == Network::Type::FlexRay; }
 
 	std::shared_ptr<Controller> getController(uint8_t index) const {
 		if(index >= controllers.size())
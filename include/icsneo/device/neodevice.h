@@ -28,7 +28,7 @@ typedef struct neodevice_t {
 #else
 typedef struct {
 #endif
-	devicehandle_t device; // Pointer back to the C++ device object
+	devicehandle_t device; // Pointer back to the C++ device object, or for those from icsneo_findAllDevices(), a handle the C API looks it up by
 	neodevice_handle_t handle; // Handle for use by the underlying driver
 	devicetype_t type;
 	char serial[7];
@@ -183,7 +183,8 @@ extern bool DLLExport icsneo_isOnline(const neodevice_t* device);
  * The client application will have to call icsneo_getMessages() very often to avoid losing messages, or change the limit.
  *
  * If the message limit is exceeded before a call to icsneo_getMessages() takes ownership of the messages,
- * the oldest message will be dropped (**LOST**) and an icsneo::APIEvent::PollingMessageOverflow will be flagged for the device.
+ * the oldest message will be dropped (**LOST**). The next call to icsneo_getMessages() will flag a single
+ * icsneo::APIEvent::PollingMessageOverflow for the device, however many were lost.
  *
  * This function will succeed even if the device is not open.
  */
@@ -281,10 +282,67 @@ extern int DLLExport icsneo_getPollingMessageLimit(const neodevice_t* device);
  * See icsneo_enableMessagePolling() for more information about the message polling system.
  *
  * Setting the maximum lower than the current number of stored messages will cause the oldest messages
- * to be dropped (**LOST**) and an icsneo::APIEvent::PollingMessageOverflow to be flagged for the device.
+ * to be dropped (**LOST**), and an icsneo::APIEvent::PollingMessageOverflow to be flagged by the next icsneo_getMessages().
  */
 extern bool DLLExport icsneo_setPollingMessageLimit(const neodevice_t* device, size_t newLimit);
 
+/**
+ * \brief Enable polling messages in place from a ring of neomessage_t owned by the API, rather than having icsneo_getMessages() convert and copy them out.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \param[in] messageCapacity How many messages the ring holds, rounded up to a power of 2.
+ * \param[in] payloadCapacity How many bytes of message data the ring holds.
+ * \returns True if the ring was enabled.
+ *
+ * Messages are converted as they are received, so reading them with icsneo_readMessageRing() costs nothing per message.
+ * This is independent of icsneo_enableMessagePolling(), either or both may be enabled.
+ *
+ * As the client application may still be reading the oldest messages, once either capacity is reached the newest
+ * messages are dropped (**LOST**), and the next icsneo_readMessageRing() flags an icsneo::APIEvent::PollingMessageOverflow.
+ *
+ * Only one thread should read from and commit to the ring at a time.
+ */
+extern bool DLLExport icsneo_enableMessageRing(const neodevice_t* device, size_t messageCapacity, size_t payloadCapacity);
+
+/**
+ * \brief Disable the message ring for the specified device, dropping anything still in it.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \returns True if the ring was disabled.
+ *
+ * Any messages returned by icsneo_readMessageRing() must no longer be accessed.
+ */
+extern bool DLLExport icsneo_disableMessageRing(const neodevice_t* device);
+
+/**
+ * \brief Get the oldest messages from the message ring without taking them out of it.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \param[out] messages Set to point at the first of the messages within the ring.
+ * \param[in,out] count The most messages to return, or 0 for as many as possible. Set to how many were returned.
+ * \returns True if the ring could be read, even if there were no messages.
+ *
+ * The messages are contiguous, so fewer than are waiting may be returned when they wrap around the end of the ring.
+ * They, and the data they point to, stay valid until they are given back with icsneo_commitMessageRing().
+ *
+ * \code{.c}
+ * const neomessage_t* messages;
+ * size_t count = 0;
+ * while(icsneo_readMessageRing(device, &messages, &count) && count != 0) {
+ * 	for(size_t i = 0; i < count; i++)
+ * 		handleMessage(&messages[i]);
+ * 	icsneo_commitMessageRing(device, count);
+ * 	count = 0;
+ * }
+ * \endcode
+ */
+extern bool DLLExport icsneo_readMessageRing(const neodevice_t* device, const neomessage_t** messages, size_t* count);
+
+/**
+ * \brief Give the oldest messages back to the message ring, to make room for more.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \param[in] count How many of the messages returned by icsneo_readMessageRing() are done with.
+ * \returns True if the messages were given back.
+ */
+extern bool DLLExport icsneo_commitMessageRing(const neodevice_t* device, size_t count);
+
 /**
  * \brief Adds a message callback to the specified device to be called when a new message is received.
  * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
@@ -302,6 +360,26 @@ extern int DLLExport icsneo_addMessageCallback(const neodevice_t* device, void (
  */
 extern bool DLLExport icsneo_removeMessageCallback(const neodevice_t* device, int id);
 
+/**
+ * \brief Adds a callback to the specified device to be called with every message from a read at once.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \param[in] callback A function pointer with void return type, taking an array of neomessage_t and the number of messages in it.
+ * \param[in] filter Unused for now. Exists as a placeholder here for future backwards-compatibility.
+ * \returns The id of the callback added, or -1 if the operation failed.
+ *
+ * The array, and the data the messages point to, are only valid until the callback returns.
+ * Where a device delivers many messages per read, this saves a call per message over icsneo_addMessageCallback().
+ */
+extern int DLLExport icsneo_addBatchMessageCallback(const neodevice_t* device, void (*callback)(const neomessage_t* messages, size_t count), void*);
+
+/**
+ * \brief Removes a batch message callback from the specified device.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
+ * \param[in] id The id of the callback to remove.
+ * \returns True if the callback was successfully removed.
+ */
+extern bool DLLExport icsneo_removeBatchMessageCallback(const neodevice_t* device, int id);
+
 /**
  * \brief Get the network ID for the nth network of a specified type on this device
  * \param[in] device A pointer to the neodevice_t structure specifying the device to operate on.
@@ -566,6 +644,20 @@ extern bool DLLExport icsneo_transmit(const neodevice_t* device, const neomessag
  */
 extern bool DLLExport icsneo_transmitMessages(const neodevice_t* device, const neomessage_t* messages, size_t count);
 
+/**
+ * \brief Transmit multiple messages, encoded together and written to the device in as few transfers as possible.
+ * \param[in] device A pointer to the neodevice_t structure specifying the device to transmit on.
+ * \param[in] messages A pointer to the neomessage_t structures defining the messages.
+ * \param[in] count The number of messages to transmit.
+ * \returns How many of the messages, starting from the first, were verified transmittable and enqueued for transmit.
+ *
+ * Transmitting stops at the first message which can not be sent, the messages after it are not attempted.
+ * It also stops if writing to the device fails, in which case the messages which were to go in that write are not counted.
+ *
+ * See icsneo_transmitMessages() for information regarding ordering.
+ */
+extern size_t DLLExport icsneo_transmitBatch(const neodevice_t* device, const neomessage_t* messages, size_t count);
+
 /**
  * \brief Set the behavior of whether writing is a blocking action or not.
  * \param[in] device A pointer to the neodevice_t structure specifying the device to transmit on.
@@ -894,12 +986,30 @@ fn_icsneo_getPollingMessageLimit icsneo_getPollingMessageLimit;
 typedef bool(*fn_icsneo_setPollingMessageLimit)(const neodevice_t* device, size_t newLimit);
 fn_icsneo_setPollingMessageLimit icsneo_setPollingMessageLimit;
 
+typedef bool(*fn_icsneo_enableMessageRing)(const neodevice_t* device, size_t messageCapacity, size_t payloadCapacity);
+fn_icsneo_enableMessageRing icsneo_enableMessageRing;
+
+typedef bool(*fn_icsneo_disableMessageRing)(const neodevice_t* device);
+fn_icsneo_disableMessageRing icsneo_disableMessageRing;
+
+typedef bool(*fn_icsneo_readMessageRing)(const neodevice_t* device, const neomessage_t** messages, size_t* count);
+fn_icsneo_readMessageRing icsneo_readMessageRing;
+
+typedef bool(*fn_icsneo_commitMessageRing)(const neodevice_t* device, size_t count);
+fn_icsneo_commitMessageRing icsneo_commitMessageRing;
+
 typedef int(*fn_icsneo_addMessageCallback)(const neodevice_t* device, void (*callback)(neomessage_t), void*);
 fn_icsneo_addMessageCallback icsneo_addMessageCallback;
 
 typedef bool(*fn_icsneo_removeMessageCallback)(const neodevice_t* device, int id);
 fn_icsneo_removeMessageCallback icsneo_removeMessageCallback;
 
+typedef int(*fn_icsneo_addBatchMessageCallback)(const neodevice_t* device, void (*callback)(const neomessage_t* messages, size_t count), void*);
+fn_icsneo_addBatchMessageCallback icsneo_addBatchMessageCallback;
+
+typedef bool(*fn_icsneo_removeBatchMessageCallback)(const neodevice_t* device, int id);
+fn_icsneo_removeBatchMessageCallback icsneo_removeBatchMessageCallback;
+
 typedef neonetid_t (*fn_icsneo_getNetworkByNumber)(const neodevice_t* device, neonettype_t type, unsigned int number);
 fn_icsneo_getNetworkByNumber icsneo_getNetworkByNumber;
 
@@ -948,6 +1058,9 @@ fn_icsneo_transmit icsneo_transmit;
 typedef bool(*fn_icsneo_transmitMessages)(const neodevice_t* device, const neomessage_t* messages, size_t count);
 fn_icsneo_transmitMessages icsneo_transmitMessages;
 
+typedef size_t(*fn_icsneo_transmitBatch)(const neodevice_t* device, const neomessage_t* messages, size_t count);
+fn_icsneo_transmitBatch icsneo_transmitBatch;
+
 typedef bool(*fn_icsneo_setWriteBlocks)(const neodevice_t* device, bool blocks);
 fn_icsneo_setWriteBlocks icsneo_setWriteBlocks;
 
@@ -1048,8 +1161,14 @@ int icsneo_init() {
 	ICSNEO_IMPORTASSERT(icsneo_getMessages);
 	ICSNEO_IMPORTASSERT(icsneo_getPollingMessageLimit);
 	ICSNEO_IMPORTASSERT(icsneo_setPollingMessageLimit);
+	ICSNEO_IMPORTASSERT(icsneo_enableMessageRing);
+	ICSNEO_IMPORTASSERT(icsneo_disableMessageRing);
+	ICSNEO_IMPORTASSERT(icsneo_readMessageRing);
+	ICSNEO_IMPORTASSERT(icsneo_commitMessageRing);
 	ICSNEO_IMPORTASSERT(icsneo_addMessageCallback);
 	ICSNEO_IMPORTASSERT(icsneo_removeMessageCallback);
+	ICSNEO_IMPORTASSERT(icsneo_addBatchMessageCallback);
+	ICSNEO_IMPORTASSERT(icsneo_removeBatchMessageCallback);
 	ICSNEO_IMPORTASSERT(icsneo_getNetworkByNumber);
 	ICSNEO_IMPORTASSERT(icsneo_getProductName);
 	ICSNEO_IMPORTASSERT(icsneo_settingsRefresh);
@@ -1066,6 +1185,7 @@ int icsneo_init() {
 	ICSNEO_IMPORTASSERT(icsneo_setFDBaudrate);
 	ICSNEO_IMPORTASSERT(icsneo_transmit);
 	ICSNEO_IMPORTASSERT(icsneo_transmitMessages);
+	ICSNEO_IMPORTASSERT(icsneo_transmitBatch);
 	ICSNEO_IMPORTASSERT(icsneo_setWriteBlocks);
 	ICSNEO_IMPORTASSERT(icsneo_describeDevice);
 	ICSNEO_IMPORTASSERT(icsneo_getVersion);
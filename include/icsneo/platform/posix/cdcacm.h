@@ -9,7 +9,11 @@
 #include <optional>
 #include <chrono>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <stdint.h>
+#ifdef __linux__
+#include "icsneo/platform/posix/linux/ioreactor.h"
+#endif
 
 namespace icsneo {
 
@@ -50,6 +54,16 @@ private:
 	void readTask() override;
 	void writeTask() override;
 	bool fdIsValid();
+
+#ifdef __linux__
+	// Set when the shared IOReactor is doing our I/O instead of readTask and writeTask
+	std::shared_ptr<IOReactor> reactor;
+	WriteBatch reactorWrite;
+	std::vector<struct iovec> reactorIOV;
+	bool reactorAwaitingWritable = false;
+	void handleReactorEvents(uint32_t events);
+	bool writeInternal(WriteOperation&& op) override;
+#endif
 };
 
 }
@@ -9,6 +9,9 @@
 #include "icsneo/api/eventmanager.h"
 #include <optional>
 #include <string>
+#ifdef __linux__
+#include "icsneo/platform/posix/linux/ioreactor.h"
+#endif
 
 namespace icsneo {
 
@@ -27,9 +30,10 @@ public:
 private:
 	void readTask() override;
 	void writeTask() override;
+	void handleInterrupt();
 	bool writeQueueFull() override;
 	bool writeQueueAlmostFull() override;
-	bool writeInternal(const std::vector<uint8_t>& bytes) override;
+	bool writeInternal(WriteOperation&& op) override;
 
 	struct DataInfo {
 		uint32_t type;
@@ -132,6 +136,14 @@ private:
 	std::mutex outMutex;
 	std::optional<MsgQueue> out;
 	std::optional<Mempool> outMemory;
+
+	// Only used by handleInterrupt()
+	std::vector<Msg> toFree;
+
+#ifdef __linux__
+	// Set when the shared IOReactor is waiting on our interrupts instead of readTask
+	std::shared_ptr<IOReactor> reactor;
+#endif
 };
 
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <atomic>
 #include <ftdi.h>
 #include "icsneo/device/neodevice.h"
 #include "icsneo/communication/driver.h"
@@ -24,6 +25,17 @@ public:
 	bool close();
 	bool isOpen() { return ftdi.isOpen(); }
 
+	// Read tuning, these take effect on the next open()
+	struct ReadSettings {
+		// Submit several libusb bulk transfers at once rather than blocking in ftdi_read_data
+		bool bulk = true;
+		// Size of each USB transfer, including the two modem status bytes per USB packet
+		size_t chunkSize = 16384;
+		size_t transfersInFlight = 4;
+		// Milliseconds the FTDI chip will hold a partial packet before sending it
+		uint8_t latencyTimer = 1;
+	} readSettings;
+
 private:
 	class FTDIContext {
 	public:
@@ -46,8 +58,10 @@ private:
 		int write(const uint8_t* data, size_t size) { return ftdi_write_data(context, data, (int)size); }
 		int setBaudrate(int baudrate) { return ftdi_set_baudrate(context, baudrate); }
 		int setLatencyTimer(uint8_t latency) { return ftdi_set_latency_timer(context, latency); }
+		int setReadChunkSize(size_t size) { return ftdi_read_data_set_chunksize(context, (unsigned int)size); }
 		bool setReadTimeout(int timeout) { if(context == nullptr) return false; context->usb_read_timeout = timeout; return true; }
 		bool setWriteTimeout(int timeout) { if(context == nullptr) return false; context->usb_write_timeout = timeout; return true; }
+		struct ftdi_context* get() const { return context; }
 	private:
 		struct ftdi_context* context;
 		bool deviceOpen = false;
@@ -57,7 +71,11 @@ private:
 	static std::vector<std::string> handles;
 
 	static bool ErrorIsDisconnection(int errorCode);
+	static void BulkReadCallback(struct libusb_transfer* transfer);
+	void handleReadError(int error);
 	void readTask();
+	void bulkReadTask();
+	std::atomic<size_t> bulkTransfersPending{0};
 	void writeTask();
 	bool openable; // Set to false in the constructor if the object has not been found in searchResultDevices
 
@@ -0,0 +1,38 @@
+#ifndef __FTDIMODEMSTATUS_POSIX_H_
+#define __FTDIMODEMSTATUS_POSIX_H_
+
+#ifdef __cplusplus
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace icsneo {
+
+/**
+ * Removes the two modem status bytes the FTDI chip puts at the start of
+ * every `packetSize` byte USB packet, as libftdi would, and returns how
+ * many bytes of data are left at the front of `data`. `length` need not
+ * be a whole number of packets, a transfer which timed out may end part
+ * way through one.
+ */
+inline size_t StripFTDIModemStatus(uint8_t* data, size_t length, size_t packetSize) {
+	if(packetSize <= 2)
+		return 0;
+
+	size_t out = 0;
+	for(size_t offset = 0; offset < length; offset += packetSize) {
+		const size_t packetLength = std::min(packetSize, length - offset);
+		if(packetLength <= 2)
+			break;
+		memmove(data + out, data + offset + 2, packetLength - 2);
+		out += packetLength - 2;
+	}
+	return out;
+}
+
+}
+
+#endif // __cplusplus
+
+#endif
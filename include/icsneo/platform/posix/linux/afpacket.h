@@ -0,0 +1,86 @@
+#ifndef __AFPACKET_LINUX_H_
+#define __AFPACKET_LINUX_H_
+
+#ifdef __cplusplus
+
+#include "icsneo/device/neodevice.h"
+#include "icsneo/device/founddevice.h"
+#include "icsneo/communication/driver.h"
+#include "icsneo/communication/ethernetpacketizer.h"
+#include "icsneo/api/eventmanager.h"
+#include <string>
+
+struct tpacket_block_desc;
+
+namespace icsneo {
+
+/**
+ * A raw Ethernet driver for Linux which uses AF_PACKET sockets directly rather
+ * than libpcap.
+ *
+ * Frames are received into a TPACKET_V3 ring shared with the kernel and are
+ * parsed where they lie, a block of frames at a time. Frames are sent from a
+ * TX ring where the kernel supports one (4.11+), otherwise with send().
+ *
+ * The socket only sees our 0xCAB2 EtherType, so traffic for the rest of the
+ * system is never copied to us. Opening the socket needs CAP_NET_RAW, the
+ * same as libpcap. If it can't be opened, Find() finds nothing here and the
+ * PCAP driver is still tried when it is built.
+ */
+class AFPacket : public Driver {
+public:
+	static void Find(std::vector<FoundDevice>& foundDevices);
+	static bool IsHandleValid(neodevice_handle_t handle);
+
+	AFPacket(device_eventhandler_t err, neodevice_t& forDevice);
+	~AFPacket();
+	bool open() override;
+	bool isOpen() override;
+	bool close() override;
+	bool isEthernet() const override { return true; }
+
+	// Ring geometry, the RX ring is handed back to the kernel a block at a time
+	static constexpr size_t RXBlockSize = 1 << 16;
+	static constexpr size_t RXBlockCount = 32;
+	static constexpr unsigned RXBlockTimeoutMilliseconds = 1; // A partially filled block is handed to us after this long
+	static constexpr size_t TXFrameSize = 2048;
+	static constexpr size_t TXFrameCount = 128;
+
+private:
+	neodevice_t& device;
+	uint8_t deviceMAC[6];
+	bool openable = true;
+	EthernetPacketizer ethPacketizer;
+
+	class NetworkInterface {
+	public:
+		std::string name;
+		int index = 0;
+		uint8_t macAddress[6];
+	};
+	static std::vector<NetworkInterface> knownInterfaces;
+	NetworkInterface iface;
+
+	int fd = -1;
+	uint8_t* ring = nullptr;
+	size_t ringSize = 0;
+	uint8_t* txRing = nullptr; // nullptr if the kernel has no TX ring for TPACKET_V3
+	size_t rxBlock = 0;
+	size_t txFrame = 0;
+
+	static int OpenSocket(int ifindex);
+	bool setupRings();
+	void teardownRings();
+
+	void readTask() override;
+	void writeTask() override;
+	void processBlock(struct tpacket_block_desc* block);
+	bool sendFrame(const uint8_t* frame, size_t length);
+	bool flushTX();
+};
+
+}
+
+#endif // __cplusplus
+
+#endif // __AFPACKET_LINUX_H_
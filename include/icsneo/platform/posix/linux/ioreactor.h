@@ -0,0 +1,114 @@
+#ifndef __IOREACTOR_LINUX_H_
+#define __IOREACTOR_LINUX_H_
+
+#ifdef __cplusplus
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace icsneo {
+
+/**
+ * A shared epoll event loop for the POSIX drivers.
+ *
+ * By default every driver runs its own read and write threads. When the reactor
+ * is enabled, drivers opened afterwards register their file descriptors here
+ * instead and all of their I/O is done from the reactor threads, so a host with
+ * many devices attached does not need two threads per device.
+ *
+ * Handlers are always called on the reactor thread which owns the registration,
+ * one at a time, and must not block.
+ */
+class IOReactor {
+public:
+	enum Events : uint32_t {
+		Readable = 0x1,
+		Writable = 0x2,
+		Error = 0x4, // Hangup or error on the file descriptor
+		Notified = 0x8 // notify() was called for this file descriptor
+	};
+	using Handler = std::function<void(uint32_t events)>;
+
+	/**
+	 * Opt in (or back out) of the shared reactor. This only affects drivers
+	 * opened after the call, drivers which are already open keep their reactor
+	 * or threads until they are closed.
+	 *
+	 * `threadCount` reactor threads are started, each driver is assigned to one
+	 * of them.
+	 */
+	static void SetEnabled(bool enabled, size_t threadCount = 1);
+	static bool IsEnabled();
+
+	// Returns the reactor a newly opened driver should use, or nullptr if the reactor is not enabled
+	static std::shared_ptr<IOReactor> Get();
+
+	IOReactor();
+	~IOReactor();
+	IOReactor(const IOReactor&) = delete;
+	IOReactor& operator=(const IOReactor&) = delete;
+
+	bool isValid() const;
+
+	/**
+	 * Start watching `fd` for `events` (Readable and/or Writable).
+	 * Error is always reported, Notified is reported after notify().
+	 */
+	bool add(int fd, uint32_t events, Handler handler);
+	bool modify(int fd, uint32_t events);
+
+	/**
+	 * Stop watching `fd`. Once this returns the handler is not running and will
+	 * not be called again, unless remove() is called from the handler itself.
+	 */
+	bool remove(int fd);
+
+	// Wake the reactor and call the handler for `fd` with Notified
+	void notify(int fd);
+
+	bool isReactorThread() const { return std::this_thread::get_id() == threadID; }
+
+private:
+	struct Registration {
+		Handler handler;
+		std::mutex running;
+		bool active = true;
+	};
+
+	// Everything the reactor thread touches, kept alive by the thread itself so
+	// that the last reference to the reactor may be dropped from a handler
+	struct State {
+		~State();
+		int epollFD = -1;
+		int wakeFD = -1;
+		std::atomic<bool> stopping{false};
+
+		std::mutex registrationsMutex;
+		std::unordered_map<int, std::shared_ptr<Registration>> registrations;
+
+		std::mutex notifyMutex;
+		std::vector<int> notified;
+
+		std::shared_ptr<Registration> find(int fd);
+		void dispatch(int fd, uint32_t events);
+	};
+
+	std::shared_ptr<State> state;
+	std::thread thread;
+	std::thread::id threadID;
+
+	static uint32_t ToEpoll(uint32_t events);
+	static void Run(std::shared_ptr<State> state);
+};
+
+}
+
+#endif // __cplusplus
+
+#endif // __IOREACTOR_LINUX_H_
@@ -0,0 +1,119 @@
+#ifndef __IOURING_LINUX_H_
+#define __IOURING_LINUX_H_
+
+#ifdef __cplusplus
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace icsneo {
+
+/**
+ * A minimal io_uring, talking to the kernel directly so that liburing is not
+ * required. Only what the drivers need is implemented.
+ */
+class IOURing {
+public:
+	// Checked once at runtime, io_uring may be missing from the kernel or disabled by policy
+	static bool IsSupported();
+
+	explicit IOURing(unsigned entries);
+	~IOURing();
+	IOURing(const IOURing&) = delete;
+	IOURing& operator=(const IOURing&) = delete;
+
+	bool isValid() const { return ringFD >= 0; }
+	bool registerBuffers(std::vector<std::vector<uint8_t>>& buffers);
+
+	// Returns nullptr if the submission queue is full, the entry is zeroed
+	struct io_uring_sqe* getSQE();
+
+	// Submits everything queued by getSQE() and waits for at least `waitFor` completions
+	int submit(unsigned waitFor = 0);
+
+	// Calls fn(userData, result, flags) for every completion ready, returns how many there were
+	size_t forEachCompletion(const std::function<void(uint64_t, int32_t, uint32_t)>& fn);
+
+	// The number of io_uring_enter system calls made, for benchmarking
+	size_t syscalls() const { return enterCalls; }
+
+private:
+	int ringFD = -1;
+	unsigned features = 0;
+
+	void* sqRing = nullptr;
+	size_t sqRingSize = 0;
+	void* cqRing = nullptr;
+	size_t cqRingSize = 0;
+	struct io_uring_sqe* sqes = nullptr;
+	size_t sqesSize = 0;
+
+	unsigned* sqHead = nullptr;
+	unsigned* sqTail = nullptr;
+	unsigned sqMask = 0;
+	unsigned sqEntries = 0;
+	unsigned* sqArray = nullptr;
+	unsigned sqLocalTail = 0;
+	unsigned sqToSubmit = 0;
+
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	unsigned cqMask = 0;
+	struct io_uring_cqe* cqes = nullptr;
+
+	size_t enterCalls = 0;
+};
+
+/**
+ * Keeps a read of a file descriptor in flight, into a registered buffer, so
+ * that a busy stream costs one system call per chunk (handing back the data
+ * and queueing the next read together) rather than a select() and a read().
+ *
+ * Only one read is ever outstanding, io_uring makes no promise that several
+ * reads of the same stream complete in order, so chunks are handed back in
+ * the order of the byte stream.
+ */
+class IOURingReader {
+public:
+	// The same as the select() loops these replace
+	static constexpr int64_t WakeIntervalNanoseconds = 50000000;
+
+	IOURingReader(int fd, bool isSocket, size_t bufferSize = 16384);
+	bool isValid() const { return ring.isValid() && buffersRegistered; }
+
+	/**
+	 * Read until shouldStop() returns true or onError() returns false.
+	 *
+	 * onData() is called for every chunk read. onError() is called with the
+	 * result of any read which returned zero or a negative errno, other than
+	 * the ones which just mean "try again".
+	 */
+	void run(const std::function<void(const uint8_t*, size_t)>& onData,
+		const std::function<bool(int)>& onError,
+		const std::function<bool()>& shouldStop);
+
+	size_t syscalls() const { return ring.syscalls(); }
+
+private:
+	const int fd;
+	const bool isSocket;
+	IOURing ring;
+	std::vector<std::vector<uint8_t>> buffers; // Just the one, registered with the ring
+	bool buffersRegistered = false;
+
+	// Returns how many operations were queued, the linked poll counts as one of its own
+	size_t queueRead(bool afterPoll);
+	size_t queueCancel();
+	bool queueTimeout();
+};
+
+}
+
+#endif // __cplusplus
+
+#endif // __IOURING_LINUX_H_
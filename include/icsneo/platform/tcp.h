@@ -7,6 +7,10 @@
 
 #include "icsneo/communication/driver.h"
 #include "icsneo/device/founddevice.h"
+#ifdef __linux__
+#include <sys/uio.h>
+#include "icsneo/platform/posix/linux/ioreactor.h"
+#endif
 
 namespace icsneo {
 
@@ -48,6 +52,16 @@ private:
 	std::unique_ptr<Socket> socket;
 	void readTask() override;
 	void writeTask() override;
+
+#ifdef __linux__
+	// Set when the shared IOReactor is doing our I/O instead of readTask and writeTask
+	std::shared_ptr<IOReactor> reactor;
+	WriteBatch reactorWrite;
+	std::vector<struct iovec> reactorIOV;
+	bool reactorAwaitingWritable = false;
+	void handleReactorEvents(uint32_t events);
+	bool writeInternal(WriteOperation&& op) override;
+#endif
 };
 
 }
@@ -89,10 +89,8 @@ bool FTD3XX::close() {
 	if(writeThread.joinable())
 		writeThread.join();
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	if(const auto ret = FT_Close(*handle); ret != FT_OK) {
 		addEvent(ret, APIEvent::Severity::EventWarning);
@@ -137,7 +135,7 @@ void FTD3XX::readTask() {
 		}
 		FT_ReleaseOverlapped(*handle, &overlap);
 		if(received > 0) {
-			readQueue.enqueue_bulk(buffer, received);
+			pushReadBytes(buffer, received);
 		}
 	}
 }
@@ -148,7 +146,7 @@ void FTD3XX::writeTask() {
 	FT_SetPipeTimeout(*handle, WRITE_PIPE_ID, 100);
 	WriteOperation writeOp;
 	while(!closing && !isDisconnected()) {
-		if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+		if(!dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(100)))
 			continue;
 
 		const auto size = static_cast<ULONG>(writeOp.bytes.size());
@@ -161,10 +159,12 @@ void FTD3XX::writeTask() {
 		#else
 			FT_WritePipeAsync(*handle, 0, writeOp.bytes.data(), size, &sent, &overlap);
 		#endif
+		bool success = false;
 		while(!closing) {
 			const auto ret = FT_GetOverlappedResult(*handle, &overlap, &sent, true);
 			if(ret == FT_IO_PENDING)
 				continue;
+			success = (ret == FT_OK);
 			if(ret != FT_OK) {
 				if(ret == FT_IO_ERROR) {
 					disconnected = true;
@@ -177,5 +177,6 @@ void FTD3XX::writeTask() {
 			break;
 		}
 		FT_ReleaseOverlapped(*handle, &overlap);
+		writeOp.complete(success);
 	}
 }
@@ -11,6 +11,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <climits>
+#ifdef ICSNEO_ENABLE_IO_URING
+#include "icsneo/platform/posix/linux/iouring.h"
+#endif
 
 using namespace icsneo;
 
@@ -100,6 +105,16 @@ bool CDCACM::open() {
 		return false;
 	}
 
+#ifdef __linux__
+	if((reactor = IOReactor::Get())) {
+		reactorWrite.clear();
+		reactorAwaitingWritable = false;
+		if(reactor->add(fd, IOReactor::Readable, [this](uint32_t events) { handleReactorEvents(events); }))
+			return true;
+		reactor.reset(); // Fall back to our own threads
+	}
+#endif
+
 	// Create threads
 	readThread = std::thread(&CDCACM::readTask, this);
 	writeThread = std::thread(&CDCACM::writeTask, this);
@@ -119,6 +134,14 @@ bool CDCACM::close() {
 
 	closing = true;
 
+#ifdef __linux__
+	if(reactor) {
+		reactor->remove(fd);
+		reactor.reset();
+		reactorWrite.clear(); // Fails anything we hadn't finished writing, rather than leaving it to go out after a reopen
+	}
+#endif
+
 	if(readThread.joinable())
 		readThread.join();
 	
@@ -140,10 +163,8 @@ bool CDCACM::close() {
 	int ret = ::close(fd);
 	fd = -1;
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while (readQueue.try_dequeue(flush)) {}
-	while (writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	if(modeChanging) {
 		modeChanging = false;
@@ -171,16 +192,45 @@ void CDCACM::awaitModeChangeComplete() {
 }
 
 void CDCACM::readTask() {
-	constexpr size_t READ_BUFFER_SIZE = 2048;
-	uint8_t readbuf[READ_BUFFER_SIZE];
+	std::vector<uint8_t> readbuf;
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+
+#ifdef ICSNEO_ENABLE_IO_URING
+	if(IOURing::IsSupported()) {
+		IOURingReader reader(fd, false);
+		if(reader.isValid()) {
+			reader.run([this](const uint8_t* data, size_t length) {
+				pushReadBytes(data, length);
+			}, [this](int) {
+				if(modeChanging) {
+					// We were expecting a disconnect for reenumeration
+					modeChangeThread = std::thread([this] {
+						modeChangeCV.notify_all();
+						// Requesting thread is responsible for calling close. This allows for more flexibility
+					});
+					return false;
+				} else if(!closing && !fdIsValid() && !isDisconnected()) {
+					disconnected = true;
+					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+				}
+				return !isDisconnected();
+			}, [this]() {
+				return closing || isDisconnected();
+			});
+			return;
+		}
+	}
+#endif
+
 	while(!closing && !isDisconnected()) {
 		fd_set rfds = {0};
 		struct timeval tv = {0};
 		FD_SET(fd, &rfds);
 		tv.tv_usec = 50000; // 50ms
 		::select(fd + 1, &rfds, NULL, NULL, &tv);
-		auto bytesRead = ::read(fd, readbuf, READ_BUFFER_SIZE);
+		if(readbuf.empty())
+			readbuf = acquireReadBuffer();
+		auto bytesRead = ::read(fd, readbuf.data(), readbuf.size());
 		if(bytesRead > 0) {
 #if 0 // Perhaps helpful for debugging :)
 			std::cout << "Read data: (" << bytesRead << ')' << std::hex << std::endl;
@@ -192,7 +242,9 @@ void CDCACM::readTask() {
 			std::cout << std::dec << std::endl;
 #endif
 		
-			readQueue.enqueue_bulk(readbuf, bytesRead);
+			readbuf.resize(bytesRead);
+			pushReadBuffer(std::move(readbuf));
+			readbuf.clear();
 		} else {
 			if(modeChanging) {
 				// We were expecting a disconnect for reenumeration
@@ -210,57 +262,141 @@ void CDCACM::readTask() {
 }
 
 void CDCACM::writeTask() {
-	WriteOperation writeOp;
+	WriteBatch batch;
+	std::vector<struct iovec> iov;
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 	while(!closing && !isDisconnected()) {
-		if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+		if(batch.empty() && !dequeueWriteBatch(batch, std::chrono::milliseconds(100)))
 			continue;
 
-		const ssize_t totalWriteSize = (ssize_t)writeOp.bytes.size();
-		ssize_t totalWritten = 0;
-		while(totalWritten < totalWriteSize) {
-			const ssize_t writeSize = totalWriteSize - totalWritten;
-			ssize_t actualWritten = ::write(fd, writeOp.bytes.data() + totalWritten, writeSize);
-			if(actualWritten != writeSize) {
-				// If we partially wrote, it's probably EAGAIN but it won't have been set
-				// so don't signal an error unless it's < 0, we'll come back around and
-				// get a -1 to see the real error.
-				if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-					// We filled the TX FIFO, use select to wait for it to become available again
-					fd_set wfds = {0};
-					struct timeval tv = {0};
-					FD_SET(fd, &wfds);
-					tv.tv_usec = 50000; // 50ms
-					::select(fd + 1, nullptr, &wfds, nullptr, &tv);
-				} else if (actualWritten < 0) {
-					if(!fdIsValid()) {
-						if(!isDisconnected()) {
-							disconnected = true;
-							report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
-						}
-					} else
-						report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+		iov.clear();
+		batch.forEachRemaining([&iov](const uint8_t* data, size_t length) {
+			iov.push_back({ const_cast<uint8_t*>(data), length });
+			return iov.size() < IOV_MAX;
+		});
+
+		const ssize_t actualWritten = ::writev(fd, iov.data(), (int)iov.size());
+		if(actualWritten > 0) {
+#if 0 // Perhaps helpful for debugging :)
+			std::cout << "Wrote data: (" << actualWritten << ')' << std::endl;
+#endif
+			batch.consume(actualWritten);
+		} else if(actualWritten == 0) {
+			continue; // Nothing written but nothing went wrong, errno is left over from something else so just try again
+		} else if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			// We filled the TX FIFO, use select to wait for it to become available again
+			fd_set wfds = {0};
+			struct timeval tv = {0};
+			FD_SET(fd, &wfds);
+			tv.tv_usec = 50000; // 50ms
+			::select(fd + 1, nullptr, &wfds, nullptr, &tv);
+		} else {
+			if(!fdIsValid()) {
+				if(!isDisconnected()) {
+					disconnected = true;
+					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+				}
+			} else
+				report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+			batch.clear();
+		}
+	}
+}
+
+bool CDCACM::fdIsValid() {
+	struct termios tty = {};
+	return tcgetattr(fd, &tty) == 0 ? true : false;
+}
+
+#ifdef __linux__
+void CDCACM::handleReactorEvents(uint32_t events) {
+	if(events & (IOReactor::Readable | IOReactor::Error)) {
+		while(true) {
+			auto readbuf = acquireReadBuffer();
+			const auto bytesRead = ::read(fd, readbuf.data(), readbuf.size());
+			if(bytesRead > 0) {
+				const bool drained = size_t(bytesRead) < readbuf.size();
+				readbuf.resize(bytesRead);
+				pushReadBuffer(std::move(readbuf));
+				if(drained)
 					break;
+				continue;
+			}
+			releaseReadBuffer(std::move(readbuf));
+
+			if(bytesRead < 0 && errno == EINTR)
+				continue;
+			if(bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !(events & IOReactor::Error))
+				break;
+
+			if(modeChanging) {
+				// We were expecting a disconnect for reenumeration
+				reactor->remove(fd);
+				modeChangeThread = std::thread([this] {
+					modeChangeCV.notify_all();
+					// Requesting thread is responsible for calling close. This allows for more flexibility
+				});
+				return;
+			}
+			if((events & IOReactor::Error) || !fdIsValid()) {
+				if(!isDisconnected()) {
+					disconnected = true;
+					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
 				}
+				reactor->remove(fd);
+				return;
 			}
+			break;
+		}
+	}
+
+	if(events & (IOReactor::Writable | IOReactor::Notified)) {
+		bool blocked = false;
+		while(!blocked) {
+			if(reactorWrite.empty() && !dequeueWriteBatch(reactorWrite, std::chrono::milliseconds(0), false))
+				break;
+
+			reactorIOV.clear();
+			reactorWrite.forEachRemaining([this](const uint8_t* data, size_t length) {
+				reactorIOV.push_back({ const_cast<uint8_t*>(data), length });
+				return reactorIOV.size() < IOV_MAX;
+			});
+
+			const ssize_t actualWritten = ::writev(fd, reactorIOV.data(), (int)reactorIOV.size());
 			if(actualWritten > 0) {
-#if 0 // Perhaps helpful for debugging :)
-				std::cout << "Wrote data: (" << actualWritten << ')' << std::hex << std::endl;
-				for(int i = 0; i < actualWritten; i += 16) {
-					for(int j = 0; j < std::min<int>(actualWritten - i, 16); j++)
-						std::cout << std::setw(2) << std::setfill('0') << uint32_t(writeOp.bytes[totalWritten+i+j]) << ' ';
-					std::cout << std::endl;
+				reactorWrite.consume(actualWritten);
+			} else if(actualWritten == 0) {
+				continue; // As in writeTask(), errno says nothing here so try again
+			} else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				blocked = true; // We filled the TX FIFO, wait for the reactor to tell us it's available again
+			} else if(errno != EINTR) {
+				if(!fdIsValid()) {
+					if(!isDisconnected()) {
+						disconnected = true;
+						report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+					}
+					reactor->remove(fd);
+					return;
 				}
-				std::cout << std::dec << std::endl;
-#endif
-
-				totalWritten += actualWritten;
+				report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+				reactorWrite.clear(); // Drop this write
 			}
 		}
+
+		if(blocked != reactorAwaitingWritable) {
+			reactor->modify(fd, IOReactor::Readable | (blocked ? IOReactor::Writable : 0));
+			reactorAwaitingWritable = blocked;
+		}
 	}
 }
 
-bool CDCACM::fdIsValid() {
-	struct termios tty = {};
-	return tcgetattr(fd, &tty) == 0 ? true : false;
+bool CDCACM::writeInternal(WriteOperation&& op) {
+	if(!reactor)
+		return Driver::writeInternal(std::move(op));
+
+	if(!writeQueue.enqueue(std::move(op)))
+		return false;
+	reactor->notify(fd);
+	return true;
 }
+#endif
@@ -148,6 +148,22 @@ bool FirmIO::open() {
 		toFree.pop_back();
 	}
 
+#ifdef __linux__
+	if((reactor = IOReactor::Get())) {
+		const bool added = reactor->add(fd, IOReactor::Readable, [this](uint32_t events) {
+			if(events & IOReactor::Error) {
+				report(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
+				reactor->remove(fd);
+				return;
+			}
+			handleInterrupt();
+		});
+		if(added)
+			return true;
+		reactor.reset(); // Fall back to our own thread
+	}
+#endif
+
 	// Create thread
 	// No thread for writing since we don't need the extra buffer
 	readThread = std::thread(&FirmIO::readTask, this);
@@ -167,6 +183,13 @@ bool FirmIO::close() {
 
 	closing = true;
 
+#ifdef __linux__
+	if(reactor) {
+		reactor->remove(fd);
+		reactor.reset();
+	}
+#endif
+
 	if(readThread.joinable())
 		readThread.join();
 
@@ -182,8 +205,7 @@ bool FirmIO::close() {
 	ret |= ::close(fd);
 	fd = -1;
 
-	uint8_t flush;
-	while (readQueue.try_dequeue(flush)) {}
+	clearReadQueue();
 
 	if(ret == 0) {
 		return true;
@@ -195,8 +217,6 @@ bool FirmIO::close() {
 
 void FirmIO::readTask() {
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
-	Msg msg;
-	std::vector<Msg> toFree;
 
 	while(!closing && !isDisconnected()) {
 		fd_set rfds = {0};
@@ -210,56 +230,66 @@ void FirmIO::readTask() {
 		if(ret <= 0)
 			continue;
 
-		uint32_t interruptCount = 0;
-		ret = ::read(fd, &interruptCount, sizeof(interruptCount));
-		if(ret < 0)
-			report(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
-		if(ret < int(sizeof(interruptCount)) || interruptCount < 1)
-			continue;
+		handleInterrupt();
+	}
+}
 
-		toFree.clear();
-		int i = 0;
-		while(!in->isEmpty() && i++ < 1000) {
-			if(!in->read(&msg))
-				break;
-
-			switch(msg.command) {
-			case Msg::Command::ComData: {
-				if(toFree.empty() || toFree.back().payload.free.refCount == 6) {
-					toFree.emplace_back();
-					toFree.back().command = Msg::Command::ComFree;
-					toFree.back().payload.free.refCount = 0;
-				}
-
-				// Add this ref to the list of payloads to free
-				// After we process these, we'll send this list back to the device
-				// so that it can free these entries
-				toFree.back().payload.free.ref[toFree.back().payload.free.refCount] = msg.payload.data.ref;
-				toFree.back().payload.free.refCount++;
-
-				// std::cout << "Got some data @ 0x" << std::hex << msg.payload.data.addr << " " << std::dec << msg.payload.data.len << std::endl;
-
-				// Translate the physical address back to our virtual address space
-				uint8_t* addr = reinterpret_cast<uint8_t*>(msg.payload.data.addr - PHY_ADDR_BASE + vbase);
-				readQueue.enqueue_bulk(addr, msg.payload.data.len);
-				break;
+void FirmIO::handleInterrupt() {
+	Msg msg;
+
+	uint32_t interruptCount = 0;
+	int ret = ::read(fd, &interruptCount, sizeof(interruptCount));
+	if(ret < 0)
+		report(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
+	if(ret < int(sizeof(interruptCount)) || interruptCount < 1)
+		return;
+
+	toFree.clear();
+	int i = 0;
+	while(!in->isEmpty() && i++ < 1000) {
+		if(!in->read(&msg))
+			break;
+
+		switch(msg.command) {
+		case Msg::Command::ComData: {
+			if(toFree.empty() || toFree.back().payload.free.refCount == 6) {
+				toFree.emplace_back();
+				toFree.back().command = Msg::Command::ComFree;
+				toFree.back().payload.free.refCount = 0;
 			}
-			case Msg::Command::ComFree: {
+
+			// Add this ref to the list of payloads to free
+			// After we process these, we'll send this list back to the device
+			// so that it can free these entries
+			toFree.back().payload.free.ref[toFree.back().payload.free.refCount] = msg.payload.data.ref;
+			toFree.back().payload.free.refCount++;
+
+			// std::cout << "Got some data @ 0x" << std::hex << msg.payload.data.addr << " " << std::dec << msg.payload.data.len << std::endl;
+
+			// Translate the physical address back to our virtual address space
+			uint8_t* addr = reinterpret_cast<uint8_t*>(msg.payload.data.addr - PHY_ADDR_BASE + vbase);
+			pushReadBytes(addr, msg.payload.data.len);
+			break;
+		}
+		case Msg::Command::ComFree: {
+			{
 				std::lock_guard<std::mutex> lk(outMutex);
 				// std::cout << "Got some free " << std::hex << msg.payload.free.ref[0] << std::endl;
 				for(uint32_t i = 0; i < msg.payload.free.refCount; i++)
 					outMemory->free(reinterpret_cast<uint8_t*>(msg.payload.free.ref[i]));
-				break;
-			}
 			}
+			// The device has caught up with our messages, so a blocked write() may be able to continue
+			notifyWriteSpace();
+			break;
 		}
-
-		while(!toFree.empty()) {
-			std::lock_guard<std::mutex> lk(outMutex);
-			out->write(&toFree.back());
-			toFree.pop_back();
 		}
 	}
+
+	while(!toFree.empty()) {
+		std::lock_guard<std::mutex> lk(outMutex);
+		out->write(&toFree.back());
+		toFree.pop_back();
+	}
 }
 
 void FirmIO::writeTask() {
@@ -275,7 +305,9 @@ bool FirmIO::writeQueueAlmostFull() {
 	return writeQueueFull();
 }
 
-bool FirmIO::writeInternal(const std::vector<uint8_t>& bytes) {
+bool FirmIO::writeInternal(WriteOperation&& op) {
+	// There's no write thread, the bytes are handed to the device right here
+	const auto& bytes = op.bytes;
 	if(bytes.empty() || bytes.size() > Mempool::BlockSize)
 		return false;
 
@@ -296,7 +328,11 @@ bool FirmIO::writeInternal(const std::vector<uint8_t>& bytes) {
 		return false;
 
 	uint32_t genInterrupt = 0x01;
-	return ::write(fd, &genInterrupt, sizeof(genInterrupt)) == sizeof(genInterrupt);
+	if(::write(fd, &genInterrupt, sizeof(genInterrupt)) != sizeof(genInterrupt))
+		return false;
+
+	op.complete(true);
+	return true;
 }
 
 bool FirmIO::MsgQueue::read(Msg* msg) {
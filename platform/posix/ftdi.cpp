@@ -1,5 +1,6 @@
 #include "icsneo/platform/ftdi.h"
 #include "icsneo/device/founddevice.h"
+#include "icsneo/platform/posix/ftdimodemstatus.h"
 #include <iostream>
 #include <stdio.h>
 #include <cstring>
@@ -77,7 +78,8 @@ bool FTDI::open() {
 	ftdi.setWriteTimeout(1000);
 	ftdi.reset();
 	ftdi.setBaudrate(500000);
-	ftdi.setLatencyTimer(1);
+	ftdi.setLatencyTimer(readSettings.latencyTimer);
+	ftdi.setReadChunkSize(readSettings.chunkSize);
 	ftdi.flush();
 
 	// Create threads
@@ -109,10 +111,8 @@ bool FTDI::close() {
 			report(APIEvent::Type::DriverFailedToClose, APIEvent::Severity::Error);
 	}
 	
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	closing = false;
 	disconnected = false;
@@ -199,30 +199,122 @@ bool FTDI::ErrorIsDisconnection(int errorCode) {
 		errorCode == LIBUSB_ERROR_IO;
 }
 
+void FTDI::handleReadError(int error) {
+	if(ErrorIsDisconnection(error)) {
+		if(!isDisconnected()) {
+			disconnected = true;
+			report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+		}
+	} else
+		report(APIEvent::Type::FailedToRead, APIEvent::Severity::EventWarning);
+}
+
 void FTDI::readTask() {
-	constexpr size_t READ_BUFFER_SIZE = 8;
-	uint8_t readbuf[READ_BUFFER_SIZE];
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+	if(readSettings.bulk && readSettings.transfersInFlight > 0) {
+		bulkReadTask();
+		return;
+	}
+
+	std::vector<uint8_t> readbuf;
 	while(!closing && !isDisconnected()) {
-		auto readBytes = ftdi.read(readbuf, READ_BUFFER_SIZE);
+		if(readbuf.empty())
+			readbuf = acquireReadBuffer(readSettings.chunkSize);
+		auto readBytes = ftdi.read(readbuf.data(), readbuf.size());
 		if(readBytes < 0) {
-			if(ErrorIsDisconnection(readBytes)) {
-				if(!isDisconnected()) {
-					disconnected = true;
-					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
-				}
-			} else
-				report(APIEvent::Type::FailedToRead, APIEvent::Severity::EventWarning);
-		} else
-			readQueue.enqueue_bulk(readbuf, readBytes);
+			handleReadError(readBytes);
+		} else if(readBytes > 0) {
+			readbuf.resize(readBytes);
+			pushReadBuffer(std::move(readbuf));
+			readbuf.clear();
+		}
+	}
+}
+
+void FTDI::BulkReadCallback(struct libusb_transfer* transfer) {
+	FTDI* driver = reinterpret_cast<FTDI*>(transfer->user_data);
+
+	switch(transfer->status) {
+		case LIBUSB_TRANSFER_COMPLETED:
+		case LIBUSB_TRANSFER_TIMED_OUT: { // Whatever arrived before the timeout is still in the buffer
+			const size_t length = StripFTDIModemStatus(transfer->buffer, transfer->actual_length, driver->ftdi.get()->max_packet_size);
+			driver->pushReadBytes(transfer->buffer, length);
+			break;
+		}
+		case LIBUSB_TRANSFER_CANCELLED:
+			break;
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			driver->handleReadError(LIBUSB_ERROR_NO_DEVICE);
+			break;
+		case LIBUSB_TRANSFER_STALL:
+			driver->handleReadError(LIBUSB_ERROR_PIPE);
+			break;
+		default:
+			driver->handleReadError(LIBUSB_ERROR_IO);
+			break;
+	}
+
+	// Keep the transfer in flight until we're shutting down
+	if(!driver->closing && !driver->isDisconnected() && transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+		const int ret = libusb_submit_transfer(transfer);
+		if(ret == 0)
+			return;
+		driver->handleReadError(ret);
 	}
+	driver->bulkTransfersPending--;
+}
+
+void FTDI::bulkReadTask() {
+	struct ftdi_context* context = ftdi.get();
+	std::vector<struct libusb_transfer*> transfers;
+	std::vector< std::vector<uint8_t> > buffers(readSettings.transfersInFlight, std::vector<uint8_t>(readSettings.chunkSize));
+
+	for(auto& buffer : buffers) {
+		struct libusb_transfer* transfer = libusb_alloc_transfer(0);
+		if(transfer == nullptr) {
+			report(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
+			break;
+		}
+		libusb_fill_bulk_transfer(transfer, context->usb_dev, (unsigned char)context->out_ep, buffer.data(), (int)buffer.size(),
+			&FTDI::BulkReadCallback, this, context->usb_read_timeout);
+		transfers.push_back(transfer);
+	}
+
+	for(auto transfer : transfers) {
+		const int ret = libusb_submit_transfer(transfer);
+		if(ret != 0) {
+			handleReadError(ret);
+			break;
+		}
+		bulkTransfersPending++;
+	}
+
+	while(!closing && !isDisconnected() && bulkTransfersPending > 0) {
+		struct timeval tv = { 0, 100000 }; // 100ms
+		libusb_handle_events_timeout_completed(context->usb_ctx, &tv, nullptr);
+	}
+
+	// Cancel whatever is still in flight and wait for libusb to hand the transfers back
+	for(auto transfer : transfers)
+		libusb_cancel_transfer(transfer);
+	while(bulkTransfersPending > 0) {
+		struct timeval tv = { 0, 100000 }; // 100ms
+		if(libusb_handle_events_timeout_completed(context->usb_ctx, &tv, nullptr) != 0)
+			break;
+	}
+
+	// A transfer libusb still owns can not be freed, leak it rather than crash
+	if(bulkTransfersPending > 0)
+		return;
+	for(auto transfer : transfers)
+		libusb_free_transfer(transfer);
 }
 
 void FTDI::writeTask() {
 	WriteOperation writeOp;
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 	while(!closing && !isDisconnected()) {
-		if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+		if(!dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(100)))
 			continue;
 
 		size_t offset = 0;
@@ -240,6 +332,6 @@ void FTDI::writeTask() {
 			} else
 				offset += writeBytes;
 		}
-		
+		writeOp.complete(offset >= writeOp.bytes.size());
 	}
 }
\ No newline at end of file
@@ -0,0 +1,414 @@
+#include "icsneo/platform/posix/linux/afpacket.h"
+#include "icsneo/communication/network.h"
+#include "icsneo/communication/communication.h"
+#include "icsneo/communication/packetizer.h"
+#include "icsneo/communication/decoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace icsneo;
+
+static constexpr uint16_t EtherTypeToHost = 0xCAB2;
+
+// Where the frame goes in a TX ring slot, the kernel expects it right after the (aligned) header
+static constexpr size_t TXDataOffset = TPACKET_ALIGN(sizeof(struct tpacket3_hdr));
+
+std::vector<AFPacket::NetworkInterface> AFPacket::knownInterfaces;
+
+int AFPacket::OpenSocket(int ifindex) {
+	// Nothing is received until we bind, so the rings can be set up first if they are wanted
+	const int fd = ::socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+	if(fd < 0 || ifindex == 0)
+		return fd;
+
+	struct sockaddr_ll addr = {};
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(EtherTypeToHost);
+	addr.sll_ifindex = ifindex;
+	if(::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+void AFPacket::Find(std::vector<FoundDevice>& found) {
+	struct ifaddrs* addrs = nullptr;
+	if(getifaddrs(&addrs) != 0)
+		return;
+
+	std::vector<NetworkInterface> interfaces;
+	for(struct ifaddrs* ifa = addrs; ifa != nullptr; ifa = ifa->ifa_next) {
+		if(ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_PACKET)
+			continue;
+		if(!(ifa->ifa_flags & IFF_UP) || (ifa->ifa_flags & IFF_LOOPBACK))
+			continue;
+		const struct sockaddr_ll* ll = reinterpret_cast<const struct sockaddr_ll*>(ifa->ifa_addr);
+		if(ll->sll_halen != 6)
+			continue;
+
+		NetworkInterface netif;
+		netif.name = ifa->ifa_name;
+		netif.index = ll->sll_ifindex;
+		memcpy(netif.macAddress, ll->sll_addr, sizeof(netif.macAddress));
+		interfaces.push_back(netif);
+	}
+	freeifaddrs(addrs);
+
+	// The position in knownInterfaces goes into the handle, so interfaces keep their place once seen
+	std::vector<size_t> present;
+	for(auto& netif : interfaces) {
+		auto known = std::find_if(knownInterfaces.begin(), knownInterfaces.end(), [&netif](const NetworkInterface& k) {
+			return memcmp(netif.macAddress, k.macAddress, sizeof(netif.macAddress)) == 0;
+		});
+		if(known == knownInterfaces.end()) {
+			knownInterfaces.push_back(netif);
+			known = knownInterfaces.end() - 1;
+		} else {
+			*known = netif; // The interface may have been recreated with a new index
+		}
+		present.push_back(size_t(known - knownInterfaces.begin()));
+	}
+
+	for(size_t i : present) {
+		const auto& iface = knownInterfaces[i];
+		const int fd = OpenSocket(iface.index);
+		if(fd < 0)
+			continue; // Most likely we don't have CAP_NET_RAW, PCAP will report this if it is built
+
+		EthernetPacketizer::EthernetPacket requestPacket;
+		memcpy(requestPacket.srcMAC, iface.macAddress, sizeof(requestPacket.srcMAC));
+		requestPacket.payload.reserve(4);
+		requestPacket.payload = {
+			((1 << 4) | (uint8_t)Network::NetID::Main51), // Packet size of 1 on NETID_MAIN51
+			(uint8_t)Command::RequestSerialNumber
+		};
+		requestPacket.payload.push_back(Packetizer::ICSChecksum(requestPacket.payload));
+		requestPacket.payload.insert(requestPacket.payload.begin(), 0xAA);
+
+		const auto bs = requestPacket.getBytestream();
+		if(::send(fd, bs.data(), bs.size(), 0) != ssize_t(bs.size())) {
+			::close(fd);
+			continue;
+		}
+
+		uint8_t frame[ETH_FRAME_LEN + 64];
+		const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+		while(true) { // Wait up to 50ms for the responses
+			const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(timeout - std::chrono::steady_clock::now());
+			if(remaining.count() <= 0)
+				break;
+			struct pollfd pfd = { fd, POLLIN, 0 };
+			if(::poll(&pfd, 1, int(remaining.count())) <= 0)
+				continue;
+			const ssize_t length = ::recv(fd, frame, sizeof(frame), MSG_DONTWAIT);
+			if(length <= 0)
+				continue;
+
+			EthernetPacketizer ethPacketizer([](APIEvent::Type, APIEvent::Severity) {});
+			memcpy(ethPacketizer.hostMAC, iface.macAddress, sizeof(ethPacketizer.hostMAC));
+			ethPacketizer.allowInPacketsFromAnyMAC = true;
+			if(!ethPacketizer.inputUp(frame, size_t(length)))
+				continue; // This packet is not for us
+
+			Packetizer packetizer([](APIEvent::Type, APIEvent::Severity) {});
+			if(!packetizer.input(ethPacketizer.outputUp()))
+				continue; // This packet was not well formed
+
+			const uint8_t* srcMAC = frame + 6;
+			Decoder decoder([](APIEvent::Type, APIEvent::Severity) {});
+			for(const auto& packet : packetizer.output()) {
+				std::shared_ptr<Message> message;
+				if(!decoder.decode(message, packet))
+					continue;
+
+				const auto serial = std::dynamic_pointer_cast<SerialNumberMessage>(message);
+				if(!serial || serial->deviceSerial.size() != 6)
+					continue;
+
+				FoundDevice foundDevice;
+				foundDevice.handle = (neodevice_handle_t)((i << 24) | (srcMAC[3] << 16) | (srcMAC[4] << 8) | (srcMAC[5]));
+				foundDevice.productId = srcMAC[2];
+				memcpy(foundDevice.serial, serial->deviceSerial.c_str(), sizeof(foundDevice.serial) - 1);
+				foundDevice.serial[sizeof(foundDevice.serial) - 1] = '\0';
+
+				if(std::any_of(found.begin(), found.end(), [&](const auto& found) { return ::strncmp(foundDevice.serial, found.serial, sizeof(foundDevice.serial)) == 0; }))
+					continue; // We already have this device on this interface
+
+				foundDevice.makeDriver = [](const device_eventhandler_t& report, neodevice_t& device) {
+					return std::unique_ptr<Driver>(new AFPacket(report, device));
+				};
+
+				found.push_back(foundDevice);
+			}
+		}
+
+		::close(fd);
+	}
+}
+
+bool AFPacket::IsHandleValid(neodevice_handle_t handle) {
+	uint8_t netifIndex = (uint8_t)(handle >> 24);
+	return (netifIndex < knownInterfaces.size());
+}
+
+AFPacket::AFPacket(device_eventhandler_t err, neodevice_t& forDevice) : Driver(err), device(forDevice), ethPacketizer(err) {
+	if(IsHandleValid(device.handle)) {
+		iface = knownInterfaces[(device.handle >> 24) & 0xFF];
+
+		deviceMAC[0] = 0x00;
+		deviceMAC[1] = 0xFC;
+		deviceMAC[2] = 0x70;
+		deviceMAC[3] = (device.handle >> 16) & 0xFF;
+		deviceMAC[4] = (device.handle >> 8) & 0xFF;
+		deviceMAC[5] = device.handle & 0xFF;
+		memcpy(ethPacketizer.deviceMAC, deviceMAC, 6);
+		memcpy(ethPacketizer.hostMAC, iface.macAddress, 6);
+	} else {
+		openable = false;
+	}
+}
+
+AFPacket::~AFPacket() {
+	if(isOpen())
+		close();
+}
+
+bool AFPacket::setupRings() {
+	int version = TPACKET_V3;
+	if(setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+		return false;
+
+	struct tpacket_req3 rx = {};
+	rx.tp_block_size = RXBlockSize;
+	rx.tp_block_nr = RXBlockCount;
+	rx.tp_frame_size = TPACKET_ALIGNMENT << 7; // Only used for the sanity checks, V3 packs frames into the blocks
+	rx.tp_frame_nr = (RXBlockSize * RXBlockCount) / rx.tp_frame_size;
+	rx.tp_retire_blk_tov = RXBlockTimeoutMilliseconds;
+	if(setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &rx, sizeof(rx)) != 0)
+		return false;
+	const size_t rxSize = RXBlockSize * RXBlockCount;
+
+	// The kernel only takes a TPACKET_V3 TX ring from 4.11, we'll use send() without one
+	struct tpacket_req3 tx = {};
+	tx.tp_block_size = TXFrameSize * TXFrameCount;
+	tx.tp_block_nr = 1;
+	tx.tp_frame_size = TXFrameSize;
+	tx.tp_frame_nr = TXFrameCount;
+	const size_t txSize = (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &tx, sizeof(tx)) == 0) ? TXFrameSize * TXFrameCount : 0;
+
+	ringSize = rxSize + txSize;
+	void* map = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if(map == MAP_FAILED) {
+		ringSize = 0;
+		return false;
+	}
+	ring = reinterpret_cast<uint8_t*>(map);
+	txRing = txSize ? ring + rxSize : nullptr;
+	rxBlock = 0;
+	txFrame = 0;
+
+	// Our frames don't need to go through the qdisc, failing to skip it is harmless
+	int bypass = 1;
+	setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof(bypass));
+	return true;
+}
+
+void AFPacket::teardownRings() {
+	if(ring != nullptr)
+		munmap(ring, ringSize);
+	ring = txRing = nullptr;
+	ringSize = 0;
+}
+
+bool AFPacket::open() {
+	if(!openable) {
+		report(APIEvent::Type::DriverFailedToOpen, APIEvent::Severity::Error);
+		return false;
+	}
+
+	if(isOpen())
+		return false;
+
+	fd = OpenSocket(0);
+	if(fd < 0) {
+		report(APIEvent::Type::DriverFailedToOpen, APIEvent::Severity::Error);
+		return false;
+	}
+
+	struct sockaddr_ll addr = {};
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(EtherTypeToHost);
+	addr.sll_ifindex = iface.index;
+	if(!setupRings() || ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+		teardownRings();
+		::close(fd);
+		fd = -1;
+		report(APIEvent::Type::DriverFailedToOpen, APIEvent::Severity::Error);
+		return false;
+	}
+
+	// Create threads
+	readThread = std::thread(&AFPacket::readTask, this);
+	writeThread = std::thread(&AFPacket::writeTask, this);
+
+	return true;
+}
+
+bool AFPacket::isOpen() {
+	return fd >= 0;
+}
+
+bool AFPacket::close() {
+	if(!isOpen())
+		return false;
+
+	closing = true; // Signal the threads that we are closing
+	readThread.join();
+	writeThread.join();
+	closing = false;
+
+	teardownRings();
+	::close(fd);
+	fd = -1;
+
+	clearReadQueue();
+	clearWriteQueue();
+
+	return true;
+}
+
+void AFPacket::readTask() {
+	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+	while(!closing) {
+		auto block = reinterpret_cast<struct tpacket_block_desc*>(ring + rxBlock * RXBlockSize);
+		if(!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+			struct pollfd pfd = { fd, POLLIN | POLLERR, 0 };
+			if(::poll(&pfd, 1, 100) > 0 && (pfd.revents & POLLERR)) {
+				int error = 0;
+				socklen_t errorLength = sizeof(error);
+				getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+				if((error == ENETDOWN || error == ENODEV || error == ENXIO) && !isDisconnected()) {
+					disconnected = true;
+					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+				}
+			}
+			continue;
+		}
+
+		processBlock(block);
+
+		// Hand the block back to the kernel
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		rxBlock = (rxBlock + 1) % RXBlockCount;
+	}
+}
+
+void AFPacket::processBlock(struct tpacket_block_desc* block) {
+	const uint32_t count = block->hdr.bh1.num_pkts;
+	uint8_t* position = reinterpret_cast<uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt;
+
+	// Everything from this block goes up together, copied once from the ring into a pooled buffer
+	auto buffer = acquireReadBuffer(0);
+	const uint8_t* payload;
+	size_t payloadLength;
+	for(uint32_t i = 0; i < count; i++) {
+		const auto frame = reinterpret_cast<struct tpacket3_hdr*>(position);
+		if(ethPacketizer.inputUp(position + frame->tp_mac, frame->tp_snaplen, payload, payloadLength))
+			buffer.insert(buffer.end(), payload, payload + payloadLength);
+		position += frame->tp_next_offset;
+	}
+	pushReadBuffer(std::move(buffer));
+}
+
+bool AFPacket::sendFrame(const uint8_t* frame, size_t length) {
+	if(txRing == nullptr)
+		return ::send(fd, frame, length, 0) == ssize_t(length);
+
+	if(length > TXFrameSize - TXDataOffset)
+		return false;
+
+	auto slot = reinterpret_cast<struct tpacket3_hdr*>(txRing + txFrame * TXFrameSize);
+	while(__atomic_load_n(&slot->tp_status, __ATOMIC_ACQUIRE) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+		// The ring is full, let the kernel send what is there
+		if(closing || !flushTX())
+			return false;
+	}
+
+	memcpy(reinterpret_cast<uint8_t*>(slot) + TXDataOffset, frame, length);
+	slot->tp_len = uint32_t(length);
+	slot->tp_snaplen = uint32_t(length);
+	slot->tp_next_offset = 0;
+	__atomic_store_n(&slot->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+	txFrame = (txFrame + 1) % TXFrameCount;
+	return true;
+}
+
+bool AFPacket::flushTX() {
+	if(txRing == nullptr)
+		return true;
+
+	// Blocks until the kernel has sent everything we've queued
+	ssize_t ret;
+	do {
+		ret = ::send(fd, nullptr, 0, 0);
+	} while(ret < 0 && errno == EINTR);
+	return ret >= 0;
+}
+
+void AFPacket::writeTask() {
+	WriteOperation writeOp;
+	std::vector<WriteCompletion> completions;
+	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+
+	while(!closing) {
+		if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+			continue;
+
+		// Take everything which is pending, the packetizer packs small writes together
+		size_t framesQueued = 0;
+		do {
+			ethPacketizer.inputDown(writeOp.bytes.data(), writeOp.bytes.size());
+			if(writeOp.onComplete)
+				completions.push_back(std::move(writeOp.onComplete));
+			writeOp.onComplete = nullptr;
+		} while(++framesQueued < TXFrameCount && writeQueue.try_dequeue(writeOp));
+		notifyWriteSpace();
+
+		bool sent = true;
+		const uint8_t* frame;
+		size_t length;
+		while(ethPacketizer.outputDown(frame, length)) {
+			if(!sendFrame(frame, length))
+				sent = false;
+		}
+		if(!flushTX())
+			sent = false;
+
+		if(!sent) {
+			if(isDisconnected())
+				break;
+			report(APIEvent::Type::FailedToWrite, APIEvent::Severity::EventWarning);
+		}
+
+		// The writes may have been packed together, so they all succeed or fail together
+		for(const auto& fn : completions)
+			fn(sent);
+		completions.clear();
+	}
+
+	for(const auto& fn : completions)
+		fn(false);
+}
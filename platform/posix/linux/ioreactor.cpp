@@ -0,0 +1,214 @@
+#include "icsneo/platform/posix/linux/ioreactor.h"
+#include "icsneo/api/eventmanager.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace icsneo;
+
+static std::mutex reactorsMutex;
+static std::vector<std::shared_ptr<IOReactor>> reactors;
+static size_t nextReactor = 0;
+
+void IOReactor::SetEnabled(bool enabled, size_t threadCount) {
+	std::lock_guard<std::mutex> lk(reactorsMutex);
+	reactors.clear(); // Open drivers hold on to their reactor until they close
+	nextReactor = 0;
+	if(!enabled)
+		return;
+
+	if(threadCount == 0)
+		threadCount = 1;
+	for(size_t i = 0; i < threadCount; i++) {
+		auto reactor = std::make_shared<IOReactor>();
+		if(reactor->isValid())
+			reactors.push_back(std::move(reactor));
+	}
+}
+
+bool IOReactor::IsEnabled() {
+	std::lock_guard<std::mutex> lk(reactorsMutex);
+	return !reactors.empty();
+}
+
+std::shared_ptr<IOReactor> IOReactor::Get() {
+	std::lock_guard<std::mutex> lk(reactorsMutex);
+	if(reactors.empty())
+		return nullptr;
+	return reactors[nextReactor++ % reactors.size()];
+}
+
+IOReactor::IOReactor() : state(std::make_shared<State>()) {
+	state->epollFD = epoll_create1(EPOLL_CLOEXEC);
+	state->wakeFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(!isValid())
+		return;
+
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = state->wakeFD;
+	if(epoll_ctl(state->epollFD, EPOLL_CTL_ADD, state->wakeFD, &ev) != 0) {
+		::close(state->wakeFD);
+		state->wakeFD = -1;
+		return;
+	}
+
+	thread = std::thread(&IOReactor::Run, state);
+	threadID = thread.get_id();
+}
+
+IOReactor::~IOReactor() {
+	state->stopping = true;
+	if(state->wakeFD >= 0) {
+		const uint64_t one = 1;
+		(void)!::write(state->wakeFD, &one, sizeof(one));
+	}
+	if(thread.joinable()) {
+		// The last reference may be dropped from one of our own handlers,
+		// in which case the thread holds the state until it returns
+		if(isReactorThread())
+			thread.detach();
+		else
+			thread.join();
+	}
+}
+
+IOReactor::State::~State() {
+	if(wakeFD >= 0)
+		::close(wakeFD);
+	if(epollFD >= 0)
+		::close(epollFD);
+}
+
+bool IOReactor::isValid() const {
+	return state->epollFD >= 0 && state->wakeFD >= 0;
+}
+
+bool IOReactor::add(int fd, uint32_t events, Handler handler) {
+	auto registration = std::make_shared<Registration>();
+	registration->handler = std::move(handler);
+	{
+		std::lock_guard<std::mutex> lk(state->registrationsMutex);
+		if(!state->registrations.emplace(fd, registration).second)
+			return false; // Already registered
+	}
+
+	struct epoll_event ev = {};
+	ev.events = ToEpoll(events);
+	ev.data.fd = fd;
+	if(epoll_ctl(state->epollFD, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		std::lock_guard<std::mutex> lk(state->registrationsMutex);
+		state->registrations.erase(fd);
+		return false;
+	}
+	return true;
+}
+
+bool IOReactor::modify(int fd, uint32_t events) {
+	struct epoll_event ev = {};
+	ev.events = ToEpoll(events);
+	ev.data.fd = fd;
+	return epoll_ctl(state->epollFD, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+bool IOReactor::remove(int fd) {
+	std::shared_ptr<Registration> registration;
+	{
+		std::lock_guard<std::mutex> lk(state->registrationsMutex);
+		auto it = state->registrations.find(fd);
+		if(it == state->registrations.end())
+			return false;
+		registration = std::move(it->second);
+		state->registrations.erase(it);
+	}
+	epoll_ctl(state->epollFD, EPOLL_CTL_DEL, fd, nullptr);
+
+	if(isReactorThread()) {
+		// We're inside a handler, it can't be running anything else
+		registration->active = false;
+	} else {
+		// Wait for a running handler to finish
+		std::lock_guard<std::mutex> lk(registration->running);
+		registration->active = false;
+	}
+	return true;
+}
+
+void IOReactor::notify(int fd) {
+	{
+		std::lock_guard<std::mutex> lk(state->notifyMutex);
+		state->notified.push_back(fd);
+	}
+	const uint64_t one = 1;
+	(void)!::write(state->wakeFD, &one, sizeof(one));
+}
+
+uint32_t IOReactor::ToEpoll(uint32_t events) {
+	uint32_t ret = 0;
+	if(events & Readable)
+		ret |= EPOLLIN;
+	if(events & Writable)
+		ret |= EPOLLOUT;
+	return ret;
+}
+
+std::shared_ptr<IOReactor::Registration> IOReactor::State::find(int fd) {
+	std::lock_guard<std::mutex> lk(registrationsMutex);
+	auto it = registrations.find(fd);
+	if(it == registrations.end())
+		return nullptr;
+	return it->second;
+}
+
+void IOReactor::State::dispatch(int fd, uint32_t events) {
+	auto registration = find(fd);
+	if(!registration)
+		return;
+
+	std::lock_guard<std::mutex> lk(registration->running);
+	if(registration->active)
+		registration->handler(events);
+}
+
+void IOReactor::Run(std::shared_ptr<State> state) {
+	constexpr int MaxEvents = 64;
+	struct epoll_event events[MaxEvents];
+	std::vector<int> toNotify;
+
+	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
+	while(!state->stopping) {
+		const int count = epoll_wait(state->epollFD, events, MaxEvents, -1);
+		if(count < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		for(int i = 0; i < count && !state->stopping; i++) {
+			const int fd = events[i].data.fd;
+			if(fd == state->wakeFD) {
+				uint64_t value;
+				(void)!::read(state->wakeFD, &value, sizeof(value));
+
+				{
+					std::lock_guard<std::mutex> lk(state->notifyMutex);
+					toNotify.swap(state->notified);
+				}
+				for(int notifiedFD : toNotify)
+					state->dispatch(notifiedFD, Notified);
+				toNotify.clear();
+				continue;
+			}
+
+			uint32_t translated = 0;
+			if(events[i].events & EPOLLIN)
+				translated |= Readable;
+			if(events[i].events & EPOLLOUT)
+				translated |= Writable;
+			if(events[i].events & (EPOLLERR | EPOLLHUP))
+				translated |= Error;
+			state->dispatch(fd, translated);
+		}
+	}
+}
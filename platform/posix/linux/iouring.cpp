@@ -0,0 +1,272 @@
+#include "icsneo/platform/posix/linux/iouring.h"
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <poll.h>
+
+using namespace icsneo;
+
+static int SysSetup(unsigned entries, struct io_uring_params* params) {
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int SysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int SysRegister(int fd, unsigned opcode, const void* arg, unsigned args) {
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, args);
+}
+
+bool IOURing::IsSupported() {
+	static const bool supported = []() {
+		IOURing probe(2);
+		return probe.isValid();
+	}();
+	return supported;
+}
+
+IOURing::IOURing(unsigned entries) {
+	struct io_uring_params params = {};
+	const int fd = SysSetup(entries, &params);
+	if(fd < 0)
+		return;
+
+	// We rely on the ring being mapped in one go (5.4+) and on reads of non-blocking
+	// file descriptors waiting for data rather than failing (5.7+), older kernels get the fallback
+	if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL)) {
+		::close(fd);
+		return;
+	}
+	features = params.features;
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(cqRingSize > sqRingSize)
+		sqRingSize = cqRingSize;
+	cqRingSize = 0; // Shared with the SQ ring
+
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(sqRing == MAP_FAILED) {
+		sqRing = nullptr;
+		::close(fd);
+		return;
+	}
+	cqRing = sqRing;
+
+	sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(sqesMap == MAP_FAILED) {
+		munmap(sqRing, sqRingSize);
+		sqRing = cqRing = nullptr;
+		::close(fd);
+		return;
+	}
+	sqes = reinterpret_cast<struct io_uring_sqe*>(sqesMap);
+
+	uint8_t* sq = reinterpret_cast<uint8_t*>(sqRing);
+	sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	sqEntries = params.sq_entries;
+	sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+	sqLocalTail = *sqTail;
+
+	uint8_t* cq = reinterpret_cast<uint8_t*>(cqRing);
+	cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	ringFD = fd;
+}
+
+IOURing::~IOURing() {
+	if(sqes != nullptr)
+		munmap(sqes, sqesSize);
+	if(sqRing != nullptr)
+		munmap(sqRing, sqRingSize);
+	if(ringFD >= 0)
+		::close(ringFD);
+}
+
+bool IOURing::registerBuffers(std::vector<std::vector<uint8_t>>& buffers) {
+	std::vector<struct iovec> iovecs;
+	for(auto& buffer : buffers)
+		iovecs.push_back({ buffer.data(), buffer.size() });
+	return SysRegister(ringFD, IORING_REGISTER_BUFFERS, iovecs.data(), (unsigned)iovecs.size()) == 0;
+}
+
+struct io_uring_sqe* IOURing::getSQE() {
+	const unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+	if(sqLocalTail - head >= sqEntries)
+		return nullptr;
+
+	const unsigned index = sqLocalTail & sqMask;
+	struct io_uring_sqe* sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqArray[index] = index;
+	sqLocalTail++;
+	sqToSubmit++;
+	return sqe;
+}
+
+int IOURing::submit(unsigned waitFor) {
+	__atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+	const unsigned toSubmit = sqToSubmit;
+	sqToSubmit = 0;
+
+	int ret;
+	do {
+		enterCalls++;
+		ret = SysEnter(ringFD, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0);
+	} while(ret < 0 && errno == EINTR);
+	return ret;
+}
+
+size_t IOURing::forEachCompletion(const std::function<void(uint64_t, int32_t, uint32_t)>& fn) {
+	unsigned head = *cqHead;
+	const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	size_t count = 0;
+	while(head != tail) {
+		const struct io_uring_cqe& cqe = cqes[head & cqMask];
+		fn(cqe.user_data, cqe.res, cqe.flags);
+		head++;
+		count++;
+	}
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+static constexpr uint64_t TimeoutUserData = UINT64_MAX;
+static constexpr uint64_t CancelUserData = UINT64_MAX - 1;
+static constexpr uint64_t PollUserData = UINT64_MAX - 2;
+static constexpr uint64_t ReadUserData = 0;
+
+IOURingReader::IOURingReader(int fd, bool isSocket, size_t bufferSize)
+	: fd(fd), isSocket(isSocket), ring(8), buffers(1, std::vector<uint8_t>(bufferSize)) {
+	if(ring.isValid())
+		buffersRegistered = ring.registerBuffers(buffers);
+}
+
+size_t IOURingReader::queueRead(bool afterPoll) {
+	size_t queued = 0;
+	if(afterPoll) {
+		// Some files refuse to wait when they're non-blocking, so wait for data with a linked poll
+		struct io_uring_sqe* poll = ring.getSQE();
+		if(poll == nullptr)
+			return 0;
+		poll->opcode = IORING_OP_POLL_ADD;
+		poll->fd = fd;
+		poll->poll_events = POLLIN;
+		poll->flags = IOSQE_IO_LINK;
+		poll->user_data = PollUserData;
+		queued++;
+	}
+
+	struct io_uring_sqe* sqe = ring.getSQE();
+	if(sqe == nullptr)
+		return queued; // Only reachable with the poll queued if the ring is far too small, the poll still completes
+
+	auto& buffer = buffers[0];
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<uint64_t>(buffer.data());
+	sqe->len = uint32_t(buffer.size());
+	sqe->off = isSocket ? 0 : uint64_t(-1); // Sockets ignore the offset, ttys read from the current position
+	sqe->buf_index = 0;
+	sqe->user_data = ReadUserData;
+	return queued + 1;
+}
+
+bool IOURingReader::queueTimeout() {
+	static const struct __kernel_timespec interval = { 0, WakeIntervalNanoseconds };
+	struct io_uring_sqe* sqe = ring.getSQE();
+	if(sqe == nullptr)
+		return false;
+
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = reinterpret_cast<uint64_t>(&interval);
+	sqe->len = 1;
+	sqe->user_data = TimeoutUserData;
+	return true;
+}
+
+size_t IOURingReader::queueCancel() {
+	// The poll, the read and the timeout each need taking back, whichever of them is still armed
+	size_t queued = 0;
+	if(struct io_uring_sqe* sqe = ring.getSQE()) {
+		sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = TimeoutUserData;
+		sqe->user_data = CancelUserData;
+		queued++;
+	}
+	if(struct io_uring_sqe* sqe = ring.getSQE()) {
+		sqe->opcode = IORING_OP_POLL_REMOVE; // The read linked behind it then completes with -ECANCELED
+		sqe->fd = -1;
+		sqe->addr = PollUserData;
+		sqe->user_data = CancelUserData;
+		queued++;
+	}
+	if(struct io_uring_sqe* sqe = ring.getSQE()) {
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = ReadUserData;
+		sqe->user_data = CancelUserData;
+		queued++;
+	}
+	return queued;
+}
+
+void IOURingReader::run(const std::function<void(const uint8_t*, size_t)>& onData,
+	const std::function<bool(int)>& onError,
+	const std::function<bool()>& shouldStop) {
+	// A tty may be one of the files which won't wait, so start it off behind a poll
+	size_t inFlight = queueRead(!isSocket);
+	inFlight += queueTimeout() ? 1 : 0;
+
+	bool stop = false;
+	bool cancelled = false;
+	while(inFlight > 0) {
+		if(ring.submit(1) < 0)
+			break;
+
+		const size_t completed = ring.forEachCompletion([&](uint64_t userData, int32_t res, uint32_t) {
+			if(userData == CancelUserData || userData == PollUserData)
+				return;
+			if(userData == TimeoutUserData) {
+				if(!stop && queueTimeout())
+					inFlight++;
+				return;
+			}
+
+			if(res > 0) {
+				if(!stop)
+					onData(buffers[0].data(), size_t(res));
+			} else if(res != -EAGAIN && res != -EINTR && res != -ECANCELED && !stop) {
+				if(!onError(res))
+					stop = true;
+			}
+
+			// Put the buffer straight back to work, waiting for data first if there was none
+			if(!stop)
+				inFlight += queueRead(res <= 0);
+		});
+		inFlight -= completed;
+
+		stop = stop || shouldStop();
+
+		if(stop && !cancelled) {
+			// Cancel everything still outstanding so that we can return right away
+			cancelled = true;
+			inFlight += queueCancel();
+		}
+	}
+}
@@ -154,7 +154,7 @@ void PCAP::Find(std::vector<FoundDevice>& found) {
 			EthernetPacketizer ethPacketizer([](APIEvent::Type, APIEvent::Severity) {});
 			memcpy(ethPacketizer.hostMAC, iface.macAddress, sizeof(ethPacketizer.hostMAC));
 			ethPacketizer.allowInPacketsFromAnyMAC = true;
-			if(!ethPacketizer.inputUp({ data, data + header->caplen }))
+			if(!ethPacketizer.inputUp(data, header->caplen))
 				continue; // This packet is not for us
 
 			Packetizer packetizer([](APIEvent::Type, APIEvent::Severity) {});
@@ -267,10 +267,8 @@ bool PCAP::close() {
 	pcap_close(iface.fp);
 	iface.fp = nullptr;
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	return true;
 }
@@ -280,16 +278,17 @@ void PCAP::readTask() {
 	while (!closing) {
 		pcap_dispatch(iface.fp, -1, [](uint8_t* obj, const struct pcap_pkthdr* header, const uint8_t* data) {
 			PCAP* driver = reinterpret_cast<PCAP*>(obj);
-			if(driver->ethPacketizer.inputUp({data, data + header->caplen})) {
-				const auto bytes = driver->ethPacketizer.outputUp();
-				driver->readQueue.enqueue_bulk(bytes.data(), bytes.size());
-			}
+			const uint8_t* payload;
+			size_t payloadLength;
+			if(driver->ethPacketizer.inputUp(data, header->caplen, payload, payloadLength))
+				driver->pushReadBytes(payload, payloadLength);
 		}, (uint8_t*)this);
 	}
 }
 
 void PCAP::writeTask() {
 	WriteOperation writeOp;
+	std::vector<WriteCompletion> completions;
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
 	while(!closing) {
@@ -303,12 +302,26 @@ void PCAP::writeTask() {
 		do {
 			packetsPushed++;
 			bytesPushed += writeOp.bytes.size();
-			ethPacketizer.inputDown(std::move(writeOp.bytes));
+			ethPacketizer.inputDown(writeOp.bytes.data(), writeOp.bytes.size());
+			if(writeOp.onComplete)
+				completions.push_back(std::move(writeOp.onComplete));
+			writeOp.onComplete = nullptr;
 		} while(bytesPushed < (EthernetPacketizer::MaxPacketLength - (bytesPushed / packetsPushed * 2)) && writeQueue.try_dequeue(writeOp));
-
-		for(const auto& packet : ethPacketizer.outputDown()) {
-			pcap_sendpacket(iface.fp, packet.data(), (int)packet.size());
+		notifyWriteSpace();
+
+		bool sent = true;
+		const uint8_t* packet;
+		size_t length;
+		while(ethPacketizer.outputDown(packet, length)) {
+			if(pcap_sendpacket(iface.fp, packet, (int)length) != 0)
+				sent = false;
 		}
-		// TODO Handle packet send errors
+		if(!sent)
+			report(APIEvent::Type::FailedToWrite, APIEvent::Severity::EventWarning);
+
+		// The writes may have been packed together, so they all succeed or fail together
+		for(const auto& fn : completions)
+			fn(sent);
+		completions.clear();
 	}
 }
@@ -14,10 +14,15 @@
 #include <cstring>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
+#include <climits>
 #endif
 
 #include <optional>
 #include "icsneo/platform/tcp.h"
+#ifdef ICSNEO_ENABLE_IO_URING
+#include "icsneo/platform/posix/linux/iouring.h"
+#endif
 
 #ifdef _WIN32
 #define WIN_INT(a) static_cast<int>(a)
@@ -487,6 +492,17 @@ bool TCP::open() {
 	}
 
 	socket = std::move(partiallyOpenSocket);
+
+#ifdef __linux__
+	if((reactor = IOReactor::Get())) {
+		reactorWrite.clear();
+		reactorAwaitingWritable = false;
+		if(reactor->add(*socket, IOReactor::Readable, [this](uint32_t events) { handleReactorEvents(events); }))
+			return true;
+		reactor.reset(); // Fall back to our own threads
+	}
+#endif
+
 	readThread = std::thread(&TCP::readTask, this);
 	writeThread = std::thread(&TCP::writeTask, this);
 	return true;
@@ -505,15 +521,21 @@ bool TCP::close() {
 	closing = true;
 	disconnected = false;
 
+#ifdef __linux__
+	if(reactor) {
+		reactor->remove(*socket);
+		reactor.reset();
+		reactorWrite.clear(); // Fails anything we hadn't finished writing, rather than leaving it to go out after a reopen
+	}
+#endif
+
 	if(readThread.joinable())
 		readThread.join();
 	if(writeThread.joinable())
 		writeThread.join();
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	socket.reset();
 	closing = false;
@@ -524,17 +546,41 @@ bool TCP::close() {
 void TCP::readTask() {
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
+#ifdef ICSNEO_ENABLE_IO_URING
+	if(IOURing::IsSupported()) {
+		IOURingReader reader(*socket, true);
+		if(reader.isValid()) {
+			reader.run([this](const uint8_t* data, size_t length) {
+				pushReadBytes(data, length);
+			}, [this](int) {
+				// The connection was closed or reset
+				if(!isDisconnected()) {
+					disconnected = true;
+					report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+				}
+				return false;
+			}, [this]() {
+				return bool(closing);
+			});
+			return;
+		}
+	}
+#endif
+
 	const int nfds = WIN_INT(*socket) + 1;
 	fd_set readfs;
 	FD_ZERO(&readfs);
 	FD_SET(*socket, &readfs);
 	timeval timeout;
 
-	constexpr size_t READ_BUFFER_SIZE = 2048;
-	uint8_t readbuf[READ_BUFFER_SIZE];
+	std::vector<uint8_t> readbuf;
 	while(!closing) {
-		if(const auto received = ::recv(*socket, (char*)readbuf, READ_BUFFER_SIZE, 0); received > 0) {
-			readQueue.enqueue_bulk(readbuf, received);
+		if(readbuf.empty())
+			readbuf = acquireReadBuffer();
+		if(const auto received = ::recv(*socket, (char*)readbuf.data(), WIN_INT(readbuf.size()), 0); received > 0) {
+			readbuf.resize(received);
+			pushReadBuffer(std::move(readbuf));
+			readbuf.clear();
 		} else {
 			timeout.tv_sec = 0;
 			timeout.tv_usec = 50'000;
@@ -552,17 +598,123 @@ void TCP::writeTask() {
 	FD_SET(*socket, &writefs);
 	timeval timeout;
 
+#ifdef _WIN32
 	WriteOperation writeOp;
 	while(!closing) {
-		if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+		if(!dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(100)))
 			continue;
 
+		bool sent = false;
 		while(!closing) {
-			if(::send(*socket, (char*)writeOp.bytes.data(), WIN_INT(writeOp.bytes.size()), 0) > 0)
+			if(::send(*socket, (char*)writeOp.bytes.data(), WIN_INT(writeOp.bytes.size()), 0) > 0) {
+				sent = true;
 				break;
+			}
 			timeout.tv_sec = 0;
 			timeout.tv_usec = 100'000;
 			::select(nfds, 0, &writefs, 0, &timeout);
 		}
+		writeOp.complete(sent);
 	}
+#else
+	WriteBatch batch;
+	std::vector<struct iovec> iov;
+	while(!closing) {
+		if(batch.empty() && !dequeueWriteBatch(batch, std::chrono::milliseconds(100)))
+			continue;
+
+		iov.clear();
+		batch.forEachRemaining([&iov](const uint8_t* data, size_t length) {
+			iov.push_back({ const_cast<uint8_t*>(data), length });
+			return iov.size() < IOV_MAX;
+		});
+
+		struct msghdr msg = {};
+		msg.msg_iov = iov.data();
+		msg.msg_iovlen = iov.size();
+		const auto sent = ::sendmsg(*socket, &msg, 0);
+		if(sent > 0) {
+			batch.consume(sent);
+			continue;
+		}
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 100'000;
+		::select(nfds, 0, &writefs, 0, &timeout);
+	}
+#endif
 }
+
+#ifdef __linux__
+void TCP::handleReactorEvents(uint32_t events) {
+	if(events & (IOReactor::Readable | IOReactor::Error)) {
+		while(true) {
+			auto readbuf = acquireReadBuffer();
+			const auto received = ::recv(*socket, readbuf.data(), readbuf.size(), 0);
+			if(received > 0) {
+				const bool drained = size_t(received) < readbuf.size();
+				readbuf.resize(received);
+				pushReadBuffer(std::move(readbuf));
+				if(drained)
+					break;
+				continue;
+			}
+			releaseReadBuffer(std::move(readbuf));
+
+			if(received < 0 && errno == EINTR)
+				continue;
+			if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !(events & IOReactor::Error))
+				break;
+
+			// The connection was closed or reset, which would otherwise wake us forever
+			if(!isDisconnected()) {
+				disconnected = true;
+				report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
+			}
+			reactor->remove(*socket);
+			return;
+		}
+	}
+
+	if(events & (IOReactor::Writable | IOReactor::Notified)) {
+		bool blocked = false;
+		while(!blocked) {
+			if(reactorWrite.empty() && !dequeueWriteBatch(reactorWrite, std::chrono::milliseconds(0), false))
+				break;
+
+			reactorIOV.clear();
+			reactorWrite.forEachRemaining([this](const uint8_t* data, size_t length) {
+				reactorIOV.push_back({ const_cast<uint8_t*>(data), length });
+				return reactorIOV.size() < IOV_MAX;
+			});
+
+			struct msghdr msg = {};
+			msg.msg_iov = reactorIOV.data();
+			msg.msg_iovlen = reactorIOV.size();
+			const auto sent = ::sendmsg(*socket, &msg, MSG_NOSIGNAL);
+			if(sent > 0) {
+				reactorWrite.consume(sent);
+			} else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				blocked = true; // Wait for the reactor to tell us there's room in the socket buffer
+			} else if(errno != EINTR) {
+				report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+				reactorWrite.clear(); // Drop this write
+			}
+		}
+
+		if(blocked != reactorAwaitingWritable) {
+			reactor->modify(*socket, IOReactor::Readable | (blocked ? IOReactor::Writable : 0));
+			reactorAwaitingWritable = blocked;
+		}
+	}
+}
+
+bool TCP::writeInternal(WriteOperation&& op) {
+	if(!reactor)
+		return Driver::writeInternal(std::move(op));
+
+	if(!writeQueue.enqueue(std::move(op)))
+		return false;
+	reactor->notify(*socket);
+	return true;
+}
+#endif
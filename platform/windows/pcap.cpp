@@ -138,7 +138,7 @@ void PCAP::Find(std::vector<FoundDevice>& found) {
 			EthernetPacketizer ethPacketizer([](APIEvent::Type, APIEvent::Severity) {});
 			memcpy(ethPacketizer.hostMAC, iface.macAddress, sizeof(ethPacketizer.hostMAC));
 			ethPacketizer.allowInPacketsFromAnyMAC = true;
-			if(!ethPacketizer.inputUp({ data, data + header->caplen }))
+			if(!ethPacketizer.inputUp(data, header->caplen))
 				continue; // This packet is not for us
 
 			Packetizer packetizer([](APIEvent::Type, APIEvent::Severity) {});
@@ -251,10 +251,8 @@ bool PCAP::close() {
 	pcap.close(iface.fp);
 	iface.fp = nullptr;
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 	transmitQueue = nullptr;
 
 	return true;
@@ -273,15 +271,16 @@ void PCAP::readTask() {
 		if(readBytes == 0)
 			continue; // Keep waiting for that packet
 
-		if(ethPacketizer.inputUp({data, data + header->caplen})) {
-			const auto bytes = ethPacketizer.outputUp();
-			readQueue.enqueue_bulk(bytes.data(), bytes.size());
-		}
+		const uint8_t* payload;
+		size_t payloadLength;
+		if(ethPacketizer.inputUp(data, header->caplen, payload, payloadLength))
+			pushReadBytes(payload, payloadLength);
 	}
 }
 
 void PCAP::writeTask() {
 	WriteOperation writeOp;
+	std::vector<WriteCompletion> completions;
 	EventManager::GetInstance().downgradeErrorsOnCurrentThread();
 
 	pcap_send_queue* queue1 = pcap.sendqueue_alloc(128000);
@@ -295,17 +294,31 @@ void PCAP::writeTask() {
 		if(writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(queue->len ? 1 : 100))) {
 			unsigned int i = 0;
 			do {
-				ethPacketizer.inputDown(std::move(writeOp.bytes));
+				ethPacketizer.inputDown(writeOp.bytes.data(), writeOp.bytes.size());
+				if(writeOp.onComplete)
+					completions.push_back(std::move(writeOp.onComplete));
+				writeOp.onComplete = nullptr;
 				if(i++ >= (queue->maxlen - queue->len) / 1518 / 3)
 					break; // Not safe to try to fit any more packets in this queue, let it transmit and come around again
 			} while(writeQueue.try_dequeue(writeOp));
+			notifyWriteSpace();
 
-			for(const auto& data : ethPacketizer.outputDown()) {
+			bool queued = true;
+			const uint8_t* frame;
+			size_t length;
+			while(ethPacketizer.outputDown(frame, length)) {
 				pcap_pkthdr header = {};
-				header.caplen = header.len = bpf_u_int32(data.size());
-				if(pcap.sendqueue_queue(queue, &header, data.data()) != 0)
+				header.caplen = header.len = bpf_u_int32(length);
+				if(pcap.sendqueue_queue(queue, &header, frame) != 0) {
 					report(APIEvent::Type::FailedToWrite, APIEvent::Severity::EventWarning);
+					queued = false;
+				}
 			}
+
+			// Once in a send queue the frames belong to WinPcap, which transmits them in order from here
+			for(const auto& fn : completions)
+				fn(queued);
+			completions.clear();
 		}
 		
 		std::unique_lock<std::mutex> lk(transmitQueueMutex);
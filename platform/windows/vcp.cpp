@@ -357,10 +357,8 @@ bool VCP::close() {
 		detail->overlappedWait.hEvent = INVALID_HANDLE_VALUE;
 	}
 
-	uint8_t flush;
-	WriteOperation flushop;
-	while(readQueue.try_dequeue(flush)) {}
-	while(writeQueue.try_dequeue(flushop)) {}
+	clearReadQueue();
+	clearWriteQueue();
 
 	if(!ret)
 		report(APIEvent::Type::DriverFailedToClose, APIEvent::Severity::Error);
@@ -391,7 +389,7 @@ void VCP::readTask() {
 				if(ReadFile(detail->handle, readbuf, READ_BUFFER_SIZE, nullptr, &detail->overlappedRead)) {
 					if(GetOverlappedResult(detail->handle, &detail->overlappedRead, &bytesRead, FALSE)) {
 						if(bytesRead)
-							readQueue.enqueue_bulk(readbuf, bytesRead);
+							pushReadBytes(readbuf, bytesRead);
 					}
 					continue;
 				}
@@ -414,7 +412,7 @@ void VCP::readTask() {
 				auto ret = WaitForSingleObject(detail->overlappedRead.hEvent, 100);
 				if(ret == WAIT_OBJECT_0) {
 					if(GetOverlappedResult(detail->handle, &detail->overlappedRead, &bytesRead, FALSE)) {
-						readQueue.enqueue_bulk(readbuf, bytesRead);
+						pushReadBytes(readbuf, bytesRead);
 						state = LAUNCH;
 					} else
 						report(APIEvent::Type::FailedToRead, APIEvent::Severity::Error);
@@ -436,12 +434,14 @@ void VCP::writeTask() {
 	while(!closing && !isDisconnected()) {
 		switch(state) {
 			case LAUNCH: {
-				if(!writeQueue.wait_dequeue_timed(writeOp, std::chrono::milliseconds(100)))
+				if(!dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(100)))
 					continue;
 
 				bytesWritten = 0;
-				if(WriteFile(detail->handle, writeOp.bytes.data(), (DWORD)writeOp.bytes.size(), nullptr, &detail->overlappedWrite))
+				if(WriteFile(detail->handle, writeOp.bytes.data(), (DWORD)writeOp.bytes.size(), nullptr, &detail->overlappedWrite)) {
+					writeOp.complete(true);
 					continue;
+				}
 				
 				auto winerr = GetLastError();
 				if(winerr == ERROR_IO_PENDING) {
@@ -452,23 +452,30 @@ void VCP::writeTask() {
 						disconnected = true;
 						report(APIEvent::Type::DeviceDisconnected, APIEvent::Severity::Error);
 					}
-				} else
+					writeOp.complete(false);
+				} else {
 					report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+					writeOp.complete(false);
+				}
 			}
 			break;
 			case WAIT: {
 				auto ret = WaitForSingleObject(detail->overlappedWrite.hEvent, 50);
 				if(ret == WAIT_OBJECT_0) {
-					if(!GetOverlappedResult(detail->handle, &detail->overlappedWrite, &bytesWritten, FALSE))
+					const bool success = GetOverlappedResult(detail->handle, &detail->overlappedWrite, &bytesWritten, FALSE);
+					if(!success)
 						report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+					writeOp.complete(success);
 					state = LAUNCH;
 				}
 				
 				if(ret == WAIT_ABANDONED) {
 					report(APIEvent::Type::FailedToWrite, APIEvent::Severity::Error);
+					writeOp.complete(false);
 					state = LAUNCH;
 				}
 			}
 		}
 	}
+	writeOp.complete(false);
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "icsneo/platform/posix/linux/afpacket.h"
+#include "icsneo/communication/packetizer.h"
+#include "icsneo/communication/network.h"
+#include "icsneo/communication/command.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace icsneo;
+
+static const uint8_t DeviceMAC[6] = { 0x00, 0xFC, 0x70, 0x12, 0x34, 0x56 };
+
+/**
+ * Runs the driver over a veth pair, with a raw socket on the far end standing
+ * in for the device. Creating the pair needs CAP_NET_ADMIN, so the tests are
+ * skipped when we can't.
+ */
+class AFPacketTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		if(std::system("ip link add icsneotest0 type veth peer name icsneotest1 >/dev/null 2>&1") != 0)
+			GTEST_SKIP() << "Could not create a veth pair";
+		created = true;
+		ASSERT_EQ(std::system("ip link set icsneotest0 up && ip link set icsneotest1 up"), 0);
+
+		deviceFD = ::socket(AF_PACKET, SOCK_RAW, htons(0xCAB1));
+		ASSERT_GE(deviceFD, 0);
+		struct sockaddr_ll addr = {};
+		addr.sll_family = AF_PACKET;
+		addr.sll_protocol = htons(0xCAB1);
+		addr.sll_ifindex = (int)if_nametoindex("icsneotest1");
+		ASSERT_EQ(::bind(deviceFD, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+
+		responder = std::thread([this]() { respond(); });
+	}
+
+	void TearDown() override {
+		stop = true;
+		if(responder.joinable())
+			responder.join();
+		if(deviceFD >= 0)
+			::close(deviceFD);
+		if(created)
+			std::system("ip link del icsneotest0 >/dev/null 2>&1");
+	}
+
+	static std::vector<uint8_t> MakeFrame(const uint8_t* hostMAC, const std::vector<uint8_t>& payload, uint16_t number, bool first, bool last) {
+		EthernetPacketizer::EthernetPacket packet;
+		memcpy(packet.destMAC, hostMAC, 6);
+		memcpy(packet.srcMAC, DeviceMAC, 6);
+		packet.etherType = 0xCAB2;
+		packet.packetNumber = number;
+		packet.firstPiece = first;
+		packet.lastPiece = last;
+		packet.payload = payload;
+		return packet.getBytestream();
+	}
+
+	void sendToHost(const std::vector<uint8_t>& frame) {
+		ASSERT_EQ(::send(deviceFD, frame.data(), frame.size(), 0), ssize_t(frame.size()));
+	}
+
+	// Answers serial number requests and records everything else the host sends us
+	void respond() {
+		uint8_t frame[ETH_FRAME_LEN];
+		while(!stop) {
+			struct pollfd pfd = { deviceFD, POLLIN, 0 };
+			if(::poll(&pfd, 1, 10) <= 0)
+				continue;
+			const ssize_t length = ::recv(deviceFD, frame, sizeof(frame), 0);
+			if(length < 24)
+				continue;
+			EthernetPacketizer::EthernetPacket packet(frame, size_t(length));
+			if(packet.payload.size() >= 3 && packet.payload[2] == (uint8_t)Command::RequestSerialNumber) {
+				memcpy(hostMAC, packet.srcMAC, sizeof(hostMAC));
+				std::vector<uint8_t> response = {
+					(uint8_t)Command::RequestSerialNumber,
+					0x40, 0xE2, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 // 123456
+				};
+				response.push_back(Packetizer::ICSChecksum(response));
+				response.insert(response.begin(), { 0xAA, uint8_t((9 << 4) | (uint8_t)Network::NetID::Main51) });
+				sendToHost(MakeFrame(hostMAC, response, 0, true, true));
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lk(receivedMutex);
+			if(memcmp(packet.destMAC, DeviceMAC, 6) == 0)
+				received.insert(received.end(), packet.payload.begin(), packet.payload.end());
+		}
+	}
+
+	std::vector<uint8_t> receivedFromHost(size_t expected) {
+		for(int i = 0; i < 200; i++) {
+			{
+				std::lock_guard<std::mutex> lk(receivedMutex);
+				if(received.size() >= expected)
+					return received;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		std::lock_guard<std::mutex> lk(receivedMutex);
+		return received;
+	}
+
+	bool created = false;
+	int deviceFD = -1;
+	uint8_t hostMAC[6] = {};
+	std::atomic<bool> stop{false};
+	std::thread responder;
+	std::mutex receivedMutex;
+	std::vector<uint8_t> received;
+};
+
+TEST_F(AFPacketTest, FindOpenAndExchange) {
+	std::vector<FoundDevice> found;
+	AFPacket::Find(found);
+	const auto device = std::find_if(found.begin(), found.end(), [](const FoundDevice& dev) {
+		return std::string(dev.serial) == "123456";
+	});
+	ASSERT_NE(device, found.end());
+	EXPECT_EQ(device->handle & 0xFFFFFF, 0x123456);
+
+	neodevice_t neodevice = {};
+	neodevice.handle = device->handle;
+	auto driver = device->makeDriver([](APIEvent::Type, APIEvent::Severity) {}, neodevice);
+	ASSERT_TRUE(driver->open());
+	EXPECT_TRUE(driver->isEthernet());
+
+	// Host to device, small writes are packed together
+	bool completed = false;
+	ASSERT_TRUE(driver->write({ 0x01, 0x02, 0x03 }));
+	ASSERT_TRUE(driver->writeAsync({ 0x04, 0x05 }, [&completed](bool success) { completed = success; }));
+	EXPECT_EQ(receivedFromHost(5), std::vector<uint8_t>({ 0x01, 0x02, 0x03, 0x04, 0x05 }));
+
+	// Device to host, including a reassembled multi-piece packet
+	std::vector<uint8_t> big(2000);
+	for(size_t i = 0; i < big.size(); i++)
+		big[i] = uint8_t(i);
+	sendToHost(MakeFrame(hostMAC, { 0xAA, 0xBB }, 1, true, true));
+	sendToHost(MakeFrame(hostMAC, std::vector<uint8_t>(big.begin(), big.begin() + 1400), 2, true, false));
+	sendToHost(MakeFrame(hostMAC, std::vector<uint8_t>(big.begin() + 1400, big.end()), 2, false, true));
+
+	std::vector<uint8_t> expected = { 0xAA, 0xBB };
+	expected.insert(expected.end(), big.begin(), big.end());
+	std::vector<uint8_t> fromDevice;
+	std::vector<uint8_t> chunk;
+	for(int i = 0; i < 20 && fromDevice.size() < expected.size(); i++) {
+		if(driver->readChunkWait(chunk)) {
+			fromDevice.insert(fromDevice.end(), chunk.begin(), chunk.end());
+			driver->releaseReadBuffer(std::move(chunk));
+			chunk.clear();
+		}
+	}
+	EXPECT_EQ(fromDevice, expected);
+	EXPECT_TRUE(completed);
+
+	EXPECT_TRUE(driver->close());
+	EXPECT_FALSE(driver->isOpen());
+}
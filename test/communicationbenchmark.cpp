@@ -0,0 +1,150 @@
+#include "communicationtest.h"
+#include "icsneo/communication/message/filter/canmessagefilter.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <string>
+
+class CommunicationBenchmark : public CommunicationTest {};
+
+TEST_F(CommunicationBenchmark, WatchingTwoOfSixteenBuses)
+{
+	static constexpr size_t Rounds = 20000;
+	const auto cpuTime = [this](const std::vector<std::shared_ptr<MessageFilter>>& filters) {
+		std::vector<int> ids;
+		for(const auto& filter : filters)
+			ids.push_back(com->addMessageCallback(std::make_shared<MessageCallback>([](std::shared_ptr<Message>) {}, filter)));
+		const auto stream = MakeStream(Rounds);
+		std::vector<uint8_t> read;
+		const std::clock_t start = std::clock();
+		for(size_t offset = 0; offset < stream.size(); offset += 16384) { // Reads as big as a USB transfer
+			read.assign(stream.begin() + offset, stream.begin() + std::min(offset + 16384, stream.size()));
+			com->handleInput(*com->packetizer, read);
+		}
+		const std::clock_t elapsed = std::clock() - start;
+		for(const int id : ids)
+			com->removeMessageCallback(id);
+		return uint64_t(elapsed) * 1000000 / CLOCKS_PER_SEC;
+	};
+
+	const uint64_t all = cpuTime({ std::make_shared<MessageFilter>(Network::Type::CAN) });
+	const uint64_t two = cpuTime({ std::make_shared<MessageFilter>(Network::NetID::HSCAN), std::make_shared<MessageFilter>(Network::NetID::DWCAN12) });
+	EXPECT_EQ(decodedCAN(), Rounds * CANNetworks().size() + Rounds * 2);
+	RecordProperty("AllBusesMicroseconds", std::to_string(all));
+	RecordProperty("TwoBusesMicroseconds", std::to_string(two));
+}
+
+TEST_F(CommunicationBenchmark, CANFrameBatchThroughput)
+{
+	// Every frame on every bus, as messages and then as batches
+	static constexpr size_t Rounds = 20000;
+	const auto stream = MakeStream(Rounds);
+	const auto cpuTime = [&]() {
+		std::vector<uint8_t> read;
+		const std::clock_t start = std::clock();
+		for(size_t offset = 0; offset < stream.size(); offset += 16384) {
+			read.assign(stream.begin() + offset, stream.begin() + std::min(offset + 16384, stream.size()));
+			com->handleInput(*com->packetizer, read);
+		}
+		return uint64_t(std::clock() - start) * 1000000 / CLOCKS_PER_SEC;
+	};
+
+	uint64_t arbids = 0;
+	int id = com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message> message) {
+		if(const auto can = std::dynamic_pointer_cast<CANMessage>(message))
+			arbids += can->arbid;
+	}, CANMessageFilter()));
+	const uint64_t messages = cpuTime();
+	com->removeMessageCallback(id);
+
+	const uint64_t expected = arbids;
+	arbids = 0;
+	id = com->addCANFrameBatchCallback([&](const CANFrameBatch& batch) {
+		for(const uint32_t arbid : batch.arbids)
+			arbids += arbid;
+	});
+	const uint64_t batches = cpuTime();
+	com->removeCANFrameBatchCallback(id);
+
+	EXPECT_EQ(arbids, expected);
+	RecordProperty("MessageMicroseconds", std::to_string(messages));
+	RecordProperty("BatchMicroseconds", std::to_string(batches));
+}
+
+// Matches the same as CANMessageFilter, but the registry can't know that
+class OpaqueCANFilter : public CANMessageFilter {
+public:
+	using CANMessageFilter::CANMessageFilter;
+	bool match(const std::shared_ptr<Message>& message) const override { return CANMessageFilter::match(message); }
+};
+
+TEST_F(CommunicationBenchmark, IndexedDispatchThroughput)
+{
+	// One callback per arbitration ID, against the same filters hidden from the index, as every filter used to be
+	for(const size_t callbacks : { 1, 10, 100, 1000 }) {
+		const size_t messages = std::max<size_t>(2000, 200000 / callbacks);
+		for(const bool indexed : { true, false }) {
+			std::vector<int> ids;
+			size_t calls = 0;
+			for(uint32_t arbid = 0; arbid < callbacks; arbid++) {
+				std::shared_ptr<MessageFilter> filter;
+				if(indexed)
+					filter = std::make_shared<CANMessageFilter>(arbid);
+				else
+					filter = std::make_shared<OpaqueCANFilter>(arbid);
+				ids.push_back(com->addMessageCallback(std::make_shared<MessageCallback>([&calls](std::shared_ptr<Message>) { calls++; }, filter)));
+			}
+
+			auto can = std::make_shared<CANMessage>();
+			can->network = Network(Network::NetID::HSCAN);
+			std::shared_ptr<Message> message = can;
+			const auto start = std::chrono::steady_clock::now();
+			for(size_t i = 0; i < messages; i++) {
+				can->arbid = uint32_t(i % callbacks);
+				com->dispatchMessage(message);
+			}
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			EXPECT_EQ(calls, messages);
+
+			for(const int id : ids)
+				com->removeMessageCallback(id);
+			RecordProperty((indexed ? "IndexedNanosecondsPerMessageWith" : "LinearNanosecondsPerMessageWith") + std::to_string(callbacks), std::to_string(elapsed / messages));
+		}
+	}
+}
+
+TEST_F(CommunicationBenchmark, MessageBatchThroughput)
+{
+	// Every frame on every bus, a message at a time and then a read at a time
+	static constexpr size_t Rounds = 20000;
+	const auto stream = MakeStream(Rounds);
+	const auto cpuTime = [&]() {
+		std::vector<uint8_t> read;
+		const std::clock_t start = std::clock();
+		for(size_t offset = 0; offset < stream.size(); offset += 16384) {
+			read.assign(stream.begin() + offset, stream.begin() + std::min(offset + 16384, stream.size()));
+			com->handleInput(*com->packetizer, read);
+		}
+		return uint64_t(std::clock() - start) * 1000000 / CLOCKS_PER_SEC;
+	};
+
+	uint64_t arbids = 0;
+	int id = com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message> message) {
+		arbids += static_cast<const CANMessage&>(*message).arbid;
+	}, MessageFilter(Network::Type::CAN)));
+	const uint64_t messages = cpuTime();
+	com->removeMessageCallback(id);
+
+	const uint64_t expected = arbids;
+	arbids = 0;
+	id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>([&](const std::vector<std::shared_ptr<Message>>& batch) {
+		for(const auto& message : batch)
+			arbids += static_cast<const CANMessage&>(*message).arbid;
+	}, MessageFilter(Network::Type::CAN)));
+	const uint64_t batches = cpuTime();
+	com->removeMessageBatchCallback(id);
+
+	EXPECT_EQ(arbids, expected);
+	RecordProperty("MessageMicroseconds", std::to_string(messages));
+	RecordProperty("BatchMicroseconds", std::to_string(batches));
+}
@@ -0,0 +1,707 @@
+#include "communicationtest.h"
+#include "icsneo/communication/message/filter/canmessagefilter.h"
+#include "icsneo/communication/message/filter/main51messagefilter.h"
+#include "icsneo/communication/message/resetstatusmessage.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <ctime>
+
+TEST_F(CommunicationTest, FiltersDecideWhatIsDecoded)
+{
+	static constexpr size_t Rounds = 100;
+	size_t received = 0;
+	com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) { received++; }, MessageFilter(Network::NetID::HSCAN)));
+	com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) { received++; }, MessageFilter(Network::NetID::DWCAN12)));
+
+	auto stream = MakeStream(Rounds);
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_EQ(com->packetizer->skippedPackets(), Rounds * (CANNetworks().size() - 2));
+	EXPECT_EQ(com->getPacketReadCount(), 1u);
+	EXPECT_EQ(received, Rounds * 2);
+	EXPECT_EQ(decodedCAN(), Rounds * 2);
+
+	// Internal networks are decoded whether or not anyone asked for them
+	EXPECT_TRUE(com->wantsNetwork(Network(Network::NetID::DeviceStatus)));
+	EXPECT_FALSE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+
+	// Once somebody wants everything, everything is decoded
+	const int all = com->addMessageCallback(std::make_shared<MessageCallback>([](std::shared_ptr<Message>) {}));
+	stream = MakeStream(Rounds);
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_EQ(received, Rounds * 4);
+	EXPECT_EQ(decodedCAN(), Rounds * 2 + Rounds * CANNetworks().size());
+
+	// And no longer when they're gone
+	com->removeMessageCallback(all);
+	EXPECT_FALSE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+	EXPECT_TRUE(com->wantsNetwork(Network(Network::NetID::HSCAN)));
+}
+
+TEST_F(CommunicationTest, SlowCallbacksOnlyHoldUpTheirOwnRemoval)
+{
+	std::atomic<bool> inCallback{false};
+	std::atomic<bool> callbackDone{false};
+	const int slow = com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) {
+		inCallback = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		callbackDone = true;
+	}, MessageFilter(Network::NetID::HSCAN)));
+
+	std::thread reader([this]() {
+		std::vector<uint8_t> stream;
+		AppendCANPacket(stream, Network::NetID::HSCAN, 0x100);
+		com->handleInput(*com->packetizer, stream);
+	});
+	while(!inCallback)
+		std::this_thread::yield();
+
+	// Other callbacks come and go while the slow one is running, as waitForMessageSync() would
+	const auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < 100; i++)
+		EXPECT_TRUE(com->removeMessageCallback(com->addMessageCallback(std::make_shared<MessageCallback>([](std::shared_ptr<Message>) {}))));
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	EXPECT_FALSE(callbackDone);
+	RecordProperty("AddAndRemoveMicroseconds", std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 100));
+
+	// Removing the slow one waits it out, after that it is never called again
+	const std::clock_t cpuStart = std::clock();
+	EXPECT_TRUE(com->removeMessageCallback(slow));
+	const std::clock_t cpuUsed = std::clock() - cpuStart;
+	EXPECT_TRUE(callbackDone);
+	reader.join();
+#ifndef _WIN32 // Where clock() is processor time, the callback only sleeps so the wait should have cost next to nothing
+	EXPECT_LT(cpuUsed, CLOCKS_PER_SEC / 20);
+#else
+	(void)cpuUsed;
+#endif
+}
+
+TEST_F(CommunicationTest, CallbackRemovesItself)
+{
+	size_t calls = 0;
+	int id = 0;
+	id = com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) {
+		calls++;
+		EXPECT_TRUE(com->removeMessageCallback(id));
+	}, MessageFilter(Network::NetID::HSCAN)));
+	com->addMessageCallback(std::make_shared<MessageCallback>([](std::shared_ptr<Message>) {}, MessageFilter(Network::NetID::HSCAN)));
+
+	auto stream = MakeStream(3); // One read, the rest of it no longer goes to the removed callback
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_EQ(calls, 1u);
+}
+
+// Matches the same as MessageFilter, but the registry can't know that
+class OpaqueFilter : public MessageFilter {
+public:
+	using MessageFilter::MessageFilter;
+	bool match(const std::shared_ptr<Message>& message) const override { return MessageFilter::match(message); }
+};
+
+TEST_F(CommunicationTest, IndexedDispatchMatchesEveryFilter)
+{
+	const std::vector<std::shared_ptr<MessageFilter>> filters = {
+		std::make_shared<MessageFilter>(),
+		std::make_shared<CANMessageFilter>(0x100),
+		std::make_shared<MessageFilter>(Network::NetID::HSCAN),
+		std::make_shared<CANMessageFilter>(),
+		std::make_shared<MessageFilter>(Message::Type::Frame),
+		std::make_shared<OpaqueFilter>(Network::NetID::HSCAN2),
+		std::make_shared<MessageFilter>(Network::Type::CAN),
+		std::make_shared<CANMessageFilter>(0x200),
+		std::make_shared<MessageFilter>(Message::Type::ResetStatus),
+		std::make_shared<MessageFilter>(Network::Type::Internal),
+		std::make_shared<CANMessageFilter>(0x100),
+		std::make_shared<MessageFilter>(Network::NetID::Device)
+	};
+	std::vector<size_t> calls;
+	for(size_t i = 0; i < filters.size(); i++)
+		com->addMessageCallback(std::make_shared<MessageCallback>([&calls, i](std::shared_ptr<Message>) { calls.push_back(i); }, filters[i]));
+
+	std::vector<std::shared_ptr<Message>> messages;
+	for(const auto netid : { Network::NetID::HSCAN, Network::NetID::HSCAN2, Network::NetID::MSCAN }) {
+		for(const uint32_t arbid : { 0x100, 0x200, 0x300 }) {
+			auto can = std::make_shared<CANMessage>();
+			can->network = Network(netid);
+			can->arbid = arbid;
+			messages.push_back(can);
+		}
+	}
+	messages.push_back(std::make_shared<RawMessage>(Network(Network::NetID::Device)));
+	messages.push_back(std::make_shared<RawMessage>(Network(Network::NetID::Ethernet)));
+	messages.push_back(std::make_shared<ResetStatusMessage>());
+
+	for(const auto& message : messages) {
+		std::vector<size_t> expected;
+		for(size_t i = 0; i < filters.size(); i++) {
+			if(filters[i]->match(message))
+				expected.push_back(i);
+		}
+		calls.clear();
+		com->dispatchMessage(message);
+		EXPECT_EQ(calls, expected); // Including the order they were added in
+	}
+}
+
+TEST_F(CommunicationTest, NetworkInterestOfFilters)
+{
+	const auto interestOf = [](const MessageFilter& filter) {
+		NetworkInterest interest;
+		filter.addNetworkInterest(interest);
+		return interest;
+	};
+
+	EXPECT_TRUE(interestOf(MessageFilter()).wantsAll());
+	EXPECT_TRUE(interestOf(MessageFilter(Message::Type::Frame)).wantsAll());
+	EXPECT_TRUE(interestOf(MessageFilter(Message::Type::RawMessage)).wantsAll()); // Networks without a decoder give RawMessages
+
+	const auto liveData = interestOf(MessageFilter(Message::Type::LiveData));
+	EXPECT_FALSE(liveData.wantsAll());
+	EXPECT_FALSE(liveData.wants(Network(Network::NetID::HSCAN)));
+	EXPECT_TRUE(liveData.wants(Network(neonetid_t(Network::NetID::ExtendedCommand), false)));
+
+	const auto hscan2 = interestOf(MessageFilter(Network::NetID::HSCAN2));
+	EXPECT_TRUE(hscan2.wants(Network(Network::NetID::HSCAN2)));
+	EXPECT_FALSE(hscan2.wants(Network(Network::NetID::HSCAN)));
+
+	const auto can = interestOf(CANMessageFilter());
+	EXPECT_TRUE(can.wants(Network(Network::NetID::DWCAN16)));
+	EXPECT_FALSE(can.wants(Network(Network::NetID::Ethernet)));
+
+	// A subclass may match more than the fields it sets, so it wants everything unless it says otherwise
+	EXPECT_TRUE(interestOf(OpaqueFilter(Network::NetID::HSCAN2)).wantsAll());
+	class OpaqueCANFilter : public CANMessageFilter {
+	public:
+		bool match(const std::shared_ptr<Message>&) const override { return true; }
+	};
+	EXPECT_TRUE(interestOf(OpaqueCANFilter()).wantsAll());
+}
+
+TEST_F(CommunicationTest, CANFrameBatchesMatchTheMessages)
+{
+	std::vector<std::shared_ptr<CANMessage>> messages;
+	com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message> message) {
+		messages.push_back(std::static_pointer_cast<CANMessage>(message));
+	}, MessageFilter(Network::Type::CAN)));
+	size_t batches = 0;
+	CANFrameBatch frames;
+	com->addCANFrameBatchCallback([&](const CANFrameBatch& batch) {
+		batches++;
+		frames = batch;
+	});
+
+	std::vector<uint8_t> stream = MakeStream(2);
+	AppendCANFDPacket(stream, Network::NetID::HSCAN2, 0x1ABCDEF);
+	AppendCANPacket(stream, Network::NetID::HSCAN, 0x7FF);
+	reinterpret_cast<HardwareCANPacket*>(stream.data() + stream.size() - sizeof(HardwareCANPacket))->header.SRR = 1; // Remote
+	AppendCANPacket(stream, Network::NetID::HSCAN3, 0);
+	reinterpret_cast<HardwareCANPacket*>(stream.data() + stream.size() - sizeof(HardwareCANPacket))->dlc.RB1 = 1; // Error counts, not a frame
+	AppendCANPacket(stream, Network::NetID::Ethernet, 0); // Not CAN at all, so dropped
+	com->handleInput(*com->packetizer, stream);
+
+	ASSERT_EQ(batches, 1u); // All from the one read
+	ASSERT_EQ(frames.size(), messages.size());
+	ASSERT_EQ(frames.size(), 2 * CANNetworks().size() + 2);
+	ASSERT_EQ(frames.payloadOffsets.size(), frames.size() + 1);
+	for(size_t i = 0; i < frames.size(); i++) {
+		SCOPED_TRACE(i);
+		const CANMessage& msg = *messages[i];
+		EXPECT_EQ(frames.timestamps[i], msg.timestamp);
+		EXPECT_EQ(frames.arbids[i], msg.arbid);
+		EXPECT_EQ(frames.dlcs[i], msg.dlcOnWire);
+		EXPECT_EQ(frames.netids[i], msg.network.getNetID());
+		EXPECT_EQ(bool(frames.flags[i] & CANFrameBatch::Extended), msg.isExtended);
+		EXPECT_EQ(bool(frames.flags[i] & CANFrameBatch::Remote), msg.isRemote);
+		EXPECT_EQ(bool(frames.flags[i] & CANFrameBatch::CANFD), msg.isCANFD);
+		EXPECT_EQ(bool(frames.flags[i] & CANFrameBatch::BaudrateSwitch), msg.baudrateSwitch);
+		if(!msg.isRemote) { // The message is given zeroes for the length of a remote frame
+			EXPECT_EQ(std::vector<uint8_t>(frames.data(i), frames.data(i) + frames.dataLength(i)), msg.data);
+		}
+	}
+	EXPECT_EQ(frames.dataLength(frames.size() - 2), 64u);
+	EXPECT_EQ(frames.dataLength(frames.size() - 1), 0u);
+}
+
+TEST_F(CommunicationTest, CANFrameBatchesWithoutMessages)
+{
+	size_t frames = 0;
+	const int id = com->addCANFrameBatchCallback([&](const CANFrameBatch& batch) { frames += batch.size(); });
+	auto stream = MakeStream(10);
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_EQ(frames, 10 * CANNetworks().size());
+	EXPECT_EQ(decodedCAN(), 0u); // Nobody asked for messages
+
+	EXPECT_TRUE(com->removeCANFrameBatchCallback(id));
+	EXPECT_FALSE(com->removeCANFrameBatchCallback(id));
+	stream = MakeStream(10);
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_EQ(frames, 10 * CANNetworks().size());
+}
+
+// Collects the arbitration IDs a queued callback is handed, holding it up until released
+class HeldCallback {
+public:
+	HeldCallback(MessageCallback::ExecutionPolicy policy) : callback(std::make_shared<MessageCallback>([this](std::shared_ptr<Message> message) {
+		entered = true;
+		while(!released)
+			std::this_thread::yield();
+		std::lock_guard<std::mutex> lk(mutex);
+		arbids.push_back(std::static_pointer_cast<CANMessage>(message)->arbid);
+	}, MessageFilter(Network::NetID::HSCAN))) {
+		callback->setExecutionPolicy(policy);
+	}
+
+	std::vector<uint32_t> waitFor(size_t count) {
+		const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while(std::chrono::steady_clock::now() < end) {
+			{
+				std::lock_guard<std::mutex> lk(mutex);
+				if(arbids.size() >= count)
+					break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		std::lock_guard<std::mutex> lk(mutex);
+		return arbids;
+	}
+
+	const std::shared_ptr<MessageCallback> callback;
+	std::atomic<bool> entered{false};
+	std::atomic<bool> released{false};
+
+private:
+	std::mutex mutex;
+	std::vector<uint32_t> arbids;
+};
+
+static std::vector<uint32_t> Sequence(uint32_t first, uint32_t last) {
+	std::vector<uint32_t> ret;
+	for(uint32_t i = first; i <= last; i++)
+		ret.push_back(i);
+	return ret;
+}
+
+TEST_F(CommunicationTest, QueuedCallbacksDontHoldUpReading)
+{
+	static constexpr uint32_t Frames = 50;
+	for(const auto execution : { MessageCallback::Execution::Thread, MessageCallback::Execution::Pooled }) {
+		SCOPED_TRACE(int(execution));
+		HeldCallback held({ execution, Frames, MessageCallback::Overflow::Block });
+		const int heldID = com->addMessageCallback(held.callback);
+		size_t inlineCalls = 0;
+		const int inlineID = com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) { inlineCalls++; }, MessageFilter(Network::NetID::HSCAN)));
+
+		// The read is done with while the held callback hasn't gotten past the first message
+		std::vector<uint8_t> stream;
+		for(uint32_t i = 0; i < Frames; i++)
+			AppendCANPacket(stream, Network::NetID::HSCAN, i);
+		com->handleInput(*com->packetizer, stream);
+		EXPECT_EQ(inlineCalls, Frames);
+		EXPECT_GE(held.callback->getQueueDepth(), Frames - 1);
+
+		held.released = true;
+		EXPECT_EQ(held.waitFor(Frames), Sequence(0, Frames - 1));
+		EXPECT_EQ(held.callback->getQueueDepth(), 0u);
+		EXPECT_EQ(held.callback->getDroppedCount(), 0u);
+		EXPECT_TRUE(com->removeMessageCallback(heldID));
+		EXPECT_TRUE(com->removeMessageCallback(inlineID));
+	}
+}
+
+// Counts how often it is asked to match, which for a queued callback should be once per message
+class CountingFilter : public MessageFilter {
+public:
+	using MessageFilter::MessageFilter;
+	bool match(const std::shared_ptr<Message>& message) const override {
+		matches++;
+		return MessageFilter::match(message);
+	}
+	mutable std::atomic<size_t> matches{0};
+};
+
+TEST_F(CommunicationTest, QueuedCallbacksAreMatchedOnce)
+{
+	static_assert(std::is_copy_constructible<MessageCallback>::value, "MessageCallback must stay copyable");
+
+	static constexpr uint32_t Frames = 20;
+	for(const auto execution : { MessageCallback::Execution::Thread, MessageCallback::Execution::Pooled }) {
+		SCOPED_TRACE(int(execution));
+		auto filter = std::make_shared<CountingFilter>(Network::NetID::HSCAN);
+		std::atomic<uint32_t> calls{0};
+		auto callback = std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) { calls++; }, filter);
+		callback->setExecutionPolicy({ execution, Frames, MessageCallback::Overflow::Block });
+		const int id = com->addMessageCallback(callback);
+
+		std::vector<uint8_t> stream;
+		for(uint32_t i = 0; i < Frames; i++)
+			AppendCANPacket(stream, Network::NetID::HSCAN, i);
+		com->handleInput(*com->packetizer, stream);
+		for(int i = 0; i < 1000 && calls != Frames; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		EXPECT_TRUE(com->removeMessageCallback(id));
+
+		EXPECT_EQ(calls, Frames);
+		EXPECT_EQ(filter->matches, size_t(Frames));
+
+		// A copy shares the counters of the original
+		const MessageCallback copy = *callback;
+		EXPECT_EQ(copy.getQueueDepth(), callback->getQueueDepth());
+		EXPECT_EQ(copy.getDroppedCount(), callback->getDroppedCount());
+	}
+}
+
+TEST_F(CommunicationTest, QueuedCallbackOverflow)
+{
+	static constexpr size_t Capacity = 4;
+	const auto feed = [this](uint32_t first, uint32_t last) {
+		std::vector<uint8_t> stream;
+		for(uint32_t i = first; i <= last; i++)
+			AppendCANPacket(stream, Network::NetID::HSCAN, i);
+		com->handleInput(*com->packetizer, stream);
+	};
+
+	for(const auto execution : { MessageCallback::Execution::Thread, MessageCallback::Execution::Pooled }) {
+		SCOPED_TRACE(int(execution));
+		{
+			// The first message is being handled, the queue fills behind it and the rest never make it in
+			HeldCallback held({ execution, Capacity, MessageCallback::Overflow::DropNewest });
+			const int id = com->addMessageCallback(held.callback);
+			feed(0, 0);
+			while(!held.entered)
+				std::this_thread::yield();
+			feed(1, 10);
+			EXPECT_EQ(held.callback->getQueueDepth(), Capacity);
+			EXPECT_EQ(held.callback->getDroppedCount(), 10 - Capacity);
+			held.released = true;
+			EXPECT_EQ(held.waitFor(1 + Capacity), Sequence(0, Capacity));
+			EXPECT_TRUE(com->removeMessageCallback(id));
+		}
+		{
+			// The newest ones push the oldest queued ones out
+			HeldCallback held({ execution, Capacity, MessageCallback::Overflow::DropOldest });
+			const int id = com->addMessageCallback(held.callback);
+			feed(0, 0);
+			while(!held.entered)
+				std::this_thread::yield();
+			feed(1, 10);
+			EXPECT_EQ(held.callback->getQueueDepth(), Capacity);
+			EXPECT_EQ(held.callback->getDroppedCount(), 10 - Capacity);
+			held.released = true;
+			auto expected = Sequence(11 - Capacity, 10);
+			expected.insert(expected.begin(), 0);
+			EXPECT_EQ(held.waitFor(1 + Capacity), expected);
+			EXPECT_TRUE(com->removeMessageCallback(id));
+		}
+		{
+			// The reader waits for room, nothing is lost
+			HeldCallback held({ execution, Capacity, MessageCallback::Overflow::Block });
+			const int id = com->addMessageCallback(held.callback);
+			feed(0, 0);
+			while(!held.entered)
+				std::this_thread::yield();
+			std::atomic<bool> fed{false};
+			std::thread reader([&]() {
+				feed(1, 10);
+				fed = true;
+			});
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			EXPECT_FALSE(fed);
+			EXPECT_EQ(held.callback->getQueueDepth(), Capacity);
+			held.released = true;
+			reader.join();
+			EXPECT_EQ(held.waitFor(11), Sequence(0, 10));
+			EXPECT_EQ(held.callback->getDroppedCount(), 0u);
+			EXPECT_TRUE(com->removeMessageCallback(id));
+		}
+	}
+}
+
+TEST_F(CommunicationTest, RemovingQueuedCallbacks)
+{
+	for(const auto execution : { MessageCallback::Execution::Thread, MessageCallback::Execution::Pooled }) {
+		SCOPED_TRACE(int(execution));
+		std::vector<uint8_t> stream;
+		for(uint32_t i = 0; i < 20; i++)
+			AppendCANPacket(stream, Network::NetID::HSCAN, i);
+
+		// From the outside while it's busy, it finishes what it's on and the rest of the queue is dropped
+		{
+			HeldCallback held({ execution, 64, MessageCallback::Overflow::Block });
+			const int id = com->addMessageCallback(held.callback);
+			auto copy = stream;
+			com->handleInput(*com->packetizer, copy);
+			while(!held.entered)
+				std::this_thread::yield();
+			std::thread releaser([&held]() {
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				held.released = true;
+			});
+			EXPECT_TRUE(com->removeMessageCallback(id));
+			EXPECT_TRUE(held.released);
+			EXPECT_EQ(held.waitFor(1), Sequence(0, 0));
+			EXPECT_EQ(held.callback->getQueueDepth(), 0u);
+			releaser.join();
+		}
+
+		// From inside, on its own thread
+		{
+			std::atomic<size_t> calls{0};
+			std::atomic<bool> removed{false};
+			int id = 0;
+			auto callback = std::make_shared<MessageCallback>([&](std::shared_ptr<Message>) {
+				calls++;
+				EXPECT_TRUE(com->removeMessageCallback(id));
+				removed = true;
+			}, MessageFilter(Network::NetID::HSCAN));
+			callback->setExecutionPolicy({ execution, 64, MessageCallback::Overflow::Block });
+			id = com->addMessageCallback(callback);
+			auto copy = stream;
+			com->handleInput(*com->packetizer, copy);
+			while(!removed)
+				std::this_thread::yield();
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			EXPECT_EQ(calls, 1u);
+		}
+	}
+}
+
+// A Main51 response, as the device sends it
+static void AppendMain51Packet(std::vector<uint8_t>& stream, uint8_t command, uint8_t payload) {
+	const size_t length = 2 + 6;
+	stream.insert(stream.end(), { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(Network::NetID::Main51), 0x00, command, payload });
+}
+
+static uint8_t ResponsePayload(std::future< std::shared_ptr<Message> >& response) {
+	EXPECT_EQ(response.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+	const auto main51 = std::dynamic_pointer_cast<Main51Message>(response.get());
+	EXPECT_TRUE(main51);
+	return main51 && main51->data.size() == 1 ? main51->data[0] : 0;
+}
+
+TEST_F(CommunicationTest, ResponsesAreCorrelated)
+{
+	const auto filterFor = [](uint8_t command) { return std::make_shared<Main51MessageFilter>(Command(command)); };
+	auto first = com->expectResponse(filterFor(0x50));
+	auto second = com->expectResponse(filterFor(0x51));
+	auto third = com->expectResponse(filterFor(0x51)); // Expecting the same response as the one before it
+	auto broad = com->expectResponse(std::make_shared<MessageFilter>(Message::Type::Main51));
+	auto cancelled = com->expectResponse(filterFor(0x52));
+	EXPECT_TRUE(com->cancelResponse(cancelled.id));
+	EXPECT_FALSE(com->cancelResponse(cancelled.id));
+
+	// Out of order, and a command nobody asked about in particular
+	std::vector<uint8_t> stream;
+	AppendMain51Packet(stream, 0x51, 1);
+	AppendMain51Packet(stream, 0x52, 2);
+	AppendMain51Packet(stream, 0x50, 3);
+	AppendMain51Packet(stream, 0x51, 4);
+	com->handleInput(*com->packetizer, stream);
+
+	EXPECT_EQ(ResponsePayload(first.response), 3);
+	EXPECT_EQ(ResponsePayload(second.response), 1);
+	EXPECT_EQ(ResponsePayload(third.response), 4);
+	EXPECT_EQ(ResponsePayload(broad.response), 2); // The specific requests had first pick
+	EXPECT_THROW(cancelled.response.get(), std::future_error); // Broken, the promise went with the request
+	EXPECT_FALSE(com->cancelResponse(first.id));
+}
+
+TEST_F(CommunicationTest, EveryWaiterSeesTheMessage)
+{
+	auto correlated = com->expectResponse(std::make_shared<MessageFilter>(Network::NetID::HSCAN));
+
+	// A specific and a catch-all waiter outstanding at once, as the legacy icsneoWaitForRxMessagesWithTimeOut() would be
+	std::atomic<int> waiting{0};
+	const auto waitFor = [&](std::shared_ptr<MessageFilter> filter) {
+		return std::async(std::launch::async, [&, filter]() {
+			return com->waitForMessageSync([&]() { waiting++; return true; }, filter, std::chrono::seconds(5));
+		});
+	};
+	auto specific = waitFor(std::make_shared<MessageFilter>(Network::NetID::HSCAN));
+	auto anything = waitFor(nullptr);
+	while(waiting != 2)
+		std::this_thread::yield();
+
+	std::vector<uint8_t> stream;
+	AppendCANPacket(stream, Network::NetID::HSCAN, 0x123);
+	com->handleInput(*com->packetizer, stream);
+
+	for(auto* response : { &correlated.response, &specific, &anything }) {
+		const auto can = std::dynamic_pointer_cast<CANMessage>(response->get());
+		ASSERT_TRUE(can);
+		EXPECT_EQ(can->arbid, 0x123u);
+	}
+}
+
+TEST_F(CommunicationTest, ResponsesWidenTheNetworkInterestWhileOutstanding)
+{
+	EXPECT_FALSE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+	auto expected = com->expectResponse(std::make_shared<MessageFilter>(Network::NetID::HSCAN2));
+	EXPECT_TRUE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+
+	std::vector<uint8_t> stream;
+	AppendCANPacket(stream, Network::NetID::HSCAN2, 0x123);
+	com->handleInput(*com->packetizer, stream);
+	const auto can = std::dynamic_pointer_cast<CANMessage>(expected.response.get());
+	ASSERT_TRUE(can);
+	EXPECT_EQ(can->arbid, 0x123u);
+	EXPECT_FALSE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+
+	// The same once cancelled
+	expected = com->expectResponse(std::make_shared<MessageFilter>(Network::NetID::HSCAN2));
+	EXPECT_TRUE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+	EXPECT_TRUE(com->cancelResponse(expected.id));
+	EXPECT_FALSE(com->wantsNetwork(Network(Network::NetID::HSCAN2)));
+}
+
+TEST_F(CommunicationTest, PipelinedRoundTrips)
+{
+	// Each command is answered a while after it's sent, as a device busy with a disk would
+	static constexpr uint8_t Requests = 8;
+	static constexpr auto Latency = std::chrono::milliseconds(20);
+	std::mutex inputMutex; // The read thread only ever handles one read at a time
+	std::vector<std::thread> responders;
+	std::mutex respondersMutex;
+	std::atomic<size_t> answered{0};
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> requesters;
+	for(uint8_t i = 0; i < Requests; i++) {
+		requesters.emplace_back([&, i]() {
+			const auto response = com->waitForMessageSync([&]() {
+				std::lock_guard<std::mutex> lk(respondersMutex);
+				responders.emplace_back([&, i]() {
+					std::this_thread::sleep_for(Latency);
+					std::vector<uint8_t> stream;
+					AppendMain51Packet(stream, uint8_t(0x50 + i), i);
+					std::lock_guard<std::mutex> inputLk(inputMutex);
+					com->handleInput(*com->packetizer, stream);
+				});
+				return true;
+			}, std::make_shared<Main51MessageFilter>(Command(0x50 + i)), std::chrono::seconds(5));
+			const auto main51 = std::dynamic_pointer_cast<Main51Message>(response);
+			if(main51 && main51->data == std::vector<uint8_t>({ i }))
+				answered++;
+		});
+	}
+	for(auto& requester : requesters)
+		requester.join();
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	for(auto& responder : responders)
+		responder.join();
+
+	EXPECT_EQ(answered, Requests);
+	EXPECT_LT(elapsed, Latency * Requests); // One at a time would have taken at least this long
+	RecordProperty("Milliseconds", std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+}
+
+TEST_F(CommunicationTest, MessageBatchesMatchTheMessages)
+{
+	std::vector<std::shared_ptr<Message>> individually;
+	std::vector<size_t> batchSizes;
+	std::vector<std::shared_ptr<Message>> batched;
+	com->addMessageCallback(std::make_shared<MessageCallback>([&](std::shared_ptr<Message> message) {
+		individually.push_back(message);
+	}, MessageFilter(Network::Type::CAN)));
+	const int id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>([&](const std::vector<std::shared_ptr<Message>>& batch) {
+		batchSizes.push_back(batch.size());
+		batched.insert(batched.end(), batch.begin(), batch.end());
+	}, MessageFilter(Network::Type::CAN)));
+
+	// Everything in the first read matches, the second has some which don't
+	auto stream = MakeStream(3);
+	com->handleInput(*com->packetizer, stream);
+	stream.clear();
+	AppendCANPacket(stream, Network::NetID::HSCAN, 0x10);
+	AppendMain51Packet(stream, 0x50, 0);
+	AppendCANPacket(stream, Network::NetID::MSCAN, 0x11);
+	com->handleInput(*com->packetizer, stream);
+
+	EXPECT_EQ(batchSizes, std::vector<size_t>({ 3 * CANNetworks().size(), 2 }));
+	EXPECT_EQ(batched, individually);
+
+	// Messages the device hands over itself come as a batch of one
+	com->dispatchMessage(individually.front());
+	EXPECT_EQ(batchSizes.back(), 1u);
+
+	EXPECT_TRUE(com->removeMessageBatchCallback(id));
+	EXPECT_FALSE(com->removeMessageBatchCallback(id));
+}
+
+TEST_F(CommunicationTest, MessageBatchWindows)
+{
+	const size_t perRead = CANNetworks().size();
+	std::vector<size_t> batchSizes;
+	const auto record = [&batchSizes](const std::vector<std::shared_ptr<Message>>& batch) { batchSizes.push_back(batch.size()); };
+
+	// Held back until at least 50 have come
+	MessageBatchCallback::Window bySize;
+	bySize.messages = 50;
+	int id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>(record, nullptr, bySize));
+	for(size_t i = 0; i < 7; i++) {
+		auto stream = MakeStream(1);
+		com->handleInput(*com->packetizer, stream);
+	}
+	EXPECT_EQ(batchSizes, std::vector<size_t>({ perRead * 4 }));
+	EXPECT_TRUE(com->removeMessageBatchCallback(id)); // The three reads held back are handed over
+	EXPECT_EQ(batchSizes, std::vector<size_t>({ perRead * 4, perRead * 3 }));
+
+	// Held back until the delay is up, which it isn't before the callback goes
+	batchSizes.clear();
+	MessageBatchCallback::Window byTime;
+	byTime.maxDelay = std::chrono::seconds(30);
+	id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>(record, nullptr, byTime));
+	for(size_t i = 0; i < 2; i++) {
+		auto stream = MakeStream(1);
+		com->handleInput(*com->packetizer, stream);
+	}
+	EXPECT_TRUE(batchSizes.empty());
+	EXPECT_TRUE(com->removeMessageBatchCallback(id));
+	EXPECT_EQ(batchSizes, std::vector<size_t>({ perRead * 2 }));
+}
+
+TEST_F(CommunicationTest, MessageBatchWindowClosesWithoutAnotherRead)
+{
+	std::mutex mutex;
+	std::condition_variable delivered;
+	std::vector<size_t> batchSizes;
+	MessageBatchCallback::Window window;
+	window.messages = 1000;
+	window.maxDelay = std::chrono::milliseconds(20);
+	const int id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>([&](const std::vector<std::shared_ptr<Message>>& batch) {
+		std::lock_guard<std::mutex> lk(mutex);
+		batchSizes.push_back(batch.size());
+		delivered.notify_all();
+	}, nullptr, window));
+
+	auto stream = MakeStream(1);
+	com->handleInput(*com->packetizer, stream);
+	{
+		std::unique_lock<std::mutex> lk(mutex);
+		ASSERT_TRUE(delivered.wait_for(lk, std::chrono::seconds(5), [&]() { return !batchSizes.empty(); }));
+		EXPECT_EQ(batchSizes, std::vector<size_t>({ CANNetworks().size() }));
+	}
+	EXPECT_TRUE(com->removeMessageBatchCallback(id));
+	EXPECT_EQ(batchSizes.size(), 1u);
+}
+
+TEST_F(CommunicationTest, MessageBatchFlushedOnClose)
+{
+	std::vector<size_t> batchSizes;
+	MessageBatchCallback::Window window;
+	window.messages = 1000;
+	const int id = com->addMessageBatchCallback(std::make_shared<MessageBatchCallback>([&batchSizes](const std::vector<std::shared_ptr<Message>>& batch) {
+		batchSizes.push_back(batch.size());
+	}, nullptr, window));
+
+	auto stream = MakeStream(2);
+	com->handleInput(*com->packetizer, stream);
+	EXPECT_TRUE(batchSizes.empty());
+	com->close();
+	EXPECT_EQ(batchSizes, std::vector<size_t>({ CANNetworks().size() * 2 }));
+	EXPECT_TRUE(com->removeMessageBatchCallback(id));
+	EXPECT_EQ(batchSizes.size(), 1u);
+}
@@ -0,0 +1,100 @@
+#ifndef __COMMUNICATIONTEST_H_
+#define __COMMUNICATIONTEST_H_
+
+#include "icsneo/communication/communication.h"
+#include "icsneo/communication/packet/canpacket.h"
+#include "gtest/gtest.h"
+
+using namespace icsneo;
+
+class NullDriver : public Driver {
+public:
+	NullDriver() : Driver([](APIEvent::Type, APIEvent::Severity) {}) {}
+	bool open() override { return true; }
+	bool isOpen() override { return true; }
+	bool close() override { return true; }
+
+private:
+	void readTask() override {}
+	void writeTask() override {}
+};
+
+// Hands reads straight to handleInput(), as the read thread would
+class InputCommunication : public Communication {
+public:
+	using Communication::Communication;
+	using Communication::handleInput;
+};
+
+class CommunicationTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		const device_eventhandler_t report = [](APIEvent::Type, APIEvent::Severity) {};
+		com = std::make_unique<InputCommunication>(report, std::make_unique<NullDriver>(),
+			[report]() { return std::make_unique<Packetizer>(report); },
+			std::make_unique<Encoder>(report), std::make_unique<Decoder>(report));
+		com->packetizer = com->makeConfiguredPacketizer(); // As the device would
+	}
+
+	// Every CAN network of a FIRE 3
+	static const std::vector<Network::NetID>& CANNetworks() {
+		static const std::vector<Network::NetID> netids = {
+			Network::NetID::HSCAN, Network::NetID::MSCAN, Network::NetID::HSCAN2, Network::NetID::HSCAN3,
+			Network::NetID::HSCAN4, Network::NetID::HSCAN5, Network::NetID::HSCAN6, Network::NetID::HSCAN7,
+			Network::NetID::DWCAN9, Network::NetID::DWCAN10, Network::NetID::DWCAN11, Network::NetID::DWCAN12,
+			Network::NetID::DWCAN13, Network::NetID::DWCAN14, Network::NetID::DWCAN15, Network::NetID::DWCAN16
+		};
+		return netids;
+	}
+
+	static void AppendCANPacket(std::vector<uint8_t>& stream, Network::NetID netid, uint32_t arbid) {
+		std::vector<uint8_t> packet(sizeof(HardwareCANPacket));
+		HardwareCANPacket* can = reinterpret_cast<HardwareCANPacket*>(packet.data());
+		can->header.SID = arbid & 0x7FF;
+		can->dlc.DLC = 8;
+		for(uint8_t i = 0; i < 8; i++)
+			can->data[i] = i;
+		const size_t length = packet.size() + 6;
+		stream.insert(stream.end(), { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(neonetid_t(netid)), uint8_t(neonetid_t(netid) >> 8) });
+		stream.insert(stream.end(), packet.begin(), packet.end());
+	}
+
+	// A CAN FD frame with 64 bytes, the ones past 8 follow the packet along with a netid and length
+	static void AppendCANFDPacket(std::vector<uint8_t>& stream, Network::NetID netid, uint32_t arbid) {
+		std::vector<uint8_t> packet(sizeof(HardwareCANPacket) + 2 + 2 + 56);
+		HardwareCANPacket* can = reinterpret_cast<HardwareCANPacket*>(packet.data());
+		can->header.IDE = 1;
+		can->header.SID = arbid >> 18;
+		can->eid.EID = (arbid >> 6) & 0xFFF;
+		can->dlc.EID2 = arbid & 0x3F;
+		can->header.EDL = 1;
+		can->header.BRS = 1;
+		can->timestamp.IsExtended = 1;
+		can->timestamp.TS = 1000;
+		can->dlc.DLC = 0xF;
+		for(uint8_t i = 0; i < 8; i++)
+			can->data[i] = i;
+		for(uint8_t i = 8; i < 64; i++)
+			packet[sizeof(HardwareCANPacket) + 4 + i - 8] = i;
+		const size_t length = packet.size() + 6;
+		stream.insert(stream.end(), { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(neonetid_t(netid)), uint8_t(neonetid_t(netid) >> 8) });
+		stream.insert(stream.end(), packet.begin(), packet.end());
+	}
+
+	// A frame on every CAN network in turn
+	static std::vector<uint8_t> MakeStream(size_t rounds) {
+		std::vector<uint8_t> stream;
+		for(size_t round = 0; round < rounds; round++) {
+			for(const auto netid : CANNetworks())
+				AppendCANPacket(stream, netid, uint32_t(round));
+		}
+		return stream;
+	}
+
+	// Every CAN message which is decoded comes from the pool, so this counts them
+	uint64_t decodedCAN() const { return com->decoder->canPool.hits() + com->decoder->canPool.misses(); }
+
+	std::unique_ptr<InputCommunication> com;
+};
+
+#endif
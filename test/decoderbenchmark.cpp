@@ -0,0 +1,55 @@
+#include "decodertest.h"
+#include "icsneo/communication/message/filter/messagefilter.h"
+#include <chrono>
+#include <string>
+
+class DecoderBenchmark : public DecoderTest {};
+
+TEST_F(DecoderBenchmark, Throughput)
+{
+	// A busy CAN bus with the odd status in between, as the packetizer hands it to us
+	static constexpr size_t Count = 300000;
+	const auto frame = CANFrame(0x7E0);
+	const std::vector<neonetid_t> netids = {
+		neonetid_t(Network::NetID::HSCAN), neonetid_t(Network::NetID::HSCAN2), neonetid_t(Network::NetID::DWCAN9),
+		neonetid_t(Network::NetID::MSCAN), neonetid_t(Network::NetID::HSCAN), neonetid_t(Network::NetID::DeviceStatus)
+	};
+	const MessageFilter filter(Network::NetID::HSCAN);
+	auto packet = std::make_shared<Packet>();
+	std::shared_ptr<Message> msg;
+	size_t matched = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < Count; i++) {
+		packet->network = Network(netids[i % netids.size()], false);
+		packet->data = frame;
+		ASSERT_TRUE(decoder.decode(msg, packet));
+		if(filter.match(msg))
+			matched++;
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	EXPECT_EQ(matched, Count / 3);
+	RecordProperty("NanosecondsPerPacket", std::to_string(elapsed / Count));
+}
+
+TEST_F(DecoderBenchmark, NetIDLookupThroughput)
+{
+	// What the packetizer does to each packet before the decoder sees it
+	static constexpr size_t Count = 1000000;
+	std::vector<neonetid_t> netids;
+	for(neonetid_t netid = 0; netid < 600; netid++)
+		netids.push_back(netid);
+	size_t can = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < Count; i++) {
+		const Network network(netids[i % netids.size()]);
+		if(network.getType() == Network::Type::CAN)
+			can++;
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	EXPECT_GT(can, 0u);
+	RecordProperty("NanosecondsPerLookup", std::to_string(double(elapsed) / Count));
+}
@@ -0,0 +1,36 @@
+#include "decodertest.h"
+#include "icsneo/communication/message/main51message.h"
+
+TEST_F(DecoderTest, DispatchesOnNetID)
+{
+	std::shared_ptr<Message> msg;
+	ASSERT_TRUE(decoder.decode(msg, MakePacket(neonetid_t(Network::NetID::HSCAN2), CANFrame(0x123))));
+	ASSERT_EQ(msg->type, Message::Type::Frame);
+	EXPECT_EQ(std::static_pointer_cast<CANMessage>(msg)->arbid, 0x123u);
+	EXPECT_EQ(std::static_pointer_cast<CANMessage>(msg)->network.getNetID(), Network::NetID::HSCAN2);
+
+	ASSERT_TRUE(decoder.decode(msg, MakePacket(neonetid_t(Network::NetID::Main51), { 0x42, 0x01, 0x02 })));
+	ASSERT_EQ(msg->type, Message::Type::Main51);
+	EXPECT_EQ(std::static_pointer_cast<Main51Message>(msg)->data, std::vector<uint8_t>({ 0x01, 0x02 }));
+
+	// Networks without a decoder of their own come out raw
+	ASSERT_TRUE(decoder.decode(msg, MakePacket(neonetid_t(Network::NetID::J1708), { 0x01, 0x02 })));
+	ASSERT_EQ(msg->type, Message::Type::RawMessage);
+	EXPECT_EQ(std::static_pointer_cast<RawMessage>(msg)->network.getNetID(), Network::NetID::J1708);
+	EXPECT_EQ(std::static_pointer_cast<RawMessage>(msg)->data, std::vector<uint8_t>({ 0x01, 0x02 }));
+
+	// As do internal networks which are passed along to the device as they are
+	ASSERT_TRUE(decoder.decode(msg, MakePacket(neonetid_t(Network::NetID::DeviceStatus), { 0x05 })));
+	EXPECT_EQ(msg->type, Message::Type::RawMessage);
+}
+
+TEST_F(DecoderTest, NetIDTypesMatchTheSwitch)
+{
+	// The table is only a cache of TypeOfCommonNetID, whether or not VNET IDs are expanded
+	for(uint32_t i = 0; i <= 0xFFFF; i++) {
+		const auto netid = Network::NetID(i);
+		ASSERT_EQ(Network::GetTypeOfNetID(netid, false), Network::TypeOfCommonNetID(netid)) << i;
+		ASSERT_EQ(Network::GetTypeOfNetID(netid, true), Network::TypeOfCommonNetID(Network::GetVnetAgnosticNetid(neonetid_t(i)).second)) << i;
+	}
+	static_assert(Network::MakeTypeTables()[true][neonetid_t(Network::NetID::HSCAN)] == Network::Type::CAN, "Built at compile time");
+}
@@ -0,0 +1,33 @@
+#ifndef __DECODERTEST_H_
+#define __DECODERTEST_H_
+
+#include "icsneo/communication/decoder.h"
+#include "icsneo/communication/packet/canpacket.h"
+#include "gtest/gtest.h"
+
+using namespace icsneo;
+
+class DecoderTest : public ::testing::Test {
+protected:
+	static std::vector<uint8_t> CANFrame(uint32_t arbid) {
+		std::vector<uint8_t> data(sizeof(HardwareCANPacket));
+		HardwareCANPacket* can = reinterpret_cast<HardwareCANPacket*>(data.data());
+		can->header.SID = arbid & 0x7FF;
+		can->dlc.DLC = 8;
+		for(uint8_t i = 0; i < 8; i++)
+			can->data[i] = i;
+		return data;
+	}
+
+	// What the packetizer hands over for a long format packet
+	static std::shared_ptr<Packet> MakePacket(neonetid_t netid, const std::vector<uint8_t>& data) {
+		auto packet = std::make_shared<Packet>();
+		packet->network = Network(netid, false);
+		packet->data = data;
+		return packet;
+	}
+
+	Decoder decoder{[](APIEvent::Type, APIEvent::Severity) {}};
+};
+
+#endif
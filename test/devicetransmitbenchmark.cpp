@@ -0,0 +1,35 @@
+#include "devicetransmittest.h"
+#include <algorithm>
+#include <ctime>
+#include <string>
+
+class DeviceTransmitBenchmark : public DeviceTransmitTest {
+protected:
+	// How many of `frames` go out each second, one transmit() per frame or all of them through transmitBatch()
+	static uint64_t FramesPerSecond(const std::vector<std::shared_ptr<Frame>>& frames, bool batched) {
+		static constexpr size_t Rounds = 200;
+		LoopbackDevice device;
+		device.driver->keepWritten = false;
+		const std::clock_t start = std::clock();
+		for(size_t round = 0; round < Rounds; round++) {
+			if(batched) {
+				EXPECT_EQ(device.transmitBatch(frames), frames.size());
+			} else {
+				for(const auto& frame : frames)
+					EXPECT_TRUE(device.transmit(frame));
+			}
+		}
+		const std::clock_t elapsed = std::max<std::clock_t>(std::clock() - start, 1);
+		return uint64_t(Rounds * frames.size()) * CLOCKS_PER_SEC / uint64_t(elapsed);
+	}
+};
+
+TEST_F(DeviceTransmitBenchmark, Throughput)
+{
+	const auto classic = CANFrames(256, 8);
+	const auto fd = CANFrames(256, 64);
+	RecordProperty("CANFramesPerSecondEach", std::to_string(FramesPerSecond(classic, false)));
+	RecordProperty("CANFramesPerSecondBatched", std::to_string(FramesPerSecond(classic, true)));
+	RecordProperty("CANFDFramesPerSecondEach", std::to_string(FramesPerSecond(fd, false)));
+	RecordProperty("CANFDFramesPerSecondBatched", std::to_string(FramesPerSecond(fd, true)));
+}
@@ -0,0 +1,125 @@
+#include "devicetransmittest.h"
+#include "icsneo/device/extensions/deviceextension.h"
+#include "icsneo/communication/message/ethernetmessage.h"
+#include <cstdint>
+
+TEST_F(DeviceTransmitTest, BatchIsOneWriteOfEachFrameInOrder)
+{
+	const auto frames = CANFrames(100, 8);
+
+	LoopbackDevice individually;
+	for(const auto& frame : frames)
+		ASSERT_TRUE(individually.transmit(frame));
+	EXPECT_EQ(individually.driver->writes, frames.size());
+
+	LoopbackDevice batched;
+	EXPECT_EQ(batched.transmitBatch(frames), frames.size());
+	EXPECT_EQ(batched.driver->writes, 1u);
+	EXPECT_EQ(batched.driver->written, individually.driver->written);
+}
+
+TEST_F(DeviceTransmitTest, BatchStopsAtTheFirstFrameWhichCantBeSent)
+{
+	auto frames = CANFrames(10, 8);
+	auto eth = std::make_shared<EthernetMessage>();
+	eth->network = Network::NetID::Ethernet; // Not one of the device's TX networks
+	frames.insert(frames.begin() + 4, eth);
+
+	LoopbackDevice device;
+	EXPECT_EQ(device.transmitBatch(frames), 4u);
+	EXPECT_EQ(device.driver->writes, 1u);
+	EXPECT_FALSE(device.transmit(frames));
+
+	const auto sentAlone = CANFrames(4, 8);
+	LoopbackDevice reference;
+	for(const auto& frame : sentAlone)
+		ASSERT_TRUE(reference.transmit(frame));
+	EXPECT_EQ(std::vector<uint8_t>(device.driver->written.begin(), device.driver->written.begin() + reference.driver->written.size()),
+		reference.driver->written);
+}
+
+TEST_F(DeviceTransmitTest, LargeBatchIsSplitIntoFewWrites)
+{
+	const auto frames = CANFrames(2000, 64);
+
+	LoopbackDevice device;
+	EXPECT_EQ(device.transmitBatch(frames), frames.size());
+	EXPECT_GT(device.driver->writes, 1u);
+	EXPECT_LE(device.driver->writes, device.driver->written.size() / Device::TransmitBatchMaxBytes + 1);
+}
+
+TEST_F(DeviceTransmitTest, FailedWriteIsToldApartFromAFrameWhichCantBeSent)
+{
+	auto frames = CANFrames(10, 8);
+	auto eth = std::make_shared<EthernetMessage>();
+	eth->network = Network::NetID::Ethernet;
+	frames.insert(frames.begin() + 4, eth);
+
+	LoopbackDevice rejecting;
+	bool writeFailed = true;
+	EXPECT_EQ(rejecting.transmitBatch(frames, &writeFailed), 4u);
+	EXPECT_FALSE(writeFailed);
+
+	LoopbackDevice failing;
+	failing.driver->failAfter = 0;
+	EXPECT_EQ(failing.transmitBatch(frames, &writeFailed), 0u);
+	EXPECT_TRUE(writeFailed);
+
+	// A write which fails part way stops the batch there, the frames in the writes before it were accepted
+	LoopbackDevice failingLater;
+	failingLater.driver->failAfter = 1;
+	const auto large = CANFrames(2000, 64);
+	const size_t accepted = failingLater.transmitBatch(large, &writeFailed);
+	EXPECT_GT(accepted, 0u);
+	EXPECT_LT(accepted, large.size());
+	EXPECT_TRUE(writeFailed);
+	EXPECT_EQ(failingLater.driver->writes, 1u);
+}
+
+// Sends HSCAN frames with arbid 0x555 itself, writing a marker in their place
+class MarkerExtension : public DeviceExtension {
+public:
+	static constexpr uint8_t Marker[4] = { 0xDE, 0xAD, 0xBE, 0xEF };
+	MarkerExtension(Device& device) : DeviceExtension(device) {}
+	const char* getName() const override { return "Marker"; }
+	bool hooksTransmit(const Frame& frame) const override { return static_cast<const CANMessage&>(frame).arbid == 0x555; }
+	bool transmitHook(const std::shared_ptr<Frame>& frame, bool& success) override {
+		if(!hooksTransmit(*frame))
+			return true;
+		success = device.com->rawWrite(std::vector<uint8_t>(std::begin(Marker), std::end(Marker)));
+		return false;
+	}
+};
+
+TEST_F(DeviceTransmitTest, BatchGoesOutBeforeAnExtensionSends)
+{
+	auto frames = CANFrames(4, 8);
+	auto hooked = std::make_shared<CANMessage>();
+	hooked->network = Network::NetID::HSCAN;
+	hooked->arbid = 0x555;
+	frames.insert(frames.begin() + 2, hooked);
+
+	LoopbackDevice device;
+	device.addExtension(std::make_shared<MarkerExtension>(device));
+	EXPECT_EQ(device.transmitBatch(frames), frames.size());
+	EXPECT_EQ(device.driver->writes, 3u);
+
+	LoopbackDevice reference;
+	for(const auto& frame : { frames[0], frames[1] })
+		ASSERT_TRUE(reference.transmit(frame));
+	std::vector<uint8_t> expected = reference.driver->written;
+	expected.insert(expected.end(), std::begin(MarkerExtension::Marker), std::end(MarkerExtension::Marker));
+	reference.driver->written.clear();
+	for(const auto& frame : { frames[3], frames[4] })
+		ASSERT_TRUE(reference.transmit(frame));
+	expected.insert(expected.end(), reference.driver->written.begin(), reference.driver->written.end());
+	EXPECT_EQ(device.driver->written, expected);
+}
+
+TEST_F(DeviceTransmitTest, BatchOnClosedDeviceAcceptsNothing)
+{
+	LoopbackDevice device;
+	device.unplug();
+	EXPECT_EQ(device.transmitBatch(CANFrames(10, 8)), 0u);
+	EXPECT_EQ(device.driver->writes, 0u);
+}
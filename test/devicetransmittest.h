@@ -0,0 +1,93 @@
+#ifndef __DEVICETRANSMITTEST_H_
+#define __DEVICETRANSMITTEST_H_
+
+#include "icsneo/device/device.h"
+#include "icsneo/communication/message/canmessage.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <mutex>
+
+using namespace icsneo;
+
+// Takes each write as soon as it is made, as if the device were on the other end of a loopback
+class LoopbackDriver : public Driver {
+public:
+	LoopbackDriver(const device_eventhandler_t& report) : Driver(report) {}
+	bool open() override { opened = true; return true; }
+	bool isOpen() override { return opened; }
+	bool close() override { opened = false; return true; }
+
+	size_t writes = 0;
+	std::vector<uint8_t> written;
+	bool keepWritten = true; // Off for benchmarking, so only the count is kept
+	size_t failAfter = SIZE_MAX; // How many writes succeed before the rest fail
+
+private:
+	bool opened = false;
+	void readTask() override {}
+	void writeTask() override {}
+	bool writeInternal(WriteOperation&& op) override {
+		std::lock_guard<std::mutex> lk(mutex);
+		if(writes >= failAfter)
+			return false;
+		writes++;
+		if(keepWritten)
+			written.insert(written.end(), op.bytes.begin(), op.bytes.end());
+		return true;
+	}
+	std::mutex mutex;
+};
+
+// A CAN FD capable device which can transmit on HSCAN and is already online
+class LoopbackDevice : public Device {
+public:
+	LoopbackDevice() : Device(neodevice_t{}) {
+		initialize([this](device_eventhandler_t report, neodevice_t&) {
+			auto loopback = std::make_unique<LoopbackDriver>(report);
+			driver = loopback.get();
+			return loopback;
+		});
+		com->open();
+		online = true;
+	}
+	~LoopbackDevice() {
+		unplug();
+	}
+
+	void unplug() {
+		online = false;
+		if(com->isOpen())
+			com->close();
+	}
+
+	LoopbackDriver* driver = nullptr;
+
+protected:
+	void setupEncoder(Encoder& encoder) override { encoder.supportCANFD = true; }
+	void setupSupportedRXNetworks(std::vector<Network>& rxNetworks) override { rxNetworks.emplace_back(Network::NetID::HSCAN); }
+	void setupSupportedTXNetworks(std::vector<Network>& txNetworks) override { txNetworks.emplace_back(Network::NetID::HSCAN); }
+};
+
+class DeviceTransmitTest : public ::testing::Test {
+protected:
+	void TearDown() override {
+		EventManager::GetInstance().discard();
+	}
+
+	static std::vector<std::shared_ptr<Frame>> CANFrames(size_t count, size_t length) {
+		std::vector<std::shared_ptr<Frame>> frames;
+		for(size_t i = 0; i < count; i++) {
+			auto can = std::make_shared<CANMessage>();
+			can->network = Network::NetID::HSCAN;
+			can->arbid = uint32_t(0x100 + (i & 0x3FF));
+			can->isCANFD = length > 8;
+			can->data.resize(length);
+			for(size_t j = 0; j < length; j++)
+				can->data[j] = uint8_t(i + j);
+			frames.push_back(can);
+		}
+		return frames;
+	}
+};
+
+#endif
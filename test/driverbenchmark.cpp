@@ -0,0 +1,50 @@
+#include "drivertest.h"
+#include <chrono>
+#include <thread>
+
+/**
+ * Streams the same bytes through the read queue the way the old FTDI read loop did (8 bytes at a time)
+ * and the way bulk reads do (one USB transfer's worth at a time) so the per-enqueue overhead can be compared.
+ */
+TEST(DriverBenchmark, BulkReadThroughput) {
+	constexpr size_t StreamLength = 1024 * 1024;
+	std::vector<uint8_t> stream(StreamLength);
+	for(size_t i = 0; i < stream.size(); i++)
+		stream[i] = uint8_t(i * 31);
+
+	const auto run = [&stream](size_t readSize, size_t& chunks) {
+		MockReadDriver driver;
+		std::vector<uint8_t> received;
+		received.reserve(stream.size());
+		chunks = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+		std::thread producer([&]() {
+			for(size_t offset = 0; offset < stream.size(); offset += readSize)
+				driver.pushReadBytes(stream.data() + offset, std::min(readSize, stream.size() - offset));
+		});
+		std::vector<uint8_t> chunk;
+		while(received.size() < stream.size()) {
+			if(!driver.readChunkWait(chunk))
+				break;
+			chunks++;
+			received.insert(received.end(), chunk.begin(), chunk.end());
+			driver.releaseReadBuffer(std::move(chunk));
+			chunk.clear();
+		}
+		producer.join();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+
+		EXPECT_EQ(received, stream);
+		return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+	};
+
+	size_t byteChunks, bulkChunks;
+	const auto byteTime = run(8, byteChunks);
+	const auto bulkTime = run(16384, bulkChunks);
+	RecordProperty("EightByteReadsMicroseconds", std::to_string(byteTime));
+	RecordProperty("BulkReadsMicroseconds", std::to_string(bulkTime));
+
+	EXPECT_EQ(byteChunks, StreamLength / 8);
+	EXPECT_EQ(bulkChunks, StreamLength / 16384);
+}
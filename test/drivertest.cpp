@@ -0,0 +1,222 @@
+#include "drivertest.h"
+#include <atomic>
+#include <thread>
+
+using namespace icsneo;
+
+TEST(DriverTest, ChunksArriveInOrder) {
+	MockReadDriver driver;
+	driver.receive({ 1, 2, 3 });
+	const uint8_t more[] = { 4, 5 };
+	driver.pushReadBytes(more, sizeof(more));
+
+	std::vector<uint8_t> chunk;
+	ASSERT_TRUE(driver.readChunkWait(chunk, std::chrono::milliseconds(0)));
+	EXPECT_EQ(chunk, std::vector<uint8_t>({ 1, 2, 3 }));
+	driver.releaseReadBuffer(std::move(chunk));
+	chunk.clear();
+
+	ASSERT_TRUE(driver.readChunkWait(chunk, std::chrono::milliseconds(0)));
+	EXPECT_EQ(chunk, std::vector<uint8_t>({ 4, 5 }));
+	driver.releaseReadBuffer(std::move(chunk));
+	chunk.clear();
+
+	EXPECT_FALSE(driver.readChunkWait(chunk, std::chrono::milliseconds(0)));
+	EXPECT_EQ(driver.pooledBuffers(), 2u);
+}
+
+TEST(DriverTest, EmptyBuffersAreNotQueued) {
+	MockReadDriver driver;
+	driver.receive({});
+	driver.pushReadBytes(nullptr, 0);
+
+	std::vector<uint8_t> chunk;
+	EXPECT_FALSE(driver.readChunkWait(chunk, std::chrono::milliseconds(0)));
+}
+
+TEST(DriverTest, ReadLimitSpansChunks) {
+	MockReadDriver driver;
+	driver.receive({ 1, 2, 3 });
+	driver.receive({ 4, 5, 6 });
+
+	std::vector<uint8_t> bytes;
+	ASSERT_TRUE(driver.readWait(bytes, std::chrono::milliseconds(0), 4));
+	EXPECT_EQ(bytes, std::vector<uint8_t>({ 1, 2, 3, 4 }));
+
+	// The rest of the partially read chunk must come out first
+	std::vector<uint8_t> chunk;
+	ASSERT_TRUE(driver.readChunkWait(chunk, std::chrono::milliseconds(0)));
+	EXPECT_EQ(chunk, std::vector<uint8_t>({ 5, 6 }));
+
+	driver.receive({ 7 });
+	driver.receive({ 8, 9 });
+	ASSERT_TRUE(driver.read(bytes));
+	EXPECT_EQ(bytes, std::vector<uint8_t>({ 7, 8, 9 }));
+	EXPECT_FALSE(driver.readWait(bytes, std::chrono::milliseconds(0)));
+}
+
+TEST(DriverTest, CloseClearsQueue) {
+	MockReadDriver driver;
+	driver.receive({ 1, 2, 3 });
+	driver.receive({ 4, 5, 6 });
+
+	std::vector<uint8_t> bytes;
+	ASSERT_TRUE(driver.readWait(bytes, std::chrono::milliseconds(0), 1));
+	driver.close();
+	EXPECT_FALSE(driver.readWait(bytes, std::chrono::milliseconds(0)));
+	EXPECT_FALSE(driver.readChunkWait(bytes, std::chrono::milliseconds(0)));
+}
+
+TEST(DriverTest, WriteBatching) {
+	MockReadDriver driver;
+	driver.writeBatchMaxBytes = 8;
+	ASSERT_TRUE(driver.write({ 1, 2, 3 }));
+	ASSERT_TRUE(driver.write({ 4, 5, 6 }));
+	ASSERT_TRUE(driver.write({ 7, 8, 9 }));
+	ASSERT_TRUE(driver.write({ 10 }));
+
+	const auto flatten = [](const MockReadDriver::WriteBatch& batch) {
+		std::vector<uint8_t> ret;
+		batch.forEachRemaining([&ret](const uint8_t* data, size_t length) {
+			ret.insert(ret.end(), data, data + length);
+			return true;
+		});
+		return ret;
+	};
+
+	// The third write would take us over the limit, so it waits for the next batch
+	MockReadDriver::WriteBatch batch;
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+	EXPECT_EQ(batch.operations.size(), 2u);
+	EXPECT_EQ(batch.bytes, 6u);
+	EXPECT_EQ(flatten(batch), std::vector<uint8_t>({ 1, 2, 3, 4, 5, 6 }));
+
+	// A partial write picks up where it left off
+	batch.consume(4);
+	EXPECT_FALSE(batch.empty());
+	EXPECT_EQ(flatten(batch), std::vector<uint8_t>({ 5, 6 }));
+	batch.consume(2);
+	EXPECT_TRUE(batch.empty());
+
+	MockReadDriver::WriteOperation writeOp;
+	ASSERT_TRUE(driver.dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(0)));
+	EXPECT_EQ(writeOp.bytes, std::vector<uint8_t>({ 7, 8, 9, 10 }));
+	EXPECT_FALSE(driver.dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(0)));
+}
+
+TEST(DriverTest, WriteBatchLatency) {
+	MockReadDriver driver;
+	driver.writeBatchMaxLatency = std::chrono::milliseconds(100);
+	ASSERT_TRUE(driver.write({ 1 }));
+
+	std::thread producer([&driver]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		driver.write({ 2 });
+	});
+
+	// We hold the batch open for the second write
+	MockReadDriver::WriteBatch batch;
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+	producer.join();
+	EXPECT_EQ(batch.operations.size(), 2u);
+
+	// Unless we were asked not to
+	ASSERT_TRUE(driver.write({ 3 }));
+	batch.clear();
+	const auto start = std::chrono::steady_clock::now();
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0), false));
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+	EXPECT_EQ(batch.operations.size(), 1u);
+}
+
+TEST(DriverTest, ClearWriteQueueDropsHeldWrite) {
+	MockReadDriver driver;
+	driver.writeBatchMaxBytes = 2;
+	ASSERT_TRUE(driver.write({ 1, 2 }));
+	ASSERT_TRUE(driver.write({ 3, 4 }));
+
+	MockReadDriver::WriteBatch batch;
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+	EXPECT_EQ(batch.bytes, 2u);
+	driver.clearWriteQueue();
+	batch.clear();
+	EXPECT_FALSE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+}
+
+TEST(DriverTest, AsyncWriteCompletion) {
+	MockReadDriver driver;
+	std::vector<std::pair<int, bool>> completions;
+	for(int i = 0; i < 3; i++) {
+		ASSERT_TRUE(driver.writeAsync({ uint8_t(i), uint8_t(i) }, [&completions, i](bool success) {
+			completions.emplace_back(i, success);
+		}));
+	}
+
+	// Nothing completes until the bytes are actually written
+	MockReadDriver::WriteBatch batch;
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+	EXPECT_TRUE(completions.empty());
+
+	batch.consume(3);
+	ASSERT_EQ(completions.size(), 1u);
+	EXPECT_EQ(completions[0], std::make_pair(0, true));
+
+	// The partially written operation is dropped along with the rest
+	batch.clear();
+	ASSERT_EQ(completions.size(), 3u);
+	EXPECT_EQ(completions[1], std::make_pair(1, false));
+	EXPECT_EQ(completions[2], std::make_pair(2, false));
+}
+
+TEST(DriverTest, AsyncWriteCoalesced) {
+	MockReadDriver driver;
+	int succeeded = 0;
+	ASSERT_TRUE(driver.writeAsync({ 1 }, [&succeeded](bool success) { succeeded += success; }));
+	ASSERT_TRUE(driver.write({ 2 }));
+	ASSERT_TRUE(driver.writeAsync({ 3 }, [&succeeded](bool success) { succeeded += success; }));
+
+	MockReadDriver::WriteOperation writeOp;
+	ASSERT_TRUE(driver.dequeueCoalescedWrite(writeOp, std::chrono::milliseconds(0)));
+	EXPECT_EQ(writeOp.bytes, std::vector<uint8_t>({ 1, 2, 3 }));
+	EXPECT_EQ(succeeded, 0);
+	writeOp.complete(true);
+	writeOp.complete(true);
+	EXPECT_EQ(succeeded, 2);
+
+	// Writes thrown away when closing complete as failed
+	bool dropped = false;
+	ASSERT_TRUE(driver.writeAsync({ 4 }, [&dropped](bool success) { dropped = !success; }));
+	driver.clearWriteQueue();
+	EXPECT_TRUE(dropped);
+}
+
+TEST(DriverTest, AsyncWriteDoesNotBlock) {
+	MockReadDriver driver;
+	driver.writeQueueSize = 2;
+	for(int i = 0; i < 3; i++)
+		ASSERT_TRUE(driver.writeAsync({ 1 }, [](bool) {}));
+	EXPECT_FALSE(driver.writeAsync({ 1 }, [](bool) {}));
+	driver.clearWriteQueue();
+}
+
+TEST(DriverTest, BlockedWriteWokenByWriteTask) {
+	MockReadDriver driver;
+	driver.writeQueueSize = 4;
+	for(int i = 0; i < 5; i++)
+		ASSERT_TRUE(driver.write({ 1 }));
+
+	// The next write has to wait for the queue to drain
+	std::atomic<bool> written{false};
+	std::thread producer([&]() {
+		driver.write({ 2 });
+		written = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_FALSE(written);
+
+	driver.writeBatchMaxBytes = 3;
+	MockReadDriver::WriteBatch batch;
+	ASSERT_TRUE(driver.dequeueWriteBatch(batch, std::chrono::milliseconds(0)));
+	producer.join();
+	EXPECT_TRUE(written);
+}
@@ -0,0 +1,34 @@
+#ifndef __DRIVERTEST_H_
+#define __DRIVERTEST_H_
+
+#include "icsneo/communication/driver.h"
+#include "gtest/gtest.h"
+
+using namespace icsneo;
+
+class MockReadDriver : public Driver {
+public:
+	MockReadDriver() : Driver([](APIEvent::Type, APIEvent::Severity) {}) {}
+	bool open() override { return true; }
+	bool isOpen() override { return true; }
+	bool close() override { clearReadQueue(); return true; }
+
+	void receive(const std::vector<uint8_t>& bytes) {
+		auto buffer = acquireReadBuffer(bytes.size());
+		std::copy(bytes.begin(), bytes.end(), buffer.begin());
+		pushReadBuffer(std::move(buffer));
+	}
+	using Driver::pushReadBytes;
+	using Driver::WriteBatch;
+	using Driver::WriteOperation;
+	using Driver::dequeueWriteBatch;
+	using Driver::dequeueCoalescedWrite;
+	using Driver::clearWriteQueue;
+	size_t pooledBuffers() { return readBufferPool.size_approx(); }
+
+private:
+	void readTask() override {}
+	void writeTask() override {}
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "ethernetpacketizertest.h"
+#include <chrono>
+#include <string>
+
+class EthernetPacketizerBenchmark : public EthernetPacketizerTest {};
+
+TEST_F(EthernetPacketizerBenchmark, Throughput)
+{
+	// Build a capture's worth of full single-piece frames from the device
+	static constexpr size_t FrameCount = 20000;
+	std::vector<uint8_t> frame({
+		0x12, 0x23, 0x34, 0x45, 0x56, 0x67,
+		0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		0xca, 0xb2,
+		0xaa, 0xaa, 0x55, 0x55,
+		0xd2, 0x05, // 1490 bytes
+		0x00, 0x00, // packet number
+		0x03, 0x01, // first and last piece, version 1
+	});
+	frame.resize(1490 + 24, 0x5a);
+
+	size_t received = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < FrameCount; i++) {
+		const uint8_t* payload;
+		size_t payloadLength;
+		if(packetizer->inputUp(frame.data(), frame.size(), payload, payloadLength))
+			received += payloadLength;
+	}
+	const auto up = std::chrono::steady_clock::now() - start;
+	EXPECT_EQ(received, FrameCount * 1490);
+
+	// And the same amount back down, in writes the size of a typical CAN message
+	const std::vector<uint8_t> write(24, 0xa5);
+	size_t sent = 0;
+	const auto downStart = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < FrameCount * 1490 / write.size(); i++) {
+		packetizer->inputDown(write.data(), write.size());
+		if(i % 64 == 63) {
+			const uint8_t* out;
+			size_t length;
+			while(packetizer->outputDown(out, length))
+				sent += length - 24;
+		}
+	}
+	const auto down = std::chrono::steady_clock::now() - downStart;
+	EXPECT_EQ(sent, FrameCount * 1490 / write.size() / 64 * 64 * write.size());
+
+	RecordProperty("UpMicroseconds", std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(up).count()));
+	RecordProperty("DownMicroseconds", std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(down).count()));
+}
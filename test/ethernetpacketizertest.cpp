@@ -1,36 +1,7 @@
-#include "icsneo/communication/ethernetpacketizer.h"
-#include "gtest/gtest.h"
-#include <optional>
+#include "ethernetpacketizertest.h"
 
 using namespace icsneo;
 
-#define MAC_SIZE (6)
-static const uint8_t correctDeviceMAC[MAC_SIZE] = {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
-static const uint8_t correctHostMAC[MAC_SIZE] = {0x12, 0x23, 0x34, 0x45, 0x56, 0x67};
-
-class EthernetPacketizerTest : public ::testing::Test {
-protected:
-	// Start with a clean instance of the packetizer for every test
-	void SetUp() override {
-		onError = [](APIEvent::Type, APIEvent::Severity) {
-			// Unless caught by the test, the packetizer should not throw errors
-			EXPECT_TRUE(false);
-		};
-		packetizer.emplace([this](APIEvent::Type t, APIEvent::Severity s) {
-			onError(t, s);
-		});
-		memcpy(packetizer->deviceMAC, correctDeviceMAC, MAC_SIZE);
-		memcpy(packetizer->hostMAC, correctHostMAC, MAC_SIZE);
-	}
-
-	void TearDown() override {
-		packetizer.reset();
-	}
-
-	std::optional<EthernetPacketizer> packetizer;
-	device_eventhandler_t onError;
-};
-
 TEST_F(EthernetPacketizerTest, DownSmallSinglePacket)
 {
 	packetizer->inputDown({ 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99 });
@@ -250,4 +221,127 @@ TEST_F(EthernetPacketizerTest, PacketNumberIncrement)
 		0x03, 0x01, // first and last piece, version 1
 		0x13, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99
 	}));
-}
\ No newline at end of file
+}
+
+TEST_F(EthernetPacketizerTest, DownTakeFramesInPlace)
+{
+	packetizer->inputDown(std::vector<uint8_t>(3000, 0x42));
+	const uint8_t* frame;
+	size_t length;
+	ASSERT_TRUE(packetizer->outputDown(frame, length));
+	EXPECT_EQ(length, 1490u + 24);
+	EXPECT_EQ(frame[18], 0xd2); // 1490 bytes
+	EXPECT_EQ(frame[22], 0x01); // first piece
+
+	// The frame which has not been taken yet can still be packed into
+	const uint8_t small[] = { 0x11, 0x22 };
+	packetizer->inputDown(small, sizeof(small));
+	ASSERT_TRUE(packetizer->outputDown(frame, length));
+	EXPECT_EQ(frame[22], 0x00); // mid piece
+	ASSERT_TRUE(packetizer->outputDown(frame, length));
+	EXPECT_EQ(length, 22u + 24);
+	EXPECT_EQ(frame[18], 22); // 20 bytes left over, plus ours
+	EXPECT_EQ(frame[22], 0x02); // last piece
+	EXPECT_EQ(frame[length - 2], 0x11);
+	EXPECT_EQ(frame[length - 1], 0x22);
+	EXPECT_FALSE(packetizer->outputDown(frame, length));
+
+	// Once everything is taken the next write starts a new packet
+	packetizer->inputDown(small, sizeof(small));
+	ASSERT_TRUE(packetizer->outputDown(frame, length));
+	EXPECT_EQ(length, 2u + 24);
+	EXPECT_EQ(frame[20], 0x01); // packet number
+	EXPECT_EQ(frame[22], 0x03); // first and last piece
+	EXPECT_FALSE(packetizer->outputDown(frame, length));
+}
+
+TEST_F(EthernetPacketizerTest, UpSmallSinglePacket)
+{
+	const uint8_t frame[] = {
+		0x12, 0x23, 0x34, 0x45, 0x56, 0x67,
+		0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		0xca, 0xb2,
+		0xaa, 0xaa, 0x55, 0x55,
+		0x04, 0x00, // 4 bytes
+		0x00, 0x00, // packet number
+		0x03, 0x01, // first and last piece, version 1
+		0x11, 0x22, 0x33, 0x44,
+		0x00, 0x00 // Padding beyond the payload size is dropped
+	};
+	EXPECT_TRUE(packetizer->inputUp(frame, sizeof(frame)));
+	EXPECT_EQ(packetizer->outputUp(), std::vector<uint8_t>({ 0x11, 0x22, 0x33, 0x44 }));
+
+	// The same frame from another device is not for us
+	std::vector<uint8_t> other(frame, frame + sizeof(frame));
+	other[11] = 0x00;
+	EXPECT_FALSE(packetizer->inputUp(other));
+}
+
+TEST_F(EthernetPacketizerTest, UpTruncatedHeader)
+{
+	const uint8_t frame[] = {
+		0x12, 0x23, 0x34, 0x45, 0x56, 0x67,
+		0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		0xca, 0xb2,
+		0xaa, 0xaa, 0x55, 0x55
+	};
+	EXPECT_FALSE(packetizer->inputUp(frame, sizeof(frame)));
+	EXPECT_FALSE(packetizer->inputUp(std::vector<uint8_t>(frame, frame + sizeof(frame))));
+	EXPECT_TRUE(packetizer->outputUp().empty());
+}
+
+TEST_F(EthernetPacketizerTest, UpSinglePacketInPlace)
+{
+	const uint8_t frame[] = {
+		0x12, 0x23, 0x34, 0x45, 0x56, 0x67,
+		0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		0xca, 0xb2,
+		0xaa, 0xaa, 0x55, 0x55,
+		0x04, 0x00, // 4 bytes
+		0x00, 0x00, // packet number
+		0x03, 0x01, // first and last piece, version 1
+		0x11, 0x22, 0x33, 0x44,
+		0x00, 0x00
+	};
+	const uint8_t* payload = nullptr;
+	size_t payloadLength = 0;
+	ASSERT_TRUE(packetizer->inputUp(frame, sizeof(frame), payload, payloadLength));
+	EXPECT_EQ(payload, frame + 24); // Not copied
+	EXPECT_EQ(payloadLength, 4u);
+	EXPECT_TRUE(packetizer->outputUp().empty()); // Nothing was queued
+}
+
+TEST_F(EthernetPacketizerTest, UpReassembly)
+{
+	// Round trip a big write through the down side, turned around to look like it came from the device
+	std::vector<uint8_t> big(3000);
+	for(size_t i = 0; i < big.size(); i++)
+		big[i] = uint8_t(i);
+	packetizer->inputDown(big);
+	auto frames = packetizer->outputDown();
+	ASSERT_EQ(frames.size(), 3u);
+	for(auto& frame : frames) {
+		std::swap_ranges(frame.begin(), frame.begin() + 6, frame.begin() + 6);
+		frame[13] = 0xb2;
+	}
+
+	const uint8_t* payload;
+	size_t payloadLength;
+	EXPECT_FALSE(packetizer->inputUp(frames[0].data(), frames[0].size(), payload, payloadLength));
+	EXPECT_FALSE(packetizer->inputUp(frames[1].data(), frames[1].size(), payload, payloadLength));
+	ASSERT_TRUE(packetizer->inputUp(frames[2].data(), frames[2].size(), payload, payloadLength));
+	EXPECT_EQ(std::vector<uint8_t>(payload, payload + payloadLength), big);
+
+	// A piece out of sequence is dropped, along with what was being reassembled
+	EXPECT_FALSE(packetizer->inputUp(frames[0].data(), frames[0].size(), payload, payloadLength));
+	frames[2][20] = 0x05;
+	EXPECT_FALSE(packetizer->inputUp(frames[2].data(), frames[2].size(), payload, payloadLength));
+	frames[2][20] = 0x00;
+	EXPECT_FALSE(packetizer->inputUp(frames[2].data(), frames[2].size(), payload, payloadLength));
+
+	// The queueing API gives the same bytes
+	EXPECT_FALSE(packetizer->inputUp(frames[0]));
+	EXPECT_FALSE(packetizer->inputUp(frames[1]));
+	EXPECT_TRUE(packetizer->inputUp(frames[2]));
+	EXPECT_EQ(packetizer->outputUp(), big);
+}
@@ -0,0 +1,38 @@
+#ifndef __ETHERNETPACKETIZERTEST_H_
+#define __ETHERNETPACKETIZERTEST_H_
+
+#include "icsneo/communication/ethernetpacketizer.h"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <optional>
+
+using namespace icsneo;
+
+#define MAC_SIZE (6)
+static const uint8_t correctDeviceMAC[MAC_SIZE] = {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint8_t correctHostMAC[MAC_SIZE] = {0x12, 0x23, 0x34, 0x45, 0x56, 0x67};
+
+class EthernetPacketizerTest : public ::testing::Test {
+protected:
+	// Start with a clean instance of the packetizer for every test
+	void SetUp() override {
+		onError = [](APIEvent::Type, APIEvent::Severity) {
+			// Unless caught by the test, the packetizer should not throw errors
+			EXPECT_TRUE(false);
+		};
+		packetizer.emplace([this](APIEvent::Type t, APIEvent::Severity s) {
+			onError(t, s);
+		});
+		memcpy(packetizer->deviceMAC, correctDeviceMAC, MAC_SIZE);
+		memcpy(packetizer->hostMAC, correctHostMAC, MAC_SIZE);
+	}
+
+	void TearDown() override {
+		packetizer.reset();
+	}
+
+	std::optional<EthernetPacketizer> packetizer;
+	device_eventhandler_t onError;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "icsneo/platform/posix/ftdimodemstatus.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace icsneo;
+
+// What the chip sends for `data`, two status bytes then up to packetSize - 2 bytes of data per packet
+static std::vector<uint8_t> WithModemStatus(const std::vector<uint8_t>& data, size_t packetSize) {
+	std::vector<uint8_t> transfer;
+	for(size_t offset = 0; offset < data.size(); offset += packetSize - 2) {
+		transfer.insert(transfer.end(), { 0x31, 0x60 });
+		const size_t take = std::min(packetSize - 2, data.size() - offset);
+		transfer.insert(transfer.end(), data.begin() + offset, data.begin() + offset + take);
+	}
+	return transfer;
+}
+
+static std::vector<uint8_t> Counting(size_t length) {
+	std::vector<uint8_t> data(length);
+	for(size_t i = 0; i < length; i++)
+		data[i] = uint8_t(i * 7);
+	return data;
+}
+
+TEST(FTDIModemStatusTest, StripsEveryPacketAcrossBoundaries)
+{
+	static constexpr size_t PacketSize = 512;
+	for(size_t length : { size_t(1), size_t(509), size_t(510), size_t(511), size_t(1020), size_t(1021), size_t(16384 - 64) }) {
+		const auto data = Counting(length);
+		auto transfer = WithModemStatus(data, PacketSize);
+		const size_t stripped = StripFTDIModemStatus(transfer.data(), transfer.size(), PacketSize);
+		ASSERT_EQ(stripped, data.size()) << length;
+		EXPECT_EQ(std::vector<uint8_t>(transfer.begin(), transfer.begin() + stripped), data) << length;
+	}
+}
+
+TEST(FTDIModemStatusTest, StatusOnlyPacketsCarryNoData)
+{
+	std::vector<uint8_t> transfer = { 0x31, 0x60 };
+	EXPECT_EQ(StripFTDIModemStatus(transfer.data(), transfer.size(), 512), 0u);
+	EXPECT_EQ(StripFTDIModemStatus(transfer.data(), 0, 512), 0u);
+}
+
+TEST(FTDIModemStatusTest, PartialTransferKeepsWhatArrived)
+{
+	// A transfer which timed out part way through its third packet
+	static constexpr size_t PacketSize = 512;
+	const auto data = Counting(510 * 3);
+	auto transfer = WithModemStatus(data, PacketSize);
+	for(size_t actual : { size_t(512 * 2 + 2), size_t(512 * 2 + 3), size_t(512 * 2 + 100), size_t(512 + 1) }) {
+		auto partial = transfer;
+		const size_t stripped = StripFTDIModemStatus(partial.data(), actual, PacketSize);
+		const size_t packets = actual / PacketSize;
+		const size_t rest = actual % PacketSize;
+		const size_t expected = packets * (PacketSize - 2) + (rest > 2 ? rest - 2 : 0);
+		ASSERT_EQ(stripped, expected) << actual;
+		EXPECT_EQ(std::vector<uint8_t>(partial.begin(), partial.begin() + stripped),
+			std::vector<uint8_t>(data.begin(), data.begin() + expected)) << actual;
+	}
+}
@@ -0,0 +1,110 @@
+#include "icsneo/api/handletable.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace icsneo;
+
+TEST(HandleTableTest, StaleHandlesAreTurnedAway)
+{
+	HandleTable<std::string> table;
+	const auto first = table.add("first");
+	ASSERT_NE(first, 0u);
+	{
+		auto ref = table.acquire(first);
+		ASSERT_TRUE(ref);
+		EXPECT_EQ(*ref, "first");
+		EXPECT_EQ(ref->size(), 5u);
+	}
+
+	EXPECT_TRUE(table.remove(first));
+	EXPECT_FALSE(table.remove(first));
+	EXPECT_FALSE(table.acquire(first));
+
+	// The slot is reused, but the old handle doesn't get the new entry
+	const auto second = table.add("second");
+	EXPECT_NE(second, first);
+	EXPECT_EQ(second & (HandleTable<std::string>::MaxEntries - 1), first & (HandleTable<std::string>::MaxEntries - 1));
+	EXPECT_FALSE(table.acquire(first));
+	EXPECT_EQ(*table.acquire(second), "second");
+}
+
+TEST(HandleTableTest, MadeUpHandlesAreTurnedAway)
+{
+	HandleTable<int> table;
+	const auto handle = table.add(1);
+	EXPECT_FALSE(table.acquire(0));
+	EXPECT_FALSE(table.acquire(handle + 1)); // A slot which was never used
+	EXPECT_FALSE(table.acquire(handle + HandleTable<int>::MaxEntries)); // A generation the slot doesn't have
+	EXPECT_FALSE(table.acquire(~uintptr_t(0)));
+	EXPECT_FALSE(table.remove(handle + 1));
+	EXPECT_TRUE(table.acquire(handle));
+}
+
+TEST(HandleTableTest, FillsUpAndRemovesIf)
+{
+	HandleTable<size_t> table;
+	std::vector<HandleTable<size_t>::Handle> handles;
+	for(size_t i = 0; i < HandleTable<size_t>::MaxEntries; i++)
+		handles.push_back(table.add(i));
+	EXPECT_EQ(table.add(size_t(0)), 0u);
+
+	table.removeIf([](size_t value) { return value % 2 == 0; });
+	for(size_t i = 0; i < handles.size(); i++)
+		EXPECT_EQ(bool(table.acquire(handles[i])), i % 2 == 1);
+	EXPECT_NE(table.add(size_t(0)), 0u);
+}
+
+TEST(HandleTableTest, RemoveWaitsForRefs)
+{
+	HandleTable<std::shared_ptr<int>> table;
+	auto value = std::make_shared<int>(5);
+	const auto handle = table.add(value);
+	auto ref = table.acquire(handle);
+
+	std::atomic<bool> removed{false};
+	std::thread remover([&]() {
+		table.remove(handle);
+		removed = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_FALSE(removed);
+	EXPECT_FALSE(table.acquire(handle)); // Nobody new gets in while it waits
+	EXPECT_EQ(**ref, 5);
+	ref.reset();
+	remover.join();
+	EXPECT_TRUE(removed);
+	EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(HandleTableTest, ConcurrentLookupsAndRemovals)
+{
+	// Entries are only ever seen alive
+	HandleTable<std::unique_ptr<int>> table;
+	std::atomic<HandleTable<std::unique_ptr<int>>::Handle> current{table.add(std::make_unique<int>(0))};
+	std::atomic<bool> done{false};
+	std::atomic<uint64_t> found{0};
+	std::vector<std::thread> readers;
+	for(int i = 0; i < 3; i++) {
+		readers.emplace_back([&]() {
+			while(!done) {
+				if(auto ref = table.acquire(current.load())) {
+					EXPECT_GE(**ref, 0);
+					found++;
+				}
+			}
+		});
+	}
+	while(found == 0)
+		std::this_thread::yield();
+	for(int i = 1; i < 5000; i++) {
+		const auto old = current.load();
+		current = table.add(std::make_unique<int>(i));
+		EXPECT_TRUE(table.remove(old));
+	}
+	done = true;
+	for(auto& reader : readers)
+		reader.join();
+}
@@ -0,0 +1,139 @@
+#include "icsneo/platform/posix/linux/ioreactor.h"
+#include "gtest/gtest.h"
+#include <condition_variable>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace icsneo;
+
+class IOReactorTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+	}
+	void TearDown() override {
+		::close(fds[0]);
+		::close(fds[1]);
+		IOReactor::SetEnabled(false);
+	}
+
+	template<typename Predicate>
+	bool waitFor(Predicate pred) {
+		std::unique_lock<std::mutex> lk(mutex);
+		return cv.wait_for(lk, std::chrono::seconds(2), pred);
+	}
+
+	int fds[2];
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+TEST_F(IOReactorTest, DisabledByDefault) {
+	EXPECT_FALSE(IOReactor::IsEnabled());
+	EXPECT_EQ(IOReactor::Get(), nullptr);
+
+	IOReactor::SetEnabled(true, 2);
+	EXPECT_TRUE(IOReactor::IsEnabled());
+	auto first = IOReactor::Get();
+	auto second = IOReactor::Get();
+	ASSERT_NE(first, nullptr);
+	EXPECT_NE(first, second); // Drivers are spread over the reactor threads
+	EXPECT_EQ(IOReactor::Get(), first);
+
+	IOReactor::SetEnabled(false);
+	EXPECT_EQ(IOReactor::Get(), nullptr);
+	EXPECT_TRUE(first->isValid()); // Still usable by the drivers which hold it
+}
+
+TEST_F(IOReactorTest, ReadableAndNotified) {
+	IOReactor reactor;
+	ASSERT_TRUE(reactor.isValid());
+
+	std::vector<uint8_t> received;
+	int notifications = 0;
+	ASSERT_TRUE(reactor.add(fds[0], IOReactor::Readable, [&](uint32_t events) {
+		EXPECT_TRUE(reactor.isReactorThread());
+		std::lock_guard<std::mutex> lk(mutex);
+		if(events & IOReactor::Readable) {
+			uint8_t buf[64];
+			ssize_t ret;
+			while((ret = ::read(fds[0], buf, sizeof(buf))) > 0)
+				received.insert(received.end(), buf, buf + ret);
+		}
+		if(events & IOReactor::Notified)
+			notifications++;
+		cv.notify_all();
+	}));
+	EXPECT_FALSE(reactor.add(fds[0], IOReactor::Readable, [](uint32_t) {}));
+
+	const uint8_t data[] = { 0xaa, 0x55, 0x01 };
+	ASSERT_EQ(::write(fds[1], data, sizeof(data)), ssize_t(sizeof(data)));
+	EXPECT_TRUE(waitFor([&] { return received.size() == sizeof(data); }));
+	EXPECT_EQ(received, std::vector<uint8_t>(data, data + sizeof(data)));
+
+	reactor.notify(fds[0]);
+	EXPECT_TRUE(waitFor([&] { return notifications == 1; }));
+
+	EXPECT_TRUE(reactor.remove(fds[0]));
+	EXPECT_FALSE(reactor.remove(fds[0]));
+}
+
+TEST_F(IOReactorTest, WritableInterest) {
+	IOReactor reactor;
+	bool writable = false;
+	ASSERT_TRUE(reactor.add(fds[0], IOReactor::Readable, [&](uint32_t events) {
+		std::lock_guard<std::mutex> lk(mutex);
+		if(events & IOReactor::Writable) {
+			writable = true;
+			reactor.modify(fds[0], IOReactor::Readable); // Stop asking or we'd be woken forever
+		}
+		cv.notify_all();
+	}));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_FALSE(writable);
+
+	ASSERT_TRUE(reactor.modify(fds[0], IOReactor::Readable | IOReactor::Writable));
+	EXPECT_TRUE(waitFor([&] { return writable; }));
+	reactor.remove(fds[0]);
+}
+
+TEST_F(IOReactorTest, RemoveWaitsForHandler) {
+	IOReactor reactor;
+	std::atomic<bool> inHandler{false};
+	std::atomic<bool> handlerDone{false};
+	ASSERT_TRUE(reactor.add(fds[0], IOReactor::Readable, [&](uint32_t) {
+		inHandler = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		uint8_t buf[16];
+		while(::read(fds[0], buf, sizeof(buf)) > 0) {}
+		handlerDone = true;
+	}));
+
+	const uint8_t data = 0x42;
+	ASSERT_EQ(::write(fds[1], &data, 1), 1);
+	while(!inHandler)
+		std::this_thread::yield();
+	EXPECT_TRUE(reactor.remove(fds[0]));
+	EXPECT_TRUE(handlerDone);
+}
+
+TEST_F(IOReactorTest, RemoveFromHandler) {
+	IOReactor reactor;
+	int calls = 0;
+	ASSERT_TRUE(reactor.add(fds[0], IOReactor::Readable, [&](uint32_t events) {
+		std::lock_guard<std::mutex> lk(mutex);
+		calls++;
+		EXPECT_TRUE(events & IOReactor::Readable);
+		// Like a driver finding its device gone, without draining the socket
+		EXPECT_TRUE(reactor.remove(fds[0]));
+		cv.notify_all();
+	}));
+
+	const uint8_t data = 0x42;
+	ASSERT_EQ(::write(fds[1], &data, 1), 1);
+	EXPECT_TRUE(waitFor([&] { return calls > 0; }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	std::lock_guard<std::mutex> lk(mutex);
+	EXPECT_EQ(calls, 1);
+}
@@ -0,0 +1,67 @@
+#include "iouringtest.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <pty.h>
+
+class IOURingBenchmark : public IOURingTest {};
+
+/**
+ * Loopback benchmark over a pty pair (the way a CDC ACM device looks) and a socket pair
+ * (standing in for localhost TCP), comparing the select() and read() loop with io_uring.
+ * Syscalls per MB and the first byte latency are recorded as test properties.
+ */
+TEST_F(IOURingBenchmark, Loopback) {
+	constexpr size_t StreamLength = 1024 * 1024;
+	const auto stream = MakeStream(StreamLength);
+
+	const auto bench = [&](const char* name, bool usePty) {
+		for(bool useIOURing : { false, true }) {
+			int readFD, writeFD;
+			int fds[2];
+			if(usePty) {
+				// We read the slave side like CDCACM reads its tty, the master stands in for the device
+				ASSERT_EQ(openpty(&fds[1], &fds[0], nullptr, nullptr, nullptr), 0);
+				struct termios tty = {};
+				tcgetattr(fds[0], &tty);
+				cfmakeraw(&tty);
+				tcsetattr(fds[0], TCSANOW, &tty);
+				fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+				fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+				readFD = fds[0];
+				writeFD = fds[1];
+			} else {
+				ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+				readFD = fds[0];
+				writeFD = fds[1];
+			}
+			// Latency for a single small write to arrive
+			const uint8_t ping = 0x42;
+			Result latencyResult;
+			const auto start = std::chrono::steady_clock::now();
+			std::thread pinger([&]() { WriteAll(writeFD, { ping }, 1); });
+			latencyResult = useIOURing ? ReadWithIOURing(readFD, !usePty, 1) : ReadWithSelect(readFD, 1);
+			const auto latency = std::chrono::steady_clock::now() - start;
+			pinger.join();
+			EXPECT_EQ(latencyResult.received, std::vector<uint8_t>({ ping }));
+
+			std::thread writer([&]() { WriteAll(writeFD, stream, 4096); });
+			const auto result = useIOURing ? ReadWithIOURing(readFD, !usePty, stream.size()) : ReadWithSelect(readFD, stream.size());
+			writer.join();
+			EXPECT_EQ(result.received, stream);
+
+			const std::string prefix = std::string(name) + (useIOURing ? "IOURing" : "Select");
+			RecordProperty(prefix + "SyscallsPerMB", std::to_string(result.syscalls * (1024 * 1024) / StreamLength));
+			RecordProperty(prefix + "LatencyMicroseconds", std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+
+			::close(fds[0]);
+			::close(fds[1]);
+		}
+	};
+
+	bench("Socket", false);
+	bench("PTY", true);
+}
@@ -0,0 +1,111 @@
+#include "iouringtest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sys/socket.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <pty.h>
+
+using namespace icsneo;
+
+TEST_F(IOURingTest, SocketStreamInOrder) {
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+	const auto stream = MakeStream(1024 * 1024);
+
+	std::thread writer([&]() { WriteAll(fds[1], stream, 1000); });
+	const auto result = ReadWithIOURing(fds[0], true, stream.size());
+	writer.join();
+	EXPECT_EQ(result.received, stream);
+
+	::close(fds[0]);
+	::close(fds[1]);
+}
+
+TEST_F(IOURingTest, ErrorStopsReading) {
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+	::close(fds[1]); // The peer going away reads as end of stream
+
+	IOURingReader reader(fds[0], true);
+	ASSERT_TRUE(reader.isValid());
+	int errors = 0;
+	reader.run([](const uint8_t*, size_t) {}, [&](int) {
+		errors++;
+		return false;
+	}, []() {
+		return false;
+	});
+	EXPECT_EQ(errors, 1);
+
+	::close(fds[0]);
+}
+
+TEST_F(IOURingTest, StopsWhenIdle) {
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+	std::atomic<bool> stop{false};
+	std::thread reader([&]() {
+		IOURingReader r(fds[0], true);
+		r.run([](const uint8_t*, size_t) {}, [](int) { return true; }, [&]() { return bool(stop); });
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	const auto start = std::chrono::steady_clock::now();
+	stop = true;
+	reader.join();
+	// We should notice within one wake interval
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+	::close(fds[0]);
+	::close(fds[1]);
+}
+
+TEST_F(IOURingTest, StopsWhenIdleOnNonBlockingPTY) {
+	// A non-blocking tty refuses to wait in a read, so the reader sits in its poll instead
+	int master, slave;
+	ASSERT_EQ(openpty(&master, &slave, nullptr, nullptr, nullptr), 0);
+	fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+
+	std::atomic<bool> stop{false};
+	std::atomic<bool> stopped{false};
+	std::thread reader([&]() {
+		IOURingReader r(slave, false);
+		r.run([](const uint8_t*, size_t) {}, [](int) { return true; }, [&]() { return bool(stop); });
+		stopped = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	stop = true;
+	for(int i = 0; i < 100 && !stopped; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_TRUE(stopped) << "The reader is stuck, something it queued was never cancelled";
+	if(!stopped) {
+		const uint8_t wake = 0;
+		EXPECT_EQ(::write(master, &wake, 1), 1); // Let its poll finish so the thread can be joined
+	}
+	reader.join();
+
+	::close(master);
+	::close(slave);
+}
+
+TEST_F(IOURingTest, PTYStreamInOrder) {
+	int master, slave;
+	ASSERT_EQ(openpty(&master, &slave, nullptr, nullptr, nullptr), 0);
+	struct termios tty = {};
+	tcgetattr(slave, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(slave, TCSANOW, &tty);
+	fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	const auto stream = MakeStream(256 * 1024);
+
+	std::thread writer([&]() { WriteAll(master, stream, 333); });
+	const auto result = ReadWithIOURing(slave, false, stream.size());
+	writer.join();
+	EXPECT_EQ(result.received, stream);
+
+	::close(master);
+	::close(slave);
+}
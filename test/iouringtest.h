@@ -0,0 +1,82 @@
+#ifndef __IOURINGTEST_H_
+#define __IOURINGTEST_H_
+
+#include "icsneo/platform/posix/linux/iouring.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <vector>
+#include <sys/select.h>
+#include <unistd.h>
+
+using namespace icsneo;
+
+class IOURingTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		if(!IOURing::IsSupported())
+			GTEST_SKIP() << "io_uring is not available on this kernel";
+	}
+
+	static std::vector<uint8_t> MakeStream(size_t length) {
+		std::vector<uint8_t> stream(length);
+		for(size_t i = 0; i < stream.size(); i++)
+			stream[i] = uint8_t(i * 7 + (i >> 8));
+		return stream;
+	}
+
+	static void WriteAll(int fd, const std::vector<uint8_t>& stream, size_t writeSize) {
+		size_t offset = 0;
+		while(offset < stream.size()) {
+			const ssize_t ret = ::write(fd, stream.data() + offset, std::min(writeSize, stream.size() - offset));
+			if(ret > 0) {
+				offset += size_t(ret);
+			} else {
+				fd_set wfds;
+				FD_ZERO(&wfds);
+				FD_SET(fd, &wfds);
+				struct timeval tv = { 0, 50000 };
+				::select(fd + 1, nullptr, &wfds, nullptr, &tv);
+			}
+		}
+	}
+
+	struct Result {
+		std::vector<uint8_t> received;
+		size_t syscalls = 0;
+	};
+
+	// What CDCACM::readTask and TCP::readTask do without io_uring
+	static Result ReadWithSelect(int fd, size_t expected) {
+		Result result;
+		uint8_t buf[2048];
+		while(result.received.size() < expected) {
+			fd_set rfds;
+			FD_ZERO(&rfds);
+			FD_SET(fd, &rfds);
+			struct timeval tv = { 0, 50000 };
+			::select(fd + 1, &rfds, nullptr, nullptr, &tv);
+			const ssize_t ret = ::read(fd, buf, sizeof(buf));
+			result.syscalls += 2;
+			if(ret > 0)
+				result.received.insert(result.received.end(), buf, buf + ret);
+		}
+		return result;
+	}
+
+	static Result ReadWithIOURing(int fd, bool isSocket, size_t expected) {
+		Result result;
+		IOURingReader reader(fd, isSocket);
+		EXPECT_TRUE(reader.isValid());
+		reader.run([&](const uint8_t* data, size_t length) {
+			result.received.insert(result.received.end(), data, data + length);
+		}, [](int) {
+			return true;
+		}, [&]() {
+			return result.received.size() >= expected;
+		});
+		result.syscalls = reader.syscalls();
+		return result;
+	}
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "icsneo/communication/messagering.h"
+#include "icsneo/communication/message/canmessage.h"
+#include "gtest/gtest.h"
+#include <ctime>
+#include <string>
+
+using namespace icsneo;
+
+static std::shared_ptr<Message> Numbered(uint32_t number) {
+	auto msg = std::make_shared<CANMessage>();
+	msg->arbid = number;
+	return msg;
+}
+
+TEST(MessageRingBenchmark, OverloadThroughput)
+{
+	// Nobody polling, so all but the last few thousand are dropped
+	static constexpr size_t Count = 2000000;
+	std::vector<std::shared_ptr<Message>> messages;
+	for(uint32_t i = 0; i < 64; i++)
+		messages.push_back(Numbered(i));
+
+	MessageRing ring(20000);
+	const std::clock_t start = std::clock();
+	for(size_t i = 0; i < Count; i++)
+		ring.push(messages[i % messages.size()]);
+	const uint64_t microseconds = uint64_t(std::clock() - start) * 1000000 / CLOCKS_PER_SEC;
+
+	EXPECT_EQ(ring.getDroppedCount(), Count - 20000);
+	RecordProperty("OverloadNanosecondsPerMessage", std::to_string(microseconds * 1000 / Count));
+}
@@ -0,0 +1,343 @@
+#include "icsneo/communication/messagering.h"
+#include "icsneo/communication/message/canmessage.h"
+#include "icsneo/communication/message/linmessage.h"
+#include "icsneo/communication/message/neomessagering.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <chrono>
+
+using namespace icsneo;
+
+static std::shared_ptr<Message> Numbered(uint32_t number) {
+	auto msg = std::make_shared<CANMessage>();
+	msg->arbid = number;
+	return msg;
+}
+
+static std::vector<uint32_t> Numbers(const std::vector<std::shared_ptr<Message>>& messages) {
+	std::vector<uint32_t> ret;
+	for(const auto& msg : messages)
+		ret.push_back(static_cast<const CANMessage&>(*msg).arbid);
+	return ret;
+}
+
+TEST(MessageRingTest, FirstInFirstOut)
+{
+	MessageRing ring(100);
+	for(uint32_t i = 0; i < 10; i++)
+		EXPECT_TRUE(ring.push(Numbered(i)));
+	EXPECT_EQ(ring.size(), 10u);
+
+	std::vector<std::shared_ptr<Message>> out = { Numbered(99) }; // Replaced, not appended to
+	EXPECT_EQ(ring.pop(out, 4), 4u);
+	EXPECT_EQ(Numbers(out), std::vector<uint32_t>({ 0, 1, 2, 3 }));
+	EXPECT_EQ(ring.pop(out), 6u);
+	EXPECT_EQ(Numbers(out), std::vector<uint32_t>({ 4, 5, 6, 7, 8, 9 }));
+	EXPECT_EQ(ring.pop(out), 0u);
+	EXPECT_TRUE(out.empty());
+	EXPECT_EQ(ring.getDroppedCount(), 0u);
+}
+
+TEST(MessageRingTest, DropsOldestOrNewest)
+{
+	std::vector<std::shared_ptr<Message>> out;
+
+	MessageRing oldest(4);
+	for(uint32_t i = 0; i < 10; i++)
+		EXPECT_TRUE(oldest.push(Numbered(i)));
+	EXPECT_EQ(oldest.getDroppedCount(), 6u);
+	oldest.pop(out);
+	EXPECT_EQ(Numbers(out), std::vector<uint32_t>({ 6, 7, 8, 9 }));
+
+	MessageRing newest(4, MessageRing::Overflow::DropNewest);
+	for(uint32_t i = 0; i < 10; i++)
+		EXPECT_EQ(newest.push(Numbered(i)), i < 4);
+	EXPECT_EQ(newest.getDroppedCount(), 6u);
+	newest.pop(out);
+	EXPECT_EQ(Numbers(out), std::vector<uint32_t>({ 0, 1, 2, 3 }));
+
+	MessageRing none(0);
+	EXPECT_FALSE(none.push(Numbered(0)));
+	EXPECT_EQ(none.getDroppedCount(), 1u);
+	EXPECT_EQ(none.size(), 0u);
+}
+
+TEST(MessageRingTest, GrowsTowardsTheLimit)
+{
+	// Wrap around a few times before growing, the order should survive it
+	MessageRing ring(5000);
+	std::vector<std::shared_ptr<Message>> out;
+	uint32_t next = 0;
+	for(int round = 0; round < 3; round++) {
+		for(int i = 0; i < 700; i++)
+			ring.push(Numbered(next++));
+		ring.pop(out, 500);
+	}
+	for(int i = 0; i < 4000; i++)
+		ring.push(Numbered(next++));
+	EXPECT_EQ(ring.size(), 4600u);
+	ring.pop(out);
+	ASSERT_EQ(out.size(), 4600u);
+	for(size_t i = 0; i < out.size(); i++)
+		EXPECT_EQ(static_cast<const CANMessage&>(*out[i]).arbid, 1500 + i);
+	EXPECT_EQ(ring.getDroppedCount(), 0u);
+}
+
+TEST(MessageRingTest, LoweringTheLimitDropsTheOldest)
+{
+	MessageRing ring(100);
+	for(uint32_t i = 0; i < 10; i++)
+		ring.push(Numbered(i));
+	ring.setLimit(3);
+	EXPECT_EQ(ring.size(), 3u);
+	EXPECT_EQ(ring.getDroppedCount(), 7u);
+	std::vector<std::shared_ptr<Message>> out;
+	ring.pop(out);
+	EXPECT_EQ(Numbers(out), std::vector<uint32_t>({ 7, 8, 9 }));
+
+	ring.push(Numbered(10));
+	ring.clear();
+	EXPECT_EQ(ring.size(), 0u);
+	EXPECT_EQ(ring.pop(out), 0u);
+	EXPECT_EQ(ring.getDroppedCount(), 7u);
+}
+
+TEST(MessageRingTest, PopWaitsForAPush)
+{
+	MessageRing ring(100);
+	std::vector<std::shared_ptr<Message>> out;
+	const auto start = std::chrono::steady_clock::now();
+	EXPECT_EQ(ring.pop(out, 0, std::chrono::milliseconds(20)), 0u);
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+	std::thread producer([&ring]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		ring.push(Numbered(1));
+	});
+	EXPECT_EQ(ring.pop(out, 0, std::chrono::seconds(10)), 1u);
+	producer.join();
+}
+
+TEST(MessageRingTest, ConcurrentProducerAndConsumers)
+{
+	// Every message is either taken once, in order, or counted as dropped
+	static constexpr uint32_t Count = 200000;
+	MessageRing ring(256);
+	std::atomic<bool> done{false};
+	std::atomic<uint64_t> taken{0};
+	const auto consume = [&]() {
+		std::vector<std::shared_ptr<Message>> out;
+		int64_t last = -1;
+		while(!done || ring.size() != 0) {
+			ring.pop(out, 64, std::chrono::milliseconds(1));
+			for(const auto& number : Numbers(out)) {
+				EXPECT_GT(int64_t(number), last);
+				last = number;
+			}
+			taken += out.size();
+		}
+	};
+	std::thread first(consume), second(consume);
+	for(uint32_t i = 0; i < Count; i++)
+		ring.push(Numbered(i));
+	done = true;
+	first.join();
+	second.join();
+	EXPECT_EQ(taken + ring.getDroppedCount(), Count);
+}
+
+static std::shared_ptr<Message> NumberedCAN(uint32_t number, size_t length = 8) {
+	auto msg = std::make_shared<CANMessage>();
+	msg->network = Network(Network::NetID::HSCAN);
+	msg->arbid = number;
+	msg->data.assign(length, uint8_t(number));
+	return msg;
+}
+
+TEST(NeoMessageRingTest, ReadsInPlace)
+{
+	NeoMessageRing ring(8, 1024);
+	std::vector<std::shared_ptr<Message>> messages = { NumberedCAN(1), NumberedCAN(2, 3), NumberedCAN(3, 0) };
+	EXPECT_EQ(ring.write(messages), 3u);
+	messages.clear(); // The ring holds its own copy of the data
+
+	size_t count = 0;
+	const neomessage_t* read = ring.read(count);
+	ASSERT_EQ(count, 3u);
+	for(size_t i = 0; i < count; i++) {
+		const neomessage_can_t& can = *(const neomessage_can_t*)&read[i];
+		EXPECT_EQ(can.arbid, i + 1);
+		EXPECT_EQ(can.netid, (neonetid_t)Network::NetID::HSCAN);
+		EXPECT_EQ(can.length, i == 0 ? 8u : (i == 1 ? 3u : 0u));
+		for(size_t j = 0; j < can.length; j++)
+			EXPECT_EQ(can.data[j], i + 1);
+	}
+
+	// Reading doesn't take them out, committing does
+	count = 1;
+	EXPECT_EQ(ring.read(count), read);
+	EXPECT_EQ(count, 1u);
+	ring.commit(1);
+	EXPECT_EQ(ring.size(), 2u);
+	ring.commit(100);
+	EXPECT_EQ(ring.size(), 0u);
+	count = 0;
+	ring.read(count);
+	EXPECT_EQ(count, 0u);
+}
+
+TEST(NeoMessageRingTest, LINDataKeepsItsOffset)
+{
+	auto lin = std::make_shared<LINMessage>();
+	lin->network = Network(Network::NetID::LIN);
+	lin->protectedID = 0x11;
+	lin->data = { 0xA0, 0xA1, 0xA2, 0xA3 };
+	const neomessage_t expected = CreateNeoMessage(lin);
+
+	NeoMessageRing ring(4, 64);
+	EXPECT_EQ(ring.write({ lin }), 1u);
+	size_t count = 0;
+	const neomessage_lin_t& read = *(const neomessage_lin_t*)ring.read(count);
+	ASSERT_EQ(count, 1u);
+	const neomessage_lin_t& original = *(const neomessage_lin_t*)&expected;
+	EXPECT_EQ(read.length, original.length);
+	EXPECT_EQ(read.header[1], 0xA0);
+	EXPECT_EQ(read.data[0], original.data[0]);
+	EXPECT_NE(read.data, original.data);
+}
+
+TEST(NeoMessageRingTest, WrapsAndDropsTheNewest)
+{
+	// Room for 4 messages, but only 3 payloads of 8
+	NeoMessageRing ring(4, 30);
+	std::vector<std::shared_ptr<Message>> messages;
+	for(uint32_t i = 0; i < 5; i++)
+		messages.push_back(NumberedCAN(i));
+	EXPECT_EQ(ring.write(messages), 3u);
+	EXPECT_EQ(ring.takeNewlyDropped(), 2u);
+	EXPECT_EQ(ring.takeNewlyDropped(), 0u);
+
+	// Committing two frees room for two more, the second of which wraps the payload back to the start
+	ring.commit(2);
+	messages = { NumberedCAN(10), NumberedCAN(11, 0), NumberedCAN(12), NumberedCAN(13) };
+	EXPECT_EQ(ring.write(messages), 3u);
+	EXPECT_EQ(ring.getDroppedCount(), 3u);
+
+	// The records wrap around the end of the ring too, so they come in two runs
+	std::vector<uint32_t> arbids;
+	std::vector<uint8_t> firstBytes;
+	while(true) {
+		size_t count = 0;
+		const neomessage_t* read = ring.read(count);
+		if(count == 0)
+			break;
+		for(size_t i = 0; i < count; i++) {
+			const neomessage_can_t& can = *(const neomessage_can_t*)&read[i];
+			arbids.push_back(can.arbid);
+			if(can.length)
+				firstBytes.push_back(can.data[0]);
+		}
+		ring.commit(count);
+	}
+	EXPECT_EQ(arbids, std::vector<uint32_t>({ 2, 10, 11, 12 }));
+	EXPECT_EQ(firstBytes, std::vector<uint8_t>({ 2, 10, 12 }));
+}
+
+TEST(NeoMessageRingTest, DropsOnlyAPayloadWhichDoesntFit)
+{
+	NeoMessageRing ring(8, 32);
+	const std::vector<std::shared_ptr<Message>> messages = { NumberedCAN(1), NumberedCAN(2, 64), NumberedCAN(3), NumberedCAN(4, 0) };
+	EXPECT_EQ(ring.write(messages), 3u);
+	EXPECT_EQ(ring.takeNewlyDropped(), 1u);
+
+	size_t count = 0;
+	const neomessage_t* read = ring.read(count);
+	std::vector<uint32_t> arbids;
+	for(size_t i = 0; i < count; i++)
+		arbids.push_back(((const neomessage_can_t*)&read[i])->arbid);
+	EXPECT_EQ(arbids, std::vector<uint32_t>({ 1, 3, 4 }));
+	EXPECT_EQ(((const neomessage_can_t*)&read[1])->data[0], 3);
+}
+
+static std::vector<uint32_t> ReadArbIDs(NeoMessageRing& ring) {
+	std::vector<uint32_t> arbids;
+	while(true) {
+		size_t count = 0;
+		const neomessage_t* read = ring.read(count);
+		if(count == 0)
+			break;
+		for(size_t i = 0; i < count; i++)
+			arbids.push_back(((const neomessage_can_t*)&read[i])->arbid);
+		ring.commit(count);
+	}
+	return arbids;
+}
+
+TEST(NeoMessageRingTest, DropOldestKeepsTheNewest)
+{
+	// Out of records first, then out of payload space
+	NeoMessageRing ring(4, 1024, NeoMessageRing::Overflow::DropOldest);
+	std::vector<std::shared_ptr<Message>> messages;
+	for(uint32_t i = 0; i < 6; i++)
+		messages.push_back(NumberedCAN(i));
+	EXPECT_EQ(ring.write(messages), 6u);
+	EXPECT_EQ(ring.takeNewlyDropped(), 2u);
+	EXPECT_EQ(ReadArbIDs(ring), std::vector<uint32_t>({ 2, 3, 4, 5 }));
+
+	NeoMessageRing small(8, 20, NeoMessageRing::Overflow::DropOldest);
+	EXPECT_EQ(small.write({ NumberedCAN(1), NumberedCAN(2), NumberedCAN(3), NumberedCAN(4, 0), NumberedCAN(5) }), 5u);
+	EXPECT_EQ(small.getDroppedCount(), 2u);
+	EXPECT_EQ(ReadArbIDs(small), std::vector<uint32_t>({ 3, 4, 5 }));
+}
+
+TEST(NeoMessageRingTest, DropOldestLeavesWhatIsBeingRead)
+{
+	NeoMessageRing ring(4, 1024, NeoMessageRing::Overflow::DropOldest);
+	ring.write({ NumberedCAN(1), NumberedCAN(2), NumberedCAN(3), NumberedCAN(4) });
+	size_t count = 2;
+	const neomessage_t* read = ring.read(count);
+	ASSERT_EQ(count, 2u);
+
+	// The two being read stay put until they're committed, so the newest are dropped meanwhile
+	EXPECT_EQ(ring.write({ NumberedCAN(5) }), 0u);
+	EXPECT_EQ(((const neomessage_can_t*)&read[0])->arbid, 1u);
+	ring.commit(count);
+	EXPECT_EQ(ring.write({ NumberedCAN(6), NumberedCAN(7), NumberedCAN(8) }), 3u);
+	EXPECT_EQ(ring.getDroppedCount(), 2u);
+	EXPECT_EQ(ReadArbIDs(ring), std::vector<uint32_t>({ 4, 6, 7, 8 }));
+}
+
+TEST(NeoMessageRingTest, ConcurrentWriterAndReader)
+{
+	static constexpr uint32_t Count = 100000;
+	NeoMessageRing ring(256, 1024);
+	std::atomic<bool> done{false};
+	uint64_t taken = 0;
+	std::thread reader([&]() {
+		int64_t last = -1;
+		while(!done || ring.size() != 0) {
+			size_t count = 0;
+			const neomessage_t* read = ring.read(count);
+			for(size_t i = 0; i < count; i++) {
+				const neomessage_can_t& can = *(const neomessage_can_t*)&read[i];
+				EXPECT_GT(int64_t(can.arbid), last);
+				last = can.arbid;
+				for(size_t j = 0; j < can.length; j++)
+					ASSERT_EQ(can.data[j], uint8_t(can.arbid));
+			}
+			ring.commit(count);
+			taken += count;
+		}
+	});
+	std::vector<std::shared_ptr<Message>> batch;
+	for(uint32_t i = 0; i < Count; i++) {
+		batch.push_back(NumberedCAN(i, i % 65));
+		if(batch.size() == 16) {
+			ring.write(batch);
+			batch.clear();
+		}
+	}
+	done = true;
+	reader.join();
+	EXPECT_EQ(taken + ring.getDroppedCount(), Count);
+}
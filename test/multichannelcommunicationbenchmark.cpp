@@ -0,0 +1,71 @@
+#include "multichannelcommunicationtest.h"
+#include <algorithm>
+#include <string>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+class MultiChannelCommunicationBenchmark : public MultiChannelCommunicationTest {};
+
+#ifndef _WIN32
+// Voluntary and involuntary, for every thread in the process
+static long ContextSwitches() {
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+#endif
+
+TEST_P(MultiChannelCommunicationBenchmark, Throughput)
+{
+	// There is no recording of a real device in the tree, so replay a synthesized one of the same shape
+	std::vector<uint8_t> stream;
+	uint16_t perVnet[3] = {};
+	const size_t total = MakeStream(stream, 20000, perVnet);
+
+#ifndef _WIN32
+	const long switchesBefore = ContextSwitches();
+#endif
+	const auto start = std::chrono::steady_clock::now();
+	replay(stream, { 16384 });
+	ASSERT_TRUE(waitForMessages(total, std::chrono::seconds(60)));
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	RecordProperty("MegabytesPerSecond", std::to_string(elapsed ? stream.size() / elapsed : 0));
+	RecordProperty("MessagesPerSecond", std::to_string(elapsed ? total * 1000000 / elapsed : 0));
+#ifndef _WIN32
+	RecordProperty("ContextSwitches", std::to_string(ContextSwitches() - switchesBefore));
+#endif
+}
+
+TEST_P(MultiChannelCommunicationBenchmark, LightLoadLatency)
+{
+	// A frame at a time, spread across the VNETs, the way a quiet bus trickles in
+	static constexpr size_t Frames = 300;
+	static const CommandType vnetCommands[] = { CommandType::Vnet1_to_HostPC, CommandType::Vnet2_to_HostPC, CommandType::Vnet3_to_HostPC };
+	std::vector<int64_t> latencies;
+#ifndef _WIN32
+	const long switchesBefore = ContextSwitches();
+#endif
+	for(size_t i = 0; i < Frames; i++) {
+		std::vector<uint8_t> command;
+		AppendCommand(command, vnetCommands[i % 3], CANPacket(i % 3, uint16_t(i / 3)));
+		const auto sent = std::chrono::steady_clock::now();
+		driver->pushReadBytes(command.data(), command.size());
+		ASSERT_TRUE(waitForMessages(i + 1, std::chrono::seconds(1)));
+		std::lock_guard<std::mutex> lk(receivedMutex);
+		latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(lastReceived - sent).count());
+	}
+#ifndef _WIN32
+	const long switches = ContextSwitches() - switchesBefore;
+#endif
+
+	std::sort(latencies.begin(), latencies.end());
+	RecordProperty("MedianLatencyMicroseconds", std::to_string(latencies[latencies.size() / 2]));
+	RecordProperty("P99LatencyMicroseconds", std::to_string(latencies[latencies.size() * 99 / 100]));
+#ifndef _WIN32
+	RecordProperty("ContextSwitchesPerFrame", std::to_string(double(switches) / Frames));
+#endif
+}
+
+INSTANTIATE_TEST_SUITE_P(VnetExecution, MultiChannelCommunicationBenchmark, EveryVnetExecution, VnetExecutionName);
@@ -0,0 +1,46 @@
+#include "multichannelcommunicationtest.h"
+
+using namespace icsneo;
+
+TEST_P(MultiChannelCommunicationTest, DemuxesEveryVnet)
+{
+	std::vector<uint8_t> stream;
+	uint16_t perVnet[3] = {};
+	const size_t total = MakeStream(stream, 100, perVnet);
+
+	// Commands and packets straddle reads in every way, down to a byte at a time
+	replay(stream, { 1, 2, 3, 7, 64, 509, 1, 4096 });
+	ASSERT_TRUE(waitForMessages(total));
+
+	std::lock_guard<std::mutex> lk(receivedMutex);
+	for(size_t vnet = 0; vnet < 3; vnet++) {
+		SCOPED_TRACE(vnet);
+		ASSERT_EQ(received[vnet].size(), perVnet[vnet]);
+		for(size_t i = 0; i < perVnet[vnet]; i++)
+			EXPECT_EQ(received[vnet][i], i); // In order within each VNET
+	}
+	EXPECT_EQ(sdBytes, ((100 + 6) / 7) * 16);
+}
+
+INSTANTIATE_TEST_SUITE_P(VnetExecution, MultiChannelCommunicationTest, EveryVnetExecution, VnetExecutionName);
+
+TEST(MultiChannelCommunicationBatchTest, AppendedPacketsEachCarryTheirOwnHeader)
+{
+	const device_eventhandler_t report = [](APIEvent::Type, APIEvent::Severity) {};
+	MultiChannelCommunication com(report, std::make_unique<MockUSBDriver>(),
+		[report]() { return std::make_unique<Packetizer>(report); },
+		std::make_unique<Encoder>(report), std::make_unique<Decoder>(report), 1);
+
+	std::vector<uint8_t> first = { 0xAA, 0x01, 0x02 };
+	std::vector<uint8_t> second(300, 0x55);
+	std::vector<uint8_t> batch;
+	com.appendPacket(batch, first);
+	com.appendPacket(batch, second);
+
+	std::vector<uint8_t> expected;
+	for(auto packet : { first, second }) {
+		com.sendPacket(packet); // Fails since the driver isn't open, but adds the header first
+		expected.insert(expected.end(), packet.begin(), packet.end());
+	}
+	EXPECT_EQ(batch, expected);
+}
@@ -0,0 +1,162 @@
+#ifndef __MULTICHANNELCOMMUNICATIONTEST_H_
+#define __MULTICHANNELCOMMUNICATIONTEST_H_
+
+#include "icsneo/communication/multichannelcommunication.h"
+#include "icsneo/communication/packetizer.h"
+#include "icsneo/communication/decoder.h"
+#include "icsneo/communication/packet/canpacket.h"
+#include "icsneo/communication/message/neoreadmemorysdmessage.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace icsneo;
+
+using CommandType = MultiChannelCommunication::CommandType;
+using VnetExecution = MultiChannelCommunication::VnetExecution;
+
+// Stands in for the USB driver, the test pushes what the device would have sent
+class MockUSBDriver : public Driver {
+public:
+	MockUSBDriver() : Driver([](APIEvent::Type, APIEvent::Severity) {}) {}
+	bool open() override { opened = true; return true; }
+	bool isOpen() override { return opened; }
+	bool close() override { opened = false; clearReadQueue(); return true; }
+	using Driver::pushReadBytes;
+
+private:
+	bool opened = false;
+	void readTask() override {}
+	void writeTask() override {}
+};
+
+class MultiChannelCommunicationTest : public ::testing::TestWithParam<VnetExecution> {
+protected:
+	void SetUp() override {
+		const device_eventhandler_t report = [](APIEvent::Type, APIEvent::Severity) {};
+		auto mock = std::make_unique<MockUSBDriver>();
+		driver = mock.get();
+		com = std::make_unique<MultiChannelCommunication>(report, std::move(mock),
+			[report]() { return std::make_unique<Packetizer>(report); },
+			std::make_unique<Encoder>(report), std::make_unique<Decoder>(report), 3);
+		com->packetizer = com->makeConfiguredPacketizer(); // As the device would
+		com->setVnetExecution(GetParam());
+		com->addMessageCallback(std::make_shared<MessageCallback>([this](std::shared_ptr<Message> message) {
+			if(const auto can = std::dynamic_pointer_cast<CANMessage>(message)) {
+				std::lock_guard<std::mutex> lk(receivedMutex);
+				received[can->arbid >> 16].push_back(can->arbid & 0xFFFF);
+				lastReceived = std::chrono::steady_clock::now();
+			}
+			messages++;
+		}));
+		com->addMessageCallback(std::make_shared<MessageCallback>([this](std::shared_ptr<Message> message) {
+			if(const auto sd = std::dynamic_pointer_cast<NeoReadMemorySDMessage>(message)) {
+				std::lock_guard<std::mutex> lk(receivedMutex);
+				sdBytes += sd->data.size();
+				messages++;
+			}
+		}, MessageFilter(Message::Type::RawMessage)));
+		ASSERT_TRUE(com->open());
+	}
+
+	void TearDown() override {
+		com->close();
+	}
+
+	// A CAN frame as one of the VNETs packetizes it, with the VNET and a sequence number in the arbitration ID
+	static std::vector<uint8_t> CANPacket(size_t vnet, uint16_t sequence) {
+		std::vector<uint8_t> packet(sizeof(HardwareCANPacket));
+		HardwareCANPacket* can = reinterpret_cast<HardwareCANPacket*>(packet.data());
+		const uint32_t arbid = uint32_t(vnet << 16) | sequence;
+		can->header.IDE = 1;
+		can->header.SID = arbid >> 18;
+		can->eid.EID = (arbid >> 6) & 0xFFF;
+		can->dlc.EID2 = arbid & 0x3F;
+		can->dlc.DLC = 8;
+		for(uint8_t i = 0; i < 8; i++)
+			can->data[i] = uint8_t(sequence + i);
+		const size_t length = packet.size() + 6;
+		packet.insert(packet.begin(), { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(Network::NetID::HSCAN), 0x00 });
+		return packet;
+	}
+
+	static void AppendCommand(std::vector<uint8_t>& stream, CommandType type, const std::vector<uint8_t>& payload) {
+		stream.push_back(uint8_t(type));
+		stream.push_back(uint8_t(payload.size()));
+		stream.push_back(uint8_t(payload.size() >> 8));
+		stream.insert(stream.end(), payload.begin(), payload.end());
+	}
+
+	/**
+	 * What a busy three VNET device sends, each VNET's traffic in commands
+	 * holding a few packets, along with the odd Plasma status and SD read.
+	 * Returns how many messages it holds in all.
+	 */
+	static size_t MakeStream(std::vector<uint8_t>& stream, size_t rounds, uint16_t (&sequence)[3]) {
+		static const CommandType vnetCommands[] = { CommandType::Vnet1_to_HostPC, CommandType::Vnet2_to_HostPC, CommandType::Vnet3_to_HostPC };
+		stream = { 0x00, 0x01 }; // Garbage before the first command is dropped quietly
+		size_t messages = 0;
+		for(size_t round = 0; round < rounds; round++) {
+			for(size_t vnet = 0; vnet < 3; vnet++) {
+				std::vector<uint8_t> payload;
+				for(size_t i = 0; i < 1 + (round + vnet) % 3; i++) {
+					const auto packet = CANPacket(vnet, sequence[vnet]++);
+					messages++;
+					payload.insert(payload.end(), packet.begin(), packet.end());
+				}
+				AppendCommand(stream, vnetCommands[vnet], payload);
+			}
+			if(round % 5 == 0)
+				stream.insert(stream.end(), { uint8_t(CommandType::PlasmaStatusResponse), 0x12, 0x34 });
+			if(round % 7 == 0) {
+				AppendCommand(stream, CommandType::SDCC1_to_HostPC, std::vector<uint8_t>(16, 0xEE));
+				messages++;
+			}
+		}
+		return messages;
+	}
+
+	// Feed the stream in reads of the given sizes, cycling through them
+	void replay(const std::vector<uint8_t>& stream, const std::vector<size_t>& readSizes) {
+		size_t offset = 0;
+		for(size_t i = 0; offset < stream.size(); i++) {
+			const size_t length = std::min(readSizes[i % readSizes.size()], stream.size() - offset);
+			driver->pushReadBytes(stream.data() + offset, length);
+			offset += length;
+		}
+	}
+
+	bool waitForMessages(size_t count, std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+		const auto end = std::chrono::steady_clock::now() + timeout;
+		while(messages < count) {
+			if(std::chrono::steady_clock::now() > end)
+				return false;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		return true;
+	}
+
+	MockUSBDriver* driver;
+	std::unique_ptr<MultiChannelCommunication> com;
+	std::atomic<size_t> messages{0};
+	std::mutex receivedMutex;
+	std::vector<uint16_t> received[3];
+	std::chrono::steady_clock::time_point lastReceived;
+	size_t sdBytes = 0;
+};
+
+static const auto EveryVnetExecution = ::testing::Values(VnetExecution::ThreadPerVnet, VnetExecution::Inline, VnetExecution::Pooled);
+
+static inline std::string VnetExecutionName(const ::testing::TestParamInfo<VnetExecution>& info) {
+	switch(info.param) {
+		case VnetExecution::ThreadPerVnet: return "ThreadPerVnet";
+		case VnetExecution::Inline: return "Inline";
+		case VnetExecution::Pooled: return "Pooled";
+	}
+	return "Unknown";
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "icsneo/communication/objectpool.h"
+#include "icsneo/communication/packetizer.h"
+#include "icsneo/communication/packet/canpacket.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace icsneo;
+
+TEST(ObjectPoolTest, RecyclesOnLastRelease)
+{
+	ObjectPool<CANMessage> pool;
+	CANMessage* first;
+	{
+		auto msg = pool.make();
+		first = msg.get();
+		msg->arbid = 0x123;
+		msg->isExtended = true;
+		msg->data = { 1, 2, 3, 4, 5, 6, 7, 8 };
+		auto copy = msg;
+		msg.reset();
+		EXPECT_EQ(pool.misses(), 1u); // Still held by the copy
+	}
+	EXPECT_EQ(pool.hits(), 0u);
+
+	auto msg = pool.make();
+	EXPECT_EQ(msg.get(), first);
+	EXPECT_EQ(pool.hits(), 1u);
+	EXPECT_EQ(pool.misses(), 1u);
+
+	// Back to a freshly constructed message, keeping the room for data
+	EXPECT_EQ(msg->type, Message::Type::Frame);
+	EXPECT_EQ(msg->arbid, 0u);
+	EXPECT_FALSE(msg->isExtended);
+	EXPECT_TRUE(msg->data.empty());
+	EXPECT_GE(msg->data.capacity(), 8u);
+}
+
+TEST(ObjectPoolTest, ObjectsOutliveThePool)
+{
+	std::shared_ptr<Packet> packet;
+	std::weak_ptr<Packet> watch;
+	{
+		ObjectPool<Packet> pool;
+		packet = pool.make();
+		packet->data.resize(100);
+		watch = packet;
+	}
+	EXPECT_EQ(packet->data.size(), 100u);
+	packet.reset();
+	EXPECT_TRUE(watch.expired());
+}
+
+TEST(ObjectPoolTest, ReleasedFromOtherThreads)
+{
+	ObjectPool<Packet> pool;
+	static constexpr size_t Count = 10000;
+	std::vector<std::shared_ptr<Packet>> held;
+	for(size_t round = 0; round < 4; round++) {
+		for(size_t i = 0; i < Count; i++)
+			held.push_back(pool.make());
+		std::thread releaser([&held]() { held.clear(); });
+		releaser.join();
+	}
+	EXPECT_EQ(pool.hits() + pool.misses(), 4 * Count);
+	EXPECT_GE(pool.hits(), 3 * ObjectPool<Packet>::DefaultMaxIdle);
+}
+
+TEST(ObjectPoolTest, MadeFromSeveralThreads)
+{
+	// Several VNET threads share a decoder, and so its pools
+	ObjectPool<CANMessage> pool;
+	static constexpr size_t Count = 20000;
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; t++) {
+		threads.emplace_back([&pool, t]() {
+			for(size_t i = 0; i < Count; i++) {
+				auto msg = pool.make();
+				EXPECT_TRUE(msg->data.empty());
+				msg->data.assign(8, uint8_t(t));
+				msg->arbid = uint32_t(i);
+				EXPECT_EQ(msg->data, std::vector<uint8_t>(8, uint8_t(t)));
+			}
+		});
+	}
+	for(auto& thread : threads)
+		thread.join();
+	EXPECT_EQ(pool.hits() + pool.misses(), 4 * Count);
+}
+
+TEST(ObjectPoolTest, ReceivePathUsesPools)
+{
+	Packetizer packetizer([](APIEvent::Type, APIEvent::Severity) {});
+	ObjectPool<CANMessage> canPool;
+
+	// A standard CAN frame from the device
+	std::vector<uint8_t> frame(sizeof(HardwareCANPacket));
+	HardwareCANPacket* can = reinterpret_cast<HardwareCANPacket*>(frame.data());
+	can->header.SID = 0x7E0;
+	can->dlc.DLC = 2;
+	can->data[0] = 0xAB;
+	can->data[1] = 0xCD;
+	const size_t length = frame.size() + 6;
+	frame.insert(frame.begin(), { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(Network::NetID::HSCAN), 0x00 });
+
+	for(int i = 0; i < 10; i++) {
+		ASSERT_TRUE(packetizer.input(frame));
+		for(const auto& packet : packetizer.output()) {
+			const auto msg = std::dynamic_pointer_cast<CANMessage>(HardwareCANPacket::DecodeToMessage(packet->data, &canPool));
+			ASSERT_NE(msg, nullptr);
+			EXPECT_EQ(msg->arbid, 0x7E0u);
+			EXPECT_EQ(msg->data, std::vector<uint8_t>({ 0xAB, 0xCD }));
+		}
+	}
+
+	// Everything was handed back before the next frame came in, so only the first allocated
+	EXPECT_EQ(packetizer.packetPool.misses(), 1u);
+	EXPECT_EQ(packetizer.packetPool.hits(), 9u);
+	EXPECT_EQ(canPool.misses(), 1u);
+	EXPECT_EQ(canPool.hits(), 9u);
+}
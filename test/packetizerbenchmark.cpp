@@ -0,0 +1,29 @@
+#include "packetizertest.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+class PacketizerBenchmark : public PacketizerTest {};
+
+TEST_F(PacketizerBenchmark, Throughput)
+{
+	// Roughly what a busy CAN device sends us, split into reads which don't line up with the packets
+	std::vector<uint8_t> stream;
+	const std::vector<uint8_t> message(40, 0x5A);
+	while(stream.size() < 16 * 1024 * 1024) {
+		const auto packet = LongPacket(Network::NetID::HSCAN, message);
+		stream.insert(stream.end(), packet.begin(), packet.end());
+	}
+	static constexpr size_t ReadSize = 16384 + 7;
+
+	size_t packets = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t offset = 0; offset < stream.size(); offset += ReadSize) {
+		if(packetizer->input(stream.data() + offset, std::min(ReadSize, stream.size() - offset)))
+			packets += packetizer->output().size();
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	EXPECT_EQ(packets, stream.size() / (message.size() + 6));
+	RecordProperty("MegabytesPerSecond", std::to_string(elapsed ? stream.size() / elapsed : 0));
+}
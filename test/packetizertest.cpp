@@ -0,0 +1,91 @@
+#include "packetizertest.h"
+
+using namespace icsneo;
+
+TEST_F(PacketizerTest, WholeStream)
+{
+	EXPECT_TRUE(packetizer->input(MixedStream()));
+	ExpectMixedStream(packetizer->output());
+	EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(PacketizerTest, SplitAnywhere)
+{
+	// Every packet straddles a chunk boundary at some point, the packets must come out the same
+	const auto stream = MixedStream();
+	for(size_t split = 0; split <= stream.size(); split++) {
+		SetUp();
+		std::vector<std::shared_ptr<Packet>> packets;
+		for(const auto& chunk : { std::vector<uint8_t>(stream.begin(), stream.begin() + split), std::vector<uint8_t>(stream.begin() + split, stream.end()) }) {
+			if(packetizer->input(chunk)) {
+				for(auto& packet : packetizer->output())
+					packets.push_back(std::move(packet));
+			}
+		}
+		SCOPED_TRACE(split);
+		ExpectMixedStream(packets);
+	}
+}
+
+TEST_F(PacketizerTest, ByteAtATime)
+{
+	std::vector<std::shared_ptr<Packet>> packets;
+	for(uint8_t byte : MixedStream()) {
+		if(packetizer->input(&byte, 1)) {
+			for(auto& packet : packetizer->output())
+				packets.push_back(std::move(packet));
+		}
+	}
+	ExpectMixedStream(packets);
+}
+
+TEST_F(PacketizerTest, BadChecksumResyncs)
+{
+	auto stream = ShortPacket(Network::NetID::HSCAN, { 0x11, 0x22 });
+	const auto good = ShortPacket(Network::NetID::HSCAN, { 0x33, 0x44 });
+	stream.insert(stream.end(), good.begin(), good.end());
+	stream[4]++; // Break the first checksum
+	auto bad = stream;
+	stream.insert(stream.end(), bad.begin(), bad.end());
+
+	ASSERT_TRUE(packetizer->input(stream));
+	const auto packets = packetizer->output();
+	ASSERT_EQ(packets.size(), 2u);
+	EXPECT_EQ(packets[0]->data, std::vector<uint8_t>({ 0x33, 0x44 }));
+	EXPECT_EQ(packets[1]->data, std::vector<uint8_t>({ 0x33, 0x44 }));
+
+	// Only complained about once we had seen a good packet
+	EXPECT_EQ(errors, std::vector<APIEvent::Type>({ APIEvent::Type::PacketChecksumError }));
+}
+
+TEST_F(PacketizerTest, LongFormatDiskDataDropsPadding)
+{
+	// The pad byte follows DiskData with an even length in every format, not just the 0xAA5555 one
+	auto stream = LongPacket(Network::NetID::DiskData, { 0x01, 0x02, 0x03, 0x04 });
+	// Padding, then garbage which would read as a short packet if the padding were taken for its header
+	stream.insert(stream.end(), { 0xAA, 0x12, 0x34, Packetizer::ICSChecksum({ 0x34 }) });
+	const auto odd = LongPacket(Network::NetID::DiskData, { 0x05, 0x06, 0x07 });
+	stream.insert(stream.end(), odd.begin(), odd.end());
+	const auto next = ShortPacket(Network::NetID::HSCAN, { 0x11, 0x22 });
+	stream.insert(stream.end(), next.begin(), next.end());
+
+	for(size_t split = 0; split <= stream.size(); split++) {
+		SetUp();
+		std::vector<std::shared_ptr<Packet>> packets;
+		for(const auto& chunk : { std::vector<uint8_t>(stream.begin(), stream.begin() + split), std::vector<uint8_t>(stream.begin() + split, stream.end()) }) {
+			if(packetizer->input(chunk)) {
+				for(auto& packet : packetizer->output())
+					packets.push_back(std::move(packet));
+			}
+		}
+		SCOPED_TRACE(split);
+		ASSERT_EQ(packets.size(), 3u);
+		EXPECT_EQ(packets[0]->network.getNetID(), Network::NetID::DiskData);
+		EXPECT_EQ(packets[0]->data, std::vector<uint8_t>({ 0x01, 0x02, 0x03, 0x04 }));
+		EXPECT_EQ(packets[1]->network.getNetID(), Network::NetID::DiskData);
+		EXPECT_EQ(packets[1]->data, std::vector<uint8_t>({ 0x05, 0x06, 0x07 }));
+		EXPECT_EQ(packets[2]->network.getNetID(), Network::NetID::HSCAN);
+		EXPECT_EQ(packets[2]->data, std::vector<uint8_t>({ 0x11, 0x22 }));
+		EXPECT_TRUE(errors.empty());
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef __PACKETIZERTEST_H_
+#define __PACKETIZERTEST_H_
+
+#include "icsneo/communication/packetizer.h"
+#include "gtest/gtest.h"
+#include <optional>
+
+using namespace icsneo;
+
+class PacketizerTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		packetizer.emplace([this](APIEvent::Type t, APIEvent::Severity s) {
+			errors.push_back(t);
+			(void)s;
+		});
+	}
+
+	static std::vector<uint8_t> ShortPacket(Network::NetID netid, const std::vector<uint8_t>& data) {
+		std::vector<uint8_t> ret = { 0xAA, uint8_t((data.size() << 4) | uint8_t(netid)) };
+		ret.insert(ret.end(), data.begin(), data.end());
+		ret.push_back(Packetizer::ICSChecksum(data));
+		return ret;
+	}
+
+	static std::vector<uint8_t> LongPacket(Network::NetID netid, const std::vector<uint8_t>& data) {
+		const size_t length = data.size() + 6;
+		std::vector<uint8_t> ret = { 0xAA, 0x00, uint8_t(length), uint8_t(length >> 8), uint8_t(netid), uint8_t(uint16_t(netid) >> 8) };
+		ret.insert(ret.end(), data.begin(), data.end());
+		return ret;
+	}
+
+	static std::vector<uint8_t> DiskDataPacket(const std::vector<uint8_t>& data) {
+		std::vector<uint8_t> ret = { 0xAA, 0xAA, 0xAA, 0x55, 0x55, uint8_t(data.size()), uint8_t(data.size() >> 8) };
+		ret.insert(ret.end(), data.begin(), data.end());
+		if(data.size() % 2 == 0)
+			ret.push_back(0xAA); // Padding, which looks like a header if it isn't dropped
+		return ret;
+	}
+
+	// The stream used by the tests below, with some garbage at the front and between packets
+	static std::vector<uint8_t> MixedStream() {
+		std::vector<uint8_t> stream = { 0x01, 0x02, 0xAA };
+		const auto append = [&stream](const std::vector<uint8_t>& bytes) { stream.insert(stream.end(), bytes.begin(), bytes.end()); };
+		append(ShortPacket(Network::NetID::HSCAN, { 0x11, 0x22, 0x33 }));
+		append(LongPacket(Network::NetID::Ethernet, std::vector<uint8_t>(600, 0x44)));
+		append({ 0x55, 0x66 });
+		append(DiskDataPacket({ 0x77, 0x88 }));
+		append(ShortPacket(Network::NetID::Main51, { 0x99 }));
+		return stream;
+	}
+
+	static void ExpectMixedStream(const std::vector<std::shared_ptr<Packet>>& packets) {
+		ASSERT_EQ(packets.size(), 4u);
+		EXPECT_EQ(packets[0]->network.getNetID(), Network::NetID::HSCAN);
+		EXPECT_EQ(packets[0]->data, std::vector<uint8_t>({ 0x11, 0x22, 0x33 }));
+		EXPECT_EQ(packets[1]->network.getNetID(), Network::NetID::Ethernet);
+		EXPECT_EQ(packets[1]->data, std::vector<uint8_t>(600, 0x44));
+		EXPECT_EQ(packets[2]->network.getNetID(), Network::NetID::DiskData);
+		EXPECT_EQ(packets[2]->data, std::vector<uint8_t>({ 0x77, 0x88 }));
+		EXPECT_EQ(packets[3]->network.getNetID(), Network::NetID::Main51);
+		EXPECT_EQ(packets[3]->data, std::vector<uint8_t>({ 0x99 }));
+	}
+
+	std::optional<Packetizer> packetizer;
+	std::vector<APIEvent::Type> errors;
+};
+
+#endif